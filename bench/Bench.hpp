@@ -0,0 +1,147 @@
+/*
+ * Project Name: synscancontrol
+ * File: Bench.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Minimal benchmark harness, for the host and the ESP32
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <Arduino.h>
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+/* Results are printed as JSON lines, one per benchmark, after a header line
+ * describing the run. On the host times are in ns (steady_clock), on the
+ * ESP32 in CPU cycles (CCOUNT), so runs on different platforms are never
+ * compared by mistake.
+ */
+namespace Bench
+{
+#ifdef ARDUINO
+    static const char *const PLATFORM = "esp32";
+    static const char *const UNIT = "cycles";
+    typedef uint32_t Stamp;
+    inline Stamp IRAM_ATTR now() { return ESP.getCycleCount(); }
+    // Keep single measurements well under the 2^32 cycles (~17 s) wrap-around
+    inline uint64_t IRAM_ATTR elapsed(Stamp start) { return (uint32_t)(ESP.getCycleCount() - start); }
+#else
+    static const char *const PLATFORM = "host";
+    static const char *const UNIT = "ns";
+    typedef std::chrono::steady_clock::time_point Stamp;
+    inline Stamp now() { return std::chrono::steady_clock::now(); }
+    inline uint64_t elapsed(Stamp start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+#endif
+
+    // Sink for results that would otherwise be optimized away
+    extern volatile uint32_t sink;
+
+    // Where the result lines go (stdout / Serial)
+    void emit(const char *line);
+
+    void printHeader(const char *revision);
+    void report(const char *name, uint64_t iterations, double total);
+
+    // Cost of a now() / elapsed() pair, subtract it from individually timed operations
+    double timerOverhead();
+
+    // Blocks timed by run(), the fastest one is reported to filter out noise
+    static const uint32_t REPEATS = 7;
+
+    /* Time `iterations` calls of op() as one block, after an untimed call
+     * to setup() (e.g. to get a state machine back to where it started)
+     */
+    template <typename S, typename F>
+    void run(const char *name, uint32_t iterations, S setup, F op)
+    {
+        setup();
+        for (uint32_t i = 0; i < iterations / 16 + 1; i++)
+            op(); // warm-up (caches, branch predictors)
+        double best = 0.0;
+        for (uint32_t r = 0; r < REPEATS; r++)
+        {
+            setup();
+            Stamp start = now();
+            for (uint32_t i = 0; i < iterations; i++)
+                op();
+            double t = (double)elapsed(start);
+            if (r == 0 || t < best)
+                best = t;
+        }
+        report(name, iterations, best);
+    }
+
+    template <typename F>
+    void run(const char *name, uint32_t iterations, F op)
+    {
+        run(name, iterations, []() {}, op);
+    }
+
+    /* Accumulates individually timed operations, for when each needs its
+     * own setup that shouldn't be counted. Call endRepeat() after each of
+     * the REPEATS passes, the fastest pass is reported.
+     */
+    class Accumulator
+    {
+    public:
+        Accumulator(const char *name, double overhead) : _name(name), _overhead(overhead) {}
+        inline void add(uint64_t t)
+        {
+            _total += (double)t - _overhead;
+            _count++;
+        }
+        void endRepeat()
+        {
+            if (_count && (!_bestCount || _total / _count < _best / _bestCount))
+            {
+                _best = _total > 0.0 ? _total : 0.0;
+                _bestCount = _count;
+            }
+            _total = 0.0;
+            _count = 0;
+        }
+        void report() const
+        {
+            if (_bestCount)
+                Bench::report(_name, _bestCount, _best);
+        }
+
+    private:
+        const char *_name;
+        double _overhead;
+        double _total = 0.0;
+        uint64_t _count = 0;
+        double _best = 0.0;
+        uint64_t _bestCount = 0;
+    };
+
+    // All the benchmarks, in Benchmarks.cpp
+    void runAll();
+} // namespace Bench
+
+#endif /* BENCH_H */
@@ -0,0 +1,499 @@
+/*
+ * Project Name: synscancontrol
+ * File: Benchmarks.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Benchmarks of the per-tick and per-command hot paths
+ */
+#include <Arduino.h>
+#include <math.h>
+
+#include <sstream>
+
+#include "Bench.hpp"
+#include "CelestialTransform.hpp"
+#include "Command.hpp"
+#include "CommandHandler.hpp"
+#include "Constants.hpp"
+#include "EphemerisTable.hpp"
+#include "GotoPlanner.hpp"
+#include "HorizonMask.hpp"
+#include "InterruptStepper.hpp"
+#include "IsrProfiler.hpp"
+#include "Logger.hpp"
+#include "Motor.hpp"
+#include "PecTable.hpp"
+#include "PointingModel.hpp"
+#include "PolarScopeLED.hpp"
+#include "Reply.hpp"
+#include "Sgp4.hpp"
+#include "StepSegments.hpp"
+#include "TraceRecorder.hpp"
+
+using namespace SynScanControl;
+
+namespace
+{
+    /* Logs nowhere, but counts as a handler so messages get queued */
+    class NullLoggerHandler : public LoggerHandler
+    {
+    public:
+        void log(const LogRecord &record) override { Bench::sink += record.length; }
+    };
+
+    // One frame for every CommandEnum, as received (without the trailing '\r')
+    const char *const FRAMES[] = {
+        ":E1000080", ":F1", ":G110", ":S1000080", ":H1001000", ":M1001000", ":I17E0100", ":J1", ":K1",
+        ":L1", ":O11", ":P12", ":V180", ":a1", ":b1", ":h1", ":i1", ":j1", ":f1", ":g1", ":D1", ":d1",
+        ":e1", ":s1", ":q1010000", ":Z10100"};
+
+    // Allocated on the heap, the trace recorder alone is too big for the ESP32's loop task stack
+    struct Fixture
+    {
+        Logger logger;
+        IsrProfiler isrProfiler;
+        TraceRecorder trace;
+        Motor raMotor;
+        Motor decMotor;
+        PolarScopeLED polarScopeLED;
+        ClockCalibration clockCalibration;
+        HorizonMask horizonMask;
+        GotoController gotoController;
+        CommandHandler cmdHandler;
+
+        Fixture()
+            : raMotor(AxisEnum::AXIS_RA, RA_M0, RA_M1, RA_M2, RA_STEP, RA_DIR, 0x800000, false, &trace, &logger),
+              decMotor(AxisEnum::AXIS_DEC, DEC_M0, DEC_M1, DEC_M2, DEC_STEP, DEC_DIR, 0x913640, true, &trace, &logger),
+              polarScopeLED(SCOPE_LED, SCOPE_LED_PWM, &logger),
+              clockCalibration(&raMotor, &decMotor, &logger),
+              horizonMask(&raMotor, &decMotor, &logger),
+              gotoController(&raMotor, &decMotor, &clockCalibration, &horizonMask, &logger),
+              cmdHandler(nullptr, &raMotor, &decMotor, &polarScopeLED, &isrProfiler, &trace, &clockCalibration, &gotoController, &logger)
+        {
+            raMotor.begin();
+            decMotor.begin();
+        }
+    };
+
+    void startMotion(Motor *motor, SlewTypeEnum type, SlewSpeedEnum speed, uint32_t stepPeriod)
+    {
+        motor->setSlewType(type);
+        motor->setSlewSpeed(speed);
+        motor->setSlewDir(SlewDirectionEnum::CW);
+        motor->setStepPeriod(stepPeriod);
+        motor->setTargetPosition(motor->getPosition() + MICROSTEPS_PER_REV / 4);
+        motor->setMotion(true);
+    }
+
+    // Every timed block starts from a fresh motor, freshly set in motion
+    void benchMotorTick(const char *name, SlewTypeEnum type, SlewSpeedEnum speed, uint32_t stepPeriod, float accel = MOTOR_ACCEL,
+                        bool pec = false, bool limits = false, bool gears = false)
+    {
+        Fixture *f = nullptr;
+        Bench::run(
+            name, 200000, [&f, type, speed, stepPeriod, accel, pec, limits, gears]()
+            {
+                delete f;
+                f = new Fixture();
+                f->raMotor.setRampLimits(accel, MAX_PULSE_PER_SECOND / 2);
+                // Far enough not to be reached, every step is checked against them
+                if (limits)
+                    f->raMotor.setLimits(0x800000 - MICROSTEPS_PER_REV / 3, 0x800000 + MICROSTEPS_PER_REV / 3);
+                if (gears)
+                    f->raMotor.setGearShift(true, DEFAULT_GEAR_SHIFT_SPEED);
+                if (pec)
+                {
+                    PecTable *table = f->raMotor.getPecTable();
+                    for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+                        table->setEntry(i, (int32_t)(300 * sin(2 * M_PI * i / PecTable::NUM_BINS)));
+                    table->setEnabled(true);
+                }
+                if (type != SlewTypeEnum::NONE)
+                    startMotion(&f->raMotor, type, speed, stepPeriod); },
+            [&f]()
+            { f->raMotor.tick(); });
+        delete f;
+    }
+
+    void benchMotorTick()
+    {
+        benchMotorTick("motor_tick_idle", SlewTypeEnum::NONE, SlewSpeedEnum::NONE, 0);
+        // Sidereal rate, a step every ~382 ticks
+        benchMotorTick("motor_tick_tracking", SlewTypeEnum::TRACKING, SlewSpeedEnum::SLOW, (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5));
+        // Same, following a PEC table
+        benchMotorTick("motor_tick_tracking_pec", SlewTypeEnum::TRACKING, SlewSpeedEnum::SLOW, (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5), MOTOR_ACCEL, true);
+        // Slow slew, a step every 6 ticks
+        benchMotorTick("motor_tick_slew_slow", SlewTypeEnum::TRACKING, SlewSpeedEnum::SLOW, 6);
+        // Fast GOTO, accelerating then at max speed
+        benchMotorTick("motor_tick_goto_fast", SlewTypeEnum::GOTO, SlewSpeedEnum::FAST, 6);
+        // Worst case: a step (and ramp update) every other tick from the start
+        benchMotorTick("motor_tick_goto_max_rate", SlewTypeEnum::GOTO, SlewSpeedEnum::FAST, 6, 1e6f);
+        // Same, with soft limits
+        benchMotorTick("motor_tick_goto_max_rate_limits", SlewTypeEnum::GOTO, SlewSpeedEnum::FAST, 6, 1e6f, false, true);
+        // Fast GOTO shifting gears on the way up (as motor_tick_goto_fast otherwise)
+        benchMotorTick("motor_tick_goto_gear_shifting", SlewTypeEnum::GOTO, SlewSpeedEnum::FAST, 6, MOTOR_ACCEL, false, false, true);
+    }
+
+    void benchComputeNewSpeed()
+    {
+        const double overhead = Bench::timerOverhead();
+        Bench::Accumulator accel("stepper_compute_new_speed_accel", overhead);
+        Bench::Accumulator cruise("stepper_compute_new_speed_cruise", overhead);
+        Bench::Accumulator decel("stepper_compute_new_speed_decel", overhead);
+
+        // A full trapezoidal profile: 40000 steps at the firmware's ramp limits
+        const float maxSpeed = MAX_PULSE_PER_SECOND / 2;
+        for (uint32_t r = 0; r < Bench::REPEATS; r++)
+        {
+            InterruptStepper stepper(RA_STEP, RA_DIR, MAX_PULSE_PER_SECOND, false);
+            stepper.setAcceleration(MOTOR_ACCEL);
+            stepper.setMaxSpeed(maxSpeed);
+            stepper.initPosition(0);
+            stepper.setTargetPosition(40000);
+            stepper.computeNewSpeed();
+            while (stepper.isRunning())
+            {
+                int32_t n = stepper.getN();
+                bool cruising = fabs(stepper.getSpeed()) >= maxSpeed * 0.999f;
+                stepper.run();
+
+                Bench::Stamp start = Bench::now();
+                stepper.computeNewSpeed();
+                uint64_t t = Bench::elapsed(start);
+
+                if (n < 0)
+                    decel.add(t);
+                else if (cruising)
+                    cruise.add(t);
+                else
+                    accel.add(t);
+            }
+            accel.endRepeat();
+            cruise.endRepeat();
+            decel.endRepeat();
+        }
+        accel.report();
+        cruise.report();
+        decel.report();
+    }
+
+    // RMT refills: half a memory block of items, planned off the same 40000 step profile
+    void benchStepSegments()
+    {
+        const double overhead = Bench::timerOverhead();
+        Bench::Accumulator refill("rmt_refill_half_block", overhead);
+        for (uint32_t r = 0; r < Bench::REPEATS; r++)
+        {
+            InterruptStepper stepper(RA_STEP, RA_DIR, MAX_PULSE_PER_SECOND, false);
+            stepper.setAcceleration(MOTOR_ACCEL);
+            stepper.setMaxSpeed(MAX_PULSE_PER_SECOND / 2);
+            stepper.initPosition(0);
+            stepper.setTargetPosition(40000);
+            StepPlanner planner;
+            StepEncoder encoder;
+            planner.begin(&stepper);
+            encoder.reset();
+
+            RmtItem items[32];
+            uint32_t count = 32;
+            while (count == 32)
+            {
+                Bench::Stamp start = Bench::now();
+                count = encoder.fill(items, 32);
+                StepSegment segment;
+                while (count < 32 && planner.next(&segment))
+                {
+                    encoder.load(segment);
+                    count += encoder.fill(items + count, 32 - count);
+                }
+                uint64_t t = Bench::elapsed(start);
+                refill.add(t);
+                Bench::sink += items[0].duration0;
+            }
+            refill.endRepeat();
+        }
+        refill.report();
+    }
+
+    void benchCommandParse()
+    {
+        char name[48];
+        for (const char *frame : FRAMES)
+        {
+            uint16_t len = strlen(frame);
+            snprintf(name, sizeof(name), "command_parse_%c", frame[1]);
+            Bench::run(name, 100000, [frame, len]()
+                       {
+                           Command *cmd = CommandFactory::parse(frame, len);
+                           if (cmd)
+                           {
+                               Bench::sink += cmd->parse(frame, len);
+                               delete cmd;
+                           } });
+        }
+    }
+
+    void benchProcessCommand()
+    {
+        char name[48];
+        for (const char *frame : FRAMES)
+        {
+            // Fresh motors for every command, so the state doesn't build up
+            uint16_t len = strlen(frame);
+            Command *cmd = CommandFactory::parse(frame, len);
+            if (!cmd || !cmd->parse(frame, len))
+            {
+                delete cmd;
+                continue;
+            }
+            Fixture *f = new Fixture();
+            snprintf(name, sizeof(name), "process_command_%c", frame[1]);
+            Bench::run(name, 100000, [&f, cmd]()
+                       {
+                           Reply *reply = f->cmdHandler.processCommand(cmd);
+                           Bench::sink += (reply != nullptr);
+                           delete reply; });
+            delete cmd;
+            delete f;
+        }
+    }
+
+    template <typename R>
+    void benchReply(const char *name, R *reply)
+    {
+        Bench::run(name, 100000, [reply]()
+                   {
+                       std::ostringstream out;
+                       reply->toStringStream(&out);
+                       Bench::sink += out.str().size(); });
+        delete reply;
+    }
+
+    void benchReplies()
+    {
+        benchReply("reply_empty", new EmptyReply());
+        benchReply("reply_error", new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR));
+
+        PositionReply *position = new PositionReply();
+        position->setData(0x8A1234, 6);
+        benchReply("reply_position", position);
+
+        DataReply *data = new DataReply();
+        data->setData(MICROSTEPS_PER_REV, 6);
+        benchReply("reply_data", data);
+
+        VersionReply *version = new VersionReply();
+        version->setVersion(3, 2, 1, 0);
+        benchReply("reply_version", version);
+
+        StatusReply *status = new StatusReply();
+        status->setRunning(true);
+        status->setSlewMode(SlewTypeEnum::TRACKING);
+        benchReply("reply_status", status);
+
+        benchReply("reply_extended_status", new ExtendedStatusReply());
+    }
+
+    void benchLogger()
+    {
+        const uint32_t BATCH = Logger::RING_SIZE / 2;
+        const uint32_t BATCHES = 2000;
+        const double overhead = Bench::timerOverhead();
+
+        Logger *logger = new Logger();
+        NullLoggerHandler handler;
+        logger->addHandler(&handler);
+
+        Bench::Accumulator ints("logger_log_ints", overhead / BATCH);
+        Bench::Accumulator str("logger_log_string", overhead / BATCH);
+        Bench::Accumulator flt("logger_log_float", overhead / BATCH);
+        for (uint32_t b = 0; b < BATCHES * Bench::REPEATS; b++)
+        {
+            // Only the enqueue is timed, the ring is drained between batches
+            Bench::Stamp start = Bench::now();
+            for (uint32_t i = 0; i < BATCH; i++)
+                logger->debug(LogMsg::MOTOR_SET_TARGET, 1, 0x800000u + i);
+            uint64_t t = Bench::elapsed(start);
+            for (uint32_t i = 0; i < BATCH; i++)
+                ints.add(t / BATCH);
+            logger->drain();
+
+            start = Bench::now();
+            for (uint32_t i = 0; i < BATCH; i++)
+                logger->debug(LogMsg::CMD_RECEIVED, ":j1");
+            t = Bench::elapsed(start);
+            for (uint32_t i = 0; i < BATCH; i++)
+                str.add(t / BATCH);
+            logger->drain();
+
+            start = Bench::now();
+            for (uint32_t i = 0; i < BATCH; i++)
+                logger->debug(LogMsg::MOTOR_STOPPING, 1, 1234.5f, (int32_t)i);
+            t = Bench::elapsed(start);
+            for (uint32_t i = 0; i < BATCH; i++)
+                flt.add(t / BATCH);
+            logger->drain();
+
+            if ((b + 1) % BATCHES == 0)
+            {
+                ints.endRepeat();
+                str.endRepeat();
+                flt.endRepeat();
+            }
+        }
+        ints.report();
+        str.report();
+        flt.report();
+
+        // Below the runtime level: the cost every disabled debug() call pays
+        logger->setLevel(LoggingLevel::LOG_INFO);
+        Bench::run("logger_log_filtered", 200000, [logger]()
+                   { logger->debug(LogMsg::MOTOR_SET_TARGET, 1, 0x800000u); });
+        delete logger;
+    }
+
+    // What a GOTO_RADEC costs on top of the command: sidereal time, then RA / Dec to both axis positions
+    void benchCelestialTransform()
+    {
+        static int64_t ms = 845000000000LL;
+        Bench::run("celestial_sidereal_time", 100000, []()
+                   { Bench::sink += CelestialTransform::siderealTime(ms += 997); });
+
+        static uint32_t ra = 0;
+        Bench::run("celestial_radec_to_axes", 100000, []()
+                   {
+                       int32_t raAxis = 0;
+                       int32_t decAxis = 0;
+                       uint32_t lst = CelestialTransform::siderealTime(ms += 997);
+                       ra += 0x9E3779B9;
+                       CelestialTransform::toAxes((int32_t)(lst - ra), (int32_t)ra >> 2, PierSideEnum::AUTO, false, &raAxis, &decAxis);
+                       Bench::sink += CelestialTransform::toPosition(raAxis) + CelestialTransform::toPosition(decAxis); });
+    }
+
+    // Refitting the pointing model with a full set of alignment stars
+    void benchPointingModel()
+    {
+        static PointingModel model;
+        uint32_t seed = 1;
+        for (uint32_t i = 0; i < PointingModel::MAX_STARS; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            int32_t ha = (int32_t)(seed >> 1) - 0x40000000;
+            int32_t dec = (int32_t)(seed % 0x471C71C7) - 0x0E38E38E; // -20 to 80 degrees
+            model.addStar(ha, dec, ha + 400000, dec - 250000, (ha >= 0) ? PierSideEnum::EAST : PierSideEnum::WEST);
+        }
+        Bench::run("pointing_model_fit_50", 200, []()
+                   { Bench::sink += model.fit(); });
+        Bench::run("pointing_model_apply", 100000, []()
+                   {
+                       int32_t ha = 0;
+                       int32_t dec = 0;
+                       model.apply((int32_t)Bench::sink << 8, 0x1C71C71C, PierSideEnum::EAST, &ha, &dec);
+                       Bench::sink += ha + dec; });
+    }
+
+    // Satellite following: one propagation per update (SATELLITE_UPDATE_MS), and loading a TLE
+    void benchSgp4()
+    {
+        static const char *line1 = "1 25544U 98067A   26290.50000000  .00016717  00000-0  10270-3 0  9999";
+        static const char *line2 = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.50103472 47750";
+        static Sgp4 sgp4;
+        sgp4.parse(line1, line2);
+        Bench::run("sgp4_parse", 20000, []()
+                   { Bench::sink += sgp4.parse(line1, line2); });
+
+        static double minutes = 0.0;
+        Bench::run("sgp4_propagate", 100000, []()
+                   {
+                       double r[3];
+                       double v[3];
+                       sgp4.propagate(minutes += SATELLITE_UPDATE_MS / 60000.0, r, v);
+                       Bench::sink += (uint32_t)r[0]; });
+    }
+
+    // Ephemeris following: one interpolation per update, in a full table
+    void benchEphemeris()
+    {
+        static EphemerisTable table;
+        table.start(EphemerisKindEnum::RADEC, 0, 600000);
+        for (uint32_t i = 0; i < EphemerisTable::MAX_POINTS; i++)
+            table.append((int32_t)(i * 1193046), (int32_t)(238609294 - i * 119305));
+        static int64_t ms = 0;
+        Bench::run("ephemeris_interpolate", 100000, []()
+                   {
+                       int32_t a = 0;
+                       int32_t b = 0;
+                       ms = (ms + SATELLITE_UPDATE_MS) % 37800000;
+                       table.at(ms, &a, &b);
+                       Bench::sink += a + b; });
+    }
+
+    // GOTO planning: the direction and estimate on each :J, with the RA axis limited
+    void benchGotoPlanner()
+    {
+        static uint32_t target = 0x800000;
+        Bench::run("goto_planner_shortest_way", 100000, []()
+                   {
+                       SlewDirectionEnum dir = SlewDirectionEnum::NONE;
+                       uint32_t distance = 0;
+                       target = 0x800000 + (target * 1664525 + 1013904223) % 3000000 - 1500000;
+                       GotoPlanner::shortestWay(0x800000 + 750000, target, true, 0x800000 - 1692000, 0x800000 + 1692000,
+                                                &dir, &distance);
+                       Bench::sink += (uint32_t)GotoPlanner::slewSeconds(distance, true) + (uint32_t)dir; });
+    }
+
+    // Horizon mask: compiling the table (loop), and the check the tick ISR makes every HORIZON_CHECK_TICKS
+    void benchHorizonMask()
+    {
+        static Fixture *f = new Fixture();
+        HorizonMask *mask = &f->horizonMask;
+        for (uint32_t i = 0; i < HorizonMask::NUM_POINTS; i++)
+            mask->setPoint(i, 15);
+        mask->setEnabled(true);
+        Bench::run("horizon_mask_compile", 20, []()
+                   {
+                       f->horizonMask.setLatitude((int32_t)(Bench::sink % 2 ? 0x24FA4FA5 : 0x24FA4FA4)); // 52 degrees
+                       f->horizonMask.longTick();
+                       Bench::sink += f->horizonMask.isActive(); });
+        startMotion(&f->raMotor, SlewTypeEnum::GOTO, SlewSpeedEnum::FAST, 6);
+        startMotion(&f->decMotor, SlewTypeEnum::GOTO, SlewSpeedEnum::FAST, 6);
+        Bench::run("horizon_mask_check", 100000, []()
+                   {
+                       f->horizonMask.check();
+                       Bench::sink += f->raMotor.getLimitStop() == LimitStopEnum::NONE; });
+        delete f;
+    }
+} // namespace
+
+void Bench::runAll()
+{
+    benchMotorTick();
+    benchComputeNewSpeed();
+    benchStepSegments();
+    benchCommandParse();
+    benchProcessCommand();
+    benchReplies();
+    benchLogger();
+    benchCelestialTransform();
+    benchPointingModel();
+    benchSgp4();
+    benchEphemeris();
+    benchGotoPlanner();
+    benchHorizonMask();
+}
@@ -0,0 +1,116 @@
+/*
+ * Project Name: synscancontrol
+ * File: main.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Entry points of the benchmark suite, for the host and the ESP32
+ */
+#include <Arduino.h>
+
+#include "Bench.hpp"
+
+#ifndef BENCH_REVISION
+#define BENCH_REVISION "unknown"
+#endif
+
+volatile uint32_t Bench::sink = 0;
+
+double Bench::timerOverhead()
+{
+    double best = 1e18;
+    for (int i = 0; i < 1000; i++)
+    {
+        Stamp start = now();
+        double t = (double)elapsed(start);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+void Bench::printHeader(const char *revision)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "{\"suite\": \"synscancontrol\", \"platform\": \"%s\", \"unit\": \"%s\", \"revision\": \"%s\"}",
+             PLATFORM, UNIT, revision);
+    emit(line);
+}
+
+void Bench::report(const char *name, uint64_t iterations, double total)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "{\"name\": \"%s\", \"iterations\": %llu, \"per_op\": %.2f, \"unit\": \"%s\"}",
+             name, (unsigned long long)iterations, total / (double)iterations, UNIT);
+    emit(line);
+}
+
+#ifdef ARDUINO
+
+void Bench::emit(const char *line)
+{
+    Serial.println(line);
+}
+
+void setup()
+{
+    setCpuFrequencyMhz(240);
+    Serial.begin(115200);
+    delay(2000);
+    Bench::printHeader(BENCH_REVISION);
+    Bench::runAll();
+    Serial.println("{\"done\": true}");
+}
+
+void loop()
+{
+    delay(1000);
+}
+
+#else
+
+#include <string.h>
+
+static FILE *_out = stdout;
+
+void Bench::emit(const char *line)
+{
+    fputs(line, _out);
+    fputc('\n', _out);
+}
+
+// Usage: synscanbench [output.jsonl] (default stdout)
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "-") != 0)
+    {
+        _out = fopen(argv[1], "w");
+        if (!_out)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+    Bench::printHeader(BENCH_REVISION);
+    Bench::runAll();
+    if (_out != stdout)
+        fclose(_out);
+    return 0;
+}
+
+#endif
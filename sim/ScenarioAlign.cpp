@@ -0,0 +1,341 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioAlign.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: multi-star alignment against a mount with known pointing errors
+ */
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+#include <Preferences.h>
+
+#include "CelestialTransform.hpp"
+#include "LeastSquares.hpp"
+#include "PointingModel.hpp"
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+#include "SkyReference.hpp"
+
+using namespace Sim;
+using SkyReference::wrap;
+
+static const double Q32_PER_DEGREE = 4294967296.0 / 360.0;
+static const double DEGREES_PER_UNIT = 360.0 / MICROSTEPS_PER_REV;
+static const char *const TERM_NAMES[] = {"IH", "ID", "CH", "NP", "MA", "ME"};
+
+// The mount's actual errors, arcsec: a few arcmin of polar misalignment, smaller mechanical errors
+static const double TRUE_TERMS[PointingModel::NUM_TERMS] = {120.0, -80.0, 45.0, -30.0, 300.0, -150.0};
+
+static const double LATITUDE = 52.0;
+static const double LONGITUDE = 5.0;
+
+// A random hour angle / Dec at least 20 degrees up
+template <typename Rng>
+static void randomStar(Rng &rng, double *ha, double *dec)
+{
+    std::uniform_real_distribution<double> haDist(-90.0, 90.0);
+    std::uniform_real_distribution<double> decDist(-20.0, 85.0);
+    const double rad = M_PI / 180.0;
+    do
+    {
+        *ha = haDist(rng);
+        *dec = decDist(rng);
+    } while (sin(LATITUDE * rad) * sin(*dec * rad) + cos(LATITUDE * rad) * cos(*dec * rad) * cos(*ha * rad) <
+             sin(20.0 * rad));
+}
+
+/* The fit on its own: synthetic stars with centering noise, the
+ * firmware's single precision fit against the same normal equations in
+ * double, and the time a refit takes on the host.
+ */
+static bool checkSolver(uint32_t stars, double noise)
+{
+    std::mt19937 rng(3);
+    std::normal_distribution<double> jitter(0.0, noise);
+    PointingModel model;
+    LeastSquares<double, PointingModel::NUM_TERMS> reference;
+    const double rad = M_PI / 180.0;
+    for (uint32_t i = 0; i < stars; i++)
+    {
+        double ha = 0.0;
+        double dec = 0.0;
+        randomStar(rng, &ha, &dec);
+        bool east = ha >= 0.0;
+        double dHa = 0.0;
+        double dDec = 0.0;
+        SkyReference::modelOffsets(TRUE_TERMS, ha, dec, east, &dHa, &dDec);
+        dHa += jitter(rng) / 3600.0 / cos(dec * rad);
+        dDec += jitter(rng) / 3600.0;
+        model.addStar((int32_t)llround(ha * Q32_PER_DEGREE), (int32_t)llround(dec * Q32_PER_DEGREE),
+                      (int32_t)llround((ha + dHa) * Q32_PER_DEGREE), (int32_t)llround((dec + dDec) * Q32_PER_DEGREE),
+                      east ? PierSideEnum::EAST : PierSideEnum::WEST);
+
+        double p = east ? 1.0 : -1.0;
+        double h = ha * rad;
+        double d = dec * rad;
+        const double haRow[] = {cos(d), 0.0, p, p * sin(d), -cos(h) * sin(d), sin(h) * sin(d)};
+        const double decRow[] = {0.0, p, 0.0, 0.0, sin(h), cos(h)};
+        reference.add(haRow, dHa * 3600.0 * cos(d));
+        reference.add(decRow, dDec * 3600.0);
+    }
+
+    double expected[PointingModel::NUM_TERMS];
+    if (!model.fit() || !reference.solve(expected, nullptr, 0.0))
+        return false;
+
+    const uint32_t loops = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; i++)
+        model.fit();
+    double us = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e6 / loops;
+
+    printf("Solver, %u stars with %.1f\" noise, %.1f us per fit on the host:\n", stars, noise, us);
+    printf("%-4s %10s %12s %12s %12s\n", "term", "true \"", "double \"", "float \"", "diff \"");
+    double worst = 0.0;
+    for (uint32_t i = 0; i < PointingModel::NUM_TERMS; i++)
+    {
+        double fitted = model.getTerm((PointingModel::Term)i);
+        printf("%-4s %10.2f %12.3f %12.3f %12.4f\n", TERM_NAMES[i], TRUE_TERMS[i], expected[i], fitted,
+               fitted - expected[i]);
+        worst = fmax(worst, fabs(fitted - expected[i]));
+    }
+    printf("RMS residual %.2f\"\n", model.getRms());
+    return worst < 0.05;
+}
+
+/* The mount: the axes read the model's offsets from where the telescope
+ * actually points. Hour angle / Dec the telescope looks at, from the
+ * axis positions.
+ */
+static void truePointing(SimMount *mount, double *ha, double *dec, bool *east)
+{
+    double mountHa = 0.0;
+    double mountDec = 0.0;
+    SkyReference::fromAxes(wrap((int32_t)(mount->getMotor(AxisEnum::AXIS_RA)->getPosition() - 0x800000) * DEGREES_PER_UNIT),
+                           wrap((int32_t)(mount->getMotor(AxisEnum::AXIS_DEC)->getPosition() - 0x800000) * DEGREES_PER_UNIT),
+                           &mountHa, &mountDec, east);
+    *ha = mountHa;
+    *dec = mountDec;
+    for (int i = 0; i < 5; i++)
+    {
+        double dHa = 0.0;
+        double dDec = 0.0;
+        SkyReference::modelOffsets(TRUE_TERMS, *ha, *dec, *east, &dHa, &dDec);
+        *ha = wrap(mountHa - dHa);
+        *dec = mountDec - dDec;
+    }
+}
+
+struct Session
+{
+    SimMount mount;
+    int64_t unixMs;
+    uint64_t timeSent;
+
+    // ms since J2000 and the local sidereal time (degrees) at the sim's time
+    int64_t now() const
+    {
+        return unixMs - CelestialTransform::J2000_UNIX_MS + (int64_t)((Sim::now() - timeSent) / 1000);
+    }
+    double lst() const { return wrap(SkyReference::siderealTime(now()) + LONGITUDE); }
+
+    static std::string angle(double degrees)
+    {
+        return SimMount::toHex((uint32_t)llround(degrees / 360.0 * 16777216.0) & 0xFFFFFF);
+    }
+
+    bool begin()
+    {
+        mount.begin();
+        unixMs = 1792360800000LL; // 2026-10-18 20:00 UTC
+        std::string reply;
+        uint32_t days = (uint32_t)(unixMs / 86400000);
+        uint32_t msOfDay = (uint32_t)(unixMs % 86400000);
+        if (!mount.command(":F3", &reply) || !mount.command(":Z112" + angle(LATITUDE) + angle(LONGITUDE), &reply) ||
+            reply != "=")
+            return false;
+        timeSent = Sim::now();
+        return mount.command(":Z113" + SimMount::toHex(days).substr(0, 4) + SimMount::toHex(msOfDay / 1000) +
+                                 SimMount::toHex(msOfDay % 1000).substr(0, 4),
+                             &reply) &&
+               reply == "=";
+    }
+
+    // GOTO_RADEC to what is at this hour angle now, until tracking
+    bool gotoStar(double ha, double dec, double *ra)
+    {
+        *ra = wrap(lst() - ha);
+        uint32_t side = 0;
+        if (!mount.query(":Z114" + angle(*ra < 0 ? *ra + 360.0 : *ra) + angle(dec), &side))
+            return false;
+        uint32_t active = 1;
+        while (active)
+        {
+            mount.runFor(100000);
+            if (!mount.query(":Z11504", &active))
+                return false;
+        }
+        return true;
+    }
+
+    // Slow GOTO of one axis with the SynScan commands, as a hand controller would to center a star
+    bool moveAxis(char axis, uint32_t target)
+    {
+        Motor *motor = mount.getMotor(axis == '1' ? AxisEnum::AXIS_RA : AxisEnum::AXIS_DEC);
+        int32_t distance = (int32_t)(target - motor->getPosition());
+        if (distance == 0)
+            return true;
+        std::string reply;
+        std::string a(1, axis);
+        return mount.command(":G" + a + (distance > 0 ? "20" : "21"), &reply) && reply == "=" &&
+               mount.command(":S" + a + SimMount::toHex(target), &reply) && reply == "=" &&
+               mount.command(":J" + a, &reply) && reply == "=";
+    }
+
+    /* Center the star (RA / Dec) on the axes by hand, ADD_ALIGNMENT_STAR
+     * at the time the axes were aimed for, the stars the model has.
+     */
+    bool center(double ra, double dec, uint32_t *count)
+    {
+        std::string reply;
+        if (!mount.command(":K1", &reply))
+            return false;
+        mount.runFor(200000);
+
+        uint64_t at = Sim::now() + 3000000;
+        int64_t atMs = now() + 3000;
+        double ha = wrap(SkyReference::siderealTime(atMs) + LONGITUDE - ra);
+        double unused = 0.0;
+        bool east = true;
+        truePointing(&mount, &unused, &unused, &east);
+        double dHa = 0.0;
+        double dDec = 0.0;
+        SkyReference::modelOffsets(TRUE_TERMS, ha, dec, east, &dHa, &dDec);
+        double raAxis = 0.0;
+        double decAxis = 0.0;
+        SkyReference::toAxes(ha + dHa, dec + dDec, east, false, &raAxis, &decAxis);
+        if (!moveAxis('1', 0x800000 + (int32_t)llround(raAxis / DEGREES_PER_UNIT)) ||
+            !moveAxis('2', 0x800000 + (int32_t)llround(decAxis / DEGREES_PER_UNIT)))
+            return false;
+        while (Sim::now() < at)
+            mount.runFor(1000);
+        if (mount.getMotor(AxisEnum::AXIS_RA)->isMoving() || mount.getMotor(AxisEnum::AXIS_DEC)->isMoving())
+            return false;
+
+        return mount.query(":Z116" + angle(ra < 0 ? ra + 360.0 : ra) + angle(dec), count);
+    }
+
+    // GOTO the test stars, on-sky error once tracking
+    bool test(uint32_t count, double *mean, double *worst)
+    {
+        std::mt19937 rng(11);
+        *mean = 0.0;
+        *worst = 0.0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            double ha = 0.0;
+            double dec = 0.0;
+            double ra = 0.0;
+            randomStar(rng, &ha, &dec);
+            if (!gotoStar(ha, dec, &ra))
+                return false;
+            double pointingHa = 0.0;
+            double pointingDec = 0.0;
+            bool east = true;
+            truePointing(&mount, &pointingHa, &pointingDec, &east);
+            double error = SkyReference::separation(pointingHa, pointingDec, wrap(lst() - ra), dec);
+            *mean += error / count;
+            *worst = fmax(*worst, error);
+        }
+        return true;
+    }
+};
+
+/* Usage: align [alignment stars] [test stars] */
+int Sim::scenarioAlign(int argc, char **argv)
+{
+    uint32_t stars = argc > 0 ? (uint32_t)atoi(argv[0]) : 12;
+    uint32_t tests = argc > 1 ? (uint32_t)atoi(argv[1]) : 10;
+    if (stars == 0 || stars > PointingModel::MAX_STARS)
+        return 1;
+
+    bool ok = checkSolver(PointingModel::MAX_STARS, 1.0);
+
+    Sim::eraseFlash();
+    Session session;
+    if (!session.begin())
+        return 1;
+    double before = 0.0;
+    double beforeWorst = 0.0;
+    if (!session.test(tests, &before, &beforeWorst))
+        return 1;
+
+    std::mt19937 rng(5);
+    for (uint32_t i = 0; i < stars; i++)
+    {
+        double ha = 0.0;
+        double dec = 0.0;
+        double ra = 0.0;
+        randomStar(rng, &ha, &dec);
+        uint32_t count = 0;
+        if (!session.gotoStar(ha, dec, &ra) || !session.center(ra, dec, &count))
+            return 1;
+    }
+
+    printf("\nMount, %u alignment stars:\n%-4s %10s %10s\n", stars, "term", "true \"", "fitted \"");
+    for (uint32_t i = 0; i < PointingModel::NUM_TERMS; i++)
+    {
+        uint32_t raw = 0;
+        if (!session.mount.query(":Z118" + SimMount::toHex(i).substr(0, 2), &raw))
+            return 1;
+        printf("%-4s %10.1f %10.1f\n", TERM_NAMES[i], TRUE_TERMS[i], ((int32_t)(raw << 8) >> 8) / 10.0);
+    }
+    uint32_t rms = 0;
+    if (!session.mount.query(":Z11807", &rms))
+        return 1;
+    printf("RMS residual %.1f\"\n", rms / 10.0);
+
+    double after = 0.0;
+    double afterWorst = 0.0;
+    if (!session.test(tests, &after, &afterWorst))
+        return 1;
+    printf("\n%u test GOTOs, on-sky error: without a model mean %.1f\" / max %.1f\", with the model mean %.2f\" / max %.2f\"\n",
+           tests, before, beforeWorst, after, afterWorst);
+
+    // Reboot and add one more star, it refits from the stars kept in flash as well
+    Session rebooted;
+    double ha = 0.0;
+    double dec = 0.0;
+    double ra = 0.0;
+    randomStar(rng, &ha, &dec);
+    uint32_t count = 0;
+    if (!rebooted.begin() || !rebooted.gotoStar(ha, dec, &ra) || !rebooted.center(ra, dec, &count))
+        return 1;
+    double reboot = 0.0;
+    double rebootWorst = 0.0;
+    if (!rebooted.test(tests, &reboot, &rebootWorst))
+        return 1;
+    printf("After a reboot and one more star (%u kept): mean %.2f\" / max %.2f\"\n", count, reboot, rebootWorst);
+    return (ok && afterWorst < 3.0 && count == stars + 1 && rebootWorst < 3.0) ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioBacklash.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Guiding / GOTO / tracking start against a gear train with backlash
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Preferences.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+
+/* Gears with some play: the output only follows the motor once the
+ * motor has crossed the gap, then it is pushed along. Positions in
+ * SynScan position units.
+ */
+struct BacklashGear
+{
+    double gap;
+    double motor;
+    double output;
+
+    // Loaded in the CW direction
+    void reset(double backlash)
+    {
+        gap = backlash;
+        motor = 0.0;
+        output = -gap / 2.0;
+    }
+
+    void drive(double increment)
+    {
+        motor += increment;
+        if (motor - output > gap / 2.0)
+            output = motor - gap / 2.0;
+        else if (output - motor > gap / 2.0)
+            output = motor + gap / 2.0;
+    }
+};
+
+struct BacklashResult
+{
+    double guideDeadMs;    // mean over the reversing pulses
+    double guideShortfall; // mean correction missing at the output, in arcsec
+    double gotoSpread;     // pointing offset, max - min over GOTOs from either side, in arcsec
+    double trackDeadMs;    // tracking start after a GOTO the other way
+};
+
+static bool waitStopped(SimMount &mount, char axis)
+{
+    std::string reply;
+    uint64_t start = Sim::now();
+    while (Sim::now() - start < 600000000ULL)
+    {
+        if (!mount.command(std::string(":f") + axis, &reply) || reply.size() != 4)
+            return false;
+        if (!(charToHex(reply[2]) & 0x01))
+            return true;
+        mount.runFor(50000);
+    }
+    return false;
+}
+
+static bool gotoTarget(SimMount &mount, char axis, int32_t offset)
+{
+    uint32_t position = 0;
+    if (!mount.query(std::string(":j") + axis, &position))
+        return false;
+    return mount.expectOk(std::string(":G") + axis + ((offset > 0) ? "00" : "01"), true) &&
+           mount.expectOk(std::string(":S") + axis + SimMount::toHex(position + offset), true) &&
+           mount.expectOk(std::string(":J") + axis, true) && waitStopped(mount, axis);
+}
+
+static bool runBacklash(double backlash, uint32_t firmwareBacklash, bool preload, BacklashResult *result)
+{
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+
+    BacklashGear gears[2];
+    gears[0].reset(backlash);
+    gears[1].reset(backlash);
+    uint64_t moveTime = 0; // first time the output moved the expected way since armed
+    int moveSign = 0;
+    mount.setStepListener([&](AxisEnum axis, int32_t increment)
+                          {
+                              BacklashGear &gear = gears[axis == AxisEnum::AXIS_DEC ? 1 : 0];
+                              double before = gear.output;
+                              gear.drive(increment);
+                              if (moveSign && !moveTime && (gear.output - before) * moveSign > 0)
+                                  moveTime = Sim::now(); });
+    auto arm = [&](int sign)
+    {
+        moveSign = sign;
+        moveTime = 0;
+    };
+
+    if (!mount.expectOk(":F3", true) ||
+        !mount.expectOk(":Z10B" + SimMount::toHex(firmwareBacklash) + (preload ? "01" : "00"), true) ||
+        !mount.expectOk(":Z20B" + SimMount::toHex(firmwareBacklash) + "00", true))
+        return false;
+
+    // DEC guiding: alternating 3 s pulses at 1x, the first one only loads the gears
+    const uint32_t pulseMs = 3000;
+    const double commanded = pulseMs / 1000.0 * SIDEREAL_SPEED_ARCSEC;
+    double deadTotal = 0.0;
+    double shortfallTotal = 0.0;
+    const int pulses = 7;
+    for (int i = 0; i < pulses; i++)
+    {
+        int sign = (i % 2) ? -1 : 1;
+        double output = gears[1].output;
+        uint64_t start = Sim::now();
+        arm(sign);
+        if (!mount.expectOk(std::string(":Z209") + (sign > 0 ? "00" : "01") + SimMount::toHex(1000).substr(0, 4) +
+                            SimMount::toHex(pulseMs).substr(0, 4), true))
+            return false;
+        mount.runFor(pulseMs * 1000 + 500000);
+        if (i == 0)
+            continue;
+        deadTotal += moveTime ? (moveTime - start) / 1000.0 : pulseMs;
+        shortfallTotal += commanded - sign * (gears[1].output - output) * ARCSEC_PER_UNIT;
+    }
+    result->guideDeadMs = deadTotal / (pulses - 1);
+    result->guideShortfall = shortfallTotal / (pulses - 1);
+    arm(0);
+
+    // DEC GOTOs from either side: where the output ends up against the position reported
+    double lo = 1e9, hi = -1e9;
+    for (int i = 0; i < 6; i++)
+    {
+        if (!gotoTarget(mount, '2', (i % 2) ? -20000 : 30000))
+            return false;
+        double offset = (gears[1].output - mount.getMotorPositionOffset(AxisEnum::AXIS_DEC)) * ARCSEC_PER_UNIT;
+        lo = min(lo, offset);
+        hi = max(hi, offset);
+    }
+    result->gotoSpread = hi - lo;
+
+    // RA: GOTO westwards, then start tracking eastwards
+    const uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+    if (!gotoTarget(mount, '1', -50000))
+        return false;
+    mount.runFor(500000);
+    arm(1);
+    if (!mount.expectOk(":G110", true) || !mount.expectOk(":I1" + SimMount::toHex(period), true))
+        return false;
+    uint64_t start = Sim::now();
+    if (!mount.expectOk(":J1", true))
+        return false;
+    mount.runFor(10000000);
+    result->trackDeadMs = moveTime ? (moveTime - start) / 1000.0 : 10000.0;
+    arm(0);
+    return mount.expectOk(":K1", true);
+}
+
+/* A gear train with backlash behind the motors (see BacklashGear), with
+ * no compensation, with reversal take-up, and with take-up plus a
+ * preload direction for RA. Measures the dead time of reversing DEC
+ * guide pulses, how much of their correction is lost, the pointing
+ * spread of DEC GOTOs from either side, and the dead time of starting
+ * RA tracking after a GOTO the other way.
+ * Usage: backlash [backlash, position units]
+ */
+int Sim::scenarioBacklash(int argc, char **argv)
+{
+    uint32_t backlash = argc > 0 ? (uint32_t)atoi(argv[0]) : 150;
+    printf("Gear backlash: %u units, %.1f arcsec\n", backlash, backlash * ARCSEC_PER_UNIT);
+    printf("%-22s %14s %16s %14s %14s\n", "", "guide dead ms", "guide lost \"", "GOTO spread \"", "track dead ms");
+
+    struct Case
+    {
+        const char *name;
+        uint32_t firmwareBacklash;
+        bool preload;
+    };
+    const Case cases[] = {
+        {"no compensation", 0, false},
+        {"take-up", backlash, false},
+        {"take-up + preload", backlash, true},
+    };
+    BacklashResult results[3];
+    for (int i = 0; i < 3; i++)
+    {
+        if (!runBacklash(backlash, cases[i].firmwareBacklash, cases[i].preload, &results[i]))
+            return 1;
+        printf("%-22s %14.1f %16.2f %14.2f %14.1f\n", cases[i].name, results[i].guideDeadMs,
+               results[i].guideShortfall, results[i].gotoSpread, results[i].trackDeadMs);
+    }
+
+    // Flash still holds the last case: the settings come back after a reboot
+    SimMount mount;
+    mount.begin();
+    uint32_t saved = 0;
+    uint32_t savedPreload = 0;
+    if (!mount.query(":Z10C00", &saved) || !mount.query(":Z10C01", &savedPreload) || saved != backlash ||
+        savedPreload != 1)
+    {
+        printf("Backlash settings not restored from flash\n");
+        return 1;
+    }
+
+    const BacklashResult &none = results[0];
+    const BacklashResult &takeUp = results[1];
+    const BacklashResult &preload = results[2];
+    bool ok = takeUp.guideDeadMs < none.guideDeadMs / 4.0 && takeUp.gotoSpread < none.gotoSpread / 4.0 &&
+              preload.trackDeadMs <= takeUp.trackDeadMs;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioClock.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Crystal error calibration against a host clock, and the RA drift it saves
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+#include <Preferences.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+
+/* Sidereal tracking (built-in rate) on RA for a number of hours, with
+ * the crystal off by `ppm`. Returns the drift against true time in
+ * arcsec, once an hour.
+ */
+static bool trackDrift(double ppm, double hours, std::vector<double> *drift)
+{
+    Sim::setClockError(ppm);
+    SimMount mount;
+    mount.begin();
+    std::string reply;
+    if (!mount.command(":F3", &reply) || !mount.command(":G110", &reply) || !mount.command(":Z10D01", &reply) ||
+        reply != "=" || !mount.command(":J1", &reply) || reply != "=")
+        return false;
+
+    const double rate = 1296000.0 / 86164.0905 / ARCSEC_PER_UNIT; // steps per second
+    const uint64_t start = Sim::now();
+    const int64_t startPins = mount.getPinPosition(AxisEnum::AXIS_RA);
+    drift->clear();
+    for (int hour = 1; hour <= (int)hours; hour++)
+    {
+        mount.runFor(3600000000ULL);
+        double expected = rate * (Sim::now() - start) / 1e6;
+        drift->push_back((mount.getPinPosition(AxisEnum::AXIS_RA) - startPins - expected) * ARCSEC_PER_UNIT);
+    }
+    return mount.command(":K1", &reply);
+}
+
+/* The crystal is off by `ppm`. A host with an accurate clock sends its
+ * time every `interval` s for `minutes` (with some latency jitter on
+ * the way), the measured error is applied and saved. Then a reboot,
+ * and a tracking session with and without the correction.
+ * Usage: clock [ppm] [hours] [calibration minutes] [jitter ms]
+ */
+int Sim::scenarioClock(int argc, char **argv)
+{
+    double ppm = argc > 0 ? atof(argv[0]) : 30.0;
+    double hours = argc > 1 ? atof(argv[1]) : 8.0;
+    double minutes = argc > 2 ? atof(argv[2]) : 30.0;
+    double jitterMs = argc > 3 ? atof(argv[3]) : 2.0;
+    const uint64_t interval = 60000000ULL;
+
+    Sim::eraseFlash();
+    int32_t measured = 0;
+    {
+        Sim::setClockError(ppm);
+        SimMount mount;
+        mount.begin();
+        std::mt19937 rng(1);
+        std::normal_distribution<double> jitter(0.0, jitterMs);
+        std::string reply;
+        const uint64_t end = Sim::now() + (uint64_t)(minutes * 60e6);
+        while (Sim::now() < end)
+        {
+            uint32_t hostMs = (uint32_t)llround(Sim::now() / 1000.0 + jitter(rng));
+            if (!mount.command(":Z10F" + SimMount::toHex(hostMs & 0xFFFFFF), &reply) || reply != "=")
+                return 1;
+            mount.runFor(interval);
+        }
+        uint32_t raw = 0;
+        uint32_t syncs = 0;
+        if (!mount.query(":Z11000", &raw) || !mount.query(":Z11002", &syncs) || !mount.command(":Z111", &reply) ||
+            reply != "=")
+            return 1;
+        measured = (int32_t)(raw << 8) >> 8;
+        // The correction goes to flash on the next long tick
+        mount.runFor(200000);
+        printf("Crystal error %.3f ppm, measured %.3f ppm from %u syncs over %.0f min, %.1f ms jitter\n", ppm,
+               measured / 1000.0, syncs, minutes, jitterMs);
+    }
+
+    // Rebooted: the correction comes back from flash
+    std::vector<double> corrected;
+    if (!trackDrift(ppm, hours, &corrected))
+        return 1;
+    Sim::eraseFlash();
+    std::vector<double> uncorrected;
+    if (!trackDrift(ppm, hours, &uncorrected))
+        return 1;
+
+    printf("%-6s %16s %16s\n", "hour", "uncorrected \"", "corrected \"");
+    for (size_t i = 0; i < corrected.size(); i++)
+        printf("%-6zu %16.2f %16.2f\n", i + 1, uncorrected[i], corrected[i]);
+
+    if (corrected.empty())
+        return 1;
+    return fabs(corrected.back()) < fabs(uncorrected.back()) / 10.0 + 0.5 ? 0 : 1;
+}
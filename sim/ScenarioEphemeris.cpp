@@ -0,0 +1,283 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioEphemeris.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: ephemeris table interpolation, and tracking the Moon from a streamed table
+ */
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Preferences.h>
+
+#include "CelestialTransform.hpp"
+#include "EphemerisTable.hpp"
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+#include "SkyReference.hpp"
+
+using namespace Sim;
+using SkyReference::wrap;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+
+// 52N 5E, from 2026-10-18 18h UTC (the Moon a few days past first quarter)
+static const double LAT = 52.0;
+static const double LON = 5.0;
+static const int64_t START_UNIX_MS = 1792346400000LL;
+
+static int32_t turns(double degrees)
+{
+    return (int32_t)(uint32_t)(int64_t)llround(degrees / 360.0 * 4294967296.0);
+}
+
+static double degrees(int32_t turns)
+{
+    return turns / 4294967296.0 * 360.0;
+}
+
+// Axis angles of the Moon (degrees) with the telescope on this side
+static void moonAxes(int64_t ms, bool east, double *raAxis, double *decAxis, double *dec)
+{
+    double ra = 0.0;
+    SkyReference::moon(ms, LAT, LON, &ra, dec);
+    double ha = wrap(SkyReference::siderealTime(ms) + LON - ra);
+    SkyReference::toAxes(ha, *dec, east, LAT < 0, raAxis, decAxis);
+}
+
+/* A full table at each spacing against the Moon itself, every 10 s,
+ * and how long an interpolation takes on the host.
+ */
+static bool checkInterpolation()
+{
+    const int64_t from = START_UNIX_MS - CelestialTransform::J2000_UNIX_MS;
+    const uint32_t spacings[] = {5, 10, 30, 60}; // minutes
+    printf("%10s %8s %12s %12s %12s\n", "spacing", "covers", "max \"", "rms \"", "ends max \"");
+    bool ok = true;
+    for (uint32_t minutes : spacings)
+    {
+        EphemerisTable table;
+        table.start(EphemerisKindEnum::RADEC, from, minutes * 60000);
+        for (uint32_t i = 0; i < EphemerisTable::MAX_POINTS; i++)
+        {
+            double ra = 0.0;
+            double dec = 0.0;
+            SkyReference::moon(from + (int64_t)i * minutes * 60000, LAT, LON, &ra, &dec);
+            table.append(turns(ra), turns(dec));
+        }
+
+        // The first and last segments have one sided tangents
+        double maxErr = 0.0;
+        double maxEnds = 0.0;
+        double sumSq = 0.0;
+        uint32_t samples = 0;
+        for (int64_t ms = table.getFirstMs(); ms <= table.getLastMs(); ms += 10000)
+        {
+            int32_t a = 0;
+            int32_t b = 0;
+            double ra = 0.0;
+            double dec = 0.0;
+            table.at(ms, &a, &b);
+            SkyReference::moon(ms, LAT, LON, &ra, &dec);
+            double err = hypot(wrap(degrees(a) - ra) * cos(dec * M_PI / 180.0), degrees(b) - dec) * 3600.0;
+            if (ms < table.getFirstMs() + minutes * 60000 || ms > table.getLastMs() - minutes * 60000)
+            {
+                maxEnds = fmax(maxEnds, err);
+                continue;
+            }
+            maxErr = fmax(maxErr, err);
+            sumSq += err * err;
+            samples++;
+        }
+        printf("%6u min %6.1f h %12.3f %12.3f %12.3f\n", minutes, (table.getLastMs() - table.getFirstMs()) / 3600000.0,
+               maxErr, sqrt(sumSq / samples), maxEnds);
+        // Under a step (0.29") at the spacings that matter for the Moon
+        if (minutes <= 10)
+            ok = ok && maxErr < 0.29;
+    }
+
+    EphemerisTable table;
+    table.start(EphemerisKindEnum::RADEC, 0, 600000);
+    for (uint32_t i = 0; i < EphemerisTable::MAX_POINTS; i++)
+        table.append(turns(i * 0.1), turns(20.0 - i * 0.01));
+    const uint32_t loops = 10000000;
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; i++)
+    {
+        int32_t a = 0;
+        int32_t b = 0;
+        table.at((int64_t)(i % 37000) * 1000, &a, &b);
+        sink += a + b;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Interpolation: %.1f ns on the host%s\n", seconds / loops * 1e9, (sink == 1) ? " " : "");
+    return ok;
+}
+
+/* Tracks the Moon for this long on a simulated mount from a table of
+ * RA / Dec or axis positions, 2 minutes apart: the ring holds about
+ * two hours of it, so it is topped up every minute while tracking,
+ * as a host would. The axes against the Moon every second.
+ */
+static bool trackMoon(EphemerisKindEnum kind, double hours)
+{
+    const uint32_t SPACING_MS = 120000;
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    GotoController *gotoController = mount.getGotoController();
+    Motor *raMotor = mount.getMotor(AxisEnum::AXIS_RA);
+    Motor *decMotor = mount.getMotor(AxisEnum::AXIS_DEC);
+
+    std::string reply;
+    std::string site = SimMount::toHex((uint32_t)llround(LAT / 360.0 * 16777216.0) & 0xFFFFFF) +
+                       SimMount::toHex((uint32_t)llround(LON / 360.0 * 16777216.0) & 0xFFFFFF);
+    uint32_t days = (uint32_t)(START_UNIX_MS / 86400000);
+    uint32_t msOfDay = (uint32_t)(START_UNIX_MS % 86400000);
+    std::string time = SimMount::toHex(days).substr(0, 4) + SimMount::toHex(msOfDay / 1000) +
+                       SimMount::toHex(msOfDay % 1000).substr(0, 4);
+    if (!mount.command(":F3", &reply) || !mount.command(":Z112" + site, &reply) || reply != "=")
+        return false;
+    const uint64_t timeSent = Sim::now();
+    if (!mount.command(":Z113" + time, &reply) || reply != "=")
+        return false;
+    auto mountMs = [&]()
+    { return START_UNIX_MS - CelestialTransform::J2000_UNIX_MS + (int64_t)((Sim::now() - timeSent) / 1000); };
+
+    // Axis tables are for the side the host picked: east of the pier past the meridian
+    double ra = 0.0;
+    double dec = 0.0;
+    SkyReference::moon(mountMs(), LAT, LON, &ra, &dec);
+    bool east = wrap(SkyReference::siderealTime(mountMs()) + LON - ra) > 0.0;
+
+    // The first point a couple of minutes back, in the table's own time format
+    int64_t firstUnixMs = START_UNIX_MS - 120000;
+    std::string first = SimMount::toHex((uint32_t)(firstUnixMs / 86400000)).substr(0, 4) +
+                        SimMount::toHex((uint32_t)(firstUnixMs % 86400000 / 1000)) +
+                        SimMount::toHex((uint32_t)(firstUnixMs % 1000)).substr(0, 4);
+    if (!mount.command(":Z11C" + SimMount::toHex((uint32_t)kind).substr(0, 2) + first +
+                           SimMount::toHex(SPACING_MS / 1000).substr(0, 4),
+                       &reply) ||
+        reply != "=")
+        return false;
+
+    // Points are sent 10 a command, for as long as there is room
+    uint32_t sent = 0;
+    uint32_t commands = 0;
+    auto topUp = [&]()
+    {
+        for (;;)
+        {
+            std::string payload;
+            for (uint32_t i = 0; i < 10; i++)
+            {
+                int64_t ms = firstUnixMs - CelestialTransform::J2000_UNIX_MS + (int64_t)(sent + i) * SPACING_MS;
+                double a = 0.0;
+                double b = 0.0;
+                uint32_t wireA = 0;
+                uint32_t wireB = 0;
+                if (kind == EphemerisKindEnum::RADEC)
+                {
+                    SkyReference::moon(ms, LAT, LON, &a, &b);
+                    wireA = (uint32_t)llround(a / 360.0 * 16777216.0);
+                    wireB = (uint32_t)llround(b / 360.0 * 16777216.0);
+                }
+                else
+                {
+                    double pointDec = 0.0;
+                    moonAxes(ms, east, &a, &b, &pointDec);
+                    wireA = 0x800000 + (uint32_t)llround(a / 360.0 * MICROSTEPS_PER_REV);
+                    wireB = 0x800000 + (uint32_t)llround(b / 360.0 * MICROSTEPS_PER_REV);
+                }
+                payload += SimMount::toHex(wireA & 0xFFFFFF) + SimMount::toHex(wireB & 0xFFFFFF);
+            }
+            uint32_t taken = 0;
+            if (!mount.query(":Z11D" + payload, &taken))
+                return false;
+            commands++;
+            sent += taken;
+            if (taken < 10)
+                return true;
+        }
+    };
+    if (!topUp())
+        return false;
+
+    uint32_t side = 0;
+    if (!mount.query(":Z11E", &side))
+        return false;
+    if (kind == EphemerisKindEnum::RADEC)
+        east = side == (uint32_t)PierSideEnum::EAST;
+
+    // Settled: the error once following for this long
+    const int64_t SETTLE_MS = 10000;
+    const int64_t end = mountMs() + (int64_t)(hours * 3600000.0);
+    int64_t followingFrom = -1;
+    uint32_t stops = 0;
+    double maxErr = 0.0;
+    double sumSq = 0.0;
+    uint32_t samples = 0;
+    for (uint32_t second = 0; gotoController->isActive() && mountMs() < end; second++)
+    {
+        mount.runFor(1000000);
+        if (second % 60 == 0 && !topUp())
+            return false;
+        if (!gotoController->isFollowingEphemeris())
+            continue;
+        int64_t ms = mountMs();
+        if (followingFrom < 0)
+            followingFrom = ms;
+        if (!raMotor->isMoving() || !decMotor->isMoving())
+            stops++;
+
+        double raAxis = 0.0;
+        double decAxis = 0.0;
+        moonAxes(ms, east, &raAxis, &decAxis, &dec);
+        double raErr = wrap(((int32_t)(raMotor->getPosition() - 0x800000)) * ARCSEC_PER_UNIT / 3600.0 - raAxis);
+        double decErr = wrap(((int32_t)(decMotor->getPosition() - 0x800000)) * ARCSEC_PER_UNIT / 3600.0 - decAxis);
+        double err = hypot(raErr * cos(dec * M_PI / 180.0), decErr) * 3600.0;
+        if (ms - followingFrom >= SETTLE_MS)
+        {
+            maxErr = fmax(maxErr, err);
+            sumSq += err * err;
+            samples++;
+        }
+    }
+
+    double rms = sqrt(sumSq / fmax(samples, 1));
+    printf("%-6s %5s %9.1f %8u %9u %7u %9.2f %9.2f\n", (kind == EphemerisKindEnum::RADEC) ? "radec" : "axes",
+           east ? "E" : "W", (mountMs() - followingFrom) / 3600000.0, sent, commands, stops, maxErr, rms);
+    return followingFrom >= 0 && gotoController->isFollowingEphemeris() && stops == 0 && maxErr < 1.0;
+}
+
+/* Usage: ephemeris [hours] */
+int Sim::scenarioEphemeris(int argc, char **argv)
+{
+    double hours = argc > 0 ? atof(argv[0]) : 3.0;
+    bool ok = checkInterpolation();
+    printf("%-6s %5s %9s %8s %9s %7s %9s %9s\n", "table", "side", "hours", "points", "commands", "stops", "max \"",
+           "rms \"");
+    ok = trackMoon(EphemerisKindEnum::RADEC, hours) && ok;
+    ok = trackMoon(EphemerisKindEnum::AXES, hours) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioGears.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: fast GOTOs with and without microstep gear shifting
+ */
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Preferences.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+struct GearStats
+{
+    uint32_t gotos = 0;
+    double totalTime = 0.0;
+    double maxTime = 0.0;
+    uint32_t maxError = 0;
+    double totalError = 0.0;
+    float topSpeed = 0.0f;
+    uint32_t shifts = 0;
+    int64_t mismatch[2] = {0, 0};
+};
+
+/* The same random fast GOTOs (one axis at a time, anywhere within half
+ * a turn) on a fresh mount, with gear shifting off or on. The pins
+ * follow the DRV8825 indexer, so a shift off a full step would show
+ * as a mismatch between the pins and the motor.
+ */
+static bool runGotos(bool shifting, uint32_t count, uint32_t seed, GearStats *stats)
+{
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    if (!mount.expectOk(":F3") || !mount.expectOk(std::string(":Z127") + (shifting ? "01" : "00")) ||
+        !mount.expectOk(std::string(":Z227") + (shifting ? "01" : "00")))
+        return false;
+
+    std::mt19937 rng(seed);
+    const AxisEnum axes[2] = {AxisEnum::AXIS_RA, AxisEnum::AXIS_DEC};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string axis = (i % 2) ? "2" : "1";
+        Motor *motor = mount.getMotor(axes[i % 2]);
+        uint32_t position = motor->getPosition();
+        uint32_t home = (i % 2) ? 0x913640 : 0x800000;
+        std::uniform_int_distribution<uint32_t> dist(home - MICROSTEPS_PER_REV / 2 + 1, home + MICROSTEPS_PER_REV / 2 - 1);
+        uint32_t target = dist(rng);
+        if (!mount.expectOk(":G" + axis + ((target > position) ? "00" : "01")) ||
+            !mount.expectOk(":S" + axis + SimMount::toHex(target)) || !mount.expectOk(":J" + axis))
+            return false;
+
+        uint64_t start = Sim::now();
+        while (motor->isMoving() && Sim::now() - start < 600000000ULL)
+        {
+            mount.runFor(10000);
+            stats->topSpeed = fmaxf(stats->topSpeed, motor->getSpeed() * SLOW_MICROSTEPS / motor->getMicrosteps());
+        }
+        uint32_t shifts = 0;
+        if (motor->isMoving() || !mount.query(":Z" + axis + "2803", &shifts))
+            return false;
+        double seconds = (Sim::now() - start) / 1e6;
+        uint32_t error = abs((int32_t)(motor->getPosition() - target));
+        stats->gotos++;
+        stats->totalTime += seconds;
+        stats->maxTime = fmax(stats->maxTime, seconds);
+        stats->maxError = max(stats->maxError, error);
+        stats->totalError += error;
+        stats->shifts += shifts;
+    }
+    for (int a = 0; a < 2; a++)
+        stats->mismatch[a] = mount.getMotorPositionOffset(axes[a]) - mount.getPinPosition(axes[a]);
+    return true;
+}
+
+/* Usage: gears [gotos] [seed] */
+int Sim::scenarioGears(int argc, char **argv)
+{
+    uint32_t count = argc > 0 ? (uint32_t)atoi(argv[0]) : 40;
+    uint32_t seed = argc > 1 ? (uint32_t)atoi(argv[1]) : 1;
+    GearStats fixed;
+    GearStats shifting;
+    if (!runGotos(false, count, seed, &fixed) || !runGotos(true, count, seed, &shifting))
+        return 1;
+
+    const float degPerUnit = 360.0f / MICROSTEPS_PER_REV;
+    printf("%u random fast GOTOs        mean s    max s   error mean / max   top deg/s   shifts   pins - motor RA / DEC\n",
+           count);
+    const GearStats *rows[2] = {&fixed, &shifting};
+    const char *names[2] = {"8 microsteps", "gear shifting"};
+    for (int i = 0; i < 2; i++)
+    {
+        const GearStats &s = *rows[i];
+        printf("%-25s %8.2f %8.2f %10.2f / %-6u %10.2f %8.1f %12lld / %lld\n", names[i], s.totalTime / s.gotos, s.maxTime,
+               s.totalError / s.gotos, s.maxError, s.topSpeed * degPerUnit, (double)s.shifts / s.gotos,
+               (long long)s.mismatch[0], (long long)s.mismatch[1]);
+    }
+    // Exact with gear shifting: no landing error, pins and motor agree
+    bool ok = shifting.maxError == 0 && shifting.mismatch[0] == 0 && shifting.mismatch[1] == 0 &&
+              shifting.totalTime < fixed.totalTime;
+    return ok ? 0 : 1;
+}
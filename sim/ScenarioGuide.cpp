@@ -0,0 +1,270 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioGuide.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: ST-4 and timed guide pulses against the steps the driver gets
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+
+struct GuideInput
+{
+    const char *name;
+    uint8_t pin;
+    AxisEnum axis;
+    int sign;
+};
+
+static const GuideInput INPUTS[] = {
+    {"RA+", RA_POS_PIN, AxisEnum::AXIS_RA, 1},
+    {"RA-", RA_NEG_PIN, AxisEnum::AXIS_RA, -1},
+    {"DEC+", DEC_POS_PIN, AxisEnum::AXIS_DEC, 1},
+    {"DEC-", DEC_NEG_PIN, AxisEnum::AXIS_DEC, -1},
+};
+
+// Contact bounce: the input chatters for a few hundred us around each edge
+static void bounce(SimMount &mount, uint8_t pin, uint8_t level)
+{
+    static const uint32_t gaps[] = {30, 20, 60, 40, 90};
+    for (uint32_t gap : gaps)
+    {
+        Sim::setInputPin(pin, level);
+        mount.runFor(gap);
+        Sim::setInputPin(pin, !level);
+        mount.runFor(gap);
+    }
+    Sim::setInputPin(pin, level);
+}
+
+/* RA tracking at sidereal, DEC stopped, while guide pulses of various
+ * lengths come in on each of the ST-4 inputs. The correction the driver
+ * actually got (the RA steps on top of the tracking rate, the DEC steps)
+ * is compared with pulse length x guide rate.
+ * Usage: guide [guide rate index, as :P 0-4]
+ */
+int Sim::scenarioGuide(int argc, char **argv)
+{
+    uint32_t rateIndex = argc > 0 ? (uint32_t)atoi(argv[0]) : 2;
+    static const uint32_t rates[] = {1000, 750, 500, 250, 125};
+    if (rateIndex > 4)
+        return 1;
+    const double rate = rates[rateIndex] / 1000.0;
+
+    SimMount mount;
+    mount.begin();
+    std::string reply;
+    const uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+    const std::string rateArg(1, "01234"[rateIndex]);
+    if (!mount.command(":F3", &reply) || !mount.command(":P1" + rateArg, &reply) ||
+        !mount.command(":P2" + rateArg, &reply) || !mount.command(":G110", &reply) ||
+        !mount.command(":I1" + SimMount::toHex(period), &reply) || !mount.command(":J1", &reply) || reply != "=")
+        return 1;
+    mount.runFor(1000000);
+
+    // The tracking rate the RA motor runs at, in steps per tick
+    const double baseRate = (double)(0xFFFFFFFF / period + 1) / 4294967296.0;
+    const double guideRate = rate / SIDEREAL_PULSE_PER_STEP;
+    printf("Guide rate %.3fx sidereal, %.4f arcsec per ms\n", rate, rate * SIDEREAL_SPEED_ARCSEC / 1000.0);
+    printf("%-5s %8s %12s %12s %10s %12s\n", "input", "pulse ms", "commanded\"", "applied\"", "error\"", "measured ms");
+
+    static const uint32_t pulses[] = {5, 20, 100, 500, 2000};
+    const uint32_t settleUs = 200000;
+    GuidePort *port = mount.getGuidePort();
+    double worst = 0.0;
+    for (const GuideInput &input : INPUTS)
+    {
+        for (uint32_t pulseMs : pulses)
+        {
+            for (bool bouncy : {false, true})
+            {
+                if (bouncy && pulseMs != 100)
+                    continue;
+                uint64_t t0 = Sim::now();
+                int64_t p0 = mount.getPinPosition(input.axis);
+                uint64_t active0 = port->getActiveMicros(input.axis);
+
+                if (bouncy)
+                    bounce(mount, input.pin, LOW);
+                else
+                    Sim::setInputPin(input.pin, LOW);
+                mount.runFor(pulseMs * 1000 - (Sim::now() - t0));
+                if (bouncy)
+                    bounce(mount, input.pin, HIGH);
+                else
+                    Sim::setInputPin(input.pin, HIGH);
+                mount.runFor(settleUs);
+
+                double ticks = (Sim::now() - t0) / (double)TICK_PERIOD_US;
+                double moved = (double)(mount.getPinPosition(input.axis) - p0);
+                if (input.axis == AxisEnum::AXIS_RA)
+                    moved -= ticks * baseRate;
+                double commanded = input.sign * (pulseMs * 1000.0) / TICK_PERIOD_US * guideRate;
+                double measuredMs = (port->getActiveMicros(input.axis) - active0) / 1000.0;
+                worst = max(worst, fabs(moved - commanded));
+                printf("%-5s %7u%s %12.3f %12.3f %10.3f %12.3f\n", input.name, pulseMs, bouncy ? "b" : " ",
+                       commanded * ARCSEC_PER_UNIT, moved * ARCSEC_PER_UNIT, (moved - commanded) * ARCSEC_PER_UNIT,
+                       measuredMs);
+            }
+        }
+    }
+    mount.command(":K1", &reply);
+    mount.runFor(1000000);
+
+    printf("Pulses accepted: RA %u, DEC %u\n", port->getPulseCount(AxisEnum::AXIS_RA),
+           port->getPulseCount(AxisEnum::AXIS_DEC));
+    printf("Worst error: %.2f steps, %.3f arcsec\n", worst, worst * ARCSEC_PER_UNIT);
+
+    bool ok = worst <= 2.0;
+    for (AxisEnum axis : {AxisEnum::AXIS_RA, AxisEnum::AXIS_DEC})
+    {
+        int64_t pins = mount.getPinPosition(axis);
+        int64_t motor = mount.getMotorPositionOffset(axis);
+        if (pins != motor)
+        {
+            printf("%s position mismatch: %lld\n", axis == AxisEnum::AXIS_RA ? "RA" : "DEC", (long long)(motor - pins));
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
+
+static bool pulseGuide(SimMount &mount, char axis, int sign, uint32_t perMille, uint32_t ms)
+{
+    std::string reply;
+    std::string cmd = std::string(":Z") + axis + "09" + (sign > 0 ? "00" : "01") +
+                      SimMount::toHex(perMille).substr(0, 4) + SimMount::toHex(ms).substr(0, 4);
+    return mount.command(cmd, &reply) && reply == "=";
+}
+
+/* Timed pulses through the extended command, with RA tracking at
+ * sidereal and DEC stopped: single pulses, then bursts sent while the
+ * previous pulse is still playing (merged or queued). Waits for each to
+ * complete by polling GET_PULSE_GUIDE and compares the correction the
+ * driver got with rate x duration.
+ * Usage: pulseguide [rate per mille]
+ */
+int Sim::scenarioPulseGuide(int argc, char **argv)
+{
+    uint32_t perMille = argc > 0 ? (uint32_t)atoi(argv[0]) : 500;
+    if (perMille == 0 || perMille > 1000)
+        return 1;
+
+    SimMount mount;
+    mount.begin();
+    std::string reply;
+    const uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+    if (!mount.command(":F3", &reply) || !mount.command(":G110", &reply) ||
+        !mount.command(":I1" + SimMount::toHex(period), &reply) || !mount.command(":J1", &reply) || reply != "=")
+        return 1;
+    mount.runFor(1000000);
+
+    const double baseRate = (double)(0xFFFFFFFF / period + 1) / 4294967296.0;
+    const double stepsPerMs = 1000.0 / TICK_PERIOD_US / SIDEREAL_PULSE_PER_STEP;
+    printf("%-5s %-18s %12s %12s %10s %10s\n", "axis", "pulses", "commanded\"", "applied\"", "error\"", "done ms");
+
+    struct Burst
+    {
+        const char *name;
+        int signs[3];
+        uint32_t ms[3];
+        uint32_t rates[3]; // per mille, 0 = the one given on the command line
+    };
+    static const Burst bursts[] = {
+        {"+7", {1}, {7}, {0}},
+        {"-33", {-1}, {33}, {0}},
+        {"+250", {1}, {250}, {0}},
+        {"-1234", {-1}, {1234}, {0}},
+        {"+100 +100 +100", {1, 1, 1}, {100, 100, 100}, {0, 0, 0}},
+        {"+300 -200", {1, -1}, {300, 200}, {0, 0}},
+        {"+150@1x -80@.25x", {1, -1}, {150, 80}, {1000, 250}},
+    };
+
+    double worst = 0.0;
+    for (char axis : {'1', '2'})
+    {
+        AxisEnum axisEnum = (axis == '1') ? AxisEnum::AXIS_RA : AxisEnum::AXIS_DEC;
+        for (const Burst &burst : bursts)
+        {
+            uint64_t t0 = Sim::now();
+            int64_t p0 = mount.getPinPosition(axisEnum);
+            double commanded = 0.0;
+            uint32_t total = 0;
+            for (int i = 0; i < 3 && burst.ms[i]; i++)
+            {
+                uint32_t rate = burst.rates[i] ? burst.rates[i] : perMille;
+                if (!pulseGuide(mount, axis, burst.signs[i], rate, burst.ms[i]))
+                {
+                    printf("Pulse %s refused\n", burst.name);
+                    return 1;
+                }
+                commanded += burst.signs[i] * (burst.ms[i] * stepsPerMs * rate / 1000.0);
+                total += burst.ms[i];
+            }
+
+            // Poll for completion the way a client would
+            uint32_t remaining = 1;
+            uint64_t done = 0;
+            while (remaining && Sim::now() - t0 < (total + 1000) * 1000ull)
+            {
+                mount.runFor(1000);
+                if (!mount.query(std::string(":Z") + axis + "0A", &remaining))
+                    return 1;
+                done = Sim::now();
+            }
+            if (remaining)
+            {
+                printf("Pulse %s did not complete\n", burst.name);
+                return 1;
+            }
+            mount.runFor(100000);
+
+            double moved = (double)(mount.getPinPosition(axisEnum) - p0);
+            if (axisEnum == AxisEnum::AXIS_RA)
+                moved -= (Sim::now() - t0) / (double)TICK_PERIOD_US * baseRate;
+            worst = max(worst, fabs(moved - commanded));
+            printf("%-5s %-18s %12.3f %12.3f %10.3f %10.1f\n", axisEnum == AxisEnum::AXIS_RA ? "RA" : "DEC",
+                   burst.name, commanded * ARCSEC_PER_UNIT, moved * ARCSEC_PER_UNIT,
+                   (moved - commanded) * ARCSEC_PER_UNIT, (done - t0) / 1000.0);
+        }
+    }
+    mount.command(":K1", &reply);
+    mount.runFor(1000000);
+    printf("Worst error: %.2f steps, %.3f arcsec\n", worst, worst * ARCSEC_PER_UNIT);
+
+    bool ok = worst <= 2.0;
+    for (AxisEnum axis : {AxisEnum::AXIS_RA, AxisEnum::AXIS_DEC})
+    {
+        if (mount.getPinPosition(axis) != mount.getMotorPositionOffset(axis))
+        {
+            printf("%s position mismatch\n", axis == AxisEnum::AXIS_RA ? "RA" : "DEC");
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
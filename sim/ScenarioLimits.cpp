@@ -0,0 +1,234 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioLimits.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: soft limits and the horizon mask stopping the axes
+ */
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Preferences.h>
+
+#include "HorizonMask.hpp"
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+static const uint32_t HOME = 0x800000;
+// RA within 60 degrees of counterweight down
+static const uint32_t RA_LIMIT = MICROSTEPS_PER_REV / 6;
+
+struct ModeStats
+{
+    const char *name;
+    char mode;  // :G motion mode
+    bool ramp;
+    uint32_t runs = 0;
+    uint32_t halted = 0;
+    int32_t maxOvershoot = 0;
+    double shortSum = 0.0;
+    double stopRatioSum = 0.0;
+    double stopRatioMax = 0.0;
+
+    ModeStats(const char *name, char mode, bool ramp) : name(name), mode(mode), ramp(ramp) {}
+};
+
+/* Runs the RA axis from near a limit towards (and past) it in one of
+ * the :G modes. Overshoot: how far past the limit it got. For the
+ * ramped modes the distance from the halt to rest is compared with
+ * v^2 / 2a at the speed it was halted at: about 1 down the ramp,
+ * much less for a hard stop.
+ */
+static bool runToLimit(SimMount &mount, ModeStats *stats, std::mt19937 &rng)
+{
+    Motor *motor = mount.getMotor(AxisEnum::AXIS_RA);
+    std::uniform_int_distribution<uint32_t> away(MICROSTEPS_PER_REV / 720, MICROSTEPS_PER_REV / 72);
+    std::uniform_int_distribution<uint32_t> period(6, 20);
+    bool up = rng() % 2;
+    uint32_t start = up ? HOME + RA_LIMIT - away(rng) : HOME - RA_LIMIT + away(rng);
+    uint32_t beyond = up ? HOME + RA_LIMIT + MICROSTEPS_PER_REV / 36 : HOME - RA_LIMIT - MICROSTEPS_PER_REV / 36;
+    std::string dir = up ? "0" : "1";
+    if (!mount.expectOk(":E1" + SimMount::toHex(start)) || !mount.expectOk(std::string(":G1") + stats->mode + dir) ||
+        !mount.expectOk(":I1" + SimMount::toHex(period(rng))) ||
+        ((stats->mode == '0' || stats->mode == '2') && !mount.expectOk(":S1" + SimMount::toHex(beyond))) ||
+        !mount.expectOk(":J1"))
+        return false;
+
+    uint32_t ratio = (stats->mode == '0' || stats->mode == '3') ? HIGH_SPEED_RATIO : 1;
+    bool halted = false;
+    uint32_t haltPosition = 0;
+    double expected = 0.0;
+    int32_t overshoot = 0;
+    uint64_t deadline = Sim::now() + 120000000ULL;
+    while (motor->isMoving() && Sim::now() < deadline)
+    {
+        mount.runFor(1000);
+        int32_t past = up ? (int32_t)(motor->getPosition() - (HOME + RA_LIMIT)) : (int32_t)(HOME - RA_LIMIT - motor->getPosition());
+        overshoot = max(overshoot, past);
+        if (!halted && motor->getLimitStop() != LimitStopEnum::NONE)
+        {
+            halted = true;
+            haltPosition = motor->getPosition();
+            float speed = motor->getSpeed();
+            expected = speed * speed / (2.0 * MOTOR_ACCEL) * ratio;
+        }
+    }
+    uint32_t status = 0;
+    if (motor->isMoving() || !mount.query(":Z12203", &status))
+        return false;
+
+    stats->runs++;
+    stats->maxOvershoot = max(stats->maxOvershoot, overshoot);
+    if (!halted || status != (uint32_t)LimitStopEnum::SOFT_LIMIT)
+        return true;
+    stats->halted++;
+    stats->shortSum += up ? (int32_t)(HOME + RA_LIMIT - motor->getPosition()) : (int32_t)(motor->getPosition() - (HOME - RA_LIMIT));
+    if (stats->ramp && expected > 100.0)
+    {
+        double ratioToRamp = abs((int32_t)(motor->getPosition() - haltPosition)) / expected;
+        stats->stopRatioSum += ratioToRamp;
+        stats->stopRatioMax = fmax(stats->stopRatioMax, ratioToRamp);
+    }
+    return true;
+}
+
+static bool softLimits(uint32_t runs, uint32_t seed)
+{
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    if (!mount.expectOk(":F3") || !mount.expectOk(":Z121" + SimMount::toHex(HOME - RA_LIMIT) + SimMount::toHex(HOME + RA_LIMIT)))
+        return false;
+
+    ModeStats modes[] = {{"fast GOTO", '0', true}, {"slow GOTO", '2', true}, {"slow slew / tracking", '1', false}, {"fast slew", '3', true}};
+    std::mt19937 rng(seed);
+    for (uint32_t i = 0; i < runs; i++)
+        if (!runToLimit(mount, &modes[i % 4], rng))
+            return false;
+
+    printf("RA soft limits +-60 degrees, %u runs at them from up to 5 degrees inside\n", runs);
+    printf("%-22s %6s %7s %10s %10s %12s %12s\n", "mode", "runs", "halted", "past max", "short by", "stop/ramp", "max");
+    bool ok = true;
+    for (const ModeStats &m : modes)
+    {
+        double halted = fmax(m.halted, 1);
+        if (m.ramp)
+            printf("%-22s %6u %7u %10d %10.1f %12.2f %12.2f\n", m.name, m.runs, m.halted, m.maxOvershoot, m.shortSum / halted,
+                   m.stopRatioSum / halted, m.stopRatioMax);
+        else
+            printf("%-22s %6u %7u %10d %10.1f %12s %12s\n", m.name, m.runs, m.halted, m.maxOvershoot, m.shortSum / halted, "-", "-");
+        ok = ok && m.halted == m.runs && m.maxOvershoot <= 0;
+    }
+    return ok;
+}
+
+/* Random fast GOTOs of both axes at once at 52N, with the horizon
+ * mask on (15 degrees, 30 from east to south, 10 degrees with the
+ * counterweight up): how low the telescope got (exact margin over the
+ * mask, sampled every ms) on moves starting above it, and how far
+ * above it the halted ones stopped.
+ */
+static bool horizon(uint32_t moves, uint32_t seed)
+{
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    HorizonMask *mask = mount.getHorizonMask();
+    std::string site = SimMount::toHex((uint32_t)llround(52.0 / 360.0 * 16777216.0)) + SimMount::toHex(0);
+    if (!mount.expectOk(":F3") || !mount.expectOk(":Z112" + site))
+        return false;
+    for (uint32_t i = 0; i < HorizonMask::NUM_POINTS; i++)
+    {
+        int8_t altitude = (i >= 4 && i <= 8) ? 30 : 15;
+        char point[8];
+        snprintf(point, sizeof(point), "%02X%02X", i, (uint8_t)altitude);
+        if (!mount.expectOk(std::string(":Z124") + point))
+            return false;
+    }
+    uint32_t active = 0;
+    if (!mount.expectOk(":Z12410" + SimMount::toHex(10).substr(0, 2)) || !mount.expectOk(":Z12501"))
+        return false;
+    mount.runFor(300000);
+    if (!mount.query(":Z12612", &active) || !active)
+        return false;
+
+    Motor *ra = mount.getMotor(AxisEnum::AXIS_RA);
+    Motor *dec = mount.getMotor(AxisEnum::AXIS_DEC);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> raTarget(HOME - MICROSTEPS_PER_REV / 3, HOME + MICROSTEPS_PER_REV / 3);
+    std::uniform_int_distribution<uint32_t> decTarget(0x913640 - MICROSTEPS_PER_REV / 3, 0x913640 + MICROSTEPS_PER_REV / 3);
+    uint32_t counted = 0;
+    uint32_t halted = 0;
+    uint32_t entered = 0;
+    float lowest = 90.0f;
+    double haltedMargin = 0.0;
+    for (uint32_t i = 0; i < moves; i++)
+    {
+        float margin = mask->exactMargin(ra->getPosition(), dec->getPosition());
+        uint32_t targets[2] = {raTarget(rng), decTarget(rng)};
+        Motor *motors[2] = {ra, dec};
+        for (int a = 0; a < 2; a++)
+        {
+            std::string axis = (a == 0) ? "1" : "2";
+            bool cw = targets[a] > motors[a]->getPosition();
+            if (!mount.expectOk(":G" + axis + "0" + (cw ? "0" : "1")) || !mount.expectOk(":S" + axis + SimMount::toHex(targets[a])))
+                return false;
+        }
+        if (!mount.expectOk(":J1") || !mount.expectOk(":J2"))
+            return false;
+
+        float low = margin;
+        while (ra->isMoving() || dec->isMoving())
+        {
+            mount.runFor(1000);
+            low = fminf(low, mask->exactMargin(ra->getPosition(), dec->getPosition()));
+        }
+        if (margin < 0.0f)
+            continue;
+        counted++;
+        lowest = fminf(lowest, low);
+        entered += (low < 0.0f) ? 1 : 0;
+        if (ra->getLimitStop() == LimitStopEnum::HORIZON)
+        {
+            halted++;
+            haltedMargin += mask->exactMargin(ra->getPosition(), dec->getPosition());
+        }
+    }
+
+    printf("\nHorizon mask at 52N (15 / 30 degrees, pier 10 degrees), %u random GOTOs of both axes\n", moves);
+    printf("from above the mask: %u, halted %u, stopped %.1f degrees above it on average\n", counted, halted,
+           haltedMargin / fmax(halted, 1));
+    printf("lowest point reached: %.2f degrees above the mask; went below it: %u\n", lowest, entered);
+    return entered == 0;
+}
+
+/* Usage: limits [runs] [seed] */
+int Sim::scenarioLimits(int argc, char **argv)
+{
+    uint32_t runs = argc > 0 ? (uint32_t)atoi(argv[0]) : 40;
+    uint32_t seed = argc > 1 ? (uint32_t)atoi(argv[1]) : 1;
+    bool ok = softLimits(runs, seed);
+    ok = horizon(runs, seed) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioPec.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Tracking with a synthetic worm error, with and without PEC, and PEC training
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <Preferences.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+
+/* Synthetic periodic error of the worm, in arcsec, at a given axis
+ * position: the fundamental plus some second harmonic, as is typical.
+ */
+struct WormError
+{
+    double amplitude;
+
+    double phase(double position) const
+    {
+        double turns = position * WORM_TEETH / MICROSTEPS_PER_REV;
+        return 2.0 * M_PI * (turns - floor(turns));
+    }
+
+    double at(double position) const
+    {
+        double p = phase(position);
+        return amplitude * (sin(p) + 0.3 * sin(2.0 * p + 0.7));
+    }
+
+    // d(error) / d(phase)
+    double slope(double p) const
+    {
+        return amplitude * (cos(p) + 0.6 * cos(2.0 * p + 0.7));
+    }
+};
+
+// The ideal table: the motor has to run slower where the worm error runs ahead,
+// correction = -d(error) / d(position), as a Q15 fraction of the rate
+static int32_t idealCorrection(const WormError &worm, uint32_t bin)
+{
+    const double phasePerUnit = 2.0 * M_PI * WORM_TEETH / MICROSTEPS_PER_REV;
+    double p = 2.0 * M_PI * bin / PecTable::NUM_BINS;
+    return (int32_t)lround(-worm.slope(p) * phasePerUnit / ARCSEC_PER_UNIT * 32768.0);
+}
+
+static bool pecTracking(SimMount &mount, char axis, bool *tracking, bool *training)
+{
+    std::string reply;
+    if (!mount.command(std::string(":q") + axis + "010000", &reply) || reply.size() < 2)
+        return false;
+    *tracking = charToHex(reply[1]) & 0x2;
+    *training = charToHex(reply[1]) & 0x1;
+    return true;
+}
+
+static bool getPecEntry(SimMount &mount, uint32_t bin, int32_t *value)
+{
+    char cmd[16];
+    snprintf(cmd, sizeof(cmd), ":Z106%02X", bin);
+    uint32_t raw = 0;
+    if (!mount.query(cmd, &raw))
+        return false;
+    *value = (int16_t)raw;
+    return true;
+}
+
+struct Residual
+{
+    double peakToPeak;
+    double rms;
+};
+
+/* Track for a number of worm periods, sampling where the axis really
+ * points (the steps the driver got, plus the worm error) once a second.
+ * The linear drift of the tracking rate is fitted out, what is left is
+ * the periodic error.
+ */
+static bool trackResidual(SimMount &mount, const WormError &worm, double wormPeriods, Residual *result)
+{
+    std::string reply;
+    uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+    if (!mount.command(":G110", &reply) || !mount.command(":I1" + SimMount::toHex(period), &reply) ||
+        !mount.command(":J1", &reply) || reply != "=")
+        return false;
+
+    const double start = mount.getMotor(AxisEnum::AXIS_RA)->getPosition() - mount.getPinPosition(AxisEnum::AXIS_RA);
+    const double wormSeconds = MICROSTEPS_PER_REV / (double)WORM_TEETH / SIDEREAL_STEP_PER_SECOND;
+    const int samples = (int)(wormPeriods * wormSeconds);
+
+    std::vector<double> t(samples);
+    std::vector<double> pointing(samples);
+    for (int i = 0; i < samples; i++)
+    {
+        mount.runFor(1000000);
+        double position = start + mount.getPinPosition(AxisEnum::AXIS_RA);
+        t[i] = i;
+        pointing[i] = position * ARCSEC_PER_UNIT + worm.at(position);
+    }
+    mount.command(":K1", &reply);
+    mount.runFor(1000000);
+
+    // Least squares line through the samples
+    double st = 0, sp = 0, stt = 0, stp = 0;
+    for (int i = 0; i < samples; i++)
+    {
+        st += t[i];
+        sp += pointing[i];
+        stt += t[i] * t[i];
+        stp += t[i] * pointing[i];
+    }
+    double slope = (samples * stp - st * sp) / (samples * stt - st * st);
+    double offset = (sp - slope * st) / samples;
+
+    double lo = 1e9, hi = -1e9, sum2 = 0;
+    for (int i = 0; i < samples; i++)
+    {
+        double r = pointing[i] - (offset + slope * t[i]);
+        lo = min(lo, r);
+        hi = max(hi, r);
+        sum2 += r * r;
+    }
+    result->peakToPeak = hi - lo;
+    result->rms = sqrt(sum2 / samples);
+    return true;
+}
+
+/* Sidereal tracking on RA against a synthetic worm error, first without
+ * PEC, then with a PEC table computed from that same error curve and
+ * loaded through the extended commands. Reports the residual error.
+ * Usage: pec [worm periods] [amplitude arcsec]
+ */
+int Sim::scenarioPec(int argc, char **argv)
+{
+    double wormPeriods = argc > 0 ? atof(argv[0]) : 2.0;
+    WormError worm = {argc > 1 ? atof(argv[1]) : 10.0};
+
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    std::string reply;
+    uint32_t pecPeriod = 0;
+    if (!mount.command(":F3", &reply) || !mount.query(":s1", &pecPeriod))
+        return 1;
+    printf("Worm period: %u steps, %.1f s; error amplitude %.1f arcsec\n", pecPeriod,
+           pecPeriod / SIDEREAL_STEP_PER_SECOND, worm.amplitude);
+
+    Residual without;
+    if (!trackResidual(mount, worm, wormPeriods, &without))
+        return 1;
+
+    for (uint32_t bin = 0; bin < PecTable::NUM_BINS; bin++)
+    {
+        char cmd[16];
+        snprintf(cmd, sizeof(cmd), ":Z105%02X", bin);
+        if (!mount.command(cmd + SimMount::toHex(idealCorrection(worm, bin) & 0xFFFF).substr(0, 4), &reply) || reply != "=")
+        {
+            fprintf(stderr, "%s: unexpected reply '%s'\n", cmd, reply.c_str());
+            return 1;
+        }
+    }
+    if (!mount.command(":W1020000", &reply) || reply != "=")
+        return 1;
+
+    bool tracking = false, training = false;
+    pecTracking(mount, '1', &tracking, &training);
+    printf("PEC tracking reported: %s\n", tracking ? "on" : "off");
+
+    Residual with;
+    if (!trackResidual(mount, worm, wormPeriods, &with))
+        return 1;
+
+    printf("Residual without PEC: %.2f arcsec p-p, %.2f arcsec RMS\n", without.peakToPeak, without.rms);
+    printf("Residual with PEC:    %.2f arcsec p-p, %.2f arcsec RMS\n", with.peakToPeak, with.rms);
+    return (tracking && with.peakToPeak < without.peakToPeak / 4.0) ? 0 : 1;
+}
+
+/* Tracks for a while under a simulated autoguider, which corrects the
+ * worm error (plus seeing noise) every couple of seconds with pulses at
+ * 0.5x / 1.5x sidereal through :I, the way EQMOD pulse guides.
+ * Returns the number of guide pulses.
+ */
+static int guide(SimMount &mount, const WormError &worm, double seconds, double noise, std::mt19937 &rng,
+                 const std::function<bool()> &done)
+{
+    const double cycle = 2.0;
+    const uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+    std::normal_distribution<double> seeing(0.0, noise);
+    std::string reply;
+
+    const double start = mount.getMotor(AxisEnum::AXIS_RA)->getPosition() - mount.getPinPosition(AxisEnum::AXIS_RA);
+    const uint64_t t0 = Sim::now();
+    const double pointing0 = start * ARCSEC_PER_UNIT + worm.at(start);
+    int pulses = 0;
+    while ((Sim::now() - t0) / 1e6 < seconds && !done())
+    {
+        uint64_t cycleStart = Sim::now();
+        double position = start + mount.getPinPosition(AxisEnum::AXIS_RA);
+        double ideal = pointing0 + SIDEREAL_SPEED_ARCSEC * (cycleStart - t0) / 1e6;
+        double error = position * ARCSEC_PER_UNIT + worm.at(position) - ideal + seeing(rng);
+
+        // Ahead: slow down, behind: speed up, for long enough to cancel the error
+        double pulse = min(fabs(error) / (0.5 * SIDEREAL_SPEED_ARCSEC), cycle * 0.8);
+        if (pulse > 0.05)
+        {
+            uint32_t pulsePeriod = (error > 0) ? period * 2 : (uint32_t)(period / 1.5 + 0.5);
+            mount.command(":I1" + SimMount::toHex(pulsePeriod), &reply);
+            mount.runFor((uint64_t)(pulse * 1e6));
+            mount.command(":I1" + SimMount::toHex(period), &reply);
+            pulses++;
+        }
+        uint64_t elapsed = Sim::now() - cycleStart;
+        if (elapsed < cycle * 1e6)
+            mount.runFor((uint64_t)(cycle * 1e6) - elapsed);
+    }
+    return pulses;
+}
+
+/* PEC training under a simulated autoguider against a synthetic worm
+ * error, then unguided tracking with and without the trained table, and
+ * a reboot to check the table comes back from flash.
+ * Usage: pectrain [amplitude arcsec] [seeing arcsec] [seed]
+ */
+int Sim::scenarioPecTrain(int argc, char **argv)
+{
+    WormError worm = {argc > 0 ? atof(argv[0]) : 10.0};
+    double noise = argc > 1 ? atof(argv[1]) : 0.5;
+    std::mt19937 rng(argc > 2 ? (unsigned)atoi(argv[2]) : 1);
+    const double wormSeconds = MICROSTEPS_PER_REV / (double)WORM_TEETH / SIDEREAL_STEP_PER_SECOND;
+
+    Sim::eraseFlash();
+    std::vector<int32_t> trained(PecTable::NUM_BINS);
+    {
+        SimMount mount;
+        mount.begin();
+        std::string reply;
+        uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+        if (!mount.command(":F3", &reply) || !mount.command(":G110", &reply) ||
+            !mount.command(":I1" + SimMount::toHex(period), &reply) || !mount.command(":J1", &reply) ||
+            !mount.command(":W1000000", &reply) || reply != "=")
+            return 1;
+
+        bool tracking = false, training = true;
+        uint64_t start = Sim::now();
+        int pulses = guide(mount, worm, (PEC_TRAINING_CYCLES + 1) * wormSeconds, noise, rng, [&]()
+                           { return !pecTracking(mount, '1', &tracking, &training) || !training; });
+        printf("Trained for %.0f s with %d guide pulses, error %.1f arcsec, seeing %.1f arcsec\n",
+               (Sim::now() - start) / 1e6, pulses, worm.amplitude, noise);
+        mount.command(":K1", &reply);
+        mount.runFor(1000000);
+        if (training)
+        {
+            printf("Training did not finish\n");
+            return 1;
+        }
+
+        double diff2 = 0.0, ideal2 = 0.0;
+        for (uint32_t bin = 0; bin < PecTable::NUM_BINS; bin++)
+        {
+            if (!getPecEntry(mount, bin, &trained[bin]))
+                return 1;
+            double ideal = idealCorrection(worm, bin);
+            diff2 += (trained[bin] - ideal) * (trained[bin] - ideal);
+            ideal2 += ideal * ideal;
+        }
+        printf("Trained table vs ideal: RMS %.1f vs %.1f (Q15)\n", sqrt(diff2 / PecTable::NUM_BINS), sqrt(ideal2 / PecTable::NUM_BINS));
+    }
+
+    // Reboot, the table should come back from flash
+    SimMount mount;
+    mount.begin();
+    std::string reply;
+    if (!mount.command(":F3", &reply))
+        return 1;
+    for (uint32_t bin = 0; bin < PecTable::NUM_BINS; bin++)
+    {
+        int32_t value = 0;
+        if (!getPecEntry(mount, bin, &value) || value != trained[bin])
+        {
+            printf("PEC table not restored from flash (bin %u)\n", bin);
+            return 1;
+        }
+    }
+
+    Residual without;
+    Residual with;
+    if (!trackResidual(mount, worm, 2.0, &without) || !mount.command(":W1020000", &reply) || reply != "=" ||
+        !trackResidual(mount, worm, 2.0, &with))
+        return 1;
+    printf("Unguided residual without PEC: %.2f arcsec p-p, %.2f arcsec RMS\n", without.peakToPeak, without.rms);
+    printf("Unguided residual with PEC:    %.2f arcsec p-p, %.2f arcsec RMS\n", with.peakToPeak, with.rms);
+    return (with.peakToPeak < without.peakToPeak / 4.0) ? 0 : 1;
+}
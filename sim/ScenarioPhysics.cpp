@@ -0,0 +1,134 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioPhysics.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sweep of GOTO ramp limits against a physical model of the loaded mount
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+#include "StepperModel.hpp"
+
+using namespace Sim;
+
+struct PhysicsResult
+{
+    float accel;
+    float maxSpeed;
+    double slewTime;
+    float peakLag;
+    float margin;
+    uint32_t missedSteps;
+    bool finished;
+};
+
+static PhysicsResult runSlew(const StepperModel::Params &params, float accel, float maxSpeed, uint32_t distance)
+{
+    SimMount mount;
+    mount.begin();
+    Motor *motor = mount.getMotor(AxisEnum::AXIS_RA);
+    motor->setRampLimits(accel, maxSpeed);
+
+    StepperModel model(params);
+    mount.setStepListener([&model](AxisEnum axis, int32_t increment)
+                          {
+                              if (axis == AxisEnum::AXIS_RA)
+                                  model.step(Sim::now(), increment);
+                          });
+
+    PhysicsResult result = {accel, maxSpeed, 0.0, 0.0f, 0.0f, 0, false};
+    std::string reply;
+    if (!mount.command(":F3", &reply) || !mount.command(":G100", &reply) ||
+        !mount.command(":S1" + SimMount::toHex(motor->getPosition() + distance), &reply) ||
+        !mount.command(":J1", &reply))
+        return result;
+
+    const uint64_t start = Sim::now();
+    while (motor->isMoving() && Sim::now() - start < 600000000ULL)
+    {
+        mount.runFor(10000);
+        model.advance(Sim::now());
+    }
+    result.finished = !motor->isMoving();
+    result.slewTime = (Sim::now() - start) / 1e6;
+
+    // Let the rotor settle
+    mount.runFor(200000);
+    model.advance(Sim::now());
+
+    result.peakLag = model.getPeakLagDegrees();
+    result.margin = model.getSafetyMargin();
+    result.missedSteps = model.getMissedSteps();
+    return result;
+}
+
+/* Sweeps the GOTO acceleration and max speed against a model of the motor
+ * and payload, and picks the fastest profile that keeps the safety margin.
+ * Usage: physics [load inertia kg m^2] [slew degrees] [min margin %]
+ */
+int Sim::scenarioPhysics(int argc, char **argv)
+{
+    StepperModel::Params params;
+    params.gearRatio = (float)FULL_STEPS_PER_REV / params.fullStepsPerRev;
+    params.positionUnitsPerStep = SLOW_MICROSTEPS;
+    if (argc > 0)
+        params.loadInertia = atof(argv[0]);
+    float degrees = argc > 1 ? atof(argv[1]) : 30.0f;
+    float minMargin = (argc > 2 ? atof(argv[2]) : 30.0f) / 100.0f;
+    uint32_t distance = (uint32_t)(degrees / 360.0f * MICROSTEPS_PER_REV);
+
+    static const float ACCELS[] = {1000, 2000, 5000, 10000, 20000, 50000};
+    static const float MAX_SPEEDS[] = {2500, 5000, 10000, 20000};
+
+    printf("Load %.2f kg m^2, %.1f deg slew, holding torque %.2f N m, gear ratio %.0f\n",
+           params.loadInertia, degrees, params.holdingTorque, params.gearRatio);
+    printf("Current: accel %.0f steps/s^2, max speed %u steps/s\n\n", MOTOR_ACCEL, MAX_PULSE_PER_SECOND / 2);
+    printf("%10s %10s %10s %10s %8s %8s\n", "accel", "max speed", "slew (s)", "lag (deg)", "margin", "missed");
+
+    bool found = false;
+    PhysicsResult best = {};
+    for (float accel : ACCELS)
+    {
+        for (float maxSpeed : MAX_SPEEDS)
+        {
+            PhysicsResult r = runSlew(params, accel, maxSpeed, distance);
+            bool safe = r.finished && r.missedSteps == 0 && r.margin >= minMargin;
+            printf("%10.0f %10.0f %10.2f %10.1f %7.0f%% %8u%s\n", r.accel, r.maxSpeed, r.slewTime, r.peakLag,
+                   r.margin * 100.0f, r.missedSteps, safe ? "" : (r.missedSteps ? "  LOST STEPS" : "  unsafe"));
+            if (safe && (!found || r.slewTime < best.slewTime))
+            {
+                best = r;
+                found = true;
+            }
+        }
+    }
+
+    if (!found)
+    {
+        printf("\nNo profile keeps a %.0f%% margin\n", minMargin * 100.0f);
+        return 1;
+    }
+    printf("\nFastest safe profile (>= %.0f%% margin): accel %.0f steps/s^2, max speed %.0f steps/s, %.2f s\n",
+           minMargin * 100.0f, best.accel, best.maxSpeed, best.slewTime);
+    return 0;
+}
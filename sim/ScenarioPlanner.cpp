@@ -0,0 +1,246 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioPlanner.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: GOTO planner slew times against host-chosen directions and pier sides
+ */
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Preferences.h>
+
+#include "CelestialTransform.hpp"
+#include "GotoPlanner.hpp"
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+#include "SkyReference.hpp"
+
+using namespace Sim;
+
+static const uint32_t HOME = 0x800000;
+// The RA axis within 135 degrees of counterweight down, for the limited runs
+static const uint32_t RA_LIMIT = MICROSTEPS_PER_REV * 135 / 360;
+
+struct Totals
+{
+    double sum = 0.0;
+    double max = 0.0;
+    uint32_t count = 0;
+
+    void add(double seconds)
+    {
+        sum += seconds;
+        max = fmax(max, seconds);
+        count++;
+    }
+};
+
+static void printTotals(const char *name, const Totals &totals, const char *note = "")
+{
+    printf("%-34s %8.2f %8.2f %s\n", name, totals.sum / fmax(totals.count, 1), totals.max, note);
+}
+
+/* Estimated slew times (GotoPlanner::slewSeconds()) of random axis
+ * GOTOs over the whole turn, by how the direction is picked.
+ */
+static bool estimate(uint32_t count, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<uint32_t> anywhere(HOME - MICROSTEPS_PER_REV / 2 + 1, HOME + MICROSTEPS_PER_REV / 2 - 1);
+    Totals alwaysCw;
+    Totals byCounts;
+    Totals planned;
+    Totals limitedByCounts;
+    Totals limitedPlanned;
+    uint32_t wouldCross = 0;
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t position = anywhere(rng);
+        uint32_t target = anywhere(rng);
+        uint32_t direct = (target > position) ? target - position : position - target;
+        alwaysCw.add(GotoPlanner::slewSeconds((target > position) ? direct : MICROSTEPS_PER_REV - direct, true));
+        byCounts.add(GotoPlanner::slewSeconds(direct, true));
+
+        SlewDirectionEnum dir = SlewDirectionEnum::NONE;
+        uint32_t distance = 0;
+        GotoPlanner::shortestWay(position, target, false, 0, 0, &dir, &distance);
+        planned.add(GotoPlanner::slewSeconds(distance, true));
+        ok = ok && distance <= MICROSTEPS_PER_REV / 2;
+
+        // Within the limits the planner never wraps, so the shortest angle is no good there
+        if (position < HOME - RA_LIMIT || position > HOME + RA_LIMIT || target < HOME - RA_LIMIT || target > HOME + RA_LIMIT)
+            continue;
+        limitedByCounts.add(GotoPlanner::slewSeconds(direct, true));
+        ok = GotoPlanner::shortestWay(position, target, true, HOME - RA_LIMIT, HOME + RA_LIMIT, &dir, &distance) &&
+             distance == direct && ok;
+        limitedPlanned.add(GotoPlanner::slewSeconds(distance, true));
+        if (direct > MICROSTEPS_PER_REV / 2)
+            wouldCross++;
+    }
+
+    char note[64];
+    snprintf(note, sizeof(note), "(the shortest angle crosses them %.1f%%)", 100.0 * wouldCross / fmax(limitedPlanned.count, 1));
+    printf("%u random axis GOTOs, estimated:  mean s    max s\n", count);
+    printTotals("host: always CW", alwaysCw);
+    printTotals("host: by position counts", byCounts);
+    printTotals("planner", planned);
+    printTotals("host: by counts, +-135 deg limits", limitedByCounts);
+    printTotals("planner, +-135 deg limits", limitedPlanned, note);
+    return ok;
+}
+
+/* Random RA axis GOTOs on a simulated mount from a host that always
+ * says CW, with the planner off / on (and the +-135 degree limits):
+ * the time each took, the ETA at the start, and how far outside the
+ * limits the axis went.
+ */
+static bool simulateAxisGotos(uint32_t count, uint32_t seed, bool planner)
+{
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    Motor *motor = mount.getMotor(AxisEnum::AXIS_RA);
+    if (!mount.expectOk(":F3"))
+        return false;
+    if (planner && (!mount.expectOk(":Z12001") ||
+                    !mount.expectOk(":Z121" + SimMount::toHex(HOME - RA_LIMIT) + SimMount::toHex(HOME + RA_LIMIT))))
+        return false;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> within(HOME - RA_LIMIT, HOME + RA_LIMIT);
+    Totals taken;
+    double maxEtaErr = 0.0;
+    uint32_t outside = 0;
+    uint32_t turned = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t target = within(rng);
+        uint32_t eta = 0;
+        uint32_t changed = 0;
+        if (!mount.expectOk(":G100") || !mount.expectOk(":S1" + SimMount::toHex(target)) || !mount.expectOk(":J1") ||
+            !mount.query(":Z12300", &eta) || !mount.query(":Z12303", &changed))
+            return false;
+        turned += changed;
+
+        uint64_t start = Sim::now();
+        bool left = false;
+        while (motor->isMoving() && Sim::now() - start < 600000000ULL)
+        {
+            mount.runFor(20000);
+            uint32_t position = motor->getPosition();
+            left = left || position < HOME - RA_LIMIT || position > HOME + RA_LIMIT;
+        }
+        double seconds = (Sim::now() - start) / 1e6;
+        taken.add(seconds);
+        outside += left ? 1 : 0;
+        if (planner)
+            maxEtaErr = fmax(maxEtaErr, fabs(seconds - eta / 1000.0));
+    }
+
+    char note[96];
+    if (planner)
+        snprintf(note, sizeof(note), "(%u turned around, ETA off by %.2f s at most; %u left the limits)", turned,
+                 maxEtaErr, outside);
+    else
+        snprintf(note, sizeof(note), "(%u left the limits)", outside);
+    printTotals(planner ? "planner, +-135 deg limits" : "host: always CW", taken, note);
+    return !planner || (outside == 0 && maxEtaErr < 1.0);
+}
+
+/* RA / Dec GOTOs one after the other at 52N 5E, to random targets
+ * above 20 degrees near the meridian (within 2 hours), with the pier
+ * side from the hour angle or from the planner (15 degree overlap).
+ */
+static bool simulateRadecGotos(uint32_t count, uint32_t seed, bool planner)
+{
+    const double lat = 52.0;
+    const double lon = 5.0;
+    const int64_t unixMs = 1792353600000LL; // 2026-10-18 20:00 UTC
+
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    std::string site = SimMount::toHex((uint32_t)llround(lat / 360.0 * 16777216.0) & 0xFFFFFF) +
+                       SimMount::toHex((uint32_t)llround(lon / 360.0 * 16777216.0) & 0xFFFFFF);
+    uint32_t days = (uint32_t)(unixMs / 86400000);
+    uint32_t msOfDay = (uint32_t)(unixMs % 86400000);
+    std::string time = SimMount::toHex(days).substr(0, 4) + SimMount::toHex(msOfDay / 1000) +
+                       SimMount::toHex(msOfDay % 1000).substr(0, 4);
+    if (!mount.expectOk(":F3") || !mount.expectOk(":Z112" + site))
+        return false;
+    const uint64_t timeSent = Sim::now();
+    if (!mount.expectOk(":Z113" + time) || (planner && !mount.expectOk(":Z120010F")))
+        return false;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> haDist(-30.0, 30.0);
+    std::uniform_real_distribution<double> decDist(-15.0, 85.0);
+    Totals taken;
+    uint32_t flipped = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int64_t ms = unixMs - CelestialTransform::J2000_UNIX_MS + (int64_t)((Sim::now() - timeSent) / 1000);
+        double ha = haDist(rng);
+        double dec = decDist(rng);
+        double ra = fmod(SkyReference::siderealTime(ms) + lon - ha + 720.0, 360.0);
+        std::string payload = SimMount::toHex((uint32_t)llround(ra / 360.0 * 16777216.0) & 0xFFFFFF) +
+                              SimMount::toHex((uint32_t)llround(dec / 360.0 * 16777216.0) & 0xFFFFFF);
+        uint32_t side = 0;
+        uint64_t start = Sim::now();
+        if (!mount.query(":Z114" + payload, &side))
+            return false;
+        if (side != (uint32_t)CelestialTransform::autoPierSide((int32_t)llround(ha / 360.0 * 4294967296.0)))
+            flipped++;
+        uint32_t active = 1;
+        while (active)
+        {
+            mount.runFor(100000);
+            if (!mount.query(":Z11504", &active))
+                return false;
+        }
+        taken.add((Sim::now() - start) / 1e6);
+    }
+
+    char note[64];
+    snprintf(note, sizeof(note), "(%u on the other side)", flipped);
+    printTotals(planner ? "pier side: planner" : "pier side: hour angle", taken, note);
+    return true;
+}
+
+/* Usage: planner [gotos] [seed] */
+int Sim::scenarioPlanner(int argc, char **argv)
+{
+    uint32_t count = argc > 0 ? (uint32_t)atoi(argv[0]) : 40;
+    uint32_t seed = argc > 1 ? (uint32_t)atoi(argv[1]) : 1;
+    std::mt19937 rng(seed);
+    bool ok = estimate(100000, rng);
+
+    printf("\n%u simulated RA axis GOTOs:          mean s    max s\n", count);
+    ok = simulateAxisGotos(count, seed, false) && ok;
+    ok = simulateAxisGotos(count, seed, true) && ok;
+
+    printf("\n%u simulated RA / Dec GOTOs:         mean s    max s\n", count);
+    ok = simulateRadecGotos(count, seed, false) && ok;
+    ok = simulateRadecGotos(count, seed, true) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioRadec.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: on-device RA / Dec transforms and GOTOs against a double precision reference
+ */
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+#include <Preferences.h>
+
+#include "CelestialTransform.hpp"
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+#include "SkyReference.hpp"
+
+using namespace Sim;
+using SkyReference::wrap;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+static const double Q32_PER_DEGREE = 4294967296.0 / 360.0;
+
+/* Fixed point transforms against the reference for random times
+ * (2000-2050), sites and targets, and how many per second the host
+ * manages.
+ */
+static bool checkTransforms(uint32_t count)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double maxLst = 0.0;
+    double maxAxis = 0.0;
+    uint32_t positionsOff = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int64_t ms = (int64_t)(uniform(rng) * 50 * 365.25 * 86400000.0);
+        double lon = uniform(rng) * 360.0 - 180.0;
+        double lat = uniform(rng) * 180.0 - 90.0;
+        double ra = uniform(rng) * 360.0;
+        double dec = asin(uniform(rng) * 2.0 - 1.0) * 180.0 / M_PI;
+
+        int32_t lonQ = (int32_t)llround(lon * Q32_PER_DEGREE);
+        uint32_t raQ = (uint32_t)llround(ra * Q32_PER_DEGREE);
+        int32_t decQ = (int32_t)llround(dec * Q32_PER_DEGREE);
+        uint32_t lst = CelestialTransform::siderealTime(ms) + (uint32_t)lonQ;
+        int32_t ha = (int32_t)(lst - raQ);
+        int32_t raAxis = 0;
+        int32_t decAxis = 0;
+        CelestialTransform::toAxes(ha, decQ, PierSideEnum::AUTO, lat < 0, &raAxis, &decAxis);
+
+        double refLst = wrap(SkyReference::siderealTime(ms) + lon);
+        double refHa = wrap(refLst - ra);
+        double refRa = 0.0;
+        double refDec = 0.0;
+        bool east = (ha >= 0); // Same side, right at the meridian the two may disagree
+        SkyReference::toAxes(refHa, dec, east, lat < 0, &refRa, &refDec);
+
+        maxLst = fmax(maxLst, fabs(wrap((int32_t)lst / Q32_PER_DEGREE - refLst)) * 3600.0);
+        double raErr = fabs(wrap(raAxis / Q32_PER_DEGREE - refRa)) * 3600.0;
+        double decErr = fabs(wrap(decAxis / Q32_PER_DEGREE - refDec)) * 3600.0;
+        maxAxis = fmax(maxAxis, fmax(raErr, decErr));
+
+        // Positions: at most one unit off the reference rounding (the angles differ by up to an arcsec)
+        int64_t refRaPos = 0x800000 + llround(refRa / 360.0 * MICROSTEPS_PER_REV);
+        int64_t refDecPos = 0x800000 + llround(refDec / 360.0 * MICROSTEPS_PER_REV);
+        if (llabs((int64_t)CelestialTransform::toPosition(raAxis) - refRaPos) > (int64_t)(raErr / ARCSEC_PER_UNIT) + 1 ||
+            llabs((int64_t)CelestialTransform::toPosition(decAxis) - refDecPos) > (int64_t)(decErr / ARCSEC_PER_UNIT) + 1)
+            positionsOff++;
+    }
+
+    // Throughput, the same steps as a GOTO_RADEC
+    const uint32_t loops = 2000000;
+    volatile uint32_t sink = 0;
+    int64_t ms = 845000000000LL;
+    uint32_t ra = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; i++)
+    {
+        int32_t raAxis = 0;
+        int32_t decAxis = 0;
+        ra += 0x9E3779B9;
+        uint32_t lst = CelestialTransform::siderealTime(ms += 997);
+        CelestialTransform::toAxes((int32_t)(lst - ra), (int32_t)ra >> 2, PierSideEnum::AUTO, false, &raAxis, &decAxis);
+        sink += CelestialTransform::toPosition(raAxis) + CelestialTransform::toPosition(decAxis);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Transforms: %u random, max error sidereal time %.3f\" / axes %.3f\", positions off %u; %.1f M/s on the host\n",
+           count, maxLst, maxAxis, positionsOff, loops / seconds / 1e6);
+    return maxLst < 2.0 && maxAxis < 2.0 && positionsOff == 0;
+}
+
+struct Target
+{
+    const char *name;
+    double ra;  // degrees
+    double dec; // degrees
+};
+
+/* GOTOs on a simulated mount at 52N 5E, one GOTO_RADEC command each,
+ * checked against the reference once tracking started and 10 minutes
+ * later.
+ */
+static bool checkGotos(double trackMinutes)
+{
+    const double lat = 52.0;
+    const double lon = 5.0;
+    const int64_t unixMs = 1792360800000LL; // 2026-10-18 20:00 UTC
+
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    std::string reply;
+    std::string site = SimMount::toHex((uint32_t)llround(lat / 360.0 * 16777216.0) & 0xFFFFFF) +
+                       SimMount::toHex((uint32_t)llround(lon / 360.0 * 16777216.0) & 0xFFFFFF);
+    uint32_t days = (uint32_t)(unixMs / 86400000);
+    uint32_t msOfDay = (uint32_t)(unixMs % 86400000);
+    std::string time = SimMount::toHex(days).substr(0, 4) + SimMount::toHex(msOfDay / 1000) +
+                       SimMount::toHex(msOfDay % 1000).substr(0, 4);
+    if (!mount.command(":F3", &reply) || !mount.command(":Z112" + site, &reply) ||
+        reply != "=")
+        return false;
+    const uint64_t timeSent = Sim::now();
+    if (!mount.command(":Z113" + time, &reply) || reply != "=")
+        return false;
+
+    const Target targets[] = {
+        {"Vega", 279.2347, 38.7837},
+        {"Deneb", 310.3580, 45.2803},
+        {"Capella", 79.1723, 45.9980},
+        {"Fomalhaut", 344.4128, -29.6222},
+        {"Polaris", 37.9546, 89.2641},
+        {"M31", 10.6847, 41.2692},
+        {"Altair", 297.6958, 8.8683},
+    };
+
+    printf("%-16s %5s %8s %12s %12s %12s\n", "target", "side", "slew s", "start \"", "tracked \"", "readback \"");
+    bool ok = true;
+    for (const Target &target : targets)
+    {
+        std::string payload = SimMount::toHex((uint32_t)llround(target.ra / 360.0 * 16777216.0) & 0xFFFFFF) +
+                              SimMount::toHex((uint32_t)llround(target.dec / 360.0 * 16777216.0) & 0xFFFFFF);
+        uint32_t side = 0;
+        uint64_t start = Sim::now();
+        if (!mount.query(":Z114" + payload, &side))
+            return false;
+        uint32_t active = 1;
+        while (active)
+        {
+            mount.runFor(100000);
+            if (!mount.query(":Z11504", &active))
+                return false;
+        }
+        double slew = (Sim::now() - start) / 1e6;
+
+        // Pointing error: the motor positions against the reference axes for the time now
+        auto error = [&]()
+        {
+            int64_t ms = unixMs - CelestialTransform::J2000_UNIX_MS + (int64_t)((Sim::now() - timeSent) / 1000);
+            double ha = wrap(SkyReference::siderealTime(ms) + lon - target.ra);
+            double raAxis = 0.0;
+            double decAxis = 0.0;
+            SkyReference::toAxes(ha, target.dec, side == (uint32_t)PierSideEnum::EAST, false, &raAxis, &decAxis);
+            double raErr = wrap(((int32_t)(mount.getMotor(AxisEnum::AXIS_RA)->getPosition() - 0x800000)) * ARCSEC_PER_UNIT / 3600.0 - raAxis);
+            double decErr = wrap(((int32_t)(mount.getMotor(AxisEnum::AXIS_DEC)->getPosition() - 0x800000)) * ARCSEC_PER_UNIT / 3600.0 - decAxis);
+            return hypot(raErr * cos(target.dec * M_PI / 180.0), decErr) * 3600.0;
+        };
+        double startErr = error();
+
+        // Read back through GET_POINTING
+        uint32_t ra = 0;
+        uint32_t dec = 0;
+        if (!mount.query(":Z11500", &ra) || !mount.query(":Z11501", &dec))
+            return false;
+        double readback = hypot(wrap(ra * 360.0 / 16777216.0 - target.ra) * cos(target.dec * M_PI / 180.0),
+                                wrap(((int32_t)(dec << 8) >> 8) * 360.0 / 16777216.0 - target.dec)) *
+                          3600.0;
+
+        mount.runFor((uint64_t)(trackMinutes * 60e6));
+        double trackedErr = error();
+        printf("%-16s %5s %8.1f %12.2f %12.2f %12.2f\n", target.name, (side == (uint32_t)PierSideEnum::EAST) ? "E" : "W",
+               slew, startErr, trackedErr, readback);
+        ok = ok && startErr < 3.0 && trackedErr < 3.0 && readback < 3.0;
+    }
+
+    return ok;
+}
+
+/* Usage: radec [transforms] [tracking minutes] */
+int Sim::scenarioRadec(int argc, char **argv)
+{
+    uint32_t count = argc > 0 ? (uint32_t)atoi(argv[0]) : 100000;
+    double minutes = argc > 1 ? atof(argv[1]) : 10.0;
+    bool ok = checkTransforms(count);
+    ok = checkGotos(minutes) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioRates.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Tracking accuracy of the built-in rates against the host step period
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+/* Tracks RA for a while at each built-in rate (and at sidereal through
+ * :I, the way hosts do it) and measures the step rate from the time of
+ * the first and the last step the driver got, which is good to a tick
+ * over the whole run rather than to a step.
+ * Usage: rates [hours]
+ */
+int Sim::scenarioRates(int argc, char **argv)
+{
+    double hours = argc > 0 ? atof(argv[0]) : 1.0;
+
+    struct Rate
+    {
+        const char *name;
+        TrackingRateEnum rate;
+        double arcsecPerSecond; // Exact, from the definitions
+    };
+    const double sidereal = 1296000.0 / 86164.0905;
+    const Rate rates[] = {
+        {"sidereal (:I)", TrackingRateEnum::HOST, sidereal},
+        {"sidereal", TrackingRateEnum::SIDEREAL, sidereal},
+        {"lunar", TrackingRateEnum::LUNAR, sidereal - 1296000.0 / (27.321661 * 86400.0)},
+        {"solar", TrackingRateEnum::SOLAR, 15.0},
+        {"King", TrackingRateEnum::KING, 15.0369},
+    };
+
+    printf("%-14s %14s %14s %10s\n", "rate", "steps/s", "expected", "error ppm");
+    bool ok = true;
+    for (const Rate &rate : rates)
+    {
+        SimMount mount;
+        mount.begin();
+        uint64_t steps = 0;
+        uint64_t first = 0;
+        uint64_t last = 0;
+        mount.setStepListener([&](AxisEnum axis, int32_t)
+                              {
+                                  if (axis != AxisEnum::AXIS_RA)
+                                      return;
+                                  if (steps++ == 0)
+                                      first = Sim::now();
+                                  last = Sim::now(); });
+
+        std::string reply;
+        std::string setup = (rate.rate == TrackingRateEnum::HOST)
+                                ? ":I1" + SimMount::toHex((uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5))
+                                : ":Z10D" + SimMount::toHex((uint32_t)rate.rate).substr(0, 2);
+        if (!mount.command(":F3", &reply) || !mount.command(":G110", &reply) || !mount.command(setup, &reply) ||
+            reply != "=" || !mount.command(":J1", &reply) || reply != "=")
+            return 1;
+        mount.runFor((uint64_t)(hours * 3600e6));
+        mount.command(":K1", &reply);
+
+        double measured = (steps - 1) / ((last - first) / 1e6);
+        double expected = rate.arcsecPerSecond * MICROSTEPS_PER_REV / 1296000.0;
+        double ppm = (measured / expected - 1.0) * 1e6;
+        printf("%-14s %14.6f %14.6f %10.3f\n", rate.name, measured, expected, ppm);
+        if (rate.rate != TrackingRateEnum::HOST && (ppm > 1.0 || ppm < -1.0))
+            ok = false;
+    }
+    return ok ? 0 : 1;
+}
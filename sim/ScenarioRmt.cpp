@@ -0,0 +1,241 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioRmt.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: RMT step trains decoded against the stepper's ramp
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "StepSegments.hpp"
+
+using namespace Sim;
+using namespace SynScanControl;
+
+struct RampProfile
+{
+    const char *name;
+    float accel;
+    float maxSpeed;
+    int32_t distance;
+    // Retarget to half the stopping distance after this many steps (0: never), the ramp turns around
+    int32_t retargetAt;
+};
+
+static InterruptStepper makeStepper(const RampProfile &profile)
+{
+    InterruptStepper stepper(RA_STEP, RA_DIR, MAX_PULSE_PER_SECOND, false);
+    stepper.setAcceleration(profile.accel);
+    stepper.setMaxSpeed(profile.maxSpeed);
+    stepper.initPosition(0);
+    stepper.setTargetPosition(profile.distance);
+    return stepper;
+}
+
+static void retarget(InterruptStepper *stepper)
+{
+    stepper->setTargetPosition(stepper->getPosition() + stepper->stepsToStop() / 2);
+}
+
+static bool turnsAround(InterruptStepper &stepper, int32_t distance)
+{
+    int32_t togo = stepper.distanceToGo();
+    return stepper.getN() == 0 && ((distance > 0) ? togo < 0 : togo > 0);
+}
+
+/* The ramp as the stepper computes it: each step cn after the one
+ * before, the first c0 after the start, in us.
+ */
+static std::vector<double> referenceSteps(const RampProfile &profile, int32_t retargetAt)
+{
+    InterruptStepper stepper = makeStepper(profile);
+    std::vector<double> steps;
+    double t = 0.0;
+    while (stepper.getSpeed() != 0.0f)
+    {
+        if ((int32_t)steps.size() == retargetAt)
+            retarget(&stepper);
+        t += stepper.getCn();
+        steps.push_back(t);
+        stepper.advance();
+        if (turnsAround(stepper, profile.distance))
+            break;
+        stepper.computeNewSpeed();
+    }
+    return steps;
+}
+
+/* The same ramp off the tick ISR: a step every pulsesPerStep ticks.
+ * Empty if it needs a step rate over MAX_PULSE_PER_SECOND.
+ */
+static std::vector<double> tickSteps(const RampProfile &profile, int32_t retargetAt)
+{
+    InterruptStepper stepper = makeStepper(profile);
+    std::vector<double> steps;
+    uint64_t tick = 0;
+    uint32_t ticker = 0;
+    while (stepper.getSpeed() != 0.0f)
+    {
+        uint32_t pps = stepper.getPulsesPerStep();
+        if (pps == 0)
+            return std::vector<double>();
+        tick++;
+        if (++ticker % pps > 0)
+            continue;
+        if ((int32_t)steps.size() == retargetAt)
+            retarget(&stepper);
+        steps.push_back(tick * (double)TICK_PERIOD_US);
+        stepper.advance();
+        if (turnsAround(stepper, profile.distance))
+            break;
+        stepper.computeNewSpeed();
+    }
+    return steps;
+}
+
+struct RmtTrain
+{
+    std::vector<double> steps;
+    uint32_t items = 0;
+    uint32_t segments = 0;
+    uint32_t badItems = 0;
+    uint32_t encoded = 0;
+    bool turnedAround = false;
+    int32_t retargetAt = 0;
+};
+
+/* Plans and encodes the ramp the way the RMT driver asks for it (a
+ * memory block, then half blocks), then decodes the items: a step is
+ * every low to high edge. Items must hold both levels for at least a
+ * tick, and pulses must be STEPPER_PULSE_WIDTH_US long.
+ */
+static RmtTrain rmtSteps(const RampProfile &profile)
+{
+    const uint32_t BLOCK = 64;
+    InterruptStepper stepper = makeStepper(profile);
+    StepPlanner planner;
+    StepEncoder encoder;
+    planner.begin(&stepper);
+    encoder.reset();
+
+    RmtTrain train;
+    train.retargetAt = -1;
+    std::vector<RmtItem> items;
+    uint32_t wanted = BLOCK;
+    bool ended = false;
+    while (!ended)
+    {
+        RmtItem block[BLOCK];
+        uint32_t count = encoder.fill(block, wanted);
+        while (count < wanted)
+        {
+            // Between segments, like setMotion(false) / halt() under the mux
+            if (profile.retargetAt > 0 && train.retargetAt < 0 && stepper.getPosition() >= profile.retargetAt)
+            {
+                train.retargetAt = stepper.getPosition();
+                retarget(&stepper);
+            }
+            StepSegment segment;
+            if (!planner.next(&segment))
+                break;
+            train.segments++;
+            encoder.load(segment);
+            count += encoder.fill(block + count, wanted - count);
+        }
+        items.insert(items.end(), block, block + count);
+        ended = count < wanted;
+        wanted = BLOCK / 2;
+    }
+    train.items = items.size();
+    train.encoded = encoder.getSteps();
+    train.turnedAround = planner.turnsAround();
+
+    uint64_t t = 0;
+    bool level = false;
+    for (const RmtItem &item : items)
+    {
+        if (item.duration0 == 0 || item.duration1 == 0)
+            train.badItems++;
+        if (item.level1 && item.duration1 != StepEncoder::HIGH_TICKS)
+            train.badItems++;
+        const uint32_t halves[2][2] = {{item.level0, item.duration0}, {item.level1, item.duration1}};
+        for (const uint32_t *half : halves)
+        {
+            if (!level && half[0])
+                train.steps.push_back(t / (double)StepPlanner::TICKS_PER_US);
+            level = half[0];
+            t += half[1];
+        }
+    }
+    return train;
+}
+
+static double maxError(const std::vector<double> &steps, const std::vector<double> &reference)
+{
+    double error = 0.0;
+    for (size_t i = 0; i < steps.size() && i < reference.size(); i++)
+        error = fmax(error, fabs(steps[i] - reference[i]));
+    return error;
+}
+
+/* Usage: rmt [steps] */
+int Sim::scenarioRmt(int argc, char **argv)
+{
+    int32_t distance = argc > 0 ? atoi(argv[0]) : 40000;
+    const RampProfile profiles[] = {
+        {"GOTO ramp", MOTOR_ACCEL, MAX_PULSE_PER_SECOND / 2, distance, 0},
+        {"GOTO ramp, backwards", MOTOR_ACCEL, MAX_PULSE_PER_SECOND / 2, -distance, 0},
+        {"retargeted, turns around", MOTOR_ACCEL, MAX_PULSE_PER_SECOND / 2, distance, distance / 4},
+        {"40 kHz ramp", 4 * MOTOR_ACCEL, 2 * MAX_PULSE_PER_SECOND, 4 * distance, 0},
+        {"20 Hz ramp (long steps)", 20, 20, 200, 0},
+    };
+
+    bool ok = true;
+    printf("profile                     steps   items  segments   RMT err us   tick err us   top kHz\n");
+    for (const RampProfile &profile : profiles)
+    {
+        RmtTrain train = rmtSteps(profile);
+        std::vector<double> reference = referenceSteps(profile, train.retargetAt);
+        std::vector<double> ticks = tickSteps(profile, train.retargetAt);
+
+        double top = 0.0;
+        for (size_t i = 1; i < train.steps.size(); i++)
+            top = fmax(top, 1000.0 / (train.steps[i] - train.steps[i - 1]));
+        double rmtError = maxError(train.steps, reference);
+        char tickError[16] = "stalls";
+        if (!ticks.empty())
+            snprintf(tickError, sizeof(tickError), "%.1f", maxError(ticks, reference));
+        printf("%-25s %7zu %7u %9u %12.3f %13s %9.2f\n", profile.name, train.steps.size(), train.items, train.segments,
+               rmtError, tickError, top);
+
+        // Every step where the stepper put it, to well within a us, and nothing else on the pin
+        bool match = train.steps.size() == reference.size() && train.encoded == reference.size() && train.badItems == 0 &&
+                     rmtError < 1.0;
+        if (!match)
+            printf("  mismatch: %zu steps decoded, %u encoded, %zu expected, %u bad items%s\n", train.steps.size(),
+                   train.encoded, reference.size(), train.badItems, train.turnedAround ? ", turned around" : "");
+        ok = ok && match;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioSatellite.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Sim scenario: SGP4 against reference vectors, and following satellite passes
+ */
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <Preferences.h>
+
+#include "CelestialTransform.hpp"
+#include "Scenarios.hpp"
+#include "Sgp4.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+#include "SkyReference.hpp"
+
+using namespace Sim;
+using SkyReference::wrap;
+
+static const double ARCSEC_PER_UNIT = 1296000.0 / MICROSTEPS_PER_REV;
+
+// An ISS-like orbit, with the epoch the day before the passes looked at
+static const char *ISS_LINE1 = "1 25544U 98067A   26290.50000000  .00016717  00000-0  10270-3 0  9999";
+static const char *ISS_LINE2 = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.50103472 47750";
+
+struct ReferenceVector
+{
+    const char *line1;
+    const char *line2;
+    double minutes;
+    double r[3]; // km
+    double v[3]; // km/s
+};
+
+/* From the verification runs that come with Vallado's SGP4 (tcppver.out).
+ * 06251's line 2 had its revolution number / checksum redone, neither
+ * goes into the propagation.
+ */
+static const char *SAT5_LINE1 = "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753";
+static const char *SAT5_LINE2 = "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667";
+static const char *SAT6251_LINE1 = "1 06251U 62025E   06176.82412014  .00008885  00000-0  12808-3 0  3985";
+static const char *SAT6251_LINE2 = "2 06251  58.0579  54.0425 0030035 139.1568 221.1854 15.56387291  6796";
+
+static const ReferenceVector REFERENCE[] = {
+    {SAT5_LINE1, SAT5_LINE2, 0.0, {7022.46529266, -1400.08296755, 0.03995155}, {1.893841015, 6.405893759, 4.534807250}},
+    {SAT5_LINE1, SAT5_LINE2, 360.0, {-7154.03120202, -3783.17682504, -3536.19412294}, {4.741887409, -4.151817765, -2.093935425}},
+    {SAT5_LINE1, SAT5_LINE2, 720.0, {-7134.59340119, 6531.68641334, 3260.27186483}, {-4.113793027, -2.911922039, -2.557327851}},
+    {SAT5_LINE1, SAT5_LINE2, 1080.0, {5568.53901181, 4492.06992591, 3863.87641983}, {-4.209106476, 5.159719888, 2.744852980}},
+    {SAT5_LINE1, SAT5_LINE2, 1440.0, {-938.55923943, -6268.18748831, -4294.02924751}, {7.536105209, -0.427127707, 0.989878080}},
+    {SAT6251_LINE1, SAT6251_LINE2, 0.0, {3988.31022699, 5498.96657235, 0.90055879}, {-3.290032738, 2.357652820, 6.496623475}},
+    {SAT6251_LINE1, SAT6251_LINE2, 120.0, {-3935.69800083, 409.10980837, 5471.33577327}, {-3.374784183, -6.635211043, -1.942056221}},
+};
+
+/* The propagator against the reference vectors, that broken lines
+ * are turned down, and how long a propagation takes on the host.
+ */
+static bool checkPropagator()
+{
+    double maxR = 0.0;
+    double maxV = 0.0;
+    bool ok = true;
+    for (const ReferenceVector &ref : REFERENCE)
+    {
+        Sgp4 sgp4;
+        double r[3];
+        double v[3];
+        if (!sgp4.parse(ref.line1, ref.line2) || !sgp4.propagate(ref.minutes, r, v))
+        {
+            printf("Satellite %.5s: no propagation at %.0f min\n", ref.line1 + 2, ref.minutes);
+            ok = false;
+            continue;
+        }
+        maxR = fmax(maxR, sqrt(pow(r[0] - ref.r[0], 2) + pow(r[1] - ref.r[1], 2) + pow(r[2] - ref.r[2], 2)));
+        maxV = fmax(maxV, sqrt(pow(v[0] - ref.v[0], 2) + pow(v[1] - ref.v[1], 2) + pow(v[2] - ref.v[2], 2)));
+    }
+
+    // A digit off in either line, or a deep space orbit (a GPS satellite)
+    std::string badChecksum = ISS_LINE1;
+    badChecksum[30] = '1';
+    Sgp4 sgp4;
+    bool rejects = !sgp4.parse(badChecksum.c_str(), ISS_LINE2) && !sgp4.parse(ISS_LINE1, SAT5_LINE2) &&
+                   !sgp4.parse("1 24876U 97035A   26290.50000000  .00000000  00000-0  00000-0 0  9997",
+                               "2 24876  55.5000 100.0000 0050000  50.0000 310.0000  2.00563000 12340");
+
+    // Host timing, over a day at 40 ms steps
+    sgp4.parse(ISS_LINE1, ISS_LINE2);
+    const uint32_t loops = 1000000;
+    double sink = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < loops; i++)
+    {
+        double r[3];
+        double v[3];
+        sgp4.propagate(1440.0 + i * (SATELLITE_UPDATE_MS / 60000.0), r, v);
+        sink += r[0];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("SGP4: %u reference vectors, max error %.3f mm / %.4f mm/s; bad lines %s; %.3f us per propagation on the host%s\n",
+           (uint32_t)(sizeof(REFERENCE) / sizeof(REFERENCE[0])), maxR * 1e6, maxV * 1e6,
+           rejects ? "turned down" : "ACCEPTED", seconds / loops * 1e6, (sink == 0.0) ? " " : "");
+    return ok && maxR < 1e-3 && maxV < 1e-6 && rejects;
+}
+
+struct Pass
+{
+    int64_t rise; // ms since J2000
+    int64_t set;
+    double culmination; // degrees
+};
+
+static void reference(const Sgp4 &sgp4, int64_t ms, double lat, double lon, double height, double *ha, double *dec, double *elevation)
+{
+    double r[3];
+    double v[3];
+    sgp4.propagate((ms - sgp4.getEpoch()) / 60000.0, r, v);
+    SkyReference::satellite(r, v, ms, lat, lon, height, ha, dec, elevation);
+}
+
+// Passes of the satellite over the next two days, to the second
+static std::vector<Pass> findPasses(const Sgp4 &sgp4, int64_t from, double lat, double lon, double height)
+{
+    std::vector<Pass> passes;
+    Pass pass = {0, 0, -90.0};
+    bool up = false;
+    for (int64_t ms = from; ms < from + 2 * 86400000LL; ms += 1000)
+    {
+        double ha = 0.0;
+        double dec = 0.0;
+        double elevation = 0.0;
+        reference(sgp4, ms, lat, lon, height, &ha, &dec, &elevation);
+        if (elevation >= 0.0 && !up)
+            pass = {ms, 0, elevation};
+        else if (elevation < 0.0 && up)
+        {
+            pass.set = ms;
+            passes.push_back(pass);
+        }
+        pass.culmination = fmax(pass.culmination, elevation);
+        up = elevation >= 0.0;
+    }
+    return passes;
+}
+
+/* One pass on a simulated mount: SET_SITE, SET_TIME a couple of
+ * minutes before it rises, the TLE and GOTO_SATELLITE, then the motor
+ * positions against the reference every 50 ms until it set.
+ */
+static bool followPass(const Sgp4 &sgp4, const Pass &pass, double lat, double lon, double height)
+{
+    Sim::eraseFlash();
+    SimMount mount;
+    mount.begin();
+    GotoController *gotoController = mount.getGotoController();
+    Motor *raMotor = mount.getMotor(AxisEnum::AXIS_RA);
+    Motor *decMotor = mount.getMotor(AxisEnum::AXIS_DEC);
+
+    std::string reply;
+    std::string site = SimMount::toHex((uint32_t)llround(lat / 360.0 * 16777216.0) & 0xFFFFFF) +
+                       SimMount::toHex((uint32_t)llround(lon / 360.0 * 16777216.0) & 0xFFFFFF) +
+                       SimMount::toHex((uint32_t)llround(height) & 0xFFFF).substr(0, 4);
+    int64_t unixMs = pass.rise - 120000 + CelestialTransform::J2000_UNIX_MS;
+    uint32_t days = (uint32_t)(unixMs / 86400000);
+    uint32_t msOfDay = (uint32_t)(unixMs % 86400000);
+    std::string time = SimMount::toHex(days).substr(0, 4) + SimMount::toHex(msOfDay / 1000) +
+                       SimMount::toHex(msOfDay % 1000).substr(0, 4);
+    if (!mount.command(":F3", &reply) || !mount.command(":Z112" + site, &reply) || reply != "=")
+        return false;
+    const uint64_t timeSent = Sim::now();
+    if (!mount.command(":Z113" + time, &reply) || reply != "=" ||
+        !mount.command(std::string(":Z119") + ISS_LINE1, &reply) || reply != "=" ||
+        !mount.command(std::string(":Z119") + ISS_LINE2, &reply) || reply != "=")
+        return false;
+    uint32_t side = 0;
+    if (!mount.query(":Z11A", &side))
+        return false;
+    auto mountMs = [&]()
+    { return unixMs - CelestialTransform::J2000_UNIX_MS + (int64_t)((Sim::now() - timeSent) / 1000); };
+
+    // Settled: the error once following for this long
+    const int64_t SETTLE_MS = 5000;
+    int64_t followingFrom = -1;
+    uint32_t stops = 0;
+    uint32_t reversals[2] = {0, 0};
+    SlewDirectionEnum lastDir[2] = {SlewDirectionEnum::NONE, SlewDirectionEnum::NONE};
+    double maxErr = 0.0;
+    double sumSq = 0.0;
+    uint32_t samples = 0;
+    double peakRate[2] = {0.0, 0.0};
+    int32_t lastPosition[2] = {0, 0};
+    while (gotoController->isActive() && mountMs() < pass.set + 60000)
+    {
+        mount.runFor(50000);
+        if (!gotoController->isFollowing())
+            continue;
+        int64_t ms = mountMs();
+        if (followingFrom < 0)
+            followingFrom = ms;
+
+        Motor *motors[2] = {raMotor, decMotor};
+        for (int i = 0; i < 2; i++)
+        {
+            if (!motors[i]->isMoving())
+                stops++;
+            SlewDirectionEnum dir = motors[i]->getSlewDirection();
+            if (lastDir[i] != SlewDirectionEnum::NONE && dir != lastDir[i])
+                reversals[i]++;
+            lastDir[i] = dir;
+            int32_t position = (int32_t)motors[i]->getPosition();
+            // Positions wrap around with the axis, so wrap the difference too
+            if (samples > 0)
+                peakRate[i] = fmax(peakRate[i], fabs(wrap((position - lastPosition[i]) * ARCSEC_PER_UNIT / 3600.0)) / 0.05);
+            lastPosition[i] = position;
+        }
+
+        double ha = 0.0;
+        double dec = 0.0;
+        double elevation = 0.0;
+        reference(sgp4, ms, lat, lon, height, &ha, &dec, &elevation);
+        double raAxis = 0.0;
+        double decAxis = 0.0;
+        SkyReference::toAxes(ha, dec, side == (uint32_t)PierSideEnum::EAST, lat < 0, &raAxis, &decAxis);
+        double raErr = wrap(((int32_t)(raMotor->getPosition() - 0x800000)) * ARCSEC_PER_UNIT / 3600.0 - raAxis);
+        double decErr = wrap(((int32_t)(decMotor->getPosition() - 0x800000)) * ARCSEC_PER_UNIT / 3600.0 - decAxis);
+        double err = hypot(raErr * cos(dec * M_PI / 180.0), decErr) * 3600.0;
+        if (ms - followingFrom >= SETTLE_MS)
+        {
+            maxErr = fmax(maxErr, err);
+            sumSq += err * err;
+        }
+        samples++;
+    }
+
+    int64_t followedUntil = mountMs();
+    double rms = sqrt(sumSq / fmax(samples, 1));
+    printf("%8.1f %5s %5s %9.1f %9.1f %6u %5u %5u %8.2f %8.2f %9.1f %9.1f\n", pass.culmination,
+           (side == (uint32_t)PierSideEnum::EAST) ? "E" : "W",
+           (raMotor->getSlewSpeed() == SlewSpeedEnum::FAST) ? "fast" : "slow", (followingFrom - pass.rise) / 1000.0,
+           (followedUntil - pass.set) / 1000.0, stops, reversals[0], reversals[1], peakRate[0], peakRate[1], maxErr, rms);
+    return followingFrom >= 0 && followingFrom - pass.rise < 5000 && followedUntil - pass.set < 5000 && stops == 0 &&
+           rms < 60.0;
+}
+
+/* Usage: satellite [passes] */
+int Sim::scenarioSatellite(int argc, char **argv)
+{
+    uint32_t count = argc > 0 ? (uint32_t)atoi(argv[0]) : 3;
+    bool ok = checkPropagator();
+
+    // 52N 5E, the passes from 2026-10-18 0h UTC on
+    const double lat = 52.0;
+    const double lon = 5.0;
+    const double height = 50.0;
+    Sgp4 sgp4;
+    sgp4.parse(ISS_LINE1, ISS_LINE2);
+    std::vector<Pass> passes = findPasses(sgp4, 1792281600000LL - CelestialTransform::J2000_UNIX_MS, lat, lon, height);
+
+    // Per update on the host: propagation and the topocentric transform
+    {
+        Sim::eraseFlash();
+        SimMount mount;
+        mount.begin();
+        GotoController *gotoController = mount.getGotoController();
+        gotoController->setSite((int32_t)llround(lat / 360.0 * 4294967296.0), (int32_t)llround(lon / 360.0 * 4294967296.0), 50);
+        gotoController->setTime(1792281600000LL);
+        gotoController->setTleLine(ISS_LINE1, Sgp4::LINE_LENGTH);
+        gotoController->setTleLine(ISS_LINE2, Sgp4::LINE_LENGTH);
+        const uint32_t loops = 1000000;
+        float elevation = 0;
+        float range = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < loops; i++)
+            gotoController->getSatellitePosition(&elevation, &range);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("Per update: %.3f us on the host (propagation and topocentric transform); %u passes in two days\n",
+               seconds / loops * 1e6, (uint32_t)passes.size());
+    }
+
+    printf("%8s %5s %5s %9s %9s %6s %5s %5s %8s %8s %9s %9s\n", "culm deg", "side", "step", "from s", "until s",
+           "stops", "rev R", "rev D", "RA d/s", "Dec d/s", "max \"", "rms \"");
+    uint32_t followed = 0;
+    for (const Pass &pass : passes)
+    {
+        if (followed >= count)
+            break;
+        if (pass.culmination < 10.0)
+            continue;
+        ok = followPass(sgp4, pass, lat, lon, height) && ok;
+        followed++;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/*
+ * Project Name: synscancontrol
+ * File: ScenarioServe.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Serve the simulated mount's SynScan UART on a pseudo-terminal
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+// Virtual time simulated per pass of the serve loop
+static const uint64_t SLICE_US = 1000;
+
+static int openPty()
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+        return -1;
+
+    struct termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/* Runs the mount in step with the wall clock (or `speed` times faster)
+ * and bridges its SynScan UART to a pty, so EQMOD / INDI / the replay
+ * tool can talk to it like to a real serial port. Replies are held back
+ * until they would have been fully sent at 9600 baud.
+ * Usage: serve [speed] [--log]
+ */
+int Sim::scenarioServe(int argc, char **argv)
+{
+    double speed = 1.0;
+    bool log = false;
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--log") == 0)
+            log = true;
+        else
+            speed = atof(argv[i]);
+    }
+    if (speed <= 0.0)
+        speed = 1.0;
+
+    int fd = openPty();
+    if (fd < 0)
+    {
+        perror("pty");
+        return 1;
+    }
+
+    SimMount mount;
+    mount.setLogEcho(log ? stderr : nullptr);
+    mount.begin();
+    HardwareSerial *serial = mount.getSynScanSerial();
+
+    printf("Serving the simulated mount on %s (%.1fx real time), Ctrl-C to stop\n", ptsname(fd), speed);
+    fflush(stdout);
+
+    using namespace std::chrono;
+    const steady_clock::time_point wallStart = steady_clock::now();
+    std::string pending;
+    char buffer[256];
+    while (true)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n > 0)
+            serial->hostWrite(std::string(buffer, n));
+        else if (n < 0 && errno != EAGAIN && errno != EIO)
+            break; // EIO just means nothing has the slave side open yet
+
+        mount.runFor(SLICE_US);
+
+        pending += serial->hostRead();
+        if (!pending.empty() && Sim::now() >= serial->getLastTxTime())
+        {
+            if (write(fd, pending.data(), pending.size()) < 0 && errno != EAGAIN)
+                break;
+            pending.clear();
+        }
+
+        // Keep virtual time in step with the wall clock
+        steady_clock::time_point due = wallStart + microseconds((uint64_t)(Sim::now() / speed));
+        std::this_thread::sleep_until(due);
+    }
+
+    close(fd);
+    return 0;
+}
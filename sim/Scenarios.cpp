@@ -0,0 +1,165 @@
+/*
+ * Project Name: synscancontrol
+ * File: Scenarios.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Simulation scenarios run by synscansim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+
+#include "Scenarios.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+static double wallSeconds()
+{
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool isRunning(SimMount &mount, char axis)
+{
+    std::string reply;
+    if (!mount.command(std::string(":f") + axis, &reply) || reply.size() != 4)
+        return false;
+    return charToHex(reply[2]) & 0x01;
+}
+
+// The position the motor reports should always match the steps the driver got
+static bool checkPositions(SimMount &mount, AxisEnum axis, const char *name)
+{
+    int64_t pins = mount.getPinPosition(axis);
+    int64_t motor = mount.getMotorPositionOffset(axis);
+    printf("%s steps: %llu, moved %lld by the pins, %lld by the motor\n", name,
+           (unsigned long long)mount.getStepCount(axis), (long long)pins, (long long)motor);
+    if (pins != motor)
+    {
+        printf("%s position mismatch: %lld\n", name, (long long)(motor - pins));
+        return false;
+    }
+    return true;
+}
+
+/* Sidereal tracking on RA for a number of hours (default 1), reports
+ * the achieved rate against the sidereal rate.
+ * Usage: track [hours]
+ */
+int Sim::scenarioTrack(int argc, char **argv)
+{
+    double hours = argc > 0 ? atof(argv[0]) : 1.0;
+
+    SimMount mount;
+    mount.begin();
+
+    uint32_t period = (uint32_t)(SIDEREAL_PULSE_PER_STEP + 0.5);
+    if (!mount.expectOk(":F3", true) || !mount.expectOk(":G110", true) ||
+        !mount.expectOk(":I1" + SimMount::toHex(period), true) || !mount.expectOk(":J1", true))
+        return 1;
+
+    const uint64_t start = Sim::now();
+    const int64_t startPins = mount.getPinPosition(AxisEnum::AXIS_RA);
+    const uint64_t duration = (uint64_t)(hours * 3600e6);
+    const double wallStart = wallSeconds();
+    mount.runFor(duration);
+    const double wall = wallSeconds() - wallStart;
+
+    double seconds = (Sim::now() - start) / 1e6;
+    double rate = (mount.getPinPosition(AxisEnum::AXIS_RA) - startPins) / seconds;
+    printf("Tracked %.2f h (virtual) in %.2f s (wall), %.0fx real time\n", hours, wall, seconds / wall);
+    printf("Step period: %u ticks\n", period);
+    printf("Rate: %.6f steps/s, sidereal %.6f steps/s, error %.1f ppm\n",
+           rate, SIDEREAL_STEP_PER_SECOND, (rate / SIDEREAL_STEP_PER_SECOND - 1.0) * 1e6);
+    printf("Drift: %.2f arcsec\n",
+           (rate - SIDEREAL_STEP_PER_SECOND) * seconds * 1296000.0 / MICROSTEPS_PER_REV);
+
+    return checkPositions(mount, AxisEnum::AXIS_RA, "RA") ? 0 : 1;
+}
+
+/* Random GOTOs on both axes, reports the landing error and duration.
+ * Usage: goto [count] [seed]
+ */
+int Sim::scenarioGoto(int argc, char **argv)
+{
+    int count = argc > 0 ? atoi(argv[0]) : 100;
+    unsigned seed = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    std::mt19937 rng(seed);
+
+    SimMount mount;
+    mount.begin();
+    if (!mount.expectOk(":F3", true))
+        return 1;
+
+    const char axes[2] = {'1', '2'};
+    const AxisEnum axisEnums[2] = {AxisEnum::AXIS_RA, AxisEnum::AXIS_DEC};
+    uint32_t maxError = 0;
+    double totalError = 0.0;
+    double totalTime = 0.0;
+    double maxTime = 0.0;
+    int timeouts = 0;
+
+    const double wallStart = wallSeconds();
+    for (int i = 0; i < count; i++)
+    {
+        char axis = axes[i % 2];
+        Motor *motor = mount.getMotor(axisEnums[i % 2]);
+
+        // Anywhere within half a revolution either side of the start
+        uint32_t position = motor->getPosition();
+        uint32_t home = (i % 2) ? 0x913640 : 0x800000;
+        std::uniform_int_distribution<uint32_t> dist(home - MICROSTEPS_PER_REV / 2 + 1, home + MICROSTEPS_PER_REV / 2 - 1);
+        uint32_t target = dist(rng);
+        const char *dir = (target > position) ? "00" : "01";
+
+        if (!mount.expectOk(std::string(":G") + axis + dir, true) ||
+            !mount.expectOk(std::string(":S") + axis + SimMount::toHex(target), true) ||
+            !mount.expectOk(std::string(":J") + axis, true))
+            return 1;
+
+        uint64_t start = Sim::now();
+        while (isRunning(mount, axis) && Sim::now() - start < 600000000ULL)
+            mount.runFor(50000);
+        if (isRunning(mount, axis))
+            timeouts++;
+        double seconds = (Sim::now() - start) / 1e6;
+
+        uint32_t reached = 0;
+        if (!mount.query(std::string(":j") + axis, &reached))
+            return 1;
+        uint32_t error = (reached > target) ? reached - target : target - reached;
+        maxError = max(maxError, error);
+        totalError += error;
+        totalTime += seconds;
+        maxTime = max(maxTime, seconds);
+    }
+    const double wall = wallSeconds() - wallStart;
+
+    printf("%d GOTOs in %.0f s (virtual), %.2f s (wall)\n", count, totalTime, wall);
+    printf("Duration: mean %.2f s, max %.2f s\n", totalTime / count, maxTime);
+    printf("Landing error: mean %.2f, max %u steps\n", totalError / count, maxError);
+    printf("Timeouts: %d\n", timeouts);
+
+    bool ok = checkPositions(mount, AxisEnum::AXIS_RA, "RA");
+    ok = checkPositions(mount, AxisEnum::AXIS_DEC, "DEC") && ok;
+    return (ok && timeouts == 0) ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+/*
+ * Project Name: synscancontrol
+ * File: Scenarios.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Simulation scenarios run by synscansim
+ */
+#ifndef SIM_SCENARIOS_H
+#define SIM_SCENARIOS_H
+
+namespace Sim
+{
+    /* Each scenario takes the command line arguments after its name
+     * and returns the process exit code (non-zero on failure).
+     */
+    int scenarioTrack(int argc, char **argv);
+    int scenarioGoto(int argc, char **argv);
+    int scenarioPhysics(int argc, char **argv);
+    int scenarioServe(int argc, char **argv);
+    int scenarioPec(int argc, char **argv);
+    int scenarioPecTrain(int argc, char **argv);
+    int scenarioGuide(int argc, char **argv);
+    int scenarioPulseGuide(int argc, char **argv);
+    int scenarioBacklash(int argc, char **argv);
+    int scenarioRates(int argc, char **argv);
+    int scenarioClock(int argc, char **argv);
+    int scenarioRadec(int argc, char **argv);
+    int scenarioAlign(int argc, char **argv);
+    int scenarioSatellite(int argc, char **argv);
+    int scenarioEphemeris(int argc, char **argv);
+    int scenarioPlanner(int argc, char **argv);
+    int scenarioLimits(int argc, char **argv);
+    int scenarioGears(int argc, char **argv);
+    int scenarioRmt(int argc, char **argv);
+} // namespace Sim
+
+#endif /* SIM_SCENARIOS_H */
@@ -0,0 +1,429 @@
+/*
+ * Project Name: synscancontrol
+ * File: SimHardware.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Simulated GPIO / timers / UART running on a deterministic virtual clock
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SimHardware.hpp"
+
+namespace
+{
+    const uint8_t NUM_PINS = 40;
+    const uint8_t NUM_LEDC_CHANNELS = 16;
+    const uint8_t NUM_HW_TIMERS = 4;
+    const uint32_t APB_CLOCK_MHZ = 80;
+
+    uint64_t _now = 0;
+    // Device clock ticks per virtual (true) microsecond, see Sim::setClockError()
+    double _clockRate = 1.0;
+    uint32_t _cpuMhz = 240;
+    uint8_t _pinLevels[NUM_PINS] = {0};
+    uint32_t _ledcDuty[NUM_LEDC_CHANNELS] = {0};
+    Sim::PinListener _pinListener;
+
+    struct Timer
+    {
+        void (*isr)(void) = nullptr;
+        esp_timer_cb_t callback = nullptr;
+        void *arg = nullptr;
+        uint64_t periodUs = 0;
+        uint64_t next = 0;
+        double nextExact = 0.0;
+        bool enabled = false;
+        // Scheduled once, disabling only holds the alarm back
+        bool armed = false;
+
+        // Timers count device clock ticks, next is rounded to the microsecond
+        void schedule(double from)
+        {
+            nextExact = from + periodUs / _clockRate;
+            next = (uint64_t)(nextExact + 0.5);
+        }
+    };
+
+    std::vector<Timer> _timers;
+
+    struct PinInterrupt
+    {
+        void (*fn)(void *) = nullptr;
+        void *arg = nullptr;
+        int mode = 0;
+    };
+
+    PinInterrupt _pinInterrupts[NUM_PINS];
+
+    void _setPin(uint8_t pin, uint8_t level)
+    {
+        if (pin >= NUM_PINS)
+            return;
+        level = level ? HIGH : LOW;
+        if (_pinLevels[pin] == level)
+            return;
+        _pinLevels[pin] = level;
+        if (_pinListener)
+            _pinListener(pin, level);
+    }
+} // namespace
+
+/* Arduino API */
+
+gpio_dev_t GPIO;
+EspClass ESP;
+
+struct hw_timer_t
+{
+    size_t index;
+    uint16_t divider;
+};
+
+struct esp_timer
+{
+    size_t index;
+};
+
+SimGpioSetRegister &SimGpioSetRegister::operator=(uint32_t mask)
+{
+    for (uint8_t pin = 0; pin < 32; pin++)
+        if (mask & ((uint32_t)1 << pin))
+            _setPin(pin, HIGH);
+    return *this;
+}
+
+SimGpioClearRegister &SimGpioClearRegister::operator=(uint32_t mask)
+{
+    for (uint8_t pin = 0; pin < 32; pin++)
+        if (mask & ((uint32_t)1 << pin))
+            _setPin(pin, LOW);
+    return *this;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    _setPin(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+    return (pin < NUM_PINS) ? _pinLevels[pin] : LOW;
+}
+
+void attachInterruptArg(uint8_t pin, void (*userFunc)(void *), void *arg, int mode)
+{
+    if (pin >= NUM_PINS)
+        return;
+    _pinInterrupts[pin].fn = userFunc;
+    _pinInterrupts[pin].arg = arg;
+    _pinInterrupts[pin].mode = mode;
+}
+
+static uint64_t deviceNow()
+{
+    return (_clockRate == 1.0) ? _now : (uint64_t)(_now * _clockRate);
+}
+
+unsigned long millis()
+{
+    // unsigned long is 32 bits on the ESP32, keep the same wrap-around
+    return (uint32_t)(deviceNow() / 1000);
+}
+
+unsigned long micros()
+{
+    return (uint32_t)deviceNow();
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)deviceNow();
+}
+
+void delay(uint32_t ms)
+{
+    _now += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    _now += us;
+}
+
+double ledcSetup(uint8_t, double freq, uint8_t)
+{
+    return freq;
+}
+
+void ledcAttachPin(uint8_t, uint8_t) {}
+
+void ledcWrite(uint8_t channel, uint32_t duty)
+{
+    if (channel < NUM_LEDC_CHANNELS)
+        _ledcDuty[channel] = duty;
+}
+
+hw_timer_t *timerBegin(uint8_t timer, uint16_t divider, bool)
+{
+    static hw_timer_t handles[NUM_HW_TIMERS];
+    if (timer >= NUM_HW_TIMERS)
+        return nullptr;
+    handles[timer].index = _timers.size();
+    handles[timer].divider = divider;
+    _timers.push_back(Timer());
+    return &handles[timer];
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool)
+{
+    _timers[timer->index].isr = fn;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool)
+{
+    _timers[timer->index].periodUs = alarm_value * timer->divider / APB_CLOCK_MHZ;
+}
+
+// Like the hardware, an alarm passed while disabled goes off right away
+void timerAlarmEnable(hw_timer_t *timer)
+{
+    Timer &t = _timers[timer->index];
+    if (!t.armed)
+        t.schedule(_now);
+    else if (t.next < _now)
+        t.next = _now;
+    t.armed = true;
+    t.enabled = t.periodUs > 0;
+}
+
+void timerAlarmDisable(hw_timer_t *timer)
+{
+    _timers[timer->index].enabled = false;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    Timer t;
+    t.callback = create_args->callback;
+    t.arg = create_args->arg;
+    *out_handle = new esp_timer{_timers.size()};
+    _timers.push_back(t);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    Timer &t = _timers[timer->index];
+    t.periodUs = period;
+    t.schedule(_now);
+    t.enabled = period > 0;
+    return ESP_OK;
+}
+
+void setCpuFrequencyMhz(uint32_t cpu_freq_mhz)
+{
+    _cpuMhz = cpu_freq_mhz;
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+    return _cpuMhz;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)(_now * _cpuMhz);
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *, int, TaskHandle_t *, int)
+{
+    return pdFAIL;
+}
+
+void vTaskDelay(uint32_t ticks)
+{
+    _now += (uint64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+HardwareSerial::HardwareSerial(int uart_nr) : _uart(uart_nr) {}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t)
+{
+    _baud = baud;
+}
+
+int HardwareSerial::available()
+{
+    int count = 0;
+    for (auto it = _rx.begin(); it != _rx.end() && it->time <= _now; ++it)
+        count++;
+    return count;
+}
+
+int HardwareSerial::read()
+{
+    if (_rx.empty() || _rx.front().time > _now)
+        return -1;
+    uint8_t value = _rx.front().value;
+    _rx.pop_front();
+    return value;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    _lastTxTime = max(_lastTxTime, _now) + _byteTime();
+    _tx.push_back((char)c);
+    if (_echo)
+        fputc(c, _echo);
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        write(buffer[i]);
+    return size;
+}
+
+size_t HardwareSerial::write(const char *str)
+{
+    return write((const uint8_t *)str, strlen(str));
+}
+
+size_t HardwareSerial::print(const char *str)
+{
+    return write(str);
+}
+
+size_t HardwareSerial::println(const char *str)
+{
+    return write(str) + write((const uint8_t *)"\r\n", 2);
+}
+
+void HardwareSerial::hostWrite(const std::string &data)
+{
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        _lastRxTime = max(_lastRxTime, _now) + _byteTime();
+        _rx.push_back(RxByte{_lastRxTime, (uint8_t)data[i]});
+    }
+}
+
+std::string HardwareSerial::hostRead()
+{
+    std::string out;
+    out.swap(_tx);
+    return out;
+}
+
+/* Simulator control */
+
+uint64_t Sim::now()
+{
+    return _now;
+}
+
+void Sim::reset()
+{
+    _now = 0;
+    memset(_pinLevels, 0, sizeof(_pinLevels));
+    memset(_ledcDuty, 0, sizeof(_ledcDuty));
+    _timers.clear();
+    _pinListener = nullptr;
+    for (PinInterrupt &interrupt : _pinInterrupts)
+        interrupt = PinInterrupt();
+}
+
+uint8_t Sim::getPinLevel(uint8_t pin)
+{
+    return digitalRead(pin);
+}
+
+void Sim::setPinListener(PinListener listener)
+{
+    _pinListener = listener;
+}
+
+void Sim::setInputPin(uint8_t pin, uint8_t level)
+{
+    if (pin >= NUM_PINS)
+        return;
+    level = level ? HIGH : LOW;
+    if (_pinLevels[pin] == level)
+        return;
+    _pinLevels[pin] = level;
+
+    const PinInterrupt &interrupt = _pinInterrupts[pin];
+    int edge = level ? RISING : FALLING;
+    if (interrupt.fn && (interrupt.mode & edge))
+        interrupt.fn(interrupt.arg);
+}
+
+void Sim::setClockError(double ppm)
+{
+    _clockRate = 1.0 + ppm * 1e-6;
+}
+
+uint32_t Sim::getLedcDuty(uint8_t channel)
+{
+    return (channel < NUM_LEDC_CHANNELS) ? _ledcDuty[channel] : 0;
+}
+
+void Sim::runFor(uint64_t us, const std::function<void()> &loop, uint64_t loopPeriodUs)
+{
+    const uint64_t end = _now + us;
+    uint64_t nextLoop = _now;
+
+    while (true)
+    {
+        // Find whatever is due first, timers win ties with the loop
+        Timer *due = nullptr;
+        for (size_t i = 0; i < _timers.size(); i++)
+            if (_timers[i].enabled && (!due || _timers[i].next < due->next))
+                due = &_timers[i];
+
+        uint64_t when = (due && due->next <= nextLoop) ? due->next : nextLoop;
+        if (when > end)
+            break;
+        // A timer may be late if the previous handler busy-waited past it
+        if (_now < when)
+            _now = when;
+
+        if (due && due->next == when)
+        {
+            due->schedule(due->nextExact);
+            if (due->isr)
+                due->isr();
+            else if (due->callback)
+                due->callback(due->arg);
+        }
+        else
+        {
+            loop();
+            nextLoop = _now + loopPeriodUs;
+        }
+    }
+
+    if (_now < end)
+        _now = end;
+}
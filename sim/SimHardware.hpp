@@ -0,0 +1,63 @@
+/*
+ * Project Name: synscancontrol
+ * File: SimHardware.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Simulated GPIO / timers / UART running on a deterministic virtual clock
+ */
+#ifndef SIM_HARDWARE_H
+#define SIM_HARDWARE_H
+
+#include <stdint.h>
+#include <functional>
+
+namespace Sim
+{
+    typedef std::function<void(uint8_t pin, uint8_t level)> PinListener;
+
+    /* Virtual time in microseconds since reset(). It only moves
+     * forward in runFor() and in delay() / delayMicroseconds().
+     */
+    uint64_t now();
+
+    // Back to t = 0, all pins low, no timers (the crystal error stays)
+    void reset();
+
+    uint8_t getPinLevel(uint8_t pin);
+    // Called on every change of an output pin's level
+    void setPinListener(PinListener listener);
+    uint32_t getLedcDuty(uint8_t channel);
+    // Drive an input pin from outside, firing its GPIO interrupt on a matching edge
+    void setInputPin(uint8_t pin, uint8_t level);
+
+    /* Make the ESP32's crystal run fast (or slow, if negative) by this
+     * much from now on: the timers, micros() and esp_timer_get_time()
+     * follow it, virtual time stays true time. It is a property of the
+     * board, so it survives reset().
+     */
+    void setClockError(double ppm);
+
+    /* Advance virtual time by `us`, firing the hardware timer ISRs and
+     * esp_timer callbacks when they are due and calling loop() every
+     * loopPeriodUs in between (like the Arduino loop() spinning).
+     */
+    void runFor(uint64_t us, const std::function<void()> &loop, uint64_t loopPeriodUs);
+} // namespace Sim
+
+#endif /* SIM_HARDWARE_H */
@@ -0,0 +1,236 @@
+/*
+ * Project Name: synscancontrol
+ * File: SimMount.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: The firmware wired up as in main.cpp, on simulated hardware
+ */
+#include <Arduino.h>
+
+#include "FlashSettings.hpp"
+#include "HexConversionUtils.hpp"
+#include "SimHardware.hpp"
+#include "SimMount.hpp"
+
+using namespace Sim;
+
+SimMount *SimMount::_active = nullptr;
+
+SimMount::SimMount()
+    : _loggerSerial(SERIAL_LOGGER_UART),
+      _synscanSerial(SERIAL_SYNSCAN_UART),
+      _serialHandler(&_loggerSerial),
+      _raMotor(AxisEnum::AXIS_RA, RA_M0, RA_M1, RA_M2, RA_STEP, RA_DIR, 0x800000, false, &_trace, &_logger),
+      _decMotor(AxisEnum::AXIS_DEC, DEC_M0, DEC_M1, DEC_M2, DEC_STEP, DEC_DIR, 0x913640, true, &_trace, &_logger),
+      _polarScopeLED(SCOPE_LED, SCOPE_LED_PWM, &_logger),
+      _guidePort(&_raMotor, &_decMotor),
+      _clockCalibration(&_raMotor, &_decMotor, &_logger),
+      _horizonMask(&_raMotor, &_decMotor, &_logger),
+      _gotoController(&_raMotor, &_decMotor, &_clockCalibration, &_horizonMask, &_logger),
+      _cmdHandler(&_synscanSerial, &_raMotor, &_decMotor, &_polarScopeLED, &_isrProfiler, &_trace, &_clockCalibration, &_gotoController, &_logger)
+{
+    _pins[0] = AxisPins{RA_M0, RA_M1, RA_M2, RA_STEP, RA_DIR, false, 0x800000, 0, 0, 0};
+    _pins[1] = AxisPins{DEC_M0, DEC_M1, DEC_M2, DEC_STEP, DEC_DIR, true, 0x913640, 0, 0, 0};
+}
+
+SimMount::~SimMount()
+{
+    if (_active == this)
+    {
+        FlashSettings::begin(nullptr, nullptr, nullptr);
+        Sim::reset();
+        _active = nullptr;
+    }
+}
+
+void SimMount::begin()
+{
+    Sim::reset();
+    _active = this;
+    Sim::setPinListener([this](uint8_t pin, uint8_t level)
+                        { _onPin(pin, level); });
+
+    setCpuFrequencyMhz(240);
+
+    _loggerSerial.begin(115200);
+    _synscanSerial.begin(9600, SERIAL_8N1, SERIAL_SYNSCAN_RX, SERIAL_SYNSCAN_TX);
+
+    _logger.addHandler(&_serialHandler);
+    _polarScopeLED.begin();
+
+    _isrProfiler.begin(getCpuFrequencyMhz());
+    hw_timer_t *tickTimer = timerBegin(0, 80, true);
+    timerAttachInterrupt(tickTimer, &_tick, true);
+    timerAlarmWrite(tickTimer, TICK_PERIOD_US, true);
+    timerAlarmEnable(tickTimer);
+    FlashSettings::begin(tickTimer, &_raMotor, &_decMotor);
+
+    _decMotor.begin();
+    _raMotor.begin();
+
+    // The guide inputs are pulled up on the board, i.e. released
+    for (uint8_t pin : {RA_POS_PIN, RA_NEG_PIN, DEC_POS_PIN, DEC_NEG_PIN})
+        Sim::setInputPin(pin, HIGH);
+    _guidePort.begin();
+    _clockCalibration.begin();
+    _horizonMask.begin();
+    _gotoController.begin();
+
+    _longTickTimer = millis();
+    _satelliteTimer = millis();
+    _logger.begin();
+    _logger.debug(LogMsg::LOGGING_STARTED);
+}
+
+void SimMount::runFor(uint64_t us)
+{
+    Sim::runFor(us, [this]()
+                { _loop(); }, LOOP_PERIOD_US);
+}
+
+bool SimMount::command(const std::string &cmd, std::string *reply, uint64_t timeoutUs)
+{
+    _synscanSerial.hostRead(); // discard anything stale
+    _synscanSerial.hostWrite(cmd + "\r");
+
+    std::string received;
+    const uint64_t deadline = Sim::now() + timeoutUs;
+    while (Sim::now() < deadline)
+    {
+        runFor(LOOP_PERIOD_US);
+        received += _synscanSerial.hostRead();
+        size_t end = received.find('\r');
+        if (end != std::string::npos)
+        {
+            *reply = received.substr(0, end);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SimMount::query(const std::string &cmd, uint32_t *value, uint64_t timeoutUs)
+{
+    std::string reply;
+    if (!command(cmd, &reply, timeoutUs) || reply.empty() || reply[0] != '=')
+        return false;
+    size_t len = reply.size() - 1;
+    if (len != 2 && len != 4 && len != 6)
+        return false;
+    *value = parseToHex<uint32_t>(reply.c_str() + 1, len);
+    return true;
+}
+
+bool SimMount::expectOk(const std::string &cmd, bool report)
+{
+    std::string reply;
+    if (command(cmd, &reply) && reply == "=")
+        return true;
+    if (report)
+        fprintf(stderr, "%s: unexpected reply '%s'\n", cmd.c_str(), reply.c_str());
+    return false;
+}
+
+std::string SimMount::toHex(uint32_t value)
+{
+    char out[7] = {0};
+    toHexString<uint32_t>(value, out, 6);
+    return std::string(out, 6);
+}
+
+int64_t SimMount::getMotorPositionOffset(AxisEnum axis)
+{
+    // Motor positions wrap within a revolution, bring the difference
+    // to the revolution closest to what the pins say
+    const AxisPins &pins = _axis(axis);
+    int64_t offset = (int64_t)getMotor(axis)->getPosition() - (int64_t)pins.startPosition;
+    int64_t revs = (pins.position - offset) / (int64_t)MICROSTEPS_PER_REV;
+    offset += revs * (int64_t)MICROSTEPS_PER_REV;
+    if (pins.position - offset > (int64_t)MICROSTEPS_PER_REV / 2)
+        offset += MICROSTEPS_PER_REV;
+    else if (offset - pins.position > (int64_t)MICROSTEPS_PER_REV / 2)
+        offset -= MICROSTEPS_PER_REV;
+    return offset;
+}
+
+void SimMount::_tick()
+{
+    // Same as tick() in main.cpp
+#ifdef ISR_PROFILING
+    _active->_isrProfiler.enter();
+#endif
+    _active->_trace.tick();
+    _active->_guidePort.tick();
+    _active->_decMotor.tick();
+    _active->_raMotor.tick();
+    _active->_horizonMask.tick();
+#ifdef ISR_PROFILING
+    _active->_isrProfiler.exit();
+#endif
+}
+
+void SimMount::_loop()
+{
+    // Same as loop() in main.cpp, plus what the logger task would do
+    _cmdHandler.processSerial();
+    _trace.pump(&_logger);
+
+    if (millis() - _longTickTimer > LONG_TICK_MS)
+    {
+        _longTickTimer = millis();
+        _decMotor.longTick();
+        _raMotor.longTick();
+        _gotoController.longTick();
+        _clockCalibration.longTick();
+        _horizonMask.longTick();
+    }
+    if (millis() - _satelliteTimer >= SATELLITE_UPDATE_MS)
+    {
+        _satelliteTimer = millis();
+        _gotoController.update();
+    }
+
+    _logger.drain();
+}
+
+void SimMount::_onPin(uint8_t pin, uint8_t level)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        AxisPins &axis = _pins[i];
+        if (pin != axis.STEP || level != HIGH)
+            continue;
+
+        // DRV8825 microstep table, as driven by Motor::setMicrosteps()
+        uint8_t mode = (Sim::getPinLevel(axis.M0) ? 1 : 0) | (Sim::getPinLevel(axis.M1) ? 2 : 0) |
+                       (Sim::getPinLevel(axis.M2) ? 4 : 0);
+        static const uint8_t MICROSTEPS[8] = {1, 2, 4, 8, 16, 32, 32, 32};
+        int32_t size = SLOW_MICROSTEPS / MICROSTEPS[mode];
+        bool forward = (Sim::getPinLevel(axis.DIR) == HIGH) != axis.reversed;
+        // Out of step with the mode (changed in between), the indexer goes to its next valid state
+        int32_t off = axis.phase % size;
+        int32_t increment = forward ? size - off : -(off ? off : size);
+        axis.phase = (axis.phase + increment) & 127;
+
+        axis.position += increment;
+        axis.steps++;
+        if (_stepListener)
+            _stepListener(i ? AxisEnum::AXIS_DEC : AxisEnum::AXIS_RA, increment);
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * Project Name: synscancontrol
+ * File: SimMount.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: The firmware wired up as in main.cpp, on simulated hardware
+ */
+#ifndef SIM_MOUNT_H
+#define SIM_MOUNT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+
+#include <Arduino.h>
+
+#include "ClockCalibration.hpp"
+#include "CommandHandler.hpp"
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "GotoController.hpp"
+#include "GuidePort.hpp"
+#include "HorizonMask.hpp"
+#include "IsrProfiler.hpp"
+#include "Logger.hpp"
+#include "Motor.hpp"
+#include "PolarScopeLED.hpp"
+#include "TraceRecorder.hpp"
+
+namespace Sim
+{
+    using namespace SynScanControl;
+
+    /* Everything main.cpp sets up, minus WiFi / OTA / the status LED.
+     * The tick timer ISR and loop() run on the virtual clock, and the
+     * STEP / DIR / microstep pins are watched to count the steps the
+     * drivers would actually have received.
+     * Only one instance can be alive at a time.
+     */
+    class SimMount
+    {
+    public:
+        // How often loop() gets a turn, in virtual us
+        static const uint64_t LOOP_PERIOD_US = 250;
+        // Mirrors the long tick period in main.cpp
+        static const uint64_t LONG_TICK_MS = 100;
+
+        SimMount();
+        ~SimMount();
+
+        // Mirrors setup()
+        void begin();
+        void runFor(uint64_t us);
+
+        /* Send a command, e.g. ":j1", and run until the reply comes back.
+         * Returns false on timeout. The reply has the trailing '\r' removed.
+         */
+        bool command(const std::string &cmd, std::string *reply, uint64_t timeoutUs = 500000);
+        // Same, for commands whose reply is a data value (2, 4 or 6 hex chars)
+        bool query(const std::string &cmd, uint32_t *value, uint64_t timeoutUs = 500000);
+        // Same, for commands that should reply '=', reporting any other reply on stderr if asked
+        bool expectOk(const std::string &cmd, bool report = false);
+        static std::string toHex(uint32_t value);
+
+        // Echo the text log output to this file, nullptr to disable
+        void setLogEcho(FILE *f) { _loggerSerial.setEcho(f); }
+
+        Motor *getMotor(AxisEnum axis) { return axis == AxisEnum::AXIS_DEC ? &_decMotor : &_raMotor; }
+        Logger *getLogger() { return &_logger; }
+        TraceRecorder *getTrace() { return &_trace; }
+        IsrProfiler *getIsrProfiler() { return &_isrProfiler; }
+        GuidePort *getGuidePort() { return &_guidePort; }
+        GotoController *getGotoController() { return &_gotoController; }
+        HorizonMask *getHorizonMask() { return &_horizonMask; }
+        HardwareSerial *getSynScanSerial() { return &_synscanSerial; }
+
+        /* What the driver saw: total step pulses, and the net movement in
+         * SynScan position units (SLOW_MICROSTEPS per full step) from
+         * the STEP / DIR / M0-M2 pins.
+         */
+        uint64_t getStepCount(AxisEnum axis) const { return _axis(axis).steps; }
+        int64_t getPinPosition(AxisEnum axis) const { return _axis(axis).position; }
+        // Motor position relative to begin(), unwrapped the same way
+        int64_t getMotorPositionOffset(AxisEnum axis);
+
+        // Called on every step pulse with its signed size in SynScan position units
+        typedef std::function<void(AxisEnum axis, int32_t increment)> StepListener;
+        void setStepListener(StepListener listener) { _stepListener = listener; }
+
+    private:
+        struct AxisPins
+        {
+            uint8_t M0, M1, M2, STEP, DIR;
+            bool reversed;
+            uint32_t startPosition;
+            uint64_t steps;
+            int64_t position;
+            uint32_t phase; // DRV8825 indexer state, in position units (128 per electrical cycle)
+        };
+
+        static SimMount *_active;
+
+        HardwareSerial _loggerSerial;
+        HardwareSerial _synscanSerial;
+        Logger _logger;
+        HardwareSerialLoggerHandler _serialHandler;
+        IsrProfiler _isrProfiler;
+        TraceRecorder _trace;
+        Motor _raMotor;
+        Motor _decMotor;
+        PolarScopeLED _polarScopeLED;
+        GuidePort _guidePort;
+        ClockCalibration _clockCalibration;
+        HorizonMask _horizonMask;
+        GotoController _gotoController;
+        CommandHandler _cmdHandler;
+
+        AxisPins _pins[2];
+        StepListener _stepListener;
+        unsigned long _longTickTimer = 0;
+        unsigned long _satelliteTimer = 0;
+
+        static void _tick();
+        void _loop();
+        void _onPin(uint8_t pin, uint8_t level);
+        const AxisPins &_axis(AxisEnum axis) const { return _pins[axis == AxisEnum::AXIS_DEC ? 1 : 0]; }
+    };
+} // namespace Sim
+
+#endif /* SIM_MOUNT_H */
@@ -0,0 +1,183 @@
+/*
+ * Project Name: synscancontrol
+ * File: SkyReference.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Double precision sidereal time and axis transforms to check the firmware against
+ */
+#ifndef SIM_SKY_REFERENCE_H
+#define SIM_SKY_REFERENCE_H
+
+#include <math.h>
+#include <stdint.h>
+
+namespace Sim
+{
+    /* Written independently of CelestialTransform / PointingModel, in
+     * degrees and double precision, as the reference for the sim
+     * scenarios. Same axis convention (see CelestialTransform.hpp).
+     */
+    namespace SkyReference
+    {
+        // Wrapped into [-180, 180)
+        inline double wrap(double degrees)
+        {
+            degrees = fmod(degrees + 180.0, 360.0);
+            return (degrees < 0.0) ? degrees + 180.0 : degrees - 180.0;
+        }
+
+        /* Apparent sidereal time at Greenwich in degrees, ms since J2000 (UT1):
+         * IAU 2006 GMST with every term, plus the equation of the equinoxes
+         * from the four largest nutation terms (Meeus, good to 0.5 arcsec).
+         */
+        inline double meanSiderealTime(int64_t ms)
+        {
+            double days = ms / 86400000.0;
+            double t = (ms + 69184.0) / 86400000.0 / 36525.0; // TT
+            double era = 360.0 * (0.7790572732640 + 0.00273781191135448 * days + fmod(days, 1.0));
+            double poly = 0.014506 + t * (4612.156534 + t * (1.3915817 + t * (-0.00000044 + t * (-0.000029956 + t * -0.0000000368))));
+            return wrap(era + poly / 3600.0);
+        }
+
+        inline double siderealTime(int64_t ms)
+        {
+            double t = (ms + 69184.0) / 86400000.0 / 36525.0;
+            const double rad = M_PI / 180.0;
+            double omega = (125.04452 - 1934.136261 * t) * rad;
+            double sun = (280.4665 + 36000.7698 * t) * rad;
+            double moon = (218.3165 + 481267.8813 * t) * rad;
+            double dpsi = -17.20 * sin(omega) - 1.32 * sin(2 * sun) - 0.23 * sin(2 * moon) + 0.21 * sin(2 * omega);
+            double eps = (23.4393 - 0.0130 * t) * rad;
+            return wrap(meanSiderealTime(ms) + dpsi * cos(eps) / 3600.0);
+        }
+
+        /* Hour angle, Dec and elevation (degrees) of a satellite at r / v
+         * (TEME, km and km/s) from a WGS-84 site: the site is turned into
+         * TEME by the mean sidereal time, and the satellite taken back by
+         * the light time.
+         */
+        inline void satellite(const double *r, const double *v, int64_t ms, double lat, double lon, double heightM,
+                              double *ha, double *dec, double *elevation)
+        {
+            const double rad = M_PI / 180.0;
+            double f = 1.0 / 298.257223563;
+            double e2 = f * (2.0 - f);
+            double phi = lat * rad;
+            double n = 6378.137 / sqrt(1.0 - e2 * sin(phi) * sin(phi));
+            double lst = (meanSiderealTime(ms) + lon) * rad;
+            double zenith[3] = {cos(phi) * cos(lst), cos(phi) * sin(lst), sin(phi)};
+            double site[3] = {(n + heightM / 1000.0) * zenith[0], (n + heightM / 1000.0) * zenith[1],
+                              (n * (1.0 - e2) + heightM / 1000.0) * zenith[2]};
+
+            double rho[3];
+            for (int i = 0; i < 3; i++)
+                rho[i] = r[i] - site[i];
+            double lightTime = sqrt(rho[0] * rho[0] + rho[1] * rho[1] + rho[2] * rho[2]) / 299792.458;
+            for (int i = 0; i < 3; i++)
+                rho[i] -= v[i] * lightTime;
+            double distance = sqrt(rho[0] * rho[0] + rho[1] * rho[1] + rho[2] * rho[2]);
+
+            *ha = wrap((lst - atan2(rho[1], rho[0])) / rad);
+            *dec = asin(rho[2] / distance) / rad;
+            *elevation = asin((rho[0] * zenith[0] + rho[1] * zenith[1] + rho[2] * zenith[2]) / distance) / rad;
+        }
+
+        /* Topocentric RA / Dec of the Moon (degrees), from the low
+         * precision formulae of the Astronomical Almanac (0.3 degree):
+         * not where the Moon is, but moving like it, parallax included.
+         */
+        inline void moon(int64_t ms, double lat, double lon, double *ra, double *dec)
+        {
+            const double rad = M_PI / 180.0;
+            double t = (ms + 69184.0) / 86400000.0 / 36525.0;
+            double lambda = 218.32 + 481267.881 * t + 6.29 * sin((135.0 + 477198.87 * t) * rad) -
+                            1.27 * sin((259.3 - 413335.36 * t) * rad) + 0.66 * sin((235.7 + 890534.22 * t) * rad) +
+                            0.21 * sin((269.9 + 954397.74 * t) * rad) - 0.19 * sin((357.5 + 35999.05 * t) * rad) -
+                            0.11 * sin((186.5 + 966404.03 * t) * rad);
+            double beta = 5.13 * sin((93.3 + 483202.02 * t) * rad) + 0.28 * sin((228.2 + 960400.89 * t) * rad) -
+                          0.28 * sin((318.3 + 6003.15 * t) * rad) - 0.17 * sin((217.6 - 407332.21 * t) * rad);
+            double parallax = 0.9508 + 0.0518 * cos((135.0 + 477198.87 * t) * rad) +
+                              0.0095 * cos((259.3 - 413335.36 * t) * rad) + 0.0078 * cos((235.7 + 890534.22 * t) * rad) +
+                              0.0028 * cos((269.9 + 954397.74 * t) * rad);
+
+            // Geocentric, in earth radii, less the site
+            double r = 1.0 / sin(parallax * rad);
+            double l = cos(beta * rad) * cos(lambda * rad);
+            double m = 0.9175 * cos(beta * rad) * sin(lambda * rad) - 0.3978 * sin(beta * rad);
+            double n = 0.3978 * cos(beta * rad) * sin(lambda * rad) + 0.9175 * sin(beta * rad);
+            double lst = (siderealTime(ms) + lon) * rad;
+            double x = r * l - cos(lat * rad) * cos(lst);
+            double y = r * m - cos(lat * rad) * sin(lst);
+            double z = r * n - sin(lat * rad);
+            *ra = atan2(y, x) / rad;
+            if (*ra < 0.0)
+                *ra += 360.0;
+            *dec = asin(z / sqrt(x * x + y * y + z * z)) / rad;
+        }
+
+        // Hour angle / Dec to axis angles from the start position
+        inline void toAxes(double ha, double dec, bool east, bool south, double *raAxis, double *decAxis)
+        {
+            if (south)
+            {
+                ha = -ha;
+                dec = -dec;
+                east = !east;
+            }
+            *raAxis = wrap(east ? ha - 90.0 : ha + 90.0);
+            *decAxis = wrap(east ? dec : 180.0 - dec);
+            if (south)
+                *raAxis = wrap(-*raAxis);
+        }
+
+        // And back (northern hemisphere)
+        inline void fromAxes(double raAxis, double decAxis, double *ha, double *dec, bool *east)
+        {
+            *east = fabs(decAxis) <= 90.0;
+            *ha = wrap(*east ? raAxis + 90.0 : raAxis - 90.0);
+            *dec = *east ? decAxis : wrap(180.0 - decAxis);
+        }
+
+        /* Six term equatorial pointing model, terms in arcsec (IH, ID, CH,
+         * NP, MA, ME): where the axes read when pointing at (ha, dec).
+         */
+        inline void modelOffsets(const double *terms, double ha, double dec, bool east, double *dHa, double *dDec)
+        {
+            const double rad = M_PI / 180.0;
+            double p = east ? 1.0 : -1.0;
+            double h = ha * rad;
+            double d = dec * rad;
+            double onSky = terms[0] * cos(d) + terms[2] * p + terms[3] * p * sin(d) - terms[4] * cos(h) * sin(d) +
+                           terms[5] * sin(h) * sin(d);
+            *dHa = onSky / fmax(cos(d), 0.01) / 3600.0;
+            *dDec = (terms[1] * p + terms[4] * sin(h) + terms[5] * cos(h)) / 3600.0;
+        }
+
+        // Angular distance between two hour angle / Dec positions, arcsec
+        inline double separation(double ha1, double dec1, double ha2, double dec2)
+        {
+            const double rad = M_PI / 180.0;
+            double dHa = wrap(ha1 - ha2) * cos(0.5 * (dec1 + dec2) * rad);
+            double dDec = dec1 - dec2;
+            return sqrt(dHa * dHa + dDec * dDec) * 3600.0;
+        }
+    } // namespace SkyReference
+} // namespace Sim
+
+#endif /* SIM_SKY_REFERENCE_H */
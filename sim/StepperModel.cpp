@@ -0,0 +1,106 @@
+/*
+ * Project Name: synscancontrol
+ * File: StepperModel.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Physical model of a stepper motor driving a geared mount axis
+ */
+#include <math.h>
+
+#include "StepperModel.hpp"
+
+using namespace Sim;
+
+// Integration step, well below the period of the rotor's natural oscillation
+static const double MAX_DT_S = 5e-6;
+
+StepperModel::StepperModel(const Params &params) : _p(params)
+{
+    double gear2 = (double)_p.gearRatio * _p.gearRatio;
+    _inertia = _p.rotorInertia + _p.loadInertia / gear2;
+    _friction = _p.loadFriction / _p.gearRatio;
+    _unitAngle = 2.0 * M_PI / _p.fullStepsPerRev / _p.positionUnitsPerStep;
+    _toothPitch = 2.0 * M_PI / ROTOR_TEETH;
+}
+
+void StepperModel::step(uint64_t t, int32_t units)
+{
+    advance(t);
+    _commanded += units * _unitAngle;
+}
+
+void StepperModel::advance(uint64_t t)
+{
+    if (t <= _time)
+        return;
+    double remaining = (t - _time) * 1e-6;
+    _time = t;
+
+    // Nothing to do while stopped and on target
+    if (_omega == 0.0 && fabs(_commanded - _theta - _slipTeeth * _toothPitch) < 1e-9)
+        return;
+
+    while (remaining > 0.0)
+    {
+        double dt = remaining < MAX_DT_S ? remaining : MAX_DT_S;
+        _integrate(dt);
+        remaining -= dt;
+    }
+}
+
+float StepperModel::getPeakLagDegrees() const
+{
+    return (float)(_peakLag * ROTOR_TEETH * 180.0 / M_PI);
+}
+
+double StepperModel::_pullOutTorque(double omega) const
+{
+    return _p.holdingTorque / (1.0 + fabs(omega) / _p.cornerSpeed);
+}
+
+void StepperModel::_integrate(double dt)
+{
+    // Lag relative to the tooth the rotor is locked to
+    double lag = _commanded - _theta - _slipTeeth * _toothPitch;
+    if (fabs(lag) > _toothPitch / 2)
+    {
+        int32_t teeth = (int32_t)floor(lag / _toothPitch + 0.5);
+        _slipTeeth += teeth;
+        _missedSteps += 4 * (uint32_t)abs(teeth);
+        lag -= teeth * _toothPitch;
+    }
+    if (fabs(lag) > _peakLag)
+        _peakLag = fabs(lag);
+
+    double available = _pullOutTorque(_omega);
+    double torque = available * sin(ROTOR_TEETH * lag) - _p.damping * _omega;
+
+    // Coulomb friction, which can hold the rotor still
+    if (_omega == 0.0 && fabs(torque) <= _friction)
+        return;
+    double friction = (_omega != 0.0) ? ((_omega > 0) ? _friction : -_friction) : ((torque > 0) ? _friction : -_friction);
+
+    double alpha = (torque - friction) / _inertia;
+    double omega = _omega + alpha * dt;
+    // Friction stops the rotor rather than reversing it
+    if (_omega != 0.0 && (omega > 0) != (_omega > 0) && fabs(torque) <= _friction)
+        omega = 0.0;
+    _theta += 0.5 * (_omega + omega) * dt;
+    _omega = omega;
+}
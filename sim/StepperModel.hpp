@@ -0,0 +1,97 @@
+/*
+ * Project Name: synscancontrol
+ * File: StepperModel.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Physical model of a stepper motor driving a geared mount axis
+ */
+#ifndef STEPPER_MODEL_H
+#define STEPPER_MODEL_H
+
+#include <stdint.h>
+
+namespace Sim
+{
+    /* A hybrid stepper, geared down to the mount axis, following the step
+     * pulses it is given.
+     *
+     * The rotor is pulled towards the commanded angle with a torque of
+     * T(w) * sin(N * lag), where N is the number of rotor teeth and T(w)
+     * the pull-out torque, falling off with speed past a corner speed.
+     * It is held back by its own and the (geared down) load inertia and
+     * by friction. Once the lag passes half a tooth pitch the rotor
+     * settles on the next tooth, losing 4 full steps.
+     */
+    class StepperModel
+    {
+    public:
+        struct Params
+        {
+            float holdingTorque = 0.45f;    // N m
+            float cornerSpeed = 60.0f;      // rad/s, pull-out torque halves here
+            float rotorInertia = 6.8e-6f;   // kg m^2
+            float loadInertia = 0.5f;       // kg m^2, at the mount axis
+            float loadFriction = 3.0f;      // N m, at the mount axis
+            float damping = 2.5e-3f;        // N m s/rad, at the motor (~0.1 of critical)
+            float gearRatio = 705.0f;       // motor turns per axis turn
+            uint16_t fullStepsPerRev = 200; // motor
+            uint16_t positionUnitsPerStep = 32; // SynScan position units per full step
+        };
+
+        static const uint8_t ROTOR_TEETH = 50;
+
+        StepperModel() : StepperModel(Params()) {}
+        StepperModel(const Params &params);
+
+        // A step pulse at time t (us), of `units` SynScan position units
+        void step(uint64_t t, int32_t units);
+        // Integrate up to time t (us)
+        void advance(uint64_t t);
+
+        // Full steps the rotor lost (or gained), since construction
+        uint32_t getMissedSteps() const { return _missedSteps; }
+        // Largest lag between the commanded and rotor angles seen, in electrical degrees
+        float getPeakLagDegrees() const;
+        /* 1 - peak lag / 90 electrical degrees: the rotor delivers its full
+         * pull-out torque at 90 degrees of lag and can't hold on past it
+         */
+        float getSafetyMargin() const { return 1.0f - getPeakLagDegrees() / 90.0f; }
+        float getRotorSpeed() const { return (float)_omega; }
+
+    private:
+        Params _p;
+        double _inertia;
+        double _friction;
+        double _unitAngle;
+        double _toothPitch;
+
+        uint64_t _time = 0;
+        double _commanded = 0.0;
+        double _theta = 0.0;
+        double _omega = 0.0;
+        int32_t _slipTeeth = 0;
+        uint32_t _missedSteps = 0;
+        double _peakLag = 0.0;
+
+        double _pullOutTorque(double omega) const;
+        void _integrate(double dt);
+    };
+} // namespace Sim
+
+#endif /* STEPPER_MODEL_H */
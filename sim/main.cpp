@@ -0,0 +1,73 @@
+/*
+ * Project Name: synscancontrol
+ * File: main.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Entry point of synscansim, the host simulator
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "Scenarios.hpp"
+
+struct Scenario
+{
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *usage;
+};
+
+static const Scenario SCENARIOS[] = {
+    {"track", Sim::scenarioTrack, "track [hours]            sidereal tracking, rate error and drift"},
+    {"goto", Sim::scenarioGoto, "goto [count] [seed]      random GOTOs, landing error and duration"},
+    {"physics", Sim::scenarioPhysics, "physics [load] [deg] [margin %]  GOTO ramp sweep against a loaded motor model"},
+    {"pec", Sim::scenarioPec, "pec [periods] [arcsec]   tracking against a synthetic worm error, with and without PEC"},
+    {"pectrain", Sim::scenarioPecTrain, "pectrain [arcsec] [seeing] [seed]  PEC training under a simulated autoguider"},
+    {"guide", Sim::scenarioGuide, "guide [rate index]       ST-4 guide pulses vs the correction the driver got"},
+    {"pulseguide", Sim::scenarioPulseGuide, "pulseguide [rate]        timed pulses through the extended command"},
+    {"backlash", Sim::scenarioBacklash, "backlash [units]         guiding / GOTO / tracking start against geared backlash"},
+    {"rates", Sim::scenarioRates, "rates [hours]            tracking accuracy of the built-in rates"},
+    {"clock", Sim::scenarioClock, "clock [ppm] [hours] [min] [jitter]  crystal calibration against a host clock"},
+    {"radec", Sim::scenarioRadec, "radec [count] [minutes]  RA / Dec transforms and GOTOs against a double precision reference"},
+    {"align", Sim::scenarioAlign, "align [stars] [tests]    multi-star pointing model against a mount with known errors"},
+    {"satellite", Sim::scenarioSatellite, "satellite [passes]       SGP4 against reference vectors, following satellite passes"},
+    {"ephemeris", Sim::scenarioEphemeris, "ephemeris [hours]        ephemeris interpolation, tracking the Moon from streamed tables"},
+    {"planner", Sim::scenarioPlanner, "planner [gotos] [seed]   GOTO planner against host-chosen directions and pier sides"},
+    {"limits", Sim::scenarioLimits, "limits [runs] [seed]     soft limits and the horizon mask stopping the axes"},
+    {"gears", Sim::scenarioGears, "gears [gotos] [seed]     fast GOTOs with and without microstep gear shifting"},
+    {"rmt", Sim::scenarioRmt, "rmt [steps]              RMT step trains decoded against the stepper's ramp"},
+    {"serve", Sim::scenarioServe, "serve [speed] [--log]    bridge the SynScan UART to a pty, in real time"},
+};
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        for (const Scenario &scenario : SCENARIOS)
+        {
+            if (strcmp(argv[1], scenario.name) == 0)
+                return scenario.run(argc - 2, argv + 2);
+        }
+    }
+
+    fprintf(stderr, "Usage: %s <scenario> [args]\n\nScenarios:\n", argv[0]);
+    for (const Scenario &scenario : SCENARIOS)
+        fprintf(stderr, "  %s\n", scenario.usage);
+    return 2;
+}
@@ -0,0 +1,194 @@
+/*
+ * Project Name: synscancontrol
+ * File: Arduino.h
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Host stand-in for the Arduino / ESP-IDF API used by the motion core
+ */
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+/* Only what src/synscancontrol needs is declared here. Everything is
+ * backed by the simulated hardware in sim/SimHardware.cpp, which runs
+ * on a virtual clock (see SimHardware.hpp).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+/* Digital IO */
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+// Input pins are driven with Sim::setInputPin()
+void attachInterruptArg(uint8_t pin, void (*userFunc)(void *), void *arg, int mode);
+
+/* GPIO registers: writes to out_w1ts / out_w1tc set / clear the masked pins */
+struct SimGpioSetRegister
+{
+    SimGpioSetRegister &operator=(uint32_t mask);
+};
+struct SimGpioClearRegister
+{
+    SimGpioClearRegister &operator=(uint32_t mask);
+};
+struct gpio_dev_t
+{
+    SimGpioSetRegister out_w1ts;
+    SimGpioClearRegister out_w1tc;
+};
+extern gpio_dev_t GPIO;
+
+/* Time (virtual) */
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+/* LEDC PWM */
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+/* Hardware timers */
+struct hw_timer_t;
+hw_timer_t *timerBegin(uint8_t timer, uint16_t divider, bool countUp);
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm_value, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+
+/* esp_timer */
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef enum
+{
+    ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+} esp_timer_create_args_t;
+struct esp_timer;
+typedef struct esp_timer *esp_timer_handle_t;
+typedef int esp_err_t;
+#define ESP_OK 0
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+int64_t esp_timer_get_time();
+
+/* CPU */
+void setCpuFrequencyMhz(uint32_t cpu_freq_mhz);
+uint32_t getCpuFrequencyMhz();
+
+class EspClass
+{
+public:
+    uint32_t getCycleCount();
+};
+extern EspClass ESP;
+
+/* FreeRTOS: there are no tasks in the simulator, the harness calls
+ * what would have been task bodies (e.g. Logger::drain()) itself.
+ */
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define portTICK_PERIOD_MS 1
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void *), const char *name, uint32_t stackDepth,
+                                   void *params, int priority, TaskHandle_t *handle, int core);
+void vTaskDelay(uint32_t ticks);
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+/* UART */
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial
+{
+public:
+    HardwareSerial(int uart_nr);
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    int available();
+    int read();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    size_t print(const char *str);
+    size_t println(const char *str);
+
+    /* Simulator side */
+
+    // Queue bytes sent to the device, they become available at the baud rate
+    void hostWrite(const std::string &data);
+    // Everything the device sent since the last call
+    std::string hostRead();
+    // Echo device output to this file as it is written (e.g. stdout), nullptr to disable
+    void setEcho(FILE *f) { _echo = f; }
+    // Virtual time (us) at which the last byte the device wrote leaves the wire
+    uint64_t getLastTxTime() const { return _lastTxTime; }
+    // Virtual time (us) at which the last queued byte reaches the device
+    uint64_t getLastRxTime() const { return _lastRxTime; }
+
+private:
+    struct RxByte
+    {
+        uint64_t time;
+        uint8_t value;
+    };
+
+    int _uart;
+    unsigned long _baud = 115200;
+    std::deque<RxByte> _rx;
+    std::string _tx;
+    uint64_t _lastRxTime = 0;
+    uint64_t _lastTxTime = 0;
+    FILE *_echo = nullptr;
+
+    uint64_t _byteTime() const { return 10000000ULL / _baud; } // 8N1 = 10 bits per byte
+};
+
+#endif /* SIM_ARDUINO_H */
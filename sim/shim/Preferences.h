@@ -0,0 +1,103 @@
+/*
+ * Project Name: synscancontrol
+ * File: Preferences.h
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Host stand-in for the ESP32 NVS key-value store
+ */
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+/* Same API as the arduino-esp32 Preferences library (the subset in
+ * use), backed by memory. The contents live as long as the process,
+ * so they survive a SimMount being destroyed and created again, just
+ * like flash survives a reboot.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Sim
+{
+    typedef std::map<std::string, std::vector<uint8_t>> FlashNamespace;
+
+    inline std::map<std::string, FlashNamespace> &flash()
+    {
+        static std::map<std::string, FlashNamespace> contents;
+        return contents;
+    }
+
+    // Factory-fresh flash
+    inline void eraseFlash() { flash().clear(); }
+} // namespace Sim
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false)
+    {
+        _ns = &Sim::flash()[name];
+        _readOnly = readOnly;
+        return true;
+    }
+
+    void end() { _ns = nullptr; }
+
+    size_t putBytes(const char *key, const void *value, size_t len)
+    {
+        if (!_ns || _readOnly)
+            return 0;
+        const uint8_t *bytes = (const uint8_t *)value;
+        (*_ns)[key].assign(bytes, bytes + len);
+        return len;
+    }
+
+    size_t getBytesLength(const char *key)
+    {
+        if (!_ns || !_ns->count(key))
+            return 0;
+        return (*_ns)[key].size();
+    }
+
+    size_t getBytes(const char *key, void *buf, size_t maxLen)
+    {
+        size_t len = getBytesLength(key);
+        if (!len || len > maxLen)
+            return 0;
+        memcpy(buf, (*_ns)[key].data(), len);
+        return len;
+    }
+
+    bool remove(const char *key)
+    {
+        if (!_ns || _readOnly)
+            return false;
+        return _ns->erase(key) > 0;
+    }
+
+private:
+    Sim::FlashNamespace *_ns = nullptr;
+    bool _readOnly = false;
+};
+
+#endif /* SIM_PREFERENCES_H */
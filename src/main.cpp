@@ -35,13 +35,20 @@
 #include <WiFi.h>
 #endif
 
+#include "ClockCalibration.hpp"
 #include "Constants.hpp"
 #include "Logger.hpp"
 #include "Enums.hpp"
+#include "FlashSettings.hpp"
+#include "GotoController.hpp"
+#include "GuidePort.hpp"
+#include "HorizonMask.hpp"
+#include "IsrProfiler.hpp"
 #include "Motor.hpp"
 #include "OTAUpdate.hpp"
 #include "PolarScopeLED.hpp"
 #include "StatusLED.hpp"
+#include "TraceRecorder.hpp"
 #include "CommandHandler.hpp"
 #include "UDPLogger.hpp"
 
@@ -57,8 +64,15 @@ bool wifiConnected = false;
 // Hardware timers
 hw_timer_t *tickTimer = nullptr;
 
+// Tick ISR timing (only recorded with -DISR_PROFILING)
+IsrProfiler isrProfiler;
+
+// Step / command event trace
+TraceRecorder traceRecorder;
+
 // Software timers
 unsigned long longTickTimer = 0;
+unsigned long satelliteTimer = 0;
 
 // Logger
 Logger logger;
@@ -67,8 +81,20 @@ UDPLoggerHandler *udpHandler = nullptr;
 #endif
 
 // Motors
-Motor raMotor(AxisEnum::AXIS_RA, RA_M0, RA_M1, RA_M2, RA_STEP, RA_DIR, 0x800000, false, &logger);
-Motor decMotor(AxisEnum::AXIS_DEC, DEC_M0, DEC_M1, DEC_M2, DEC_STEP, DEC_DIR, 0x913640, true, &logger);
+Motor raMotor(AxisEnum::AXIS_RA, RA_M0, RA_M1, RA_M2, RA_STEP, RA_DIR, 0x800000, false, &traceRecorder, &logger);
+Motor decMotor(AxisEnum::AXIS_DEC, DEC_M0, DEC_M1, DEC_M2, DEC_STEP, DEC_DIR, 0x913640, true, &traceRecorder, &logger);
+
+// ST-4 autoguider port
+GuidePort guidePort(&raMotor, &decMotor);
+
+// Crystal error against the host's clock
+ClockCalibration clockCalibration(&raMotor, &decMotor, &logger);
+
+// Horizon / pier collision mask
+HorizonMask horizonMask(&raMotor, &decMotor, &logger);
+
+// RA / Dec GOTOs
+GotoController gotoController(&raMotor, &decMotor, &clockCalibration, &horizonMask, &logger);
 
 // Power / Status LED
 StatusLED statusLED(PWR_LED, PWR_LED_PWM, &logger);
@@ -77,13 +103,22 @@ StatusLED statusLED(PWR_LED, PWR_LED_PWM, &logger);
 PolarScopeLED polarScopeLED(SCOPE_LED, SCOPE_LED_PWM, &logger);
 
 // Serial Command handler
-CommandHandler cmdHandler(&SerialSynScan, &raMotor, &decMotor, &polarScopeLED, &logger);
+CommandHandler cmdHandler(&SerialSynScan, &raMotor, &decMotor, &polarScopeLED, &isrProfiler, &traceRecorder, &clockCalibration, &gotoController, &logger);
 
 // Motor fast tick (hardware interrupt)
 void IRAM_ATTR tick()
 {
+#ifdef ISR_PROFILING
+    isrProfiler.enter();
+#endif
+    traceRecorder.tick();
+    guidePort.tick();
     decMotor.tick();
     raMotor.tick();
+    horizonMask.tick();
+#ifdef ISR_PROFILING
+    isrProfiler.exit();
+#endif
 }
 
 // Motor slow tick (loop)
@@ -91,6 +126,9 @@ void longTick()
 {
     decMotor.longTick();
     raMotor.longTick();
+    gotoController.longTick();
+    clockCalibration.longTick();
+    horizonMask.longTick();
 }
 
 void setup()
@@ -130,17 +168,24 @@ void setup()
     ledcAttachPin(BUILT_IN_LED, BUILT_IN_LED_PWM);
 
     // Setup motor tick timers
+    isrProfiler.begin(getCpuFrequencyMhz());
     tickTimer = timerBegin(0, 80, true);
     timerAttachInterrupt(tickTimer, &tick, true);
-    timerAlarmWrite(tickTimer, 50, true);
+    timerAlarmWrite(tickTimer, TICK_PERIOD_US, true);
     timerAlarmEnable(tickTimer);
+    FlashSettings::begin(tickTimer, &raMotor, &decMotor);
 
     // Setup motors
     decMotor.begin();
     raMotor.begin();
+    guidePort.begin();
+    clockCalibration.begin();
+    horizonMask.begin();
+    gotoController.begin();
 
     // Setup slow non-interrupt timer
     longTickTimer = millis();
+    satelliteTimer = millis();
 
 #ifdef USE_WIFI
     // Async WiFi setup (we don't wait for it to connect)
@@ -164,7 +209,9 @@ void setup()
     setupOTA(tickTimer, &SerialLogger);
 #endif
 
-    logger.debug("Logging started!");
+    // Start draining log messages to the handlers in the background
+    logger.begin();
+    logger.debug(LogMsg::LOGGING_STARTED);
 }
 
 void loop()
@@ -172,6 +219,9 @@ void loop()
     // Process serial port
     cmdHandler.processSerial();
 
+    // Send any pending trace dump to the logger
+    traceRecorder.pump(&logger);
+
 // Check WiFi status
 #ifdef USE_WIFI
     if (!wifiConnected && WiFi.status() == WL_CONNECTED)
@@ -208,6 +258,13 @@ void loop()
         longTick();
     }
 
+    // Satellite velocity updates, faster than the long tick
+    if (millis() - satelliteTimer >= SATELLITE_UPDATE_MS)
+    {
+        satelliteTimer = millis();
+        gotoController.update();
+    }
+
 #ifdef OTA_UPDATES
     if (wifiConnected)
         handleOTA();
@@ -0,0 +1,164 @@
+/*
+ * Project Name: synscancontrol
+ * File: CelestialTransform.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Fixed-point sidereal time and RA / Dec to axis transforms
+ */
+#ifndef CELESTIAL_TRANSFORM_H
+#define CELESTIAL_TRANSFORM_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+
+namespace SynScanControl
+{
+    /* Angles are binary fractions of a turn (Q32, 2^32 = 360 degrees, so
+     * 0.0003 arcsec per unit), wrapping around for free in integer
+     * arithmetic: hour angle = LST - RA needs no range reduction, and
+     * signed angles are just the int32_t view.
+     *
+     * Sidereal time is linear in time (IAU 2006 GMST, the t^2 term is
+     * 0.1 arcsec this century), so it is a single 64 bit multiply in Q64
+     * turns, wrapping to the fraction of a turn. Only the equation of the
+     * equinoxes (nutation, within 17 arcsec) is worked out in single
+     * precision. On a polar aligned equatorial mount, RA / Dec maps to
+     * the axes without any trigonometry.
+     */
+    namespace CelestialTransform
+    {
+        constexpr uint32_t QUARTER_TURN = 0x40000000;
+        constexpr uint32_t HALF_TURN = 0x80000000;
+        constexpr double Q32_PER_ARCSEC = 4294967296.0 / 1296000.0;
+
+        // J2000.0 (2000-01-01 12:00 UT) as Unix time, times are ms since then
+        constexpr int64_t J2000_UNIX_MS = 946728000000LL;
+        constexpr int64_t MS_PER_CENTURY = 36525LL * 86400000LL;
+
+        // GMST at J2000 and its rate (Earth rotation angle plus precession), Q64 turns
+        constexpr double TWO_POW_64 = 18446744073709551616.0;
+        constexpr uint64_t GMST_J2000 = (uint64_t)((0.7790572732640 + 0.014506 / 1296000.0) * TWO_POW_64);
+        constexpr uint64_t GMST_PER_MS =
+            (uint64_t)((1.00273781191135448 / 86400000.0 + 4612.156534 / 1296000.0 / MS_PER_CENTURY) * TWO_POW_64 + 0.5);
+
+        // Greenwich mean sidereal time, from UT1 (UTC is within 0.9 s)
+        inline uint32_t meanSiderealTime(int64_t ms)
+        {
+            return (uint32_t)((GMST_J2000 + (uint64_t)ms * GMST_PER_MS) >> 32);
+        }
+
+        // Greenwich apparent sidereal time
+        inline uint32_t siderealTime(int64_t ms)
+        {
+            // Equation of the equinoxes from the two largest nutation terms (Moon's node and
+            // the Sun), the rest add up to 0.4 arcsec
+            float t = (float)ms / (float)MS_PER_CENTURY;
+            float omega = (125.04452f - 1934.136261f * t) * 0.0174532925f;
+            float sun = (560.933f + 72001.5396f * t) * 0.0174532925f;
+            int32_t eqeq = (int32_t)((float)Q32_PER_ARCSEC * (-15.78f * sinf(omega) - 1.21f * sinf(sun)));
+            return meanSiderealTime(ms) + (uint32_t)eqeq;
+        }
+
+        // Axis angle (Q32 turns from the start position) to SynScan position, and back
+        inline uint32_t toPosition(int32_t angle)
+        {
+            return 0x800000 + (int32_t)(((int64_t)angle * MICROSTEPS_PER_REV + (1LL << 31)) >> 32);
+        }
+
+        inline int32_t fromPosition(uint32_t position)
+        {
+            int64_t offset = (int32_t)(position - 0x800000);
+            return (int32_t)(uint32_t)(offset * 4294967296LL / (int64_t)MICROSTEPS_PER_REV);
+        }
+
+        // Negation that wraps (-180 degrees stays -180 degrees)
+        inline int32_t negate(int32_t angle)
+        {
+            return (int32_t)(0u - (uint32_t)angle);
+        }
+
+        /* Both axes start at 0 with the RA axis counterweight down and the
+         * Dec axis at the pole. With the telescope east of the pier the Dec
+         * axis reads the declination and the RA axis is 6h behind the hour
+         * angle, from the west it reads 180 degrees less the declination
+         * and the RA axis is 6h ahead. In the southern hemisphere the RA
+         * axis turns the other way and the Dec axis looks at the south
+         * pole, a mirror image of the north.
+         */
+        inline PierSideEnum autoPierSide(int32_t ha)
+        {
+            return (ha >= 0) ? PierSideEnum::EAST : PierSideEnum::WEST;
+        }
+
+        inline void toAxes(int32_t ha, int32_t dec, PierSideEnum side, bool south, int32_t *raAxis, int32_t *decAxis)
+        {
+            if (side == PierSideEnum::AUTO)
+                side = autoPierSide(ha);
+            if (south)
+            {
+                ha = negate(ha);
+                dec = negate(dec);
+            }
+            if ((side == PierSideEnum::EAST) != south)
+            {
+                *raAxis = (int32_t)((uint32_t)ha - QUARTER_TURN);
+                *decAxis = dec;
+            }
+            else
+            {
+                *raAxis = (int32_t)((uint32_t)ha + QUARTER_TURN);
+                *decAxis = (int32_t)(HALF_TURN - (uint32_t)dec);
+            }
+            if (south)
+                *raAxis = negate(*raAxis);
+        }
+
+        inline void fromAxes(int32_t raAxis, int32_t decAxis, bool south, int32_t *ha, int32_t *dec, PierSideEnum *side)
+        {
+            bool east = decAxis >= -(int32_t)QUARTER_TURN && decAxis <= (int32_t)QUARTER_TURN;
+            uint32_t ra = (uint32_t)(south ? negate(raAxis) : raAxis);
+            if (east)
+            {
+                *ha = (int32_t)(ra + QUARTER_TURN);
+                *dec = decAxis;
+            }
+            else
+            {
+                *ha = (int32_t)(ra - QUARTER_TURN);
+                *dec = (int32_t)(HALF_TURN - (uint32_t)decAxis);
+            }
+            if (south)
+            {
+                *ha = negate(*ha);
+                *dec = negate(*dec);
+            }
+            *side = (east != south) ? PierSideEnum::EAST : PierSideEnum::WEST;
+        }
+
+        inline int32_t arcsec(int32_t angle)
+        {
+            return (int32_t)(((int64_t)angle * 1296000 + (1LL << 31)) >> 32);
+        }
+    } // namespace CelestialTransform
+} // namespace SynScanControl
+
+#endif /* CELESTIAL_TRANSFORM_H */
@@ -0,0 +1,114 @@
+/*
+ * Project Name: synscancontrol
+ * File: ClockCalibration.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Calibration of the ESP32 crystal against a host clock
+ */
+#include "ClockCalibration.hpp"
+#include "FlashSettings.hpp"
+
+using namespace SynScanControl;
+
+ClockCalibration::ClockCalibration(Motor *raMotor, Motor *decMotor, Logger *logger)
+{
+    _motors[0] = raMotor;
+    _motors[1] = decMotor;
+    _logger = logger;
+}
+
+void ClockCalibration::begin()
+{
+    int32_t ppb = 0;
+    if (!FlashSettings::load(NVS_NAMESPACE, NVS_KEY, &ppb, sizeof(ppb)))
+        return;
+
+    _correctionPpb = ppb;
+    for (Motor *motor : _motors)
+        motor->setClockCorrection(ppb);
+    _logger->info(LogMsg::CLOCK_CORRECTION_LOADED, ppb);
+}
+
+void ClockCalibration::sync(uint32_t hostMs)
+{
+    int64_t deviceUs = esp_timer_get_time();
+    hostMs &= HOST_TIME_MASK;
+    if (_count == 0)
+    {
+        _firstDeviceUs = deviceUs;
+        _hostMs = 0;
+    }
+    else
+    {
+        _hostMs += (hostMs - _lastHostRaw) & HOST_TIME_MASK;
+    }
+    _lastHostRaw = hostMs;
+    _count++;
+
+    // x: host seconds, y: how far ahead the ESP32 is, in us (the slope is in ppm)
+    double x = _hostMs / 1000.0;
+    double y = (double)(deviceUs - _firstDeviceUs) - _hostMs * 1000.0;
+    _lastHostS = x;
+    _sx += x;
+    _sy += y;
+    _sxx += x * x;
+    _sxy += x * y;
+    _logger->debug(LogMsg::CLOCK_SYNC, _count, (uint32_t)x, (int32_t)y);
+}
+
+void ClockCalibration::restart()
+{
+    _count = 0;
+    _lastHostS = 0.0;
+    _sx = _sy = _sxx = _sxy = 0.0;
+}
+
+bool ClockCalibration::hasMeasurement() const
+{
+    return _count >= 3 && _lastHostS >= 60.0;
+}
+
+int32_t ClockCalibration::getMeasuredPpb() const
+{
+    if (!hasMeasurement())
+        return 0;
+    double det = _count * _sxx - _sx * _sx;
+    double slope = (_count * _sxy - _sx * _sy) / det;
+    return (int32_t)(slope * 1000.0 + (slope >= 0 ? 0.5 : -0.5));
+}
+
+void ClockCalibration::setCorrection(int32_t ppb)
+{
+    _correctionPpb = ppb;
+    for (Motor *motor : _motors)
+        motor->setClockCorrection(ppb);
+    restart();
+    _savePending = true;
+    _logger->info(LogMsg::CLOCK_CORRECTION_SET, ppb);
+}
+
+// The axes are likely tracking when the correction is set, flash writes pause the tick timer
+void ClockCalibration::longTick()
+{
+    if (!_savePending || !FlashSettings::canSave())
+        return;
+    _savePending = false;
+    if (!FlashSettings::save(NVS_NAMESPACE, NVS_KEY, &_correctionPpb, sizeof(_correctionPpb)))
+        _logger->error(LogMsg::CLOCK_CORRECTION_SAVE_ERROR);
+}
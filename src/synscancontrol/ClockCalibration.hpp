@@ -0,0 +1,97 @@
+/*
+ * Project Name: synscancontrol
+ * File: ClockCalibration.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Calibration of the ESP32 crystal against a host clock
+ */
+#ifndef CLOCK_CALIBRATION_H
+#define CLOCK_CALIBRATION_H
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+#include "Logger.hpp"
+#include "Motor.hpp"
+
+namespace SynScanControl
+{
+    /* The tick timer runs off the ESP32's crystal, which can be off by
+     * tens of ppm, i.e. RA drifting by a few arcsec an hour.
+     *
+     * A host with a good clock (NTP / GPS) sends its time every now and
+     * then (CLOCK_SYNC). Each sync is paired with the ESP32's own time
+     * (esp_timer, same crystal as the tick timer), and a least squares
+     * line through the pairs gives the crystal error, with the host /
+     * serial latency jitter averaging out over the session. The error is
+     * saved to flash and the motors scale their tracking rate by it.
+     */
+    class ClockCalibration
+    {
+    public:
+        // Host times are in ms, SynScan's 6 hex chars: syncs have to come more often than every 4.6 hours
+        static const uint32_t HOST_TIME_MASK = 0xFFFFFF;
+
+        ClockCalibration(Motor *raMotor, Motor *decMotor, Logger *logger);
+
+        // Loads the correction from flash and applies it
+        void begin();
+
+        void sync(uint32_t hostMs);
+        void restart();
+
+        // Needs a few syncs over at least a minute
+        bool hasMeasurement() const;
+        // Crystal error in ppb (positive: the ESP32 clock runs fast)
+        int32_t getMeasuredPpb() const;
+        uint32_t getSyncCount() const { return _count; }
+        uint32_t getSpanSeconds() const { return (uint32_t)_lastHostS; }
+
+        // Applied to the motors right away, saved to flash once the axes stop; restarts the measurement
+        void setCorrection(int32_t ppb);
+        int32_t getCorrection() const { return _correctionPpb; }
+
+        // Saves the correction when it can
+        void longTick();
+
+    private:
+        static constexpr const char *NVS_NAMESPACE = "clock";
+        static constexpr const char *NVS_KEY = "ppb";
+
+        Motor *_motors[2];
+        Logger *_logger;
+        int32_t _correctionPpb = 0;
+        bool _savePending = false;
+
+        // Least squares of (device - host) against host time, relative to the first sync
+        uint32_t _count = 0;
+        uint32_t _lastHostRaw = 0;
+        uint64_t _hostMs = 0;
+        int64_t _firstDeviceUs = 0;
+        double _lastHostS = 0.0;
+        double _sx = 0.0;
+        double _sy = 0.0;
+        double _sxx = 0.0;
+        double _sxy = 0.0;
+    };
+} // namespace SynScanControl
+
+#endif /* CLOCK_CALIBRATION_H */
@@ -24,6 +24,8 @@
  * Much of this code is directly inspired from Open-Synscan, so refer to
  * that project as well if something is confusing.
  */
+#include <string.h>
+
 #include "Command.hpp"
 #include "HexConversionUtils.hpp"
 
@@ -477,6 +479,11 @@ bool SetAutoguideSpeedCommand::parse(const char *data, uint16_t len)
     return success;
 }
 
+uint32_t SetAutoguideSpeedCommand::getSpeed() const
+{
+    return _speed;
+}
+
 SetPolarLEDBrightnessCommand::SetPolarLEDBrightnessCommand()
 {
     _cmd = CommandEnum::SET_POLAR_LED_BRIGHTNESS_CMD;
@@ -507,6 +514,48 @@ uint8_t SetPolarLEDBrightnessCommand::getValue() const
     return _value;
 }
 
+SetFeatureCommand::SetFeatureCommand()
+{
+    _cmd = CommandEnum::SET_FEATURE_CMD;
+}
+
+bool SetFeatureCommand::parse(const char *data, uint16_t len)
+{
+    bool success = false;
+    if (len == MSG_SIZE)
+    {
+        if (data[0] == ':')
+        {
+            char header = data[1];
+            if (header == (char)_cmd)
+            {
+                _axis = parseAxis(data[2]);
+                uint32_t feature = parseToHex<uint32_t>(data + 3, 6);
+                switch (feature)
+                {
+                case (uint32_t)FeatureEnum::START_PEC_TRAINING:
+                case (uint32_t)FeatureEnum::STOP_PEC_TRAINING:
+                case (uint32_t)FeatureEnum::PEC_TRACKING_ON:
+                case (uint32_t)FeatureEnum::PEC_TRACKING_OFF:
+                    _feature = (FeatureEnum)feature;
+                    break;
+                default:
+                    _feature = FeatureEnum::UNKNOWN_FEATURE;
+                    break;
+                }
+                _has_init = true;
+                success = true;
+            }
+        }
+    }
+    return success;
+}
+
+FeatureEnum SetFeatureCommand::getFeature() const
+{
+    return _feature;
+}
+
 GetCountsPerRevCommand::GetCountsPerRevCommand()
 {
     _cmd = CommandEnum::GET_COUNTS_PER_REV_CMD;
@@ -594,6 +643,58 @@ bool GetExtendedStatusCommand::parse(const char *data, uint16_t len)
     return success;
 }
 
+ExtendedCommand::ExtendedCommand()
+{
+    _cmd = CommandEnum::EXTENDED_CMD;
+    _payload[0] = '\0';
+}
+
+bool ExtendedCommand::parse(const char *data, uint16_t len)
+{
+    bool success = false;
+    if (len >= MIN_MSG_SIZE && len - MIN_MSG_SIZE <= MAX_PAYLOAD_SIZE)
+    {
+        if (data[0] == ':')
+        {
+            char header = data[1];
+            if (header == (char)_cmd)
+            {
+                _axis = parseAxis(data[2]);
+                _subCmd = (ExtendedCommandEnum)parseToHex<uint32_t>(data + 3, 2);
+                _payloadLen = len - MIN_MSG_SIZE;
+                memcpy(_payload, data + MIN_MSG_SIZE, _payloadLen);
+                _payload[_payloadLen] = '\0';
+                _has_init = true;
+                success = true;
+            }
+        }
+    }
+    return success;
+}
+
+ExtendedCommandEnum ExtendedCommand::getSubCommand() const
+{
+    return _subCmd;
+}
+
+const char *ExtendedCommand::getPayload() const
+{
+    return _payload;
+}
+
+uint16_t ExtendedCommand::getPayloadLength() const
+{
+    return _payloadLen;
+}
+
+bool ExtendedCommand::getHex(uint16_t offset, uint16_t len, uint32_t *value) const
+{
+    if (offset + len > _payloadLen)
+        return false;
+    *value = parseToHex<uint32_t>(_payload + offset, len);
+    return true;
+}
+
 Command *CommandFactory::parse(const char *data, uint16_t len)
 {
     // We need a buffer of at least length 2 to determine
@@ -672,6 +773,11 @@ Command *CommandFactory::parse(const char *data, uint16_t len)
         cmd = new SetPolarLEDBrightnessCommand;
         break;
     }
+    case (char)CommandEnum::SET_FEATURE_CMD:
+    {
+        cmd = new SetFeatureCommand();
+        break;
+    }
     case (char)CommandEnum::GET_COUNTS_PER_REV_CMD:
     {
         cmd = new GetCountsPerRevCommand();
@@ -732,6 +838,11 @@ Command *CommandFactory::parse(const char *data, uint16_t len)
         cmd = new GetExtendedStatusCommand();
         break;
     }
+    case (char)CommandEnum::EXTENDED_CMD:
+    {
+        cmd = new ExtendedCommand();
+        break;
+    }
     default:
         break;
     }
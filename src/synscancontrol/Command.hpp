@@ -213,6 +213,7 @@ namespace SynScanControl
         SetAutoguideSpeedCommand();
 
         bool parse(const char *data, uint16_t len) override;
+        uint32_t getSpeed() const;
     };
 
     class SetPolarLEDBrightnessCommand : public Command
@@ -227,6 +228,18 @@ namespace SynScanControl
         bool parse(const char *data, uint16_t len) override;
     };
 
+    class SetFeatureCommand : public Command
+    {
+    private:
+        static const uint16_t MSG_SIZE = 9;
+        FeatureEnum _feature = FeatureEnum::UNKNOWN_FEATURE;
+
+    public:
+        SetFeatureCommand();
+        FeatureEnum getFeature() const;
+        bool parse(const char *data, uint16_t len) override;
+    };
+
     class GetCountsPerRevCommand : public GetterCommand
     {
     public:
@@ -313,6 +326,34 @@ namespace SynScanControl
         bool parse(const char *data, uint16_t len) override;
     };
 
+    /* Our own extension to the protocol, ":Z[axis][sub-command][payload]"
+     * The sub-command is 2 hex characters, the payload is kept as-is
+     * and interpreted by whoever handles the sub-command.
+     */
+    class ExtendedCommand : public Command
+    {
+    public:
+        static const uint16_t MAX_PAYLOAD_SIZE = 128;
+
+    private:
+        static const uint16_t MIN_MSG_SIZE = 5;
+        ExtendedCommandEnum _subCmd = ExtendedCommandEnum::UNKNOWN_EXT_CMD;
+        char _payload[MAX_PAYLOAD_SIZE + 1];
+        uint16_t _payloadLen = 0;
+
+    public:
+        ExtendedCommand();
+
+        bool parse(const char *data, uint16_t len) override;
+        ExtendedCommandEnum getSubCommand() const;
+        const char *getPayload() const;
+        uint16_t getPayloadLength() const;
+
+        // Parse len (1, 2, 4 or 6) hex chars of payload starting at offset,
+        // in SynScan byte order. Returns false if the payload is too short.
+        bool getHex(uint16_t offset, uint16_t len, uint32_t *value) const;
+    };
+
     class CommandFactory
     {
     private:
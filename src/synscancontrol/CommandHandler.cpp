@@ -25,16 +25,45 @@
  * that project as well if something is confusing.
  */
 #include "CommandHandler.hpp"
+#include "FlashSettings.hpp"
 
 using namespace SynScanControl;
 
+#ifdef SERIAL_CAPTURE
+/* Session lines longer than a log record holds are sent in pieces:
+ * "more" records, then the last piece as the usual SESSION_RX / SESSION_TX
+ * (the tools join them back up)
+ */
+static void captureLine(Logger *logger, LogMsg more, LogMsg last, const char *line)
+{
+    const uint32_t PIECE = LogRecord::PAYLOAD_SIZE - 1;
+    char piece[PIECE + 1];
+    uint32_t len = strlen(line);
+    while (len > PIECE)
+    {
+        memcpy(piece, line, PIECE);
+        piece[PIECE] = '\0';
+        logger->info(more, piece);
+        line += PIECE;
+        len -= PIECE;
+    }
+    logger->info(last, line);
+}
+#endif
+
 CommandHandler::CommandHandler(HardwareSerial *serial,
-                               Motor *raMotor, Motor *decMotor, PolarScopeLED *polarScopeLED, Logger *logger)
+                               Motor *raMotor, Motor *decMotor, PolarScopeLED *polarScopeLED,
+                               IsrProfiler *isrProfiler, TraceRecorder *trace, ClockCalibration *clock,
+                               GotoController *gotoController, Logger *logger)
 {
     _serial = serial;
     _raMotor = raMotor;
     _decMotor = decMotor;
     _polarScopeLED = polarScopeLED;
+    _isrProfiler = isrProfiler;
+    _trace = trace;
+    _clock = clock;
+    _goto = gotoController;
     _logger = logger;
 }
 
@@ -60,9 +89,11 @@ void CommandHandler::processSerial()
         if (inChar == _endChar && _buffer_idx > 2)
         {
             // Log the command we got
-            std::ostringstream log;
-            log << "Received command: " << _buffer;
-            _logger->debug(&log);
+            _logger->debug(LogMsg::CMD_RECEIVED, _buffer);
+            _trace->recordCommand((AxisEnum)(_buffer[2] - '0'), _buffer, _buffer_idx);
+#ifdef SERIAL_CAPTURE
+            captureLine(_logger, LogMsg::SESSION_RX_MORE, LogMsg::SESSION_RX, _buffer);
+#endif
 
             // Process the message and get a reply
             Command *cmd = CommandFactory::parse(_buffer, _buffer_idx);
@@ -72,22 +103,30 @@ void CommandHandler::processSerial()
                 {
                     // Command successfully parsed
                     // Process it and generate a reply
-                    Reply *reply = _processCommand(cmd);
+                    Reply *reply = processCommand(cmd);
 
                     // Send the reply
                     if (reply)
                     {
                         // Log the reply we are giving
-                        std::ostringstream log;
-                        log << "Sending reply: ";
-                        reply->toStringStream(&log);
-                        _logger->debug(&log);
+                        // (only stringify it if someone is listening)
+                        if (_logger->isEnabledFor(LoggingLevel::LOG_DEBUG))
+                        {
+                            std::ostringstream log;
+                            reply->toStringStream(&log);
+                            _logger->debug(LogMsg::CMD_REPLY, log.str().c_str());
+                        }
+#ifdef SERIAL_CAPTURE
+                        std::ostringstream capture;
+                        reply->toStringStream(&capture);
+                        captureLine(_logger, LogMsg::SESSION_TX_MORE, LogMsg::SESSION_TX, capture.str().c_str());
+#endif
 
                         reply->send(_serial);
                     }
                     else
                     {
-                        _logger->error("Failed to come up with a reply!");
+                        _logger->error(LogMsg::CMD_NO_REPLY);
                     }
 
                     // We are done processing the reply
@@ -95,18 +134,12 @@ void CommandHandler::processSerial()
                 }
                 else
                 {
-                    _logger->error("Error parsing command!");
-                    _logger->error("===");
-                    _logger->error(_buffer);
-                    _logger->error("===");
+                    _logger->error(LogMsg::CMD_PARSE_ERROR, _buffer);
                 }
             }
             else
             {
-                _logger->error("Command factory returned nullptr!");
-                _logger->error("===");
-                _logger->error(_buffer);
-                _logger->error("===");
+                _logger->error(LogMsg::CMD_FACTORY_ERROR, _buffer);
             }
 
             // We are done processing the command
@@ -131,7 +164,7 @@ void CommandHandler::processSerial()
     // Serial timeout handling
     if (_serialStarted && (millis() - _timeoutCounter > SERIAL_TIMEOUT_MS))
     {
-        _logger->info("Serial timeout reached!");
+        _logger->info(LogMsg::CMD_SERIAL_TIMEOUT);
         _serialStarted = false;
         _raMotor->setMotion(false);
         _decMotor->setMotion(false);
@@ -158,7 +191,7 @@ Motor *CommandHandler::getMotorForAxis(AxisEnum axis)
     }
 }
 
-Reply *CommandHandler::_processCommand(Command *cmd)
+Reply *CommandHandler::processCommand(Command *cmd)
 {
     Reply *reply = nullptr;
     Motor *thisMotor = getMotorForAxis(cmd->getAxis());
@@ -256,6 +289,7 @@ Reply *CommandHandler::_processCommand(Command *cmd)
     case CommandEnum::SET_STEP_PERIOD_CMD:
     {
         SetStepPeriodCommand *thisCmd = (SetStepPeriodCommand *)cmd;
+        thisMotor->setTrackingRate(TrackingRateEnum::HOST);
         thisMotor->setStepPeriod(thisCmd->getPeriod());
         reply = new EmptyReply();
         break;
@@ -263,7 +297,14 @@ Reply *CommandHandler::_processCommand(Command *cmd)
     case CommandEnum::START_MOTION_CMD:
     {
         // StartMotionCommand *thisCmd = (StartMotionCommand *)cmd;
-        if (!thisMotor->isMoving())
+        _goto->cancel();
+        GotoPlanner *planner = _goto->getPlanner();
+        if (!thisMotor->isMoving() && thisMotor->getSlewType() == SlewTypeEnum::GOTO && planner->isEnabled() &&
+            !planner->plan(thisMotor))
+        {
+            reply = new ErrorReply(ErrorEnum::OUTSIDE_LIMITS_ERROR);
+        }
+        else if (!thisMotor->isMoving())
         {
             thisMotor->setMotion(true);
             reply = new EmptyReply();
@@ -281,6 +322,7 @@ Reply *CommandHandler::_processCommand(Command *cmd)
     case CommandEnum::STOP_MOTION_CMD:
     {
         // StopMotionCommand *thisCmd = (StopMotionCommand *)cmd;
+        _goto->cancel();
         if (thisMotor->isMoving())
         {
             thisMotor->setMotion(false);
@@ -304,8 +346,8 @@ Reply *CommandHandler::_processCommand(Command *cmd)
     }
     case CommandEnum::SET_AUTOGUIDE_SPEED_CMD:
     {
-        // SetAutoguideSpeedCommand *thisCmd = (SetAutoguideSpeedCommand *)cmd;
-        // TODO: if we want
+        SetAutoguideSpeedCommand *thisCmd = (SetAutoguideSpeedCommand *)cmd;
+        thisMotor->setGuideRate(thisCmd->getSpeed());
         reply = new EmptyReply();
         break;
     }
@@ -316,6 +358,47 @@ Reply *CommandHandler::_processCommand(Command *cmd)
         reply = new EmptyReply();
         break;
     }
+    case CommandEnum::SET_FEATURE_CMD:
+    {
+        SetFeatureCommand *thisCmd = (SetFeatureCommand *)cmd;
+        PecTable *pec = thisMotor->getPecTable();
+        switch (thisCmd->getFeature())
+        {
+        case FeatureEnum::START_PEC_TRAINING:
+            thisMotor->startPecTraining();
+            reply = new EmptyReply();
+            break;
+        case FeatureEnum::STOP_PEC_TRAINING:
+            thisMotor->stopPecTraining();
+            reply = new EmptyReply();
+            break;
+        case FeatureEnum::PEC_TRACKING_ON:
+            if (thisMotor->isPecTraining())
+            {
+                reply = new ErrorReply(ErrorEnum::PEC_TRAINING_IS_RUNNING_ERROR);
+            }
+            else if (pec->isValid())
+            {
+                pec->setEnabled(true);
+                _logger->info(LogMsg::MOTOR_PEC_TRACKING, int(cmd->getAxis()), 1);
+                reply = new EmptyReply();
+            }
+            else
+            {
+                reply = new ErrorReply(ErrorEnum::NO_VALID_PEC_DATA_ERROR);
+            }
+            break;
+        case FeatureEnum::PEC_TRACKING_OFF:
+            pec->setEnabled(false);
+            _logger->info(LogMsg::MOTOR_PEC_TRACKING, int(cmd->getAxis()), 0);
+            reply = new EmptyReply();
+            break;
+        default:
+            reply = new ErrorReply(ErrorEnum::UNKNOWN_CMD_ERROR);
+            break;
+        }
+        break;
+    }
     case CommandEnum::GET_COUNTS_PER_REV_CMD:
     {
         // GetCountsPerRevCommand *thisCmd = (GetCountsPerRevCommand *)cmd;
@@ -409,9 +492,8 @@ Reply *CommandHandler::_processCommand(Command *cmd)
     case CommandEnum::GET_PEC_PERIOD_CMD:
     {
         // GetPECPeriodCommand *thisCmd = (GetPECPeriodCommand *)cmd;
-        // TODO: replace with motor PEC period, if this is something we will do
         DataReply *data_reply = new DataReply();
-        data_reply->setData(0, 6);
+        data_reply->setData(PecTable::getPeriod(), 6);
         reply = data_reply;
         break;
     }
@@ -425,15 +507,892 @@ Reply *CommandHandler::_processCommand(Command *cmd)
         ex_status_reply->setEQAZModeSupport(false);
         ex_status_reply->setHasPolarLed(true);
         ex_status_reply->setOriginalIdxPosSupport(false);
-        ex_status_reply->setPPECSupport(false);
-        ex_status_reply->setPecTracking(false);
-        ex_status_reply->setPecTraining(false);
+        ex_status_reply->setPPECSupport(true);
+        ex_status_reply->setPecTracking(thisMotor->getPecTable()->isEnabled());
+        ex_status_reply->setPecTraining(thisMotor->isPecTraining());
         ex_status_reply->setTorqueSelectionSupport(false);
         ex_status_reply->setTwoAxesSeparate(false);
         reply = ex_status_reply;
         break;
     }
+    case CommandEnum::EXTENDED_CMD:
+    {
+        reply = _processExtendedCommand((ExtendedCommand *)cmd);
+        break;
+    }
+    default:
+        break;
+    }
+    return reply;
+}
+
+Reply *CommandHandler::_processExtendedCommand(ExtendedCommand *cmd)
+{
+    Reply *reply = nullptr;
+
+    switch (cmd->getSubCommand())
+    {
+    case ExtendedCommandEnum::GET_ISR_STATS:
+    {
+        uint32_t selector = 0;
+        if (!cmd->getHex(0, 2, &selector))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+
+        IsrProfiler::Stats stats = _isrProfiler->getStats();
+        uint32_t value = 0;
+        if (selector >= (uint32_t)IsrStatEnum::JITTER_HISTOGRAM)
+        {
+            uint32_t bucket = selector - (uint32_t)IsrStatEnum::JITTER_HISTOGRAM;
+            value = (bucket < IsrProfiler::NUM_BUCKETS) ? stats.jitterHistogram[bucket] : 0;
+        }
+        else if (selector >= (uint32_t)IsrStatEnum::EXEC_HISTOGRAM)
+        {
+            uint32_t bucket = selector - (uint32_t)IsrStatEnum::EXEC_HISTOGRAM;
+            value = (bucket < IsrProfiler::NUM_BUCKETS) ? stats.execHistogram[bucket] : 0;
+        }
+        else
+        {
+            switch ((IsrStatEnum)selector)
+            {
+            case IsrStatEnum::TICKS:
+                value = stats.ticks;
+                break;
+            case IsrStatEnum::OVERRUNS:
+                value = stats.overruns;
+                break;
+            case IsrStatEnum::MAX_EXEC_CYCLES:
+                value = stats.maxExecCycles;
+                break;
+            case IsrStatEnum::MAX_JITTER_CYCLES:
+                value = stats.maxJitterCycles;
+                break;
+            case IsrStatEnum::MEAN_EXEC_CYCLES:
+                value = stats.ticks ? (uint32_t)(stats.totalExecCycles / stats.ticks) : 0;
+                break;
+            case IsrStatEnum::PERIOD_CYCLES:
+                value = _isrProfiler->getPeriodCycles();
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Saturate to what fits in the reply
+        DataReply *data_reply = new DataReply();
+        data_reply->setData(min(value, (uint32_t)0xFFFFFF), 6);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::DUMP_ISR_STATS:
+    {
+        // Optional payload: "01" to reset the stats after dumping them
+        uint32_t resetAfter = 0;
+        cmd->getHex(0, 2, &resetAfter);
+
+        IsrProfiler::Stats stats = _isrProfiler->getStats();
+        if (resetAfter)
+            _isrProfiler->reset();
+
+        _logger->info(LogMsg::ISR_STATS_SUMMARY, stats.ticks, stats.overruns,
+                      stats.ticks ? (uint32_t)(stats.totalExecCycles / stats.ticks) : 0,
+                      stats.maxExecCycles, stats.maxJitterCycles, _isrProfiler->getPeriodCycles());
+        for (uint32_t i = 0; i < IsrProfiler::NUM_BUCKETS; i++)
+        {
+            uint32_t lower = i ? (1u << (i - 1)) : 0;
+            if (stats.execHistogram[i])
+                _logger->info(LogMsg::ISR_STATS_EXEC_BUCKET, lower, 1u << i, stats.execHistogram[i]);
+            if (stats.jitterHistogram[i])
+                _logger->info(LogMsg::ISR_STATS_JITTER_BUCKET, lower, 1u << i, stats.jitterHistogram[i]);
+        }
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::DUMP_TRACE:
+    {
+        // The events are sent to the logger a few at a time from the loop
+        _trace->startDump();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SET_TRACE_ENABLED:
+    {
+        uint32_t enabled = 0;
+        if (!cmd->getHex(0, 2, &enabled))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        _trace->setEnabled(enabled != 0);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SET_PEC_ENTRY:
+    {
+        // Payload: bin (2 chars), Q15 rate correction (4 chars, two's complement)
+        uint32_t bin = 0;
+        uint32_t value = 0;
+        if (!cmd->getHex(0, 2, &bin) || !cmd->getHex(2, 4, &value) || bin >= PecTable::NUM_BINS)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        getMotorForAxis(cmd->getAxis())->getPecTable()->setEntry(bin, (int16_t)value);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_PEC_ENTRY:
+    {
+        uint32_t bin = 0;
+        if (!cmd->getHex(0, 2, &bin) || bin >= PecTable::NUM_BINS)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData(getMotorForAxis(cmd->getAxis())->getPecTable()->getEntry(bin) & 0xFFFF, 4);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::CLEAR_PEC_TABLE:
+    {
+        // Also turns PEC tracking off, and erases the saved table
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        motor->getPecTable()->clear();
+        motor->savePecTable();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SAVE_PEC_TABLE:
+    {
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        // Failures are logged by the motor
+        getMotorForAxis(cmd->getAxis())->savePecTable();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::PULSE_GUIDE:
+    {
+        // Payload: direction (2 chars, 00 + / 01 -), rate in 1/1000 sidereal (4 chars), duration in ms (4 chars)
+        uint32_t direction = 0;
+        uint32_t rate = 0;
+        uint32_t durationMs = 0;
+        // A zero duration cancels the pulses not played out yet, whatever the rate
+        if (!cmd->getHex(0, 2, &direction) || !cmd->getHex(2, 4, &rate) || !cmd->getHex(6, 4, &durationMs) ||
+            direction > 1 || (durationMs != 0 && (rate == 0 || rate > 1000)))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        if (durationMs == 0)
+            motor->clearPulseGuide();
+        else if (!motor->pulseGuide(direction ? -1 : 1, rate, durationMs * 1000))
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_PULSE_GUIDE:
+    {
+        // Time left in ms, rounded up: 0 once every pulse was played out
+        uint32_t remainingUs = getMotorForAxis(cmd->getAxis())->getPulseGuideQueue()->getRemainingUs();
+        DataReply *data_reply = new DataReply();
+        data_reply->setData(min((remainingUs + 999) / 1000, (uint32_t)0xFFFFFF), 6);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_BACKLASH:
+    {
+        // Payload: backlash in position units (6 chars), preload direction (2 chars, 00 none / 01 CW / 02 CCW)
+        uint32_t backlash = 0;
+        uint32_t preload = 0;
+        if (!cmd->getHex(0, 6, &backlash) || !cmd->getHex(6, 2, &preload) || preload > 2)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        static const SlewDirectionEnum preloads[] = {SlewDirectionEnum::NONE, SlewDirectionEnum::CW, SlewDirectionEnum::CCW};
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        motor->setBacklash(backlash, preloads[preload]);
+        motor->saveBacklash();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_BACKLASH:
+    {
+        // Payload: 00 for the backlash (6 chars), 01 for the preload direction (2 chars)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        DataReply *data_reply = new DataReply();
+        if (selector == 1)
+        {
+            data_reply->setData(Motor::preloadCode(motor->getBacklashPreload()), 2);
+        }
+        else
+        {
+            data_reply->setData(motor->getBacklash(), 6);
+        }
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_TRACKING_RATE:
+    {
+        // Payload: rate (2 chars, see TrackingRateEnum)
+        uint32_t rate = 0;
+        if (!cmd->getHex(0, 2, &rate) || rate > (uint32_t)TrackingRateEnum::KING)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        getMotorForAxis(cmd->getAxis())->setTrackingRate((TrackingRateEnum)rate);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_TRACKING_RATE:
+    {
+        DataReply *data_reply = new DataReply();
+        data_reply->setData((uint32_t)getMotorForAxis(cmd->getAxis())->getTrackingRate(), 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::CLOCK_SYNC:
+    {
+        // Payload: host time in ms (6 chars, wraps around), the axis is ignored
+        uint32_t hostMs = 0;
+        if (!cmd->getHex(0, 6, &hostMs))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        _clock->sync(hostMs);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_CLOCK_CALIBRATION:
+    {
+        // Payload: 00 measured error (ppb), 01 correction applied (ppb), 02 syncs, 03 seconds covered by the syncs
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        uint32_t value = 0;
+        switch (selector)
+        {
+        case 0:
+            value = (uint32_t)_clock->getMeasuredPpb();
+            break;
+        case 1:
+            value = (uint32_t)_clock->getCorrection();
+            break;
+        case 2:
+            value = _clock->getSyncCount();
+            break;
+        default:
+            value = _clock->getSpanSeconds();
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData(value & 0xFFFFFF, 6);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_CLOCK_CORRECTION:
+    {
+        // Payload: none to apply the measured error, or a correction in ppb (6 chars, two's complement)
+        uint32_t ppb = 0;
+        if (cmd->getHex(0, 6, &ppb))
+        {
+            _clock->setCorrection((int32_t)(ppb << 8) >> 8);
+        }
+        else if (_clock->hasMeasurement())
+        {
+            _clock->setCorrection(_clock->getMeasuredPpb());
+        }
+        else
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SET_SITE:
+    {
+        // Payload: latitude, longitude (east positive), 6 chars each in 1/2^24 turns (two's complement),
+        // height in m (4 chars, two's complement, optional)
+        uint32_t latitude = 0;
+        uint32_t longitude = 0;
+        uint32_t height = 0;
+        if (!cmd->getHex(0, 6, &latitude) || !cmd->getHex(6, 6, &longitude) ||
+            abs((int32_t)(latitude << 8) >> 8) > 0x400000)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        cmd->getHex(12, 4, &height);
+        _goto->setSite((int32_t)(latitude << 8), (int32_t)(longitude << 8), (int16_t)height);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SET_TIME:
+    {
+        // Payload: UTC as days since 1970-01-01 (4 chars), second of the day (6 chars), ms (4 chars)
+        uint32_t days = 0;
+        uint32_t seconds = 0;
+        uint32_t ms = 0;
+        if (!cmd->getHex(0, 4, &days) || !cmd->getHex(4, 6, &seconds) || !cmd->getHex(10, 4, &ms) ||
+            seconds > 86400 || ms > 999)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        _goto->setTime(((int64_t)days * 86400 + seconds) * 1000 + ms);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GOTO_RADEC:
+    {
+        // Payload: RA, Dec (6 chars each, 1/2^24 turns, Dec two's complement), pier side (2 chars, optional)
+        uint32_t ra = 0;
+        uint32_t dec = 0;
+        uint32_t side = 0;
+        if (!cmd->getHex(0, 6, &ra) || !cmd->getHex(6, 6, &dec) ||
+            abs((int32_t)(dec << 8) >> 8) > 0x400000 ||
+            (cmd->getHex(12, 2, &side) && side > (uint32_t)PierSideEnum::WEST))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!_goto->hasSite() || !_goto->hasTime())
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        if (_goto->axesBusy())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        if (!_goto->start(ra << 8, (int32_t)(dec << 8), (PierSideEnum)side))
+        {
+            reply = new ErrorReply(ErrorEnum::OUTSIDE_LIMITS_ERROR);
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData((uint32_t)_goto->getPierSide(), 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::GET_POINTING:
+    {
+        // Payload: 00 RA, 01 Dec, 03 local sidereal time (6 chars, 1/2^24 turns), 02 pier side, 04 GOTO running (2 chars)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        if (!_goto->hasTime())
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        uint32_t ra = 0;
+        int32_t dec = 0;
+        PierSideEnum side = PierSideEnum::AUTO;
+        _goto->getPointing(&ra, &dec, &side);
+        DataReply *data_reply = new DataReply();
+        switch (selector)
+        {
+        case 0:
+            data_reply->setData((ra + 0x80) >> 8, 6);
+            break;
+        case 1:
+            data_reply->setData(((uint32_t)dec + 0x80) >> 8, 6);
+            break;
+        case 2:
+            data_reply->setData((uint32_t)side, 2);
+            break;
+        case 3:
+            data_reply->setData((_goto->localSiderealTime(_goto->now()) + 0x80) >> 8, 6);
+            break;
+        default:
+            data_reply->setData(_goto->isActive() ? 1 : 0, 2);
+            break;
+        }
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::ADD_ALIGNMENT_STAR:
+    {
+        // Payload: RA, Dec of the star the telescope is centered on (6 chars each, as GOTO_RADEC)
+        uint32_t ra = 0;
+        uint32_t dec = 0;
+        if (!cmd->getHex(0, 6, &ra) || !cmd->getHex(6, 6, &dec) || abs((int32_t)(dec << 8) >> 8) > 0x400000)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!_goto->addAlignmentStar(ra << 8, (int32_t)(dec << 8)))
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData(_goto->getPointingModel()->getStarCount(), 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::CLEAR_POINTING_MODEL:
+    {
+        _goto->clearPointingModel();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_POINTING_MODEL:
+    {
+        // Payload: 00-05 a term (IH, ID, CH, NP, MA, ME), 07 RMS of the fit, in 0.1 arcsec (6 chars, two's complement),
+        // 06 the number of stars (2 chars)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        PointingModel *model = _goto->getPointingModel();
+        DataReply *data_reply = new DataReply();
+        if (selector == 6)
+        {
+            data_reply->setData(model->getStarCount(), 2);
+        }
+        else
+        {
+            float arcsec = (selector < PointingModel::NUM_TERMS) ? model->getTerm((PointingModel::Term)selector) : model->getRms();
+            data_reply->setData((uint32_t)(int32_t)lrintf(arcsec * 10.0f) & 0xFFFFFF, 6);
+        }
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_TLE_LINE:
+    {
+        // Payload: line 1 or line 2 of a TLE as-is (69 chars), the axis is ignored
+        if (!_goto->setTleLine(cmd->getPayload(), cmd->getPayloadLength()))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GOTO_SATELLITE:
+    {
+        // Payload: pier side (2 chars, optional), replies with the pier side as GOTO_RADEC
+        uint32_t side = 0;
+        if (cmd->getHex(0, 2, &side) && side > (uint32_t)PierSideEnum::WEST)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!_goto->hasSite() || !_goto->hasTime() || !_goto->hasSatellite())
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        if (_goto->axesBusy())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        if (!_goto->startSatellite((PierSideEnum)side))
+        {
+            reply = new ErrorReply(ErrorEnum::BELOW_HORIZON_ERROR);
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData((uint32_t)_goto->getPierSide(), 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::GET_SATELLITE:
+    {
+        // Payload: 00 elevation in 1/100 degree (6 chars, two's complement), 01 range in km (6 chars),
+        // 02 propagation time of the last update in us (6 chars), 03 being followed (2 chars)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        float elevation = 0;
+        float range = 0;
+        if (selector < 2 && !_goto->getSatellitePosition(&elevation, &range))
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        switch (selector)
+        {
+        case 0:
+            data_reply->setData((uint32_t)(int32_t)lrintf(elevation * 100.0f) & 0xFFFFFF, 6);
+            break;
+        case 1:
+            data_reply->setData(min((uint32_t)lrintf(range), (uint32_t)0xFFFFFF), 6);
+            break;
+        case 2:
+            data_reply->setData(min(_goto->getUpdateUs(), (uint32_t)0xFFFFFF), 6);
+            break;
+        default:
+            data_reply->setData(_goto->isFollowing() ? 1 : 0, 2);
+            break;
+        }
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::START_EPHEMERIS:
+    {
+        // Payload: kind (2 chars), time of the first point as SET_TIME (14 chars), spacing in s (4 chars)
+        uint32_t kind = 0;
+        uint32_t days = 0;
+        uint32_t seconds = 0;
+        uint32_t ms = 0;
+        uint32_t spacing = 0;
+        if (!cmd->getHex(0, 2, &kind) || kind > (uint32_t)EphemerisKindEnum::AXES || !cmd->getHex(2, 4, &days) ||
+            !cmd->getHex(6, 6, &seconds) || !cmd->getHex(12, 4, &ms) || !cmd->getHex(16, 4, &spacing) ||
+            seconds > 86400 || ms > 999 || spacing == 0)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        int64_t firstMs = ((int64_t)days * 86400 + seconds) * 1000 + ms - CelestialTransform::J2000_UNIX_MS;
+        _goto->getEphemeris()->start((EphemerisKindEnum)kind, firstMs, spacing * 1000);
+        _logger->info(LogMsg::EPHEMERIS_STARTED, int(kind), spacing * 1000);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::APPEND_EPHEMERIS:
+    {
+        // Payload: up to 10 points of 12 chars, RA / Dec as GOTO_RADEC or the two axis positions as :j,
+        // replies with how many were taken (2 chars), the rest has to wait for the table to move on
+        EphemerisTable *table = _goto->getEphemeris();
+        uint32_t length = cmd->getPayloadLength();
+        bool radec = table->getKind() == EphemerisKindEnum::RADEC;
+        bool valid = length > 0 && length % 12 == 0;
+        for (uint32_t i = 0; valid && i < length; i += 12)
+        {
+            uint32_t a = 0;
+            uint32_t b = 0;
+            valid = cmd->getHex(i, 6, &a) && cmd->getHex(i + 6, 6, &b) &&
+                    (!radec || abs((int32_t)(b << 8) >> 8) <= 0x400000);
+        }
+        if (!valid)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!table->isStarted())
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        uint32_t taken = 0;
+        for (uint32_t i = 0; i < length; i += 12)
+        {
+            uint32_t a = 0;
+            uint32_t b = 0;
+            cmd->getHex(i, 6, &a);
+            cmd->getHex(i + 6, 6, &b);
+            bool ok = radec ? _goto->appendEphemeris((int32_t)(a << 8), (int32_t)(b << 8))
+                            : _goto->appendEphemeris(CelestialTransform::fromPosition(a), CelestialTransform::fromPosition(b));
+            if (!ok)
+                break;
+            taken++;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData(taken, 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::GOTO_EPHEMERIS:
+    {
+        // Payload: pier side (2 chars, optional, RA / Dec tables), replies with the pier side as GOTO_RADEC
+        uint32_t side = 0;
+        if (cmd->getHex(0, 2, &side) && side > (uint32_t)PierSideEnum::WEST)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (_goto->axesBusy())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        if (!_goto->startEphemeris((PierSideEnum)side))
+        {
+            reply = new ErrorReply(ErrorEnum::NOT_INITIALIZED_ERROR);
+            break;
+        }
+        DataReply *data_reply = new DataReply();
+        data_reply->setData((uint32_t)_goto->getPierSide(), 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::GET_EPHEMERIS:
+    {
+        // Payload: 00 points in the table, 01 room for more, 03 being followed (2 chars),
+        // 02 s from now to the last point (6 chars, 0 if past or no time)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        EphemerisTable *table = _goto->getEphemeris();
+        DataReply *data_reply = new DataReply();
+        switch (selector)
+        {
+        case 0:
+            data_reply->setData(table->getCount(), 2);
+            break;
+        case 1:
+            data_reply->setData(table->getFree(), 2);
+            break;
+        case 2:
+        {
+            int64_t left = (_goto->hasTime() && table->getCount() > 0) ? (table->getLastMs() - _goto->now()) / 1000 : 0;
+            data_reply->setData((uint32_t)min(max(left, (int64_t)0), (int64_t)0xFFFFFF), 6);
+            break;
+        }
+        default:
+            data_reply->setData(_goto->isFollowingEphemeris() ? 1 : 0, 2);
+            break;
+        }
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_GOTO_PLANNER:
+    {
+        // Payload: 00 off / 01 on (2 chars), meridian overlap in degrees (2 chars, optional), saved to flash
+        uint32_t enabled = 0;
+        uint32_t overlap = 0;
+        GotoPlanner *planner = _goto->getPlanner();
+        if (!cmd->getHex(0, 2, &enabled) || enabled > 1 || (cmd->getHex(2, 2, &overlap) && overlap > 90))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        planner->setEnabled(enabled == 1);
+        if (cmd->getPayloadLength() >= 4)
+            planner->setMeridianOverlap(overlap);
+        if (!planner->save())
+            _logger->error(LogMsg::PLANNER_SAVE_ERROR);
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SET_AXIS_LIMITS:
+    {
+        // Payload: lower and upper position (6 chars each, as :j), none to clear them, saved to flash
+        uint32_t lower = 0;
+        uint32_t upper = 0;
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        if (cmd->getPayloadLength() == 0)
+        {
+            motor->clearLimits();
+        }
+        else if (cmd->getHex(0, 6, &lower) && cmd->getHex(6, 6, &upper) && lower < upper)
+        {
+            motor->setLimits(lower, upper);
+        }
+        else
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        motor->saveLimits();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_AXIS_LIMITS:
+    {
+        // Payload: 00 lower, 01 upper position (6 chars, the whole turn without limits), 02 limits set,
+        // 03 why the axis last stopped on its own (2 chars, LimitStopEnum)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        uint32_t lower = 0;
+        uint32_t upper = 0;
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        bool limited = motor->getLimits(&lower, &upper);
+        DataReply *data_reply = new DataReply();
+        if (selector == 2)
+            data_reply->setData(limited ? 1 : 0, 2);
+        else if (selector == 3)
+            data_reply->setData((uint32_t)motor->getLimitStop(), 2);
+        else
+            data_reply->setData(((selector == 1) ? upper : lower) & 0xFFFFFF, 6);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_HORIZON_POINT:
+    {
+        // Payload: point (2 chars, 00-0F every 22.5 degrees of azimuth from north, 10 the pier altitude),
+        // altitude in degrees (2 chars, two's complement), saved to flash
+        uint32_t point = 0;
+        uint32_t altitude = 0;
+        HorizonMask *horizon = _goto->getHorizonMask();
+        if (!cmd->getHex(0, 2, &point) || !cmd->getHex(2, 2, &altitude) || point > HorizonMask::NUM_POINTS ||
+            abs((int8_t)altitude) > 90)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        if (point == HorizonMask::NUM_POINTS)
+            horizon->setPierAltitude((int8_t)altitude);
+        else
+            horizon->setPoint(point, (int8_t)altitude);
+        horizon->save();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::SET_HORIZON_ENABLED:
+    {
+        // Payload: 00 off / 01 on (2 chars), saved to flash
+        uint32_t enabled = 0;
+        HorizonMask *horizon = _goto->getHorizonMask();
+        if (!cmd->getHex(0, 2, &enabled) || enabled > 1)
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        horizon->setEnabled(enabled == 1);
+        horizon->save();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_HORIZON:
+    {
+        // Payload: 00-0F altitude of the point, 10 pier altitude, 13 degrees above the mask now (2 chars, two's
+        // complement); 11 on, 12 compiled and checked (needs the site)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        HorizonMask *horizon = _goto->getHorizonMask();
+        int32_t value = 0;
+        if (selector < HorizonMask::NUM_POINTS)
+            value = horizon->getPoint(selector);
+        else if (selector == HorizonMask::NUM_POINTS)
+            value = horizon->getPierAltitude();
+        else if (selector == HorizonMask::NUM_POINTS + 1)
+            value = horizon->isEnabled() ? 1 : 0;
+        else if (selector == HorizonMask::NUM_POINTS + 2)
+            value = horizon->isActive() ? 1 : 0;
+        else
+            value = (int32_t)lroundf(fmaxf(-127.0f, fminf(127.0f, horizon->exactMargin(_raMotor->getPosition(),
+                                                                                           _decMotor->getPosition()))));
+        DataReply *data_reply = new DataReply();
+        data_reply->setData((uint32_t)value & 0xFF, 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::SET_GEAR_SHIFT:
+    {
+        // Payload: 00 off / 01 on (2 chars), top speed of fast moves in position units / sec (6 chars,
+        // optional: the default), saved to flash
+        uint32_t enabled = 0;
+        uint32_t speed = DEFAULT_GEAR_SHIFT_SPEED;
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        if (!cmd->getHex(0, 2, &enabled) || enabled > 1 ||
+            (cmd->getPayloadLength() > 2 && (!cmd->getHex(2, 6, &speed) || speed == 0)))
+        {
+            reply = new ErrorReply(ErrorEnum::COMMAND_LENGTH_ERROR);
+            break;
+        }
+        if (!FlashSettings::canSave())
+        {
+            reply = new ErrorReply(ErrorEnum::MOTOR_NOT_STOPPED_ERROR);
+            break;
+        }
+        motor->setGearShift(enabled == 1, speed);
+        motor->saveGearShift();
+        reply = new EmptyReply();
+        break;
+    }
+    case ExtendedCommandEnum::GET_GEAR_SHIFT:
+    {
+        // Payload: 00 on (2 chars), 01 top speed of fast moves (6 chars), 02 microsteps now,
+        // 03 gear shifts of the last fast move (2 chars)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        Motor *motor = getMotorForAxis(cmd->getAxis());
+        DataReply *data_reply = new DataReply();
+        if (selector == 1)
+            data_reply->setData((uint32_t)motor->fastTopSpeed() & 0xFFFFFF, 6);
+        else if (selector == 2)
+            data_reply->setData(motor->getMicrosteps(), 2);
+        else if (selector == 3)
+            data_reply->setData(min(motor->getGearShifts(), (uint32_t)0xFF), 2);
+        else
+            data_reply->setData(motor->getGearShift() ? 1 : 0, 2);
+        reply = data_reply;
+        break;
+    }
+    case ExtendedCommandEnum::GET_GOTO_PLAN:
+    {
+        // Payload: 00 ms until both axes of the last GOTO are there (6 chars); for this axis 01 direction
+        // (2 chars, 00 none / 01 CW / 02 CCW), 02 distance in position units (6 chars), 03 the host's
+        // direction turned around (2 chars); 04 planner on, 05 meridian overlap in degrees (2 chars)
+        uint32_t selector = 0;
+        cmd->getHex(0, 2, &selector);
+        GotoPlanner *planner = _goto->getPlanner();
+        const GotoPlanner::AxisPlan &plan = planner->getPlan(cmd->getAxis());
+        DataReply *data_reply = new DataReply();
+        switch (selector)
+        {
+        case 0:
+            data_reply->setData(min(planner->getEtaMs(), (uint32_t)0xFFFFFF), 6);
+            break;
+        case 1:
+            data_reply->setData((plan.dir == SlewDirectionEnum::CW) ? 1 : (plan.dir == SlewDirectionEnum::CCW) ? 2 : 0, 2);
+            break;
+        case 2:
+            data_reply->setData(plan.distance & 0xFFFFFF, 6);
+            break;
+        case 3:
+            data_reply->setData(plan.changed ? 1 : 0, 2);
+            break;
+        case 4:
+            data_reply->setData(planner->isEnabled() ? 1 : 0, 2);
+            break;
+        default:
+            data_reply->setData(planner->getMeridianOverlap(), 2);
+            break;
+        }
+        reply = data_reply;
+        break;
+    }
     default:
+        reply = new ErrorReply(ErrorEnum::UNKNOWN_CMD_ERROR);
         break;
     }
     return reply;
@@ -26,11 +26,15 @@
 
 #include <Arduino.h>
 
+#include "ClockCalibration.hpp"
 #include "Command.hpp"
 #include "Constants.hpp"
+#include "GotoController.hpp"
+#include "IsrProfiler.hpp"
 #include "Motor.hpp"
 #include "PolarScopeLED.hpp"
 #include "Reply.hpp"
+#include "TraceRecorder.hpp"
 #include "Logger.hpp"
 
 namespace SynScanControl
@@ -38,8 +42,12 @@ namespace SynScanControl
     class CommandHandler
     {
     public:
-        CommandHandler(HardwareSerial *serial, Motor *raMotor, Motor *decMotor, PolarScopeLED *polarScopeLED, Logger *logger);
+        CommandHandler(HardwareSerial *serial, Motor *raMotor, Motor *decMotor, PolarScopeLED *polarScopeLED,
+                       IsrProfiler *isrProfiler, TraceRecorder *trace, ClockCalibration *clock, GotoController *gotoController,
+                       Logger *logger);
         void processSerial();
+        // Process a parsed command and build its reply (caller owns both)
+        Reply *processCommand(Command *command);
         void clearBuffer();
         Motor *getMotorForAxis(AxisEnum axis);
 
@@ -48,6 +56,10 @@ namespace SynScanControl
         Motor *_raMotor;
         Motor *_decMotor;
         PolarScopeLED *_polarScopeLED;
+        IsrProfiler *_isrProfiler;
+        TraceRecorder *_trace;
+        ClockCalibration *_clock;
+        GotoController *_goto;
         char _buffer[COMMAND_BUFFER_SIZE + 1];
         uint16_t _buffer_idx = 0;
         const char _startChar = ':';
@@ -58,7 +70,7 @@ namespace SynScanControl
         Logger *_logger;
 
     private:
-        Reply *_processCommand(Command *command);
+        Reply *_processExtendedCommand(ExtendedCommand *command);
     };
 
 } // namespace SynScanControl
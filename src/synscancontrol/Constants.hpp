@@ -75,10 +75,24 @@ namespace SynScanControl
     constexpr uint32_t MICROSTEPS_PER_REV = SLOW_MICROSTEPS * FULL_STEPS_PER_REV;
     constexpr float SIDEREAL_STEP_PER_SECOND = (float)MICROSTEPS_PER_REV / 360.0 * ARCSEC_TO_DEGREE * SIDEREAL_SPEED_ARCSEC;
 
+    /* Number of teeth of the worm gear driving each axis (i.e. worm
+     * revolutions per axis revolution), this is the period of the
+     * periodic error corrected by PEC.
+     */
+    constexpr uint32_t WORM_TEETH = 135;
+
+    /* PEC training records this many worm cycles of tracking
+     * (~10.6 minutes each on the HEQ5) before fitting the table.
+     */
+    constexpr uint32_t PEC_TRAINING_CYCLES = 4;
+
     /* Maximum number of pulses per second we feel comfortable driving the motor.
      * Increasing this would slew the mount faster at the cost of stability.
      */
     constexpr uint32_t MAX_PULSE_PER_SECOND = 20000;
+
+    /* Period of the tick timer driving the motors (one pulse per tick at most) */
+    constexpr uint32_t TICK_PERIOD_US = 1000000 / MAX_PULSE_PER_SECOND;
     constexpr float SIDEREAL_PULSE_PER_STEP = MAX_PULSE_PER_SECOND / SIDEREAL_STEP_PER_SECOND;
 
     /* How fast to accelerate the motors, in pulses / sec / sec.
@@ -87,6 +101,28 @@ namespace SynScanControl
      */
     constexpr float MOTOR_ACCEL = 5000.0;
 
+    /* With gear shifting on, fast moves go up to this many position
+     * units / sec (until the host sets another): twice the top speed
+     * of FAST_MICROSTEPS, still well below a pulse per tick at full steps.
+     */
+    constexpr uint32_t DEFAULT_GEAR_SHIFT_SPEED = HIGH_SPEED_RATIO * MAX_PULSE_PER_SECOND;
+
+    /* With the GOTO planner on, RA / Dec GOTOs may take either pier
+     * side as long as the telescope ends up no further past the
+     * meridian than this, in degrees (until the host sets another).
+     */
+    constexpr uint32_t DEFAULT_MERIDIAN_OVERLAP = 15;
+
+    /* The horizon mask is checked every this many ticks (0.8 ms), one
+     * step per tick at most in between, which the look-ahead covers.
+     */
+    constexpr uint32_t HORIZON_CHECK_TICKS = 16;
+
+    /* Satellites (and ephemeris tables) are followed with a new velocity
+     * for each axis this often (25 Hz), from the position one update ahead.
+     */
+    constexpr uint32_t SATELLITE_UPDATE_MS = 40;
+
     /* Polar scope PWM frequency in Hz */
     constexpr uint32_t POLARSCOPE_PWM_FREQ = 5000;
 
@@ -113,6 +149,19 @@ namespace SynScanControl
     constexpr uint8_t RA_NEG_PIN = 34;
     constexpr uint8_t DEC_NEG_PIN = 35;
 
+    /* Autoguider input edges closer than this to the previous change
+     * are treated as contact bounce (the ESP32 has no glitch filter on
+     * its GPIOs). The first edge is acted upon right away, so this only
+     * limits the shortest guide pulse.
+     */
+    constexpr uint32_t GUIDE_DEBOUNCE_US = 1000;
+
+    /* Backlash take-up steps are sent this many ticks apart (5 kHz at
+     * 32x microstepping): quick, but slow enough for the unloaded motor
+     * to follow from a standstill.
+     */
+    constexpr uint32_t BACKLASH_TAKEUP_TICKS = 4;
+
     /* LED controller pins */
     constexpr uint8_t PWR_LED = 4;
     constexpr uint8_t SCOPE_LED = 15;
@@ -138,6 +187,13 @@ namespace SynScanControl
 #ifdef UDP_LOGGING
     /* Port used for UDP logging (if applicable) */
     constexpr uint16_t UDP_LOGGER_PORT = 6309;
+
+    /* Log messages are batched into datagrams of at most this many bytes
+     * (kept under a typical 1500 byte MTU), and sent at the latest after
+     * this many milliseconds.
+     */
+    constexpr uint32_t UDP_LOGGER_MAX_DATAGRAM = 1400;
+    constexpr uint32_t UDP_LOGGER_FLUSH_MS = 100;
 #endif
 
 }
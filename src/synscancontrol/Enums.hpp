@@ -71,6 +71,7 @@ namespace SynScanControl
         SET_SWITCH_CMD = 'O',
         SET_AUTOGUIDE_SPEED_CMD = 'P',
         SET_POLAR_LED_BRIGHTNESS_CMD = 'V',
+        SET_FEATURE_CMD = 'W',
         GET_COUNTS_PER_REV_CMD = 'a',
         GET_TIMER_FREQ_CMD = 'b',
         GET_GOTO_TARGET_CMD = 'h',
@@ -83,9 +84,122 @@ namespace SynScanControl
         GET_VERSION_CMD = 'e',
         GET_PEC_PERIOD_CMD = 's',
         GET_EXTENDED_STATUS_CMD = 'q',
+        EXTENDED_CMD = 'Z',
         UNKNOWN_CMD = '\0'
     };
 
+    /* Sub-commands of our own extended command, not part of the SynScan protocol:
+     * ":Z[axis][sub-command, 2 hex chars][payload]"
+     */
+    enum class ExtendedCommandEnum
+    {
+        GET_ISR_STATS = 0x01,
+        DUMP_ISR_STATS = 0x02,
+        DUMP_TRACE = 0x03,
+        SET_TRACE_ENABLED = 0x04,
+        SET_PEC_ENTRY = 0x05,
+        GET_PEC_ENTRY = 0x06,
+        CLEAR_PEC_TABLE = 0x07,
+        SAVE_PEC_TABLE = 0x08,
+        PULSE_GUIDE = 0x09,
+        GET_PULSE_GUIDE = 0x0A,
+        SET_BACKLASH = 0x0B,
+        GET_BACKLASH = 0x0C,
+        SET_TRACKING_RATE = 0x0D,
+        GET_TRACKING_RATE = 0x0E,
+        CLOCK_SYNC = 0x0F,
+        GET_CLOCK_CALIBRATION = 0x10,
+        SET_CLOCK_CORRECTION = 0x11,
+        SET_SITE = 0x12,
+        SET_TIME = 0x13,
+        GOTO_RADEC = 0x14,
+        GET_POINTING = 0x15,
+        ADD_ALIGNMENT_STAR = 0x16,
+        CLEAR_POINTING_MODEL = 0x17,
+        GET_POINTING_MODEL = 0x18,
+        SET_TLE_LINE = 0x19,
+        GOTO_SATELLITE = 0x1A,
+        GET_SATELLITE = 0x1B,
+        START_EPHEMERIS = 0x1C,
+        APPEND_EPHEMERIS = 0x1D,
+        GOTO_EPHEMERIS = 0x1E,
+        GET_EPHEMERIS = 0x1F,
+        SET_GOTO_PLANNER = 0x20,
+        SET_AXIS_LIMITS = 0x21,
+        GET_AXIS_LIMITS = 0x22,
+        GET_GOTO_PLAN = 0x23,
+        SET_HORIZON_POINT = 0x24,
+        SET_HORIZON_ENABLED = 0x25,
+        GET_HORIZON = 0x26,
+        SET_GEAR_SHIFT = 0x27,
+        GET_GEAR_SHIFT = 0x28,
+        UNKNOWN_EXT_CMD = 0x00
+    };
+
+    /* Tracking rates built into the firmware (SET_TRACKING_RATE),
+     * HOST tracks at the step period sent with :I
+     */
+    enum class TrackingRateEnum
+    {
+        HOST = 0x00,
+        SIDEREAL = 0x01,
+        LUNAR = 0x02,
+        SOLAR = 0x03,
+        KING = 0x04
+    };
+
+    /* Side of the pier the telescope is on (GOTO_RADEC): EAST looks west,
+     * at targets past the meridian, WEST looks east.
+     */
+    enum class PierSideEnum
+    {
+        AUTO = 0x00,
+        EAST = 0x01,
+        WEST = 0x02
+    };
+
+    /* What the points of an ephemeris table (START_EPHEMERIS) are:
+     * topocentric apparent RA / Dec, or the axis positions themselves
+     */
+    enum class EphemerisKindEnum
+    {
+        RADEC = 0x00,
+        AXES = 0x01
+    };
+
+    /* Why an axis last stopped on its own (GET_AXIS_LIMITS): at its soft
+     * limits, or the pointing going (further) below the horizon mask
+     */
+    enum class LimitStopEnum
+    {
+        NONE = 0x00,
+        SOFT_LIMIT = 0x01,
+        HORIZON = 0x02
+    };
+
+    /* Features of the SET_FEATURE_CMD (":W[axis][feature, 6 hex chars]") */
+    enum class FeatureEnum
+    {
+        START_PEC_TRAINING = 0x00,
+        STOP_PEC_TRAINING = 0x01,
+        PEC_TRACKING_ON = 0x02,
+        PEC_TRACKING_OFF = 0x03,
+        UNKNOWN_FEATURE = 0xFF
+    };
+
+    /* Selectors for GET_ISR_STATS (2 hex chars of payload) */
+    enum class IsrStatEnum
+    {
+        TICKS = 0x00,
+        OVERRUNS = 0x01,
+        MAX_EXEC_CYCLES = 0x02,
+        MAX_JITTER_CYCLES = 0x03,
+        MEAN_EXEC_CYCLES = 0x04,
+        PERIOD_CYCLES = 0x05,
+        EXEC_HISTOGRAM = 0x20,  // + bucket index
+        JITTER_HISTOGRAM = 0x40 // + bucket index
+    };
+
     enum class ErrorEnum
     {
         UNKNOWN_CMD_ERROR = 0,
@@ -95,7 +209,9 @@ namespace SynScanControl
         NOT_INITIALIZED_ERROR = 4,
         DRIVER_SLEEPING_ERROR = 5,
         PEC_TRAINING_IS_RUNNING_ERROR = 7,
-        NO_VALID_PEC_DATA_ERROR = 8
+        NO_VALID_PEC_DATA_ERROR = 8,
+        BELOW_HORIZON_ERROR = 9,  // Ours: the target isn't up (or doesn't rise soon enough)
+        OUTSIDE_LIMITS_ERROR = 10 // Ours: the target is outside the soft limits / meridian overlap
     };
 
 } // namespace SynScanControl
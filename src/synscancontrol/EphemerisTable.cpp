@@ -0,0 +1,107 @@
+/*
+ * Project Name: synscancontrol
+ * File: EphemerisTable.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Time-tagged position table for non-sidereal tracking, with cubic Hermite interpolation
+ */
+#include <math.h>
+
+#include "EphemerisTable.hpp"
+
+using namespace SynScanControl;
+
+void EphemerisTable::start(EphemerisKindEnum kind, int64_t firstMs, uint32_t spacingMs)
+{
+    _kind = kind;
+    _startMs = firstMs;
+    _spacingMs = spacingMs;
+    _first = 0;
+    _count = 0;
+}
+
+bool EphemerisTable::append(int32_t a, int32_t b)
+{
+    if (!isStarted() || _count >= MAX_POINTS)
+        return false;
+    Point &point = _points[(_first + _count) % MAX_POINTS];
+    point.a = a;
+    point.b = b;
+    _count++;
+    return true;
+}
+
+void EphemerisTable::release(int64_t ms)
+{
+    if (!isStarted() || ms < _startMs)
+        return;
+    uint32_t segment = (uint32_t)((ms - _startMs) / _spacingMs);
+    while (_count > 0 && _first + 1 < segment)
+    {
+        _first++;
+        _count--;
+    }
+}
+
+bool EphemerisTable::covers(int64_t from, int64_t to) const
+{
+    return _count >= 2 && getFirstMs() <= from && getLastMs() >= to;
+}
+
+bool EphemerisTable::at(int64_t ms, int32_t *a, int32_t *b) const
+{
+    if (!covers(ms, ms))
+        return false;
+
+    // The segment from point n to n + 1, the last point being the end of the last one
+    uint32_t n = (uint32_t)((ms - _startMs) / _spacingMs);
+    if (n == _first + _count - 1)
+        n--;
+    float s = (float)(ms - _timeOf(n)) / _spacingMs;
+    const Point &p0 = _point(n);
+    const Point &p1 = _point(n + 1);
+
+    // Missing neighbours: mirrored, so the tangent is the segment's own slope
+    Point before = {(int32_t)(2 * (uint32_t)p0.a - (uint32_t)p1.a), (int32_t)(2 * (uint32_t)p0.b - (uint32_t)p1.b)};
+    Point after = {(int32_t)(2 * (uint32_t)p1.a - (uint32_t)p0.a), (int32_t)(2 * (uint32_t)p1.b - (uint32_t)p0.b)};
+    if (n > _first)
+        before = _point(n - 1);
+    if (n + 2 < _first + _count)
+        after = _point(n + 2);
+
+    *a = _hermite(before.a, p0.a, p1.a, after.a, s);
+    *b = _hermite(before.b, p0.b, p1.b, after.b, s);
+    return true;
+}
+
+// Relative to p0, so the differences between neighbours wrap around
+int32_t EphemerisTable::_hermite(int32_t before, int32_t p0, int32_t p1, int32_t after, float s)
+{
+    float d0 = (float)(int32_t)((uint32_t)p0 - (uint32_t)before);
+    float d1 = (float)(int32_t)((uint32_t)p1 - (uint32_t)p0);
+    float d2 = (float)(int32_t)((uint32_t)after - (uint32_t)p1);
+    float m0 = 0.5f * (d0 + d1);
+    float m1 = 0.5f * (d1 + d2);
+
+    // Hermite basis, the p0 term drops out
+    float s2 = s * s;
+    float s3 = s2 * s;
+    float offset = (s3 - 2.0f * s2 + s) * m0 + (3.0f * s2 - 2.0f * s3) * d1 + (s3 - s2) * m1;
+    return (int32_t)((uint32_t)p0 + (uint32_t)(int32_t)lrintf(offset));
+}
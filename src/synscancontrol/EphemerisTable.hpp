@@ -0,0 +1,95 @@
+/*
+ * Project Name: synscancontrol
+ * File: EphemerisTable.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Time-tagged position table for non-sidereal tracking, with cubic Hermite interpolation
+ */
+#ifndef EPHEMERIS_TABLE_H
+#define EPHEMERIS_TABLE_H
+
+#include <stdint.h>
+
+#include "Enums.hpp"
+
+namespace SynScanControl
+{
+    /* Positions of a comet, an asteroid, the Moon... at evenly spaced
+     * times, uploaded by the host a chunk at a time: the first point's
+     * time and the spacing come with start(), each point after that is
+     * one spacing later. Pairs of angles in Q32 turns (RA / Dec, or the
+     * two axes).
+     *
+     * The points are kept in a ring, so an arc longer than MAX_POINTS
+     * streams through it: release() drops the points a time no longer
+     * needs, making room for more while tracking.
+     *
+     * Between two points the position is a cubic Hermite segment, with
+     * the tangents from the neighbouring points (Catmull-Rom), one sided
+     * at the ends of the table. It is worked out in single precision
+     * relative to the point before, as differences wrap around.
+     */
+    class EphemerisTable
+    {
+    public:
+        static const uint32_t MAX_POINTS = 64;
+
+        // Empties the table: the first point to append is at firstMs (ms since J2000)
+        void start(EphemerisKindEnum kind, int64_t firstMs, uint32_t spacingMs);
+        void clear() { _spacingMs = 0; _count = 0; }
+        // False if full, see release()
+        bool append(int32_t a, int32_t b);
+        // Drops the points before the segment for this time, but the one its tangent needs
+        void release(int64_t ms);
+
+        bool isStarted() const { return _spacingMs != 0; }
+        EphemerisKindEnum getKind() const { return _kind; }
+        uint32_t getCount() const { return _count; }
+        uint32_t getFree() const { return MAX_POINTS - _count; }
+        // The time of the first point kept, and of the last one
+        int64_t getFirstMs() const { return _timeOf(_first); }
+        int64_t getLastMs() const { return _timeOf(_first + _count - 1); }
+        // There are points from before `from` to after `to`
+        bool covers(int64_t from, int64_t to) const;
+
+        // The position at this time, false outside of the table
+        bool at(int64_t ms, int32_t *a, int32_t *b) const;
+
+    private:
+        struct Point
+        {
+            int32_t a;
+            int32_t b;
+        };
+
+        int64_t _timeOf(uint32_t n) const { return _startMs + (int64_t)n * _spacingMs; }
+        const Point &_point(uint32_t n) const { return _points[n % MAX_POINTS]; }
+        static int32_t _hermite(int32_t before, int32_t p0, int32_t p1, int32_t after, float s);
+
+        EphemerisKindEnum _kind = EphemerisKindEnum::RADEC;
+        int64_t _startMs = 0;
+        uint32_t _spacingMs = 0;
+        // Points by number from start(): the oldest kept, and how many
+        uint32_t _first = 0;
+        uint32_t _count = 0;
+        Point _points[MAX_POINTS];
+    };
+} // namespace SynScanControl
+
+#endif /* EPHEMERIS_TABLE_H */
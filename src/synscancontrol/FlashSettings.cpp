@@ -0,0 +1,81 @@
+/*
+ * Project Name: synscancontrol
+ * File: FlashSettings.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Settings kept in flash, written with the tick ISR paused
+ */
+#include <Preferences.h>
+
+#include "FlashSettings.hpp"
+#include "Motor.hpp"
+
+using namespace SynScanControl;
+
+hw_timer_t *FlashSettings::_tickTimer = nullptr;
+Motor *FlashSettings::_raMotor = nullptr;
+Motor *FlashSettings::_decMotor = nullptr;
+
+void FlashSettings::begin(hw_timer_t *tickTimer, Motor *raMotor, Motor *decMotor)
+{
+    _tickTimer = tickTimer;
+    _raMotor = raMotor;
+    _decMotor = decMotor;
+}
+
+bool FlashSettings::canSave()
+{
+    return (_raMotor == nullptr || !_raMotor->isMoving()) && (_decMotor == nullptr || !_decMotor->isMoving());
+}
+
+bool FlashSettings::save(const char *space, const char *key, const void *data, size_t length)
+{
+    if (_tickTimer != nullptr)
+        timerAlarmDisable(_tickTimer);
+    Preferences prefs;
+    bool ok = prefs.begin(space, false) && prefs.putBytes(key, data, length) == length;
+    prefs.end();
+    if (_tickTimer != nullptr)
+        timerAlarmEnable(_tickTimer);
+    return ok;
+}
+
+bool FlashSettings::erase(const char *space, const char *key)
+{
+    if (_tickTimer != nullptr)
+        timerAlarmDisable(_tickTimer);
+    Preferences prefs;
+    bool ok = prefs.begin(space, false);
+    if (ok)
+        prefs.remove(key); // fails if there was nothing saved, which is fine
+    prefs.end();
+    if (_tickTimer != nullptr)
+        timerAlarmEnable(_tickTimer);
+    return ok;
+}
+
+bool FlashSettings::load(const char *space, const char *key, void *data, size_t length)
+{
+    Preferences prefs;
+    if (!prefs.begin(space, true))
+        return false;
+    bool ok = prefs.getBytesLength(key) == length && prefs.getBytes(key, data, length) == length;
+    prefs.end();
+    return ok;
+}
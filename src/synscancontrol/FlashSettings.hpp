@@ -0,0 +1,62 @@
+/*
+ * Project Name: synscancontrol
+ * File: FlashSettings.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Settings kept in flash, written with the tick ISR paused
+ */
+#ifndef FLASH_SETTINGS_H
+#define FLASH_SETTINGS_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+namespace SynScanControl
+{
+    class Motor;
+
+    /* Fixed size blobs in flash (NVS), one per namespace / key. The
+     * cache is off while flash is written, and the tick ISR runs code
+     * from flash, so the tick timer is stopped around every write (as
+     * for OTA updates). The axes miss those ticks (a few ms), so nothing
+     * is written while one moves: host commands that would are refused,
+     * saves made along the way wait for canSave() in a longTick().
+     */
+    class FlashSettings
+    {
+    public:
+        // The timer to stop while writing and the axes it steps, none until set
+        static void begin(hw_timer_t *tickTimer, Motor *raMotor, Motor *decMotor);
+        // Both axes stopped: a write costs no ticks
+        static bool canSave();
+
+        static bool save(const char *space, const char *key, const void *data, size_t length);
+        // Nothing saved under the key afterwards, there being nothing before is fine
+        static bool erase(const char *space, const char *key);
+        // Only fills data from a blob of exactly that length
+        static bool load(const char *space, const char *key, void *data, size_t length);
+
+    private:
+        static hw_timer_t *_tickTimer;
+        static Motor *_raMotor;
+        static Motor *_decMotor;
+    };
+} // namespace SynScanControl
+
+#endif /* FLASH_SETTINGS_H */
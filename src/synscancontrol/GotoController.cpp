@@ -0,0 +1,724 @@
+/*
+ * Project Name: synscancontrol
+ * File: GotoController.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: On-device RA / Dec GOTO, followed by sidereal tracking
+ */
+#include <string.h>
+
+#include "FlashSettings.hpp"
+#include "GotoController.hpp"
+
+using namespace SynScanControl;
+
+// The long tick notices that a slew is over 50 ms after the fact on average
+static const float LONG_TICK_LATENCY_S = 0.05f;
+
+static const double RADIANS_PER_Q32 = 6.283185307179586 / 4294967296.0;
+static const double DEGREES_PER_RADIAN = 57.29577951308232;
+
+// Radians to Q32 turns, wrapping
+static int32_t toTurns(double radians)
+{
+    return (int32_t)(uint32_t)(int64_t)llround(radians / RADIANS_PER_Q32);
+}
+
+GotoController::GotoController(Motor *raMotor, Motor *decMotor, ClockCalibration *clock, HorizonMask *horizon, Logger *logger)
+{
+    _raMotor = raMotor;
+    _decMotor = decMotor;
+    _clock = clock;
+    _horizon = horizon;
+    _logger = logger;
+}
+
+void GotoController::begin()
+{
+    int32_t site[3];
+    if (FlashSettings::load(NVS_NAMESPACE, NVS_KEY, site, sizeof(site)))
+    {
+        _latitude = site[0];
+        _longitude = site[1];
+        _height = site[2];
+        _siteSet = true;
+        _updateSite();
+        _horizon->setLatitude(_latitude);
+        _logger->info(LogMsg::SITE_LOADED, CelestialTransform::arcsec(_latitude), CelestialTransform::arcsec(_longitude),
+                      _height);
+    }
+
+    if (_planner.load())
+        _logger->info(LogMsg::PLANNER_LOADED, int(_planner.isEnabled()), _planner.getMeridianOverlap());
+    if (_model.load())
+        _logger->info(LogMsg::POINTING_MODEL_LOADED, _model.getTerm(PointingModel::IH), _model.getTerm(PointingModel::ID),
+                      _model.getTerm(PointingModel::CH), _model.getTerm(PointingModel::NP),
+                      _model.getTerm(PointingModel::MA), _model.getTerm(PointingModel::ME));
+}
+
+void GotoController::setSite(int32_t latitude, int32_t longitude, int32_t height)
+{
+    _latitude = latitude;
+    _longitude = longitude;
+    _height = height;
+    _siteSet = true;
+    _updateSite();
+    _horizon->setLatitude(latitude);
+    _siteSavePending = true;
+    _logger->info(LogMsg::SITE_SET, CelestialTransform::arcsec(latitude), CelestialTransform::arcsec(longitude), height);
+}
+
+void GotoController::setTime(int64_t unixMs)
+{
+    _timeBaseUs = esp_timer_get_time();
+    _timeBaseMs = unixMs - CelestialTransform::J2000_UNIX_MS;
+    _timeSet = true;
+    _logger->debug(LogMsg::TIME_SET, (uint32_t)(_timeBaseMs / 1000));
+}
+
+// esp_timer runs off the crystal, so the time since SET_TIME gets the clock correction too
+int64_t GotoController::now() const
+{
+    int64_t elapsedUs = esp_timer_get_time() - _timeBaseUs;
+    elapsedUs -= elapsedUs * _clock->getCorrection() / 1000000000;
+    return _timeBaseMs + elapsedUs / 1000;
+}
+
+uint32_t GotoController::localSiderealTime(int64_t ms) const
+{
+    return CelestialTransform::siderealTime(ms) + (uint32_t)_longitude;
+}
+
+/* Both axes take the direct way, except that the Dec axis always goes
+ * through the pole (where it starts) when flipping sides, not under it.
+ */
+static int32_t axisOffset(uint32_t position, bool unwrapAtPole)
+{
+    int32_t offset = (int32_t)(position - 0x800000);
+    if (unwrapAtPole && offset < -(int32_t)(MICROSTEPS_PER_REV / 4))
+        offset += MICROSTEPS_PER_REV;
+    return offset;
+}
+
+static uint32_t axisDistance(Motor *motor, int32_t target, bool unwrapAtPole)
+{
+    return abs(axisOffset(CelestialTransform::toPosition(target), unwrapAtPole) -
+               axisOffset(motor->getPosition(), unwrapAtPole));
+}
+
+bool GotoController::axesBusy() const
+{
+    return (_raMotor->isMoving() && _raMotor->useAccel()) || (_decMotor->isMoving() && _decMotor->useAccel());
+}
+
+bool GotoController::start(uint32_t ra, int32_t dec, PierSideEnum side)
+{
+    if (!_siteSet || !_timeSet || axesBusy())
+        return false;
+
+    // The pier side is settled now, the refining pass stays on it
+    if (!reachable(ra, dec, &side))
+        return false;
+    _target = Target::RADEC;
+    _ra = ra;
+    _dec = dec;
+    _side = side;
+    _logger->info(LogMsg::GOTO_RADEC_START, (uint32_t)(((uint64_t)ra * 1296000) >> 32), CelestialTransform::arcsec(dec),
+                  int(_side));
+    _startSlew();
+    return true;
+}
+
+bool GotoController::startSatellite(PierSideEnum side)
+{
+    if (!_siteSet || !_timeSet || !_satellite.isValid() || axesBusy())
+        return false;
+
+    int64_t t = now();
+    int32_t culminationHa = 0;
+    float maxElevation = 0;
+    float peakRate = 0;
+    if (!_findPass(t, &culminationHa, &maxElevation, &peakRate))
+        return false;
+
+    // Slow microstepping tops out at the GOTO top speed, the fast one covers passes close to the pole
+    _target = Target::SATELLITE;
+    _side = (side == PierSideEnum::AUTO) ? CelestialTransform::autoPierSide(culminationHa) : side;
+    _followSpeed = (peakRate > MAX_PULSE_PER_SECOND / 2) ? SlewSpeedEnum::FAST : SlewSpeedEnum::SLOW;
+    _logger->info(LogMsg::SATELLITE_PASS, _satellite.getCatalogNumber(), (int32_t)((_riseMs - t) / 1000), maxElevation,
+                  peakRate, int(_side));
+    _startSlew();
+    return true;
+}
+
+bool GotoController::appendEphemeris(int32_t a, int32_t b)
+{
+    if (_timeSet)
+        _ephemeris.release(now());
+    return _ephemeris.append(a, b);
+}
+
+bool GotoController::startEphemeris(PierSideEnum side)
+{
+    bool radec = _ephemeris.getKind() == EphemerisKindEnum::RADEC;
+    if ((radec && !_siteSet) || !_timeSet || axesBusy())
+        return false;
+
+    int64_t t = now();
+    int32_t a = 0;
+    int32_t b = 0;
+    if (!_ephemeris.covers(t, t + EPHEMERIS_MIN_AHEAD_MS) || !_ephemeris.at(t, &a, &b))
+        return false;
+
+    // Axis positions don't go through the pier side (or the pointing model)
+    _target = Target::EPHEMERIS;
+    _side = PierSideEnum::AUTO;
+    if (radec)
+        _side = (side == PierSideEnum::AUTO) ? CelestialTransform::autoPierSide((int32_t)(localSiderealTime(t) - (uint32_t)a)) : side;
+    _followSpeed = SlewSpeedEnum::SLOW;
+    _logger->info(LogMsg::EPHEMERIS_START, _ephemeris.getCount(), (int32_t)((_ephemeris.getLastMs() - t) / 1000), int(_side));
+    _startSlew();
+    return true;
+}
+
+bool GotoController::reachable(uint32_t ra, int32_t dec, PierSideEnum *side) const
+{
+    int32_t ha = (int32_t)(localSiderealTime(now()) - ra);
+    PierSideEnum preferred = CelestialTransform::autoPierSide(ha);
+    if (!_planner.isEnabled())
+    {
+        if (*side == PierSideEnum::AUTO)
+            *side = preferred;
+        return true;
+    }
+
+    // Where the target is now, the slew time decides between the sides and the lead doesn't
+    PierSideEnum sides[2] = {preferred, (preferred == PierSideEnum::EAST) ? PierSideEnum::WEST : PierSideEnum::EAST};
+    PierSideEnum best = PierSideEnum::AUTO;
+    float bestSeconds = 0.0f;
+    for (PierSideEnum candidate : sides)
+    {
+        if (*side != PierSideEnum::AUTO && candidate != *side)
+            continue;
+        int32_t mountHa = 0;
+        int32_t mountDec = 0;
+        int32_t raAxis = 0;
+        int32_t decAxis = 0;
+        _model.apply(ha, dec, candidate, &mountHa, &mountDec);
+        CelestialTransform::toAxes(mountHa, mountDec, candidate, _latitude < 0, &raAxis, &decAxis);
+        if (!_planner.withinOverlap(raAxis) || !_withinLimits(_raMotor, raAxis) || !_withinLimits(_decMotor, decAxis))
+            continue;
+        float seconds = max(_slewSeconds(_raMotor, axisDistance(_raMotor, raAxis, false), true),
+                            _slewSeconds(_decMotor, axisDistance(_decMotor, decAxis, true), true));
+        if (best == PierSideEnum::AUTO || seconds < bestSeconds)
+        {
+            best = candidate;
+            bestSeconds = seconds;
+        }
+    }
+    if (best == PierSideEnum::AUTO)
+        return false;
+    *side = best;
+    return true;
+}
+
+// Axes still tracking are stopped first
+void GotoController::_startSlew()
+{
+    _raMotor->clearLimitStop();
+    _decMotor->clearLimitStop();
+    if (_raMotor->isMoving() || _decMotor->isMoving())
+    {
+        if (_raMotor->isMoving())
+            _raMotor->setMotion(false);
+        if (_decMotor->isMoving())
+            _decMotor->setMotion(false);
+        _state = State::STOPPING;
+    }
+    else
+    {
+        _slew(false);
+        _state = State::SLEWING;
+    }
+}
+
+void GotoController::cancel()
+{
+    if (_state == State::IDLE)
+        return;
+
+    // Nothing would update the velocities any more
+    if (_state == State::FOLLOWING)
+    {
+        _raMotor->setMotion(false);
+        _decMotor->setMotion(false);
+    }
+    _state = State::IDLE;
+    _logger->debug(LogMsg::GOTO_RADEC_CANCELLED);
+}
+
+void GotoController::getPointing(uint32_t *ra, int32_t *dec, PierSideEnum *side) const
+{
+    int32_t mountHa = 0;
+    int32_t mountDec = 0;
+    CelestialTransform::fromAxes(CelestialTransform::fromPosition(_raMotor->getPosition()),
+                                 CelestialTransform::fromPosition(_decMotor->getPosition()),
+                                 _latitude < 0, &mountHa, &mountDec, side);
+    int32_t ha = 0;
+    _model.unapply(mountHa, mountDec, *side, &ha, dec);
+    *ra = localSiderealTime(now()) - (uint32_t)ha;
+}
+
+bool GotoController::addAlignmentStar(uint32_t ra, int32_t dec)
+{
+    if (!_siteSet || !_timeSet)
+        return false;
+
+    int32_t mountHa = 0;
+    int32_t mountDec = 0;
+    PierSideEnum side = PierSideEnum::AUTO;
+    CelestialTransform::fromAxes(CelestialTransform::fromPosition(_raMotor->getPosition()),
+                                 CelestialTransform::fromPosition(_decMotor->getPosition()),
+                                 _latitude < 0, &mountHa, &mountDec, &side);
+    int32_t ha = (int32_t)(localSiderealTime(now()) - ra);
+    _model.addStar(ha, dec, mountHa, mountDec, side);
+    _logger->info(LogMsg::ALIGNMENT_STAR_ADDED, _model.getStarCount(), CelestialTransform::arcsec(mountHa - ha),
+                  CelestialTransform::arcsec(mountDec - dec), int(side));
+
+    if (_model.fit())
+        _logger->info(LogMsg::POINTING_MODEL_FIT, _model.getStarCount(), _model.getTerm(PointingModel::IH),
+                      _model.getTerm(PointingModel::ID), _model.getTerm(PointingModel::CH),
+                      _model.getTerm(PointingModel::NP), _model.getTerm(PointingModel::MA),
+                      _model.getTerm(PointingModel::ME), _model.getRms());
+    _modelSavePending = true;
+    return true;
+}
+
+void GotoController::clearPointingModel()
+{
+    _model.clear();
+    _modelSavePending = true;
+}
+
+// Flash writes pause the tick timer, so not while an axis moves
+void GotoController::_saveSettings()
+{
+    if ((!_siteSavePending && !_modelSavePending) || !FlashSettings::canSave())
+        return;
+    if (_siteSavePending)
+    {
+        _siteSavePending = false;
+        int32_t site[3] = {_latitude, _longitude, _height};
+        if (!FlashSettings::save(NVS_NAMESPACE, NVS_KEY, site, sizeof(site)))
+            _logger->error(LogMsg::SITE_SAVE_ERROR);
+    }
+    if (_modelSavePending)
+    {
+        _modelSavePending = false;
+        if (!_model.save())
+            _logger->error(LogMsg::POINTING_MODEL_SAVE_ERROR);
+    }
+}
+
+void GotoController::longTick()
+{
+    _saveSettings();
+
+    // An axis halted at its soft limits or the horizon mask ends the GOTO (or following), the other axis stops too
+    bool halted = _raMotor->getLimitStop() != LimitStopEnum::NONE || _decMotor->getLimitStop() != LimitStopEnum::NONE;
+    if (_state != State::IDLE && halted)
+    {
+        if (_raMotor->isMoving())
+            _raMotor->setMotion(false);
+        if (_decMotor->isMoving())
+            _decMotor->setMotion(false);
+        _state = State::IDLE;
+        _logger->warning(LogMsg::GOTO_LIMIT_STOP, _raMotor->getPosition(), _decMotor->getPosition());
+        return;
+    }
+
+    if (_state == State::IDLE || _state == State::WAITING || _state == State::FOLLOWING || _raMotor->isMoving() ||
+        _decMotor->isMoving())
+        return;
+
+    switch (_state)
+    {
+    case State::STOPPING:
+        _slew(false);
+        _state = State::SLEWING;
+        break;
+    case State::SLEWING:
+        // A satellite / ephemeris is followed from where the slew got to, its velocities close the gap
+        if (_target != Target::RADEC)
+        {
+            if (_target == Target::SATELLITE && now() < _riseMs)
+                _state = State::WAITING;
+            else
+                _startFollowing();
+            break;
+        }
+        _slew(true);
+        _state = State::REFINING;
+        break;
+    default:
+        _track();
+        _state = State::IDLE;
+        break;
+    }
+}
+
+void GotoController::update()
+{
+    if (_state == State::WAITING && now() >= _riseMs)
+        _startFollowing();
+    else if (_state == State::FOLLOWING && !_follow())
+        _stopFollowing();
+}
+
+// A satellite isn't looked for before it rises
+bool GotoController::_targetAt(int64_t ms, int32_t *raAxis, int32_t *decAxis, float *elevation) const
+{
+    int32_t ha = 0;
+    int32_t dec = _dec;
+    float satelliteElevation = 90.0f;
+    float range = 0.0f;
+    int32_t ra = 0;
+    switch (_target)
+    {
+    case Target::RADEC:
+        ha = (int32_t)(localSiderealTime(ms) - _ra);
+        break;
+    case Target::SATELLITE:
+        if (!_satelliteAt((ms > _riseMs) ? ms : _riseMs, &ha, &dec, &satelliteElevation, &range))
+            return false;
+        break;
+    case Target::EPHEMERIS:
+        if (_ephemeris.getKind() == EphemerisKindEnum::AXES)
+            return _ephemeris.at(ms, raAxis, decAxis);
+        if (!_ephemeris.at(ms, &ra, &dec))
+            return false;
+        ha = (int32_t)(localSiderealTime(ms) - (uint32_t)ra);
+        break;
+    }
+    if (elevation)
+        *elevation = satelliteElevation;
+
+    int32_t mountHa = 0;
+    int32_t mountDec = 0;
+    _model.apply(ha, dec, _side, &mountHa, &mountDec);
+    CelestialTransform::toAxes(mountHa, mountDec, _side, _latitude < 0, raAxis, decAxis);
+    return true;
+}
+
+/* The first pass slews to where the target will be once both axes
+ * are there, the refining pass (slow microstepping) makes up for the
+ * estimate and the fast microstepping's rounding.
+ */
+void GotoController::_slew(bool refine)
+{
+    int64_t t = now();
+    int32_t raAxis = 0;
+    int32_t decAxis = 0;
+    float lead = LONG_TICK_LATENCY_S;
+    for (int i = 0; i < 3; i++)
+    {
+        _targetAt(t + (int64_t)(lead * 1000.0f), &raAxis, &decAxis);
+        lead = max(_slewSeconds(_raMotor, axisDistance(_raMotor, raAxis, false), !refine),
+                   _slewSeconds(_decMotor, axisDistance(_decMotor, decAxis, true), !refine)) +
+               LONG_TICK_LATENCY_S;
+    }
+
+    uint32_t raTarget = _moveAxis(_raMotor, raAxis, false, !refine);
+    uint32_t decTarget = _moveAxis(_decMotor, decAxis, true, !refine);
+    _logger->debug(LogMsg::GOTO_RADEC_SLEW, refine ? 2 : 1, raTarget, decTarget, (uint32_t)(lead * 1000.0f));
+}
+
+float GotoController::_slewSeconds(Motor *motor, uint32_t distance, bool allowFast)
+{
+    return GotoPlanner::slewSeconds(distance, allowFast && distance >= FAST_GOTO_MIN, motor->fastTopSpeed());
+}
+
+bool GotoController::_withinLimits(Motor *motor, int32_t target)
+{
+    uint32_t lower = 0;
+    uint32_t upper = 0;
+    uint32_t position = CelestialTransform::toPosition(target);
+    return !motor->getLimits(&lower, &upper) || (position >= lower && position <= upper);
+}
+
+uint32_t GotoController::_moveAxis(Motor *motor, int32_t target, bool unwrapAtPole, bool allowFast)
+{
+    uint32_t position = CelestialTransform::toPosition(target);
+    int32_t from = axisOffset(motor->getPosition(), unwrapAtPole);
+    int32_t to = axisOffset(position, unwrapAtPole);
+    uint32_t distance = abs(to - from);
+    bool fast = allowFast && distance >= FAST_GOTO_MIN;
+    SlewDirectionEnum dir = (to > from) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW;
+    _planner.record(motor->getAxis(), dir, distance, _slewSeconds(motor, distance, allowFast));
+    if (from == to)
+        return position;
+
+    motor->setSlewType(SlewTypeEnum::GOTO);
+    motor->setSlewSpeed(fast ? SlewSpeedEnum::FAST : SlewSpeedEnum::SLOW);
+    motor->setSlewDir(dir);
+    motor->setTargetPosition(position);
+    motor->setMotion(true);
+    return position;
+}
+
+void GotoController::_track()
+{
+    _raMotor->setSlewType(SlewTypeEnum::TRACKING);
+    _raMotor->setSlewSpeed(SlewSpeedEnum::SLOW);
+    _raMotor->setSlewDir((_latitude < 0) ? SlewDirectionEnum::CCW : SlewDirectionEnum::CW);
+    _raMotor->setTrackingRate(TrackingRateEnum::SIDEREAL);
+    _raMotor->setMotion(true);
+    _logger->info(LogMsg::GOTO_RADEC_TRACKING, _raMotor->getPosition(), _decMotor->getPosition());
+}
+
+// Geodetic to earth fixed coordinates (WGS-84)
+void GotoController::_updateSite()
+{
+    const double a = 6378.137;
+    const double f = 1.0 / 298.257223563;
+    double lat = _latitude * RADIANS_PER_Q32;
+    double lon = _longitude * RADIANS_PER_Q32;
+    double e2 = f * (2.0 - f);
+    double n = a / sqrt(1.0 - e2 * sin(lat) * sin(lat));
+    double h = _height / 1000.0;
+    _siteUp[0] = cos(lat) * cos(lon);
+    _siteUp[1] = cos(lat) * sin(lon);
+    _siteUp[2] = sin(lat);
+    _siteXyz[0] = (n + h) * _siteUp[0];
+    _siteXyz[1] = (n + h) * _siteUp[1];
+    _siteXyz[2] = (n * (1.0 - e2) + h) * _siteUp[2];
+}
+
+bool GotoController::setTleLine(const char *line, uint32_t length)
+{
+    if (length < Sgp4::LINE_LENGTH || !Sgp4::checksum(line))
+        return false;
+    if (line[0] == '1')
+    {
+        memcpy(_tleLine1, line, Sgp4::LINE_LENGTH);
+        _tleLine1[Sgp4::LINE_LENGTH] = '\0';
+        return true;
+    }
+
+    // A satellite being followed carries on with the new elements
+    Sgp4 satellite;
+    if (line[0] != '2' || !satellite.parse(_tleLine1, line))
+        return false;
+    _satellite = satellite;
+    _logger->info(LogMsg::SATELLITE_LOADED, _satellite.getCatalogNumber(), (float)(_satellite.getEpoch() / 86400000.0));
+    return true;
+}
+
+bool GotoController::getSatellitePosition(float *elevation, float *range) const
+{
+    int32_t ha = 0;
+    int32_t dec = 0;
+    return _timeSet && _satelliteAt(now(), &ha, &dec, elevation, range);
+}
+
+/* Topocentric hour angle / Dec of the satellite: TEME rotated to earth
+ * fixed by the mean sidereal time (polar motion, under a arcsec, left
+ * out), less the site, and where it was when the light left it.
+ */
+bool GotoController::_satelliteAt(int64_t ms, int32_t *ha, int32_t *dec, float *elevation, float *range) const
+{
+    double r[3];
+    double v[3];
+    if (!_satellite.propagate((ms - _satellite.getEpoch()) / 60000.0, r, v))
+        return false;
+
+    double theta = CelestialTransform::meanSiderealTime(ms) * RADIANS_PER_Q32;
+    double c = cos(theta);
+    double s = sin(theta);
+    double x = c * r[0] + s * r[1] - _siteXyz[0];
+    double y = -s * r[0] + c * r[1] - _siteXyz[1];
+    double z = r[2] - _siteXyz[2];
+    double lightTime = sqrt(x * x + y * y + z * z) / 299792.458;
+    x -= (c * v[0] + s * v[1]) * lightTime;
+    y -= (-s * v[0] + c * v[1]) * lightTime;
+    z -= v[2] * lightTime;
+
+    double distance = sqrt(x * x + y * y + z * z);
+    *ha = (int32_t)((uint32_t)_longitude - (uint32_t)toTurns(atan2(y, x)));
+    *dec = toTurns(asin(z / distance));
+    *elevation = (float)(asin((x * _siteUp[0] + y * _siteUp[1] + z * _siteUp[2]) / distance) * DEGREES_PER_RADIAN);
+    *range = (float)distance;
+    return true;
+}
+
+/* Steps through the next PASS_SEARCH_MS for the satellite's rise
+ * (then narrowed down to 0.1 s), where it culminates and the fastest
+ * either axis has to turn while it is up. False if it doesn't rise.
+ */
+bool GotoController::_findPass(int64_t from, int32_t *culminationHa, float *maxElevation, float *peakRate)
+{
+    const float unitsPerTurn = (float)MICROSTEPS_PER_REV / 4294967296.0f;
+    bool risen = false;
+    bool lastUp = false;
+    int32_t lastHa = 0;
+    int32_t lastDec = 0;
+    *maxElevation = -90.0f;
+    *peakRate = 0.0f;
+    for (int64_t t = from; t <= from + PASS_SEARCH_MS; t += PASS_STEP_MS)
+    {
+        int32_t ha = 0;
+        int32_t dec = 0;
+        float elevation = 0;
+        float range = 0;
+        if (!_satelliteAt(t, &ha, &dec, &elevation, &range))
+            break;
+        if (elevation < 0.0f)
+        {
+            if (risen)
+                break;
+            continue;
+        }
+
+        if (!risen)
+        {
+            risen = true;
+            _riseMs = t;
+            int64_t below = t - PASS_STEP_MS;
+            while (t > from && _riseMs - below > 100)
+            {
+                int64_t middle = (below + _riseMs) / 2;
+                if (_satelliteAt(middle, &ha, &dec, &elevation, &range) && elevation >= 0.0f)
+                    _riseMs = middle;
+                else
+                    below = middle;
+            }
+            _satelliteAt(t, &ha, &dec, &elevation, &range);
+        }
+        if (elevation > *maxElevation)
+        {
+            *maxElevation = elevation;
+            *culminationHa = ha;
+            _culminationMs = t;
+        }
+        if (lastUp)
+        {
+            float rate = max(abs((int32_t)(ha - lastHa)), abs((int32_t)(dec - lastDec))) * unitsPerTurn /
+                         (PASS_STEP_MS / 1000.0f);
+            *peakRate = max(*peakRate, rate);
+        }
+        lastUp = true;
+        lastHa = ha;
+        lastDec = dec;
+    }
+    return risen;
+}
+
+void GotoController::_startFollowing()
+{
+    // The previous update, for the first one's feed forward
+    _followMs = now();
+    _raVelocity = 0.0f;
+    _decVelocity = 0.0f;
+    if (!_targetAt(_followMs, &_followRa, &_followDec))
+    {
+        _stopFollowing();
+        return;
+    }
+
+    _raMotor->setSlewType(SlewTypeEnum::TRACKING);
+    _raMotor->setSlewSpeed(_followSpeed);
+    _decMotor->setSlewType(SlewTypeEnum::TRACKING);
+    _decMotor->setSlewSpeed(_followSpeed);
+    _state = State::FOLLOWING;
+    if (!_follow())
+    {
+        _stopFollowing();
+        return;
+    }
+    _raMotor->setMotion(true);
+    _decMotor->setMotion(true);
+    if (_target == Target::SATELLITE)
+        _logger->info(LogMsg::SATELLITE_FOLLOWING, _satellite.getCatalogNumber(), _raMotor->getPosition(),
+                      _decMotor->getPosition());
+    else
+        _logger->info(LogMsg::EPHEMERIS_FOLLOWING, _raMotor->getPosition(), _decMotor->getPosition());
+}
+
+/* Axis targets for the next update and the velocities to get there,
+ * false once the satellite set or the ephemeris ran out
+ */
+bool GotoController::_follow()
+{
+    int64_t t = now() + SATELLITE_UPDATE_MS;
+    if (t <= _followMs)
+        return true;
+
+    int32_t raAxis = 0;
+    int32_t decAxis = 0;
+    float elevation = 90.0f;
+    uint32_t start = micros();
+    bool ok = _targetAt(t, &raAxis, &decAxis, &elevation);
+    _updateUs = micros() - start;
+    if (!ok || (elevation < 0.0f && t > _culminationMs))
+        return false;
+    if (_target == Target::EPHEMERIS)
+        _ephemeris.release(_followMs);
+
+    float dt = (t - _followMs) / 1000.0f;
+    _followAxis(_raMotor, raAxis, _followRa, dt, &_raVelocity);
+    _followAxis(_decMotor, decAxis, _followDec, dt, &_decVelocity);
+    _followMs = t;
+    _followRa = raAxis;
+    _followDec = decAxis;
+    return true;
+}
+
+/* The target's own rate, plus what closes the gap the axis would be
+ * left with at the target time over FOLLOW_TIME_CONSTANT_S, within the
+ * ramp limits of a GOTO (see Motor::begin()).
+ */
+void GotoController::_followAxis(Motor *motor, int32_t target, int32_t previous, float dt, float *velocity)
+{
+    const float unitsPerTurn = (float)MICROSTEPS_PER_REV / 4294967296.0f;
+    const float lead = SATELLITE_UPDATE_MS / 1000.0f;
+    float rate = (int32_t)(target - previous) * unitsPerTurn / dt;
+    float behind = (int32_t)(target - (uint32_t)CelestialTransform::fromPosition(motor->getPosition())) * unitsPerTurn -
+                   rate * lead;
+    float wanted = rate + behind / FOLLOW_TIME_CONSTANT_S;
+
+    float ratio = (motor->getSlewSpeed() == SlewSpeedEnum::FAST) ? HIGH_SPEED_RATIO : 1;
+    float maxChange = MOTOR_ACCEL * ratio * dt;
+    float maxSpeed = MAX_PULSE_PER_SECOND / 2 * ratio;
+    wanted = fminf(fmaxf(wanted, *velocity - maxChange), *velocity + maxChange);
+    *velocity = fminf(fmaxf(wanted, -maxSpeed), maxSpeed);
+    motor->setVelocity(*velocity);
+}
+
+void GotoController::_stopFollowing()
+{
+    if (_raMotor->isMoving())
+        _raMotor->setMotion(false);
+    if (_decMotor->isMoving())
+        _decMotor->setMotion(false);
+    _state = State::IDLE;
+    if (_target == Target::SATELLITE)
+        _logger->info(LogMsg::SATELLITE_DONE, _satellite.getCatalogNumber(), _raMotor->getPosition(), _decMotor->getPosition());
+    else
+        _logger->info(LogMsg::EPHEMERIS_DONE, _raMotor->getPosition(), _decMotor->getPosition());
+}
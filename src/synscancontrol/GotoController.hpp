@@ -0,0 +1,245 @@
+/*
+ * Project Name: synscancontrol
+ * File: GotoController.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: On-device RA / Dec GOTO, followed by sidereal tracking
+ */
+#ifndef GOTO_CONTROLLER_H
+#define GOTO_CONTROLLER_H
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#include "CelestialTransform.hpp"
+#include "ClockCalibration.hpp"
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "EphemerisTable.hpp"
+#include "GotoPlanner.hpp"
+#include "HorizonMask.hpp"
+#include "Logger.hpp"
+#include "Motor.hpp"
+#include "PointingModel.hpp"
+#include "Sgp4.hpp"
+
+namespace SynScanControl
+{
+    /* Takes a GOTO_RADEC target through to tracking, so a host doesn't
+     * have to convert coordinates and drive each axis with :G / :S / :J.
+     *
+     * The site comes from SET_SITE (saved to flash) and the time from
+     * SET_TIME, kept by esp_timer and the clock correction. Both axes
+     * slew at once, the RA target led by the estimated slew time. Once
+     * they are there, RA does a short slow GOTO to make up for what the
+     * estimate missed and starts tracking at the sidereal rate. Targets
+     * go through the pointing model on the way to the axes.
+     *
+     * A satellite (from a TLE) is slewed to where it will be, or where
+     * it rises, and then followed until it sets: every
+     * SATELLITE_UPDATE_MS the propagator gives the axis targets for the
+     * next update, and each axis gets the velocity that gets it there
+     * (Motor::setVelocity()), with no stops in between. Ephemeris
+     * tables (comets, asteroids, the Moon) are followed the same way,
+     * interpolated rather than propagated, until they run out.
+     */
+    class GotoController
+    {
+    public:
+        GotoController(Motor *raMotor, Motor *decMotor, ClockCalibration *clock, HorizonMask *horizon, Logger *logger);
+
+        // Loads the site and the pointing model from flash, the horizon mask gets the latitude
+        void begin();
+
+        // Latitude / longitude (east positive) in Q32 turns, height in m, saved to flash once the axes stop
+        void setSite(int32_t latitude, int32_t longitude, int32_t height = 0);
+        bool hasSite() const { return _siteSet; }
+        int32_t getLatitude() const { return _latitude; }
+        int32_t getLongitude() const { return _longitude; }
+        int32_t getHeight() const { return _height; }
+
+        // UTC as Unix time in ms
+        void setTime(int64_t unixMs);
+        bool hasTime() const { return _timeSet; }
+        // ms since J2000, and the local sidereal time then (Q32 turns)
+        int64_t now() const;
+        uint32_t localSiderealTime(int64_t ms) const;
+
+        /* RA / Dec in Q32 turns. An axis still tracking is stopped first,
+         * false if one is in a GOTO / fast slew or there is no site / time.
+         */
+        bool start(uint32_t ra, int32_t dec, PierSideEnum side);
+        /* With the planner on, the pier side (AUTO) is the one that gets
+         * there soonest, within the meridian overlap and the soft limits:
+         * false if neither does, or the side asked for doesn't.
+         */
+        bool reachable(uint32_t ra, int32_t dec, PierSideEnum *side) const;
+        // The host took the axes over, a satellite being followed is stopped
+        void cancel();
+        bool isActive() const { return _state != State::IDLE; }
+        // An axis is in a GOTO / fast slew
+        bool axesBusy() const;
+        PierSideEnum getPierSide() const { return _side; }
+
+        // Where the axes point now
+        void getPointing(uint32_t *ra, int32_t *dec, PierSideEnum *side) const;
+
+        /* The telescope is centered on a star at this RA / Dec: adds it to
+         * the pointing model and refits it, saved once the axes stop (the
+         * RA axis is likely tracking). False without site / time.
+         */
+        bool addAlignmentStar(uint32_t ra, int32_t dec);
+        void clearPointingModel();
+        PointingModel *getPointingModel() { return &_model; }
+        GotoPlanner *getPlanner() { return &_planner; }
+        HorizonMask *getHorizonMask() { return _horizon; }
+
+        /* TLE lines one at a time, line 1 first: false on a format or
+         * checksum error. The satellite is replaced once line 2 is in.
+         */
+        bool setTleLine(const char *line, uint32_t length);
+        bool hasSatellite() const { return _satellite.isValid(); }
+        uint32_t getSatelliteNumber() const { return _satellite.getCatalogNumber(); }
+
+        /* Follows the satellite through its pass, if it is up or rises
+         * in the next PASS_SEARCH_MS: false otherwise. The pier side
+         * (AUTO: the one for where it culminates) stays the same
+         * throughout, check for busy axes with axesBusy() first.
+         */
+        bool startSatellite(PierSideEnum side);
+        bool isFollowing() const { return _state == State::FOLLOWING && _target == Target::SATELLITE; }
+        // Elevation (degrees) and range (km) of the satellite now
+        bool getSatellitePosition(float *elevation, float *range) const;
+
+        /* The table goes on being appended to while it is followed,
+         * appendEphemeris() makes room by dropping the points behind.
+         */
+        EphemerisTable *getEphemeris() { return &_ephemeris; }
+        bool appendEphemeris(int32_t a, int32_t b);
+        /* Follows the table from now on, until it runs out: false without
+         * time, site (RA / Dec tables) or points from now to
+         * EPHEMERIS_MIN_AHEAD_MS on. Check for busy axes first.
+         */
+        bool startEphemeris(PierSideEnum side);
+        bool isFollowingEphemeris() const { return _state == State::FOLLOWING && _target == Target::EPHEMERIS; }
+
+        // How long the last update took to get the target (propagation / interpolation and transforms)
+        uint32_t getUpdateUs() const { return _updateUs; }
+
+        void longTick();
+        // Every SATELLITE_UPDATE_MS
+        void update();
+
+    private:
+        void _saveSettings();
+
+        enum class State
+        {
+            IDLE,
+            STOPPING,
+            SLEWING,
+            REFINING,
+            WAITING,  // For the satellite to rise
+            FOLLOWING // The satellite, or the ephemeris
+        };
+
+        enum class Target
+        {
+            RADEC,
+            SATELLITE,
+            EPHEMERIS
+        };
+
+        // Axis moves over this many position units go at the fast microstepping
+        static const uint32_t FAST_GOTO_MIN = MICROSTEPS_PER_REV / 360;
+
+        static constexpr const char *NVS_NAMESPACE = "site";
+        static constexpr const char *NVS_KEY = "latlon";
+
+        // Satellite passes are looked for this far ahead, in steps of PASS_STEP_MS
+        static const int64_t PASS_SEARCH_MS = 15 * 60000;
+        static const int64_t PASS_STEP_MS = 5000;
+        // An ephemeris has to cover a slew there, however long
+        static const int64_t EPHEMERIS_MIN_AHEAD_MS = 2 * 60000;
+        // How fast an axis that fell behind a satellite catches up
+        static constexpr float FOLLOW_TIME_CONSTANT_S = 0.25f;
+
+        void _slew(bool refine);
+        void _startSlew();
+        bool _targetAt(int64_t ms, int32_t *raAxis, int32_t *decAxis, float *elevation = nullptr) const;
+        void _track();
+        void _updateSite();
+        bool _satelliteAt(int64_t ms, int32_t *ha, int32_t *dec, float *elevation, float *range) const;
+        bool _findPass(int64_t from, int32_t *culminationHa, float *maxElevation, float *peakRate);
+        void _startFollowing();
+        bool _follow();
+        void _followAxis(Motor *motor, int32_t target, int32_t previous, float dt, float *velocity);
+        void _stopFollowing();
+        static float _slewSeconds(Motor *motor, uint32_t distance, bool allowFast);
+        static bool _withinLimits(Motor *motor, int32_t target);
+        uint32_t _moveAxis(Motor *motor, int32_t target, bool unwrapAtPole, bool allowFast);
+
+        Motor *_raMotor;
+        Motor *_decMotor;
+        ClockCalibration *_clock;
+        HorizonMask *_horizon;
+        Logger *_logger;
+
+        bool _siteSet = false;
+        int32_t _latitude = 0;
+        int32_t _longitude = 0;
+        int32_t _height = 0;
+        // The site in earth fixed coordinates (km), and its zenith
+        double _siteXyz[3] = {0, 0, 0};
+        double _siteUp[3] = {0, 0, 0};
+
+        bool _timeSet = false;
+        int64_t _timeBaseMs = 0;
+        int64_t _timeBaseUs = 0;
+
+        PointingModel _model;
+        GotoPlanner _planner;
+        // Saved by longTick() once both axes stop
+        bool _siteSavePending = false;
+        bool _modelSavePending = false;
+
+        State _state = State::IDLE;
+        uint32_t _ra = 0;
+        int32_t _dec = 0;
+        PierSideEnum _side = PierSideEnum::AUTO;
+
+        Target _target = Target::RADEC;
+        Sgp4 _satellite;
+        char _tleLine1[Sgp4::LINE_LENGTH + 1] = "";
+        EphemerisTable _ephemeris;
+        SlewSpeedEnum _followSpeed = SlewSpeedEnum::SLOW;
+        int64_t _riseMs = 0;
+        int64_t _culminationMs = 0;
+        // The previous update: when for, the axis targets and velocities (units / s)
+        int64_t _followMs = 0;
+        int32_t _followRa = 0;
+        int32_t _followDec = 0;
+        float _raVelocity = 0;
+        float _decVelocity = 0;
+        uint32_t _updateUs = 0;
+    };
+} // namespace SynScanControl
+
+#endif /* GOTO_CONTROLLER_H */
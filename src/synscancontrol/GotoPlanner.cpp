@@ -0,0 +1,138 @@
+/*
+ * Project Name: synscancontrol
+ * File: GotoPlanner.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Shortest, limit-aware GOTO directions and pier sides, with the ETA
+ */
+#include <Arduino.h>
+
+#include "FlashSettings.hpp"
+#include "GotoPlanner.hpp"
+
+using namespace SynScanControl;
+
+bool GotoPlanner::save() const
+{
+    uint32_t settings[2] = {_enabled ? 1u : 0u, _overlapDegrees};
+    return FlashSettings::save(NVS_NAMESPACE, NVS_KEY, settings, sizeof(settings));
+}
+
+bool GotoPlanner::load()
+{
+    uint32_t settings[2] = {0, 0};
+    bool ok = FlashSettings::load(NVS_NAMESPACE, NVS_KEY, settings, sizeof(settings));
+    if (ok)
+    {
+        _enabled = settings[0] != 0;
+        _overlapDegrees = settings[1];
+    }
+    return ok;
+}
+
+bool GotoPlanner::plan(Motor *motor)
+{
+    uint32_t lower = 0;
+    uint32_t upper = 0;
+    bool limited = motor->getLimits(&lower, &upper);
+    SlewDirectionEnum dir = motor->getSlewDirection();
+    uint32_t distance = 0;
+    if (!shortestWay(motor->getPosition(), motor->getTargetPosition(), limited, lower, upper, &dir, &distance))
+        return false;
+
+    bool changed = dir != motor->getSlewDirection();
+    if (changed)
+        motor->setSlewDir(dir);
+    record(motor->getAxis(), dir, distance,
+           slewSeconds(distance, motor->getSlewSpeed() == SlewSpeedEnum::FAST, motor->fastTopSpeed()), changed);
+    return true;
+}
+
+void GotoPlanner::record(AxisEnum axis, SlewDirectionEnum dir, uint32_t distance, float seconds, bool changed)
+{
+    AxisPlan &plan = _plans[(axis == AxisEnum::AXIS_DEC) ? 1 : 0];
+    plan.dir = dir;
+    plan.distance = distance;
+    plan.seconds = seconds;
+    plan.changed = changed;
+    plan.startMs = millis();
+}
+
+uint32_t GotoPlanner::getEtaMs() const
+{
+    uint32_t now = millis();
+    uint32_t eta = 0;
+    for (const AxisPlan &plan : _plans)
+    {
+        uint32_t elapsed = now - plan.startMs;
+        uint32_t total = (uint32_t)(plan.seconds * 1000.0f);
+        if (total > elapsed)
+            eta = max(eta, total - elapsed);
+    }
+    return eta;
+}
+
+bool GotoPlanner::withinOverlap(int32_t raAxis) const
+{
+    // 90 degrees off the start position the counterweight is level, the telescope on the meridian
+    uint32_t limit = (uint32_t)((90 + _overlapDegrees) * (4294967296.0 / 360.0));
+    return (uint32_t)abs((int64_t)raAxis) <= limit;
+}
+
+/* Positions stay between the start position +- half a turn: CW to a
+ * target at or below the position (CCW to one above) goes through the
+ * wrap-around, which can't be within limits.
+ */
+bool GotoPlanner::shortestWay(uint32_t position, uint32_t target, bool limited, uint32_t lower, uint32_t upper,
+                              SlewDirectionEnum *dir, uint32_t *distance)
+{
+    if (limited && (target < lower || target > upper))
+        return false;
+    // Already there: CCW is the way the motor doesn't read as a full turn
+    *distance = 0;
+    if (target == position)
+    {
+        *dir = SlewDirectionEnum::CCW;
+        return true;
+    }
+
+    uint32_t direct = (target > position) ? target - position : position - target;
+    SlewDirectionEnum directDir = (target > position) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW;
+    if (limited || direct <= MICROSTEPS_PER_REV / 2)
+    {
+        *dir = directDir;
+        *distance = direct;
+    }
+    else
+    {
+        *dir = (directDir == SlewDirectionEnum::CW) ? SlewDirectionEnum::CCW : SlewDirectionEnum::CW;
+        *distance = MICROSTEPS_PER_REV - direct;
+    }
+    return true;
+}
+
+float GotoPlanner::slewSeconds(uint32_t distance, bool fast, float topSpeed)
+{
+    // In pulses of FAST_MICROSTEPS for fast moves, gear shifting keeps the acceleration
+    float pulses = fast ? (float)distance / HIGH_SPEED_RATIO : (float)distance;
+    const float maxSpeed = fast ? topSpeed / HIGH_SPEED_RATIO : MAX_PULSE_PER_SECOND / 2;
+    if (pulses >= maxSpeed * maxSpeed / MOTOR_ACCEL)
+        return pulses / maxSpeed + maxSpeed / MOTOR_ACCEL;
+    return 2.0f * sqrtf(pulses / MOTOR_ACCEL);
+}
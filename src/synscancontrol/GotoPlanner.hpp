@@ -0,0 +1,109 @@
+/*
+ * Project Name: synscancontrol
+ * File: GotoPlanner.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Shortest, limit-aware GOTO directions and pier sides, with the ETA
+ */
+#ifndef GOTO_PLANNER_H
+#define GOTO_PLANNER_H
+
+#include <stdint.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "Motor.hpp"
+
+namespace SynScanControl
+{
+    /* The host picks the direction of a :J GOTO with :G, and nothing
+     * stops it from picking the long way round (through the position
+     * counter's wrap-around, half a turn from the start position).
+     * With the planner on, a GOTO about to start takes the shortest way
+     * to its target that stays within the axis' soft limits: wrapping
+     * around only without limits, never to a target outside of them.
+     *
+     * RA / Dec GOTOs (GotoController) already take the direct way, the
+     * planner picks their pier side: the one reaching the target
+     * soonest, as long as the RA axis stays within the meridian overlap
+     * (the telescope that far past the meridian at most) and both axes
+     * within their limits.
+     *
+     * Either way, the plan of each axis is kept for the ETA: trapezoidal
+     * ramps at the default ramp limits, both axes at once.
+     */
+    class GotoPlanner
+    {
+    public:
+        struct AxisPlan
+        {
+            SlewDirectionEnum dir = SlewDirectionEnum::NONE;
+            uint32_t distance = 0; // Position units
+            float seconds = 0;
+            bool changed = false;  // Not the way the host asked for
+            uint32_t startMs = 0;  // millis()
+        };
+
+        void setEnabled(bool enabled) { _enabled = enabled; }
+        bool isEnabled() const { return _enabled; }
+        // How far past the meridian either pier side may go, in degrees
+        void setMeridianOverlap(uint32_t degrees) { _overlapDegrees = degrees; }
+        uint32_t getMeridianOverlap() const { return _overlapDegrees; }
+
+        // Both settings, in flash
+        bool save() const;
+        bool load();
+
+        /* A GOTO about to start on this motor (:G / :S done): turns it the
+         * shortest allowed way. False if its target is outside the limits.
+         */
+        bool plan(Motor *motor);
+        // A GOTO started some other way
+        void record(AxisEnum axis, SlewDirectionEnum dir, uint32_t distance, float seconds, bool changed = false);
+        const AxisPlan &getPlan(AxisEnum axis) const { return _plans[(axis == AxisEnum::AXIS_DEC) ? 1 : 0]; }
+        // Until both axes of the last plans are there
+        uint32_t getEtaMs() const;
+
+        /* The RA axis angle (Q32 turns from the start position) keeps
+         * the telescope within the meridian overlap.
+         */
+        bool withinOverlap(int32_t raAxis) const;
+
+        /* The way from position to target: shortest, within the limits
+         * if there are any. False if the target is outside of them.
+         */
+        static bool shortestWay(uint32_t position, uint32_t target, bool limited, uint32_t lower, uint32_t upper,
+                                SlewDirectionEnum *dir, uint32_t *distance);
+        /* Trapezoidal ramp at the default ramp limits (see Motor::begin()),
+         * fast moves up to topSpeed units / sec (Motor::fastTopSpeed())
+         */
+        static float slewSeconds(uint32_t distance, bool fast,
+                                 float topSpeed = HIGH_SPEED_RATIO * MAX_PULSE_PER_SECOND / 2);
+
+    private:
+        static constexpr const char *NVS_NAMESPACE = "planner";
+        static constexpr const char *NVS_KEY = "settings";
+
+        bool _enabled = false;
+        uint32_t _overlapDegrees = DEFAULT_MERIDIAN_OVERLAP;
+        AxisPlan _plans[2];
+    };
+} // namespace SynScanControl
+
+#endif /* GOTO_PLANNER_H */
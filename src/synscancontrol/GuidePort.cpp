@@ -0,0 +1,123 @@
+/*
+ * Project Name: synscancontrol
+ * File: GuidePort.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: ST-4 autoguider port inputs
+ */
+#include "GuidePort.hpp"
+
+using namespace SynScanControl;
+
+GuidePort::GuidePort(Motor *raMotor, Motor *decMotor)
+{
+    _axes[0] = {raMotor, 0, 0, 0, 0};
+    _axes[1] = {decMotor, 0, 0, 0, 0};
+    _inputs[0] = {this, RA_POS_PIN, 0, 1, false, false, 0};
+    _inputs[1] = {this, RA_NEG_PIN, 0, -1, false, false, 0};
+    _inputs[2] = {this, DEC_POS_PIN, 1, 1, false, false, 0};
+    _inputs[3] = {this, DEC_NEG_PIN, 1, -1, false, false, 0};
+}
+
+void GuidePort::begin()
+{
+    for (Input &input : _inputs)
+    {
+        input.active = digitalRead(input.pin) == LOW;
+        attachInterruptArg(input.pin, &GuidePort::_onEdge, &input, CHANGE);
+    }
+}
+
+void IRAM_ATTR GuidePort::_onEdge(void *arg)
+{
+    Input *input = (Input *)arg;
+    GuidePort *port = input->port;
+    uint32_t now = micros();
+
+    // Bounce: look again once the lockout is over
+    if (now - input->lastChangeUs < GUIDE_DEBOUNCE_US)
+    {
+        input->pending = true;
+        port->_pending = true;
+        return;
+    }
+    port->_sample(input, now);
+}
+
+void IRAM_ATTR GuidePort::tick()
+{
+    if (!_pending)
+        return;
+
+    uint32_t now = micros();
+    bool stillPending = false;
+    for (Input &input : _inputs)
+    {
+        if (!input.pending)
+            continue;
+        if (now - input.lastChangeUs < GUIDE_DEBOUNCE_US)
+        {
+            stillPending = true;
+            continue;
+        }
+        input.pending = false;
+        _sample(&input, now);
+    }
+    _pending = stillPending;
+}
+
+void IRAM_ATTR GuidePort::_sample(Input *input, uint32_t now)
+{
+    bool active = digitalRead(input->pin) == LOW;
+    if (active == input->active)
+        return;
+    input->active = active;
+    input->lastChangeUs = now;
+
+    // Both inputs of an axis held at once cancel out
+    Axis &axis = _axes[input->axis];
+    int32_t sign = 0;
+    for (const Input &other : _inputs)
+    {
+        if (other.axis == input->axis && other.active)
+            sign += other.sign;
+    }
+    if (sign == axis.sign)
+        return;
+
+    if (axis.sign != 0)
+        axis.activeMicros += now - axis.activeSinceUs;
+    if (sign != 0)
+    {
+        axis.pulses++;
+        axis.activeSinceUs = now;
+    }
+    axis.sign = sign;
+    axis.motor->setGuide(sign);
+}
+
+uint32_t GuidePort::getPulseCount(AxisEnum axis) const
+{
+    return _axes[axis == AxisEnum::AXIS_DEC ? 1 : 0].pulses;
+}
+
+uint64_t GuidePort::getActiveMicros(AxisEnum axis) const
+{
+    return _axes[axis == AxisEnum::AXIS_DEC ? 1 : 0].activeMicros;
+}
@@ -0,0 +1,92 @@
+/*
+ * Project Name: synscancontrol
+ * File: GuidePort.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: ST-4 autoguider port inputs
+ */
+#ifndef GUIDE_PORT_H
+#define GUIDE_PORT_H
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "Motor.hpp"
+
+namespace SynScanControl
+{
+    /* The four ST-4 inputs (active low, pulled up on the board).
+     *
+     * Every edge raises a GPIO interrupt that hands the new guide state
+     * straight to the motor, so a pulse changes the step rate on the very
+     * next tick. Contact bounce is handled with a lockout: the first edge
+     * is applied immediately, edges within GUIDE_DEBOUNCE_US of it are
+     * only noted, and the tick ISR samples the input again once the
+     * lockout is over. Since the level is always read back rather than
+     * inferred from the edge, the spurious interrupts GPIO36 / GPIO39 get
+     * on the ESP32 while WiFi is on are ignored as well.
+     */
+    class GuidePort
+    {
+    public:
+        GuidePort(Motor *raMotor, Motor *decMotor);
+
+        void begin();
+
+        // Called once per tick ISR
+        void IRAM_ATTR tick();
+
+        // Accepted pulses and the total time guide inputs were held, per axis
+        uint32_t getPulseCount(AxisEnum axis) const;
+        uint64_t getActiveMicros(AxisEnum axis) const;
+
+    private:
+        struct Input
+        {
+            GuidePort *port;
+            uint8_t pin;
+            uint8_t axis; // index into _axes
+            int32_t sign;
+            volatile bool active;
+            volatile bool pending;
+            volatile uint32_t lastChangeUs;
+        };
+
+        struct Axis
+        {
+            Motor *motor;
+            uint32_t pulses;
+            uint64_t activeMicros;
+            uint32_t activeSinceUs;
+            int32_t sign;
+        };
+
+        static void IRAM_ATTR _onEdge(void *arg);
+        void IRAM_ATTR _sample(Input *input, uint32_t now);
+
+        Input _inputs[4];
+        Axis _axes[2];
+        volatile bool _pending = false;
+    };
+} // namespace SynScanControl
+
+#endif /* GUIDE_PORT_H */
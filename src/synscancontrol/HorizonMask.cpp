@@ -0,0 +1,191 @@
+/*
+ * Project Name: synscancontrol
+ * File: HorizonMask.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Horizon / pier collision mask, checked against both axes from the tick ISR
+ */
+#include <Arduino.h>
+#include <math.h>
+
+#include "CelestialTransform.hpp"
+#include "FlashSettings.hpp"
+#include "HorizonMask.hpp"
+
+using namespace SynScanControl;
+
+static const float RADIANS_PER_Q32 = 6.28318531f / 4294967296.0f;
+static const float DEGREES_PER_RADIAN = 57.2957795f;
+
+HorizonMask::HorizonMask(Motor *raMotor, Motor *decMotor, Logger *logger)
+{
+    _raMotor = raMotor;
+    _decMotor = decMotor;
+    _logger = logger;
+}
+
+void HorizonMask::begin()
+{
+    if (_load())
+        _logger->info(LogMsg::HORIZON_LOADED, int(_enabled), _pierAltitude);
+}
+
+void HorizonMask::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+    _active = _active && enabled;
+    _dirty = true;
+}
+
+void HorizonMask::setPoint(uint32_t point, int8_t altitude)
+{
+    _points[point % NUM_POINTS] = altitude;
+    _dirty = true;
+}
+
+void HorizonMask::setPierAltitude(int8_t altitude)
+{
+    _pierAltitude = altitude;
+    _dirty = true;
+}
+
+void HorizonMask::setLatitude(int32_t latitude)
+{
+    _dirty = _dirty || !_latitudeSet || latitude != _latitude;
+    _latitude = latitude;
+    _latitudeSet = true;
+}
+
+// The altitudes, the pier altitude and on / off
+bool HorizonMask::save() const
+{
+    int8_t settings[NUM_POINTS + 2];
+    memcpy(settings, _points, NUM_POINTS);
+    settings[NUM_POINTS] = _pierAltitude;
+    settings[NUM_POINTS + 1] = _enabled ? 1 : 0;
+    bool ok = FlashSettings::save(NVS_NAMESPACE, NVS_KEY, settings, sizeof(settings));
+    if (!ok)
+        _logger->error(LogMsg::HORIZON_SAVE_ERROR);
+    return ok;
+}
+
+bool HorizonMask::_load()
+{
+    int8_t settings[NUM_POINTS + 2];
+    bool ok = FlashSettings::load(NVS_NAMESPACE, NVS_KEY, settings, sizeof(settings));
+    if (ok)
+    {
+        memcpy(_points, settings, NUM_POINTS);
+        _pierAltitude = settings[NUM_POINTS];
+        _enabled = settings[NUM_POINTS + 1] != 0;
+        _dirty = true;
+    }
+    return ok;
+}
+
+void IRAM_ATTR HorizonMask::tick()
+{
+    if (!_active || ++_ticker % HORIZON_CHECK_TICKS)
+        return;
+    check();
+}
+
+void IRAM_ATTR HorizonMask::check()
+{
+    if (!_raMotor->isMoving() && !_decMotor->isMoving())
+        return;
+    int32_t now = marginAt(_raMotor->getPosition(), _decMotor->getPosition());
+    int32_t ahead = marginAt(_raMotor->stoppingPosition(HORIZON_CHECK_TICKS), _decMotor->stoppingPosition(HORIZON_CHECK_TICKS));
+    if (ahead >= 0 || ahead >= now)
+        return;
+    _raMotor->halt(LimitStopEnum::HORIZON);
+    _decMotor->halt(LimitStopEnum::HORIZON);
+}
+
+void HorizonMask::longTick()
+{
+    if (!_dirty || !_latitudeSet)
+        return;
+    _dirty = false;
+    if (!_enabled)
+        return;
+
+    // Not checked against a table half written
+    _active = false;
+    uint32_t start = micros();
+    _compile();
+    _active = true;
+    _logger->info(LogMsg::HORIZON_COMPILED, CelestialTransform::arcsec(_latitude), (uint32_t)(micros() - start));
+}
+
+/* The margin at every corner of the cells, a row of corners at a
+ * time: each cell gets the lowest of its four corners.
+ */
+void HorizonMask::_compile()
+{
+    const uint32_t cellAngle = (uint32_t)(4294967296ULL / GRID);
+    float previous[GRID + 1];
+    float row[GRID + 1];
+    for (uint32_t i = 0; i <= GRID; i++)
+    {
+        for (uint32_t j = 0; j <= GRID; j++)
+            row[j] = _margin((int32_t)(i * cellAngle), (int32_t)(j * cellAngle));
+        if (i > 0)
+        {
+            for (uint32_t j = 0; j < GRID; j++)
+            {
+                float lowest = fminf(fminf(previous[j], previous[j + 1]), fminf(row[j], row[j + 1]));
+                _table[i - 1][j] = (int8_t)fmaxf(-127.0f, fminf(127.0f, floorf(lowest)));
+            }
+        }
+        memcpy(previous, row, sizeof(row));
+    }
+}
+
+float HorizonMask::exactMargin(uint32_t raPosition, uint32_t decPosition) const
+{
+    return _margin(CelestialTransform::fromPosition(raPosition), CelestialTransform::fromPosition(decPosition));
+}
+
+// Degrees above the mask, axis angles in Q32 turns
+float HorizonMask::_margin(int32_t raAxis, int32_t decAxis) const
+{
+    int32_t ha = 0;
+    int32_t dec = 0;
+    PierSideEnum side = PierSideEnum::AUTO;
+    CelestialTransform::fromAxes(raAxis, decAxis, _latitude < 0, &ha, &dec, &side);
+
+    float lat = _latitude * RADIANS_PER_Q32;
+    float h = ha * RADIANS_PER_Q32;
+    float d = dec * RADIANS_PER_Q32;
+    float altitude = asinf(fmaxf(-1.0f, fminf(1.0f, sinf(lat) * sinf(d) + cosf(lat) * cosf(d) * cosf(h)))) * DEGREES_PER_RADIAN;
+    float azimuth = atan2f(-cosf(d) * sinf(h), sinf(d) * cosf(lat) - cosf(d) * cosf(h) * sinf(lat)) * DEGREES_PER_RADIAN;
+    if (azimuth < 0.0f)
+        azimuth += 360.0f;
+
+    float point = azimuth / (360.0f / NUM_POINTS);
+    uint32_t index = (uint32_t)point % NUM_POINTS;
+    float fraction = point - floorf(point);
+    float mask = _points[index] + (_points[(index + 1) % NUM_POINTS] - _points[index]) * fraction;
+
+    // 90 degrees off the start position the counterweight is level
+    if ((uint32_t)abs((int64_t)raAxis) > CelestialTransform::QUARTER_TURN)
+        mask = fmaxf(mask, _pierAltitude);
+    return altitude - mask;
+}
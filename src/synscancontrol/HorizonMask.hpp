@@ -0,0 +1,134 @@
+/*
+ * Project Name: synscancontrol
+ * File: HorizonMask.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Horizon / pier collision mask, checked against both axes from the tick ISR
+ */
+#ifndef HORIZON_MASK_H
+#define HORIZON_MASK_H
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "Logger.hpp"
+#include "Motor.hpp"
+
+namespace SynScanControl
+{
+    /* Keeps the telescope above the local horizon (trees, houses) and
+     * off the pier.
+     *
+     * The mask is an altitude every 22.5 degrees of azimuth, linear in
+     * between, and a minimum altitude while the counterweight is above
+     * the RA axis, where the tube comes down next to the pier. On a
+     * polar aligned mount the axis positions point at the same altitude
+     * / azimuth whatever the time, so for a given latitude the mask
+     * compiles into a table over both axes: how many degrees the
+     * telescope is above the mask, the lowest in each 5 x 5 degree cell.
+     *
+     * Every HORIZON_CHECK_TICKS the tick ISR looks up the cell the axes
+     * are in and the one they would stop in if halted then. If the
+     * latter is below the mask and lower than where they are, both axes
+     * are halted down their ramps. Moving back up out of the mask is
+     * never stopped.
+     */
+    class HorizonMask
+    {
+    public:
+        static const uint32_t NUM_POINTS = 16;
+        // Cells per turn of each axis
+        static const uint32_t GRID = 72;
+        // No pier altitude: the counterweight may go up anywhere the mask allows
+        static const int8_t NO_PIER_ALTITUDE = -90;
+
+        HorizonMask(Motor *raMotor, Motor *decMotor, Logger *logger);
+
+        // Loads the mask from flash, compiled once there is a latitude
+        void begin();
+
+        // Off by default
+        void setEnabled(bool enabled);
+        bool isEnabled() const { return _enabled; }
+        // Altitude in degrees at azimuth point * 22.5 degrees (from north through east)
+        void setPoint(uint32_t point, int8_t altitude);
+        int8_t getPoint(uint32_t point) const { return _points[point % NUM_POINTS]; }
+        void setPierAltitude(int8_t altitude);
+        int8_t getPierAltitude() const { return _pierAltitude; }
+        bool save() const;
+
+        // Site latitude in Q32 turns (GotoController)
+        void setLatitude(int32_t latitude);
+        // The table is up to date and checked
+        bool isActive() const { return _active; }
+
+        // Degrees above the mask (negative: below) of the cell these axis positions are in
+        int32_t IRAM_ATTR marginAt(uint32_t raPosition, uint32_t decPosition) const
+        {
+            return _table[_cell(raPosition)][_cell(decPosition)];
+        }
+        // The same, worked out for the exact positions
+        float exactMargin(uint32_t raPosition, uint32_t decPosition) const;
+
+        // Called once per tick ISR
+        void IRAM_ATTR tick();
+        // The check itself
+        void IRAM_ATTR check();
+        // Compiles the table after a change (loop)
+        void longTick();
+
+    private:
+        static constexpr const char *NVS_NAMESPACE = "horizon";
+        static constexpr const char *NVS_KEY = "mask";
+        // Position units to cells (Q32)
+        static constexpr uint64_t CELLS_PER_UNIT = ((uint64_t)GRID << 32) / MICROSTEPS_PER_REV;
+
+        static inline uint32_t IRAM_ATTR _cell(uint32_t position)
+        {
+            int32_t offset = (int32_t)(position - 0x800000) % (int32_t)MICROSTEPS_PER_REV;
+            if (offset < 0)
+                offset += MICROSTEPS_PER_REV;
+            return (uint32_t)((offset * CELLS_PER_UNIT) >> 32);
+        }
+
+        bool _load();
+        void _compile();
+        float _margin(int32_t raAxis, int32_t decAxis) const;
+
+        Motor *_raMotor;
+        Motor *_decMotor;
+        Logger *_logger;
+
+        bool _enabled = false;
+        int8_t _points[NUM_POINTS] = {};
+        int8_t _pierAltitude = NO_PIER_ALTITUDE;
+        bool _latitudeSet = false;
+        int32_t _latitude = 0;
+        bool _dirty = false;
+
+        volatile bool _active = false;
+        uint32_t _ticker = 0;
+        int8_t _table[GRID][GRID] = {};
+    };
+} // namespace SynScanControl
+
+#endif /* HORIZON_MASK_H */
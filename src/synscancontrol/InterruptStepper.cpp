@@ -41,31 +41,6 @@ InterruptStepper::InterruptStepper(uint8_t STEP, uint8_t DIR, uint32_t FREQ, boo
     _DIR_REVERSE = DIR_REVERSE;
 }
 
-int32_t InterruptStepper::getPosition()
-{
-    return _pos;
-}
-
-int32_t InterruptStepper::getTargetPosition()
-{
-    return _targetPos;
-}
-
-float InterruptStepper::getSpeed()
-{
-    return _speed;
-}
-
-uint32_t InterruptStepper::getPulsesPerStep()
-{
-    return _pulsesPerStep;
-}
-
-int32_t InterruptStepper::stepsToStop()
-{
-    return _stepsToStop;
-}
-
 // Inspired from AccelStepper::setCurrentPosition
 void InterruptStepper::initPosition(int32_t position)
 {
@@ -81,7 +56,7 @@ void InterruptStepper::setPosition(int32_t position)
 }
 
 // Inspired from AccelStepper:moveTo
-void InterruptStepper::setTargetPosition(int32_t targetPos)
+void IRAM_ATTR InterruptStepper::setTargetPosition(int32_t targetPos)
 {
     if (_targetPos != targetPos)
     {
@@ -127,8 +102,42 @@ void InterruptStepper::setAcceleration(float accel)
     }
 }
 
+// Steps factor times as long from now on (the microsteps changed), at the
+// same speed and acceleration in distance: the ramp carries on where it
+// was, distanceToGo steps from the target. Per Equations 15 and 16, a
+// ramp down that no longer fits (rounding) gets a touch steeper. From the
+// tick ISR (gear shifts), so in IRAM and in float.
+void IRAM_ATTR InterruptStepper::rescale(float factor, int32_t distanceToGo, float maxSpeed)
+{
+    int32_t n = (int32_t)(_n / factor);
+    _n = (n == 0 && _n != 0) ? ((_n > 0) ? 1 : -1) : n;
+    if (_n < -abs(distanceToGo) && distanceToGo != 0)
+        _n = -abs(distanceToGo);
+    _speed /= factor;
+    _accel /= factor;
+    _c0 = 0.676f * sqrtf(2.0f / _accel) * 1000000.0f;
+    _cn *= factor;
+    _maxSpeed = maxSpeed;
+    _cmin = 1000000.0f / maxSpeed;
+    _pos = 0;
+    _targetPos = distanceToGo;
+    if (_speed != 0.0f)
+    {
+        _stepInterval = _cn;
+        _pulsesPerStep = _cn * (float)_FREQ / 1000000.0f;
+    }
+    _stepsToStop = (int32_t)((_speed * _speed) / (2.0f * _accel));
+}
+
 // Inspired from AccelStepper::runSpeed
 void InterruptStepper::run()
+{
+    advance();
+    step();
+}
+
+// The position part of run(), for steps some other hardware pulses out
+void IRAM_ATTR InterruptStepper::advance()
 {
     if (_dir == SlewDirectionEnum::CW)
     {
@@ -140,7 +149,6 @@ void InterruptStepper::run()
         // Anticlockwise
         _pos -= 1;
     }
-    step();
 }
 
 // Inspired from AccelStepper:step1 (for stepper drivers)
@@ -155,7 +163,7 @@ void InterruptStepper::step()
 // Inspired from AccelStepper:distanceToGo()
 // supports infinite distances via the
 // STEPPER_[N]INFINITE static members
-int32_t InterruptStepper::distanceToGo()
+int32_t IRAM_ATTR InterruptStepper::distanceToGo()
 {
     if (_targetPos >= STEPPER_INFINITE)
         return STEPPER_INFINITE;
@@ -165,7 +173,7 @@ int32_t InterruptStepper::distanceToGo()
 };
 
 // Inspired from AccelStepper::computeNewSpeed
-void InterruptStepper::computeNewSpeed()
+void IRAM_ATTR InterruptStepper::computeNewSpeed()
 {
     int32_t distanceTo = distanceToGo();
     _stepsToStop = (int32_t)((_speed * _speed) / (2.0 * _accel)); // Equation 16
@@ -240,9 +248,16 @@ bool InterruptStepper::isRunning()
     return !(_speed == 0.0 && _targetPos == _pos);
 }
 
-void InterruptStepper::_setDirectionPin()
+void IRAM_ATTR InterruptStepper::_setDirectionPin()
+{
+    setDirectionPin(_dir);
+}
+
+// Drive the DIR pin without touching the motion state, e.g. for single
+// steps taken outside of a move. Restore it with setDirectionPin(getDirection())
+void IRAM_ATTR InterruptStepper::setDirectionPin(SlewDirectionEnum dir)
 {
-    if ((_dir == SlewDirectionEnum::CW) != _DIR_REVERSE)
+    if ((dir == SlewDirectionEnum::CW) != _DIR_REVERSE)
     {
         GPIO.out_w1ts = ((uint32_t)1 << _DIR); // digitalWrite(_DIR, 1)
     }
@@ -250,4 +265,13 @@ void InterruptStepper::_setDirectionPin()
     {
         GPIO.out_w1tc = ((uint32_t)1 << _DIR); // digitalWrite(_DIR, 0)
     }
-}
\ No newline at end of file
+}
+
+// Constant rate moves (no ramp) that turn around without stopping,
+// i.e. moveToInfinity() / moveToNInfinity() while already running
+void InterruptStepper::setRunDirection(SlewDirectionEnum dir)
+{
+    _dir = dir;
+    _targetPos = (dir == SlewDirectionEnum::CW) ? STEPPER_INFINITE : STEPPER_NINFINITE;
+    _setDirectionPin();
+}
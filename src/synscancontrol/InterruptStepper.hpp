@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <limits.h>
+#include <limits>
 #include "Constants.hpp"
 #include "Enums.hpp"
 
@@ -37,23 +38,31 @@ namespace SynScanControl
         InterruptStepper() {};
         InterruptStepper(uint8_t STEP, uint8_t DIR, uint32_t FREQ, bool DIR_REVERSE);
 
-        int32_t getPosition();
-        int32_t getTargetPosition();
-        float getSpeed();
-        uint32_t getPulsesPerStep();
-        int32_t stepsToStop();
+        int32_t getPosition() const { return _pos; };
+        int32_t getTargetPosition() const { return _targetPos; };
+        float getSpeed() const { return _speed; };
+        uint32_t getPulsesPerStep() const { return _pulsesPerStep; };
+        int32_t stepsToStop() const { return _stepsToStop; };
+        int32_t getN() const { return _n; };
+        float getCn() const { return _cn; };
+        SlewDirectionEnum getDirection() const { return _dir; };
 
         void initPosition(int32_t position);
         void setPosition(int32_t position);
         void setTargetPosition(int32_t targetPos);
         void setMaxSpeed(float speed);
         void setAcceleration(float accel);
+        void rescale(float factor, int32_t distanceToGo, float maxSpeed);
         void run();
+        void advance();
         void step();
         int32_t distanceToGo();
         void computeNewSpeed();
         bool isRunning();
 
+        void setDirectionPin(SlewDirectionEnum dir);
+        void setRunDirection(SlewDirectionEnum dir);
+
         void moveToInfinity() { setTargetPosition(STEPPER_INFINITE); };
         void moveToNInfinity() { setTargetPosition(STEPPER_NINFINITE); };
 
@@ -0,0 +1,128 @@
+/*
+ * Project Name: synscancontrol
+ * File: IsrProfiler.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Optional cycle-accurate timing instrumentation for the tick ISR
+ */
+#ifndef ISR_PROFILER_H
+#define ISR_PROFILER_H
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+
+namespace SynScanControl
+{
+    /* Records how late each tick ISR starts (entry jitter, relative to the
+     * ideal TICK_PERIOD_US) and how long it runs, in CPU cycles (CCOUNT).
+     * Both go into log2-scale histograms: bucket i counts samples in
+     * [2^(i-1), 2^i) cycles, with bucket 0 holding zero.
+     *
+     * enter() / exit() are only called from the ISR when the firmware is
+     * built with -DISR_PROFILING, otherwise all the stats stay at zero.
+     */
+    class IsrProfiler
+    {
+    public:
+        static const uint8_t NUM_BUCKETS = 24;
+
+        struct Stats
+        {
+            uint32_t ticks;
+            uint32_t overruns;
+            uint32_t maxExecCycles;
+            uint32_t maxJitterCycles;
+            uint64_t totalExecCycles;
+            uint32_t execHistogram[NUM_BUCKETS];
+            uint32_t jitterHistogram[NUM_BUCKETS];
+        };
+
+    public:
+        IsrProfiler() { memset(&_stats, 0, sizeof(_stats)); }
+
+        void begin(uint32_t cpuFreqMhz)
+        {
+            _periodCycles = cpuFreqMhz * TICK_PERIOD_US;
+        }
+
+        uint32_t getPeriodCycles() const { return _periodCycles; }
+
+        inline void IRAM_ATTR enter()
+        {
+            uint32_t now = ESP.getCycleCount();
+            if (_lastEntry != 0)
+            {
+                // Unsigned wrap-around takes care of CCOUNT overflowing
+                uint32_t interval = now - _lastEntry;
+                uint32_t jitter = (interval > _periodCycles) ? interval - _periodCycles : _periodCycles - interval;
+                _stats.jitterHistogram[bucketFor(jitter)]++;
+                if (jitter > _stats.maxJitterCycles)
+                    _stats.maxJitterCycles = jitter;
+            }
+            _lastEntry = now;
+        }
+
+        inline void IRAM_ATTR exit()
+        {
+            uint32_t exec = ESP.getCycleCount() - _lastEntry;
+            _stats.ticks++;
+            _stats.totalExecCycles += exec;
+            _stats.execHistogram[bucketFor(exec)]++;
+            if (exec > _stats.maxExecCycles)
+                _stats.maxExecCycles = exec;
+            if (exec > _periodCycles)
+                _stats.overruns++;
+        }
+
+        // Copy of the stats (taken with the tick ISR masked)
+        Stats getStats()
+        {
+            Stats copy;
+            portENTER_CRITICAL(&_mux);
+            copy = _stats;
+            portEXIT_CRITICAL(&_mux);
+            return copy;
+        }
+
+        void reset()
+        {
+            portENTER_CRITICAL(&_mux);
+            memset(&_stats, 0, sizeof(_stats));
+            _lastEntry = 0;
+            portEXIT_CRITICAL(&_mux);
+        }
+
+        static inline uint8_t IRAM_ATTR bucketFor(uint32_t cycles)
+        {
+            uint8_t bucket = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles);
+            return (bucket < NUM_BUCKETS) ? bucket : NUM_BUCKETS - 1;
+        }
+
+    private:
+        Stats _stats;
+        uint32_t _periodCycles = 240 * TICK_PERIOD_US;
+        uint32_t _lastEntry = 0;
+        portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    };
+} // namespace SynScanControl
+
+#endif /* ISR_PROFILER_H */
@@ -0,0 +1,134 @@
+/*
+ * Project Name: synscancontrol
+ * File: LeastSquares.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Fixed-size linear least squares through the normal equations
+ */
+#ifndef LEAST_SQUARES_H
+#define LEAST_SQUARES_H
+
+#include <math.h>
+#include <stdint.h>
+
+namespace SynScanControl
+{
+    /* Linear least squares with N unknowns: each observation is added
+     * to the normal equations (A^T W A, A^T W y) as it comes, which are
+     * then solved by Cholesky decomposition. Everything lives in the
+     * object (N^2 + N values), so there is no heap use and the cost of a
+     * solve doesn't depend on the number of observations.
+     */
+    template <typename T, uint32_t N>
+    class LeastSquares
+    {
+    public:
+        LeastSquares() { reset(); }
+
+        void reset()
+        {
+            for (uint32_t i = 0; i < N; i++)
+            {
+                _rhs[i] = 0;
+                for (uint32_t j = 0; j < N; j++)
+                    _normal[i][j] = 0;
+            }
+            _count = 0;
+        }
+
+        // One row of the design matrix, its observed value and weight
+        void add(const T *row, T y, T weight = 1)
+        {
+            for (uint32_t i = 0; i < N; i++)
+            {
+                T wi = weight * row[i];
+                _rhs[i] += wi * y;
+                for (uint32_t j = i; j < N; j++)
+                    _normal[i][j] += wi * row[j];
+            }
+            _count++;
+        }
+
+        uint32_t getCount() const { return _count; }
+
+        /* Solves for the unknowns left free, the others are held at 0
+         * (for when there aren't enough observations to pin them down).
+         * A small ridge on the diagonal keeps directions the observations
+         * don't constrain at 0 rather than failing. False if the system is
+         * singular anyway.
+         */
+        bool solve(T *x, const bool *free = nullptr, T ridge = (T)1e-6) const
+        {
+            T l[N][N];
+            T trace = 0;
+            for (uint32_t i = 0; i < N; i++)
+                trace += _normal[i][i];
+            T damping = ridge * trace / N;
+
+            // L L^T = A^T A, upper triangle of the normal matrix only
+            for (uint32_t i = 0; i < N; i++)
+            {
+                for (uint32_t j = 0; j <= i; j++)
+                {
+                    bool used = !free || (free[i] && free[j]);
+                    T sum = used ? _normal[j][i] : (T)(i == j ? 1 : 0);
+                    if (i == j && used)
+                        sum += damping;
+                    for (uint32_t k = 0; k < j; k++)
+                        sum -= l[i][k] * l[j][k];
+                    if (i == j)
+                    {
+                        if (!(sum > 0))
+                            return false;
+                        l[i][i] = (T)sqrt(sum);
+                    }
+                    else
+                    {
+                        l[i][j] = sum / l[j][j];
+                    }
+                }
+            }
+
+            // Forward then back substitution
+            T z[N];
+            for (uint32_t i = 0; i < N; i++)
+            {
+                T sum = (!free || free[i]) ? _rhs[i] : 0;
+                for (uint32_t k = 0; k < i; k++)
+                    sum -= l[i][k] * z[k];
+                z[i] = sum / l[i][i];
+            }
+            for (uint32_t i = N; i-- > 0;)
+            {
+                T sum = z[i];
+                for (uint32_t k = i + 1; k < N; k++)
+                    sum -= l[k][i] * x[k];
+                x[i] = sum / l[i][i];
+            }
+            return true;
+        }
+
+    private:
+        T _normal[N][N];
+        T _rhs[N];
+        uint32_t _count;
+    };
+} // namespace SynScanControl
+
+#endif /* LEAST_SQUARES_H */
@@ -0,0 +1,135 @@
+/*
+ * Project Name: synscancontrol
+ * File: LogMessages.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Dictionary of log message format strings
+ */
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+#include <stdint.h>
+
+/* Every log message the firmware can emit, as X(ID, "format string").
+ *
+ * Only the message ID and the raw arguments are queued and sent over
+ * the wire, the text is formatted later (by the serial handler) or on
+ * the host (see tools/synscanlog.py, which parses this very table).
+ * So: only ever append to this list, keep one entry per line, and
+ * stick to %d / %u / %x / %c (32-bit ints), %g / %f (floats) and %s.
+ */
+#define LOG_MESSAGES(X)                                                                      \
+    X(LOGGING_STARTED, "Logging started!")                                                   \
+    X(LOGGER_DROPPED, "Logger dropped %u message(s)")                                        \
+    X(CMD_RECEIVED, "Received command: %s")                                                  \
+    X(CMD_REPLY, "Sending reply: %s")                                                        \
+    X(CMD_NO_REPLY, "Failed to come up with a reply!")                                       \
+    X(CMD_PARSE_ERROR, "Error parsing command: %s")                                          \
+    X(CMD_FACTORY_ERROR, "Command factory returned nullptr for: %s")                         \
+    X(CMD_SERIAL_TIMEOUT, "Serial timeout reached!")                                         \
+    X(MOTOR_POSITION, "Axis: %d; Current position: 0x%x")                                    \
+    X(MOTOR_SET_TARGET, "Axis: %d; Setting target position (reference) to: 0x%x")            \
+    X(MOTOR_SET_STEP_PERIOD, "Axis: %d; Setting step period to: %u")                         \
+    X(MOTOR_SET_SLEW_TYPE, "Axis: %d; Setting slew type to: %s")                             \
+    X(MOTOR_SET_SLEW_SPEED, "Axis: %d; Setting slew speed to: %s")                           \
+    X(MOTOR_SET_SLEW_DIR, "Axis: %d; Setting slew direction to: %s")                         \
+    X(MOTOR_STOPPING, "Axis: %d; About to stop! Speed: %g, Steps to stop: %d")               \
+    X(MOTOR_STATE, "Axis: %d; TGT: 0x%x; POS: 0x%x; DTG: %d; SPEED: %g; PPS: %u; STS: %d") \
+    X(POLAR_LED_BRIGHTNESS, "Setting polar scope LED PWM to: 0x%x")                         \
+    X(ISR_STATS_SUMMARY, "ISR: %u ticks; %u overruns; exec mean %u / max %u cycles; jitter max %u cycles; period %u cycles") \
+    X(ISR_STATS_EXEC_BUCKET, "ISR exec [%u, %u) cycles: %u")                                 \
+    X(ISR_STATS_JITTER_BUCKET, "ISR jitter [%u, %u) cycles: %u")                             \
+    X(TRACE_DUMP_START, "Trace dump: %u events; %u us per tick")                              \
+    X(TRACE_EVENT, "Trace: tick %u info 0x%x args 0x%x 0x%x")                                 \
+    X(TRACE_DUMP_END, "Trace dump done")                                                      \
+    X(SESSION_RX, "Session RX: %s")                                                           \
+    X(SESSION_TX, "Session TX: %s")                                                           \
+    X(SESSION_RX_MORE, "Session RX (continued): %s")                                          \
+    X(SESSION_TX_MORE, "Session TX (continued): %s")                                          \
+    X(MOTOR_PEC_TRACKING, "Axis: %d; PEC tracking: %d")                                      \
+    X(PEC_LOADED, "Axis: %d; PEC table loaded from flash")                                    \
+    X(PEC_SAVE_ERROR, "Axis: %d; Failed to save the PEC table")                               \
+    X(PEC_TRAINING_STARTED, "Axis: %d; PEC training started")                                 \
+    X(PEC_TRAINING_DONE, "Axis: %d; PEC training done: %u worm cycles; peak correction %d / 32768") \
+    X(PEC_TRAINING_INCOMPLETE, "Axis: %d; PEC training stopped before covering the whole worm") \
+    X(MOTOR_SET_BACKLASH, "Axis: %d; Setting backlash: %u; preload: %u")                      \
+    X(BACKLASH_LOADED, "Axis: %d; Backlash loaded from flash: %u; preload: %u")               \
+    X(BACKLASH_SAVE_ERROR, "Axis: %d; Failed to save the backlash")                           \
+    X(MOTOR_SET_LIMITS, "Axis: %d; Setting soft limits: %u to %u")                            \
+    X(LIMITS_LOADED, "Axis: %d; Soft limits loaded from flash: %u to %u")                     \
+    X(LIMITS_SAVE_ERROR, "Axis: %d; Failed to save the soft limits")                          \
+    X(LIMIT_STOP, "Axis: %d; Stopped at %u: %s")                                              \
+    X(MOTOR_SET_GEAR_SHIFT, "Axis: %d; Setting gear shifting: %d; up to %u units/s")           \
+    X(MOTOR_GEAR_SHIFTS, "Axis: %d; Fast move done: %u gear shifts; ended at %u microsteps")  \
+    X(GEAR_SHIFT_LOADED, "Axis: %d; Gear shifting loaded from flash: %d; up to %u units/s")   \
+    X(GEAR_SHIFT_SAVE_ERROR, "Axis: %d; Failed to save the gear shifting")                    \
+    X(RMT_STEP_OUTPUT_ERROR, "Axis: %d; No RMT step output, ramps step from the tick ISR")    \
+    X(MOTOR_SET_TRACKING_RATE, "Axis: %d; Setting tracking rate: %d")                         \
+    X(CLOCK_SYNC, "Clock sync %u: host %u s; ESP32 ahead by %d us")                           \
+    X(CLOCK_CORRECTION_LOADED, "Clock correction loaded from flash: %d ppb")                  \
+    X(CLOCK_CORRECTION_SET, "Clock correction set: %d ppb")                                   \
+    X(CLOCK_CORRECTION_SAVE_ERROR, "Failed to save the clock correction")                     \
+    X(SITE_SET, "Site set: latitude %d; longitude %d arcsec; height %d m")                    \
+    X(SITE_LOADED, "Site loaded from flash: latitude %d; longitude %d arcsec; height %d m")   \
+    X(SITE_SAVE_ERROR, "Failed to save the site")                                             \
+    X(TIME_SET, "Time set: %u s since J2000")                                                 \
+    X(GOTO_RADEC_START, "GOTO RA %u; Dec %d arcsec; pier side: %d")                           \
+    X(GOTO_RADEC_SLEW, "GOTO pass %d: RA axis %u; Dec axis %u; lead %u ms")                   \
+    X(GOTO_RADEC_TRACKING, "GOTO done, tracking from RA axis %u; Dec axis %u")                \
+    X(GOTO_RADEC_CANCELLED, "GOTO cancelled by the host")                                     \
+    X(ALIGNMENT_STAR_ADDED, "Alignment star %u: off by HA %d; Dec %d arcsec; pier side: %d")  \
+    X(POINTING_MODEL_FIT, "Pointing model from %u stars: IH %.1f; ID %.1f; CH %.1f; NP %.1f; MA %.1f; ME %.1f; RMS %.1f arcsec") \
+    X(POINTING_MODEL_LOADED, "Pointing model loaded from flash: IH %.1f; ID %.1f; CH %.1f; NP %.1f; MA %.1f; ME %.1f") \
+    X(POINTING_MODEL_SAVE_ERROR, "Failed to save the pointing model")                         \
+    X(PLANNER_LOADED, "GOTO planner loaded from flash: on %d; meridian overlap %u degrees")    \
+    X(PLANNER_SAVE_ERROR, "Failed to save the GOTO planner settings")                         \
+    X(GOTO_LIMIT_STOP, "GOTO stopped at a limit: RA axis %u; Dec axis %u")                    \
+    X(HORIZON_LOADED, "Horizon mask loaded from flash: on %d; pier altitude %d degrees")      \
+    X(HORIZON_COMPILED, "Horizon mask compiled for latitude %d arcsec in %u us")              \
+    X(HORIZON_SAVE_ERROR, "Failed to save the horizon mask")                                  \
+    X(SATELLITE_LOADED, "Satellite %u loaded: epoch %.3f days after J2000")                   \
+    X(SATELLITE_PASS, "Satellite %u rises in %d s; culminates at %.1f degrees; axes up to %.0f units/s; pier side: %d") \
+    X(SATELLITE_FOLLOWING, "Following satellite %u from RA axis %u; Dec axis %u")             \
+    X(SATELLITE_DONE, "Satellite %u done at RA axis %u; Dec axis %u")                         \
+    X(EPHEMERIS_STARTED, "Ephemeris table started: kind %d; every %u ms")                     \
+    X(EPHEMERIS_START, "Ephemeris GOTO: %u points, to %d s from now; pier side: %d")          \
+    X(EPHEMERIS_FOLLOWING, "Following the ephemeris from RA axis %u; Dec axis %u")            \
+    X(EPHEMERIS_DONE, "Ephemeris ran out at RA axis %u; Dec axis %u")
+
+enum class LogMsg : uint16_t
+{
+#define LOG_MESSAGE_ID(id, fmt) id,
+    LOG_MESSAGES(LOG_MESSAGE_ID)
+#undef LOG_MESSAGE_ID
+        COUNT
+};
+
+inline const char *logMessageFormat(LogMsg id)
+{
+    static const char *const formats[] = {
+#define LOG_MESSAGE_FORMAT(id, fmt) fmt,
+        LOG_MESSAGES(LOG_MESSAGE_FORMAT)
+#undef LOG_MESSAGE_FORMAT
+    };
+    if ((uint16_t)id >= (uint16_t)LogMsg::COUNT)
+        return "Unknown log message";
+    return formats[(uint16_t)id];
+}
+
+#endif /* LOG_MESSAGES_H */
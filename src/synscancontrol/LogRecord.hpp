@@ -0,0 +1,232 @@
+/*
+ * Project Name: synscancontrol
+ * File: LogRecord.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Binary log records and their (deferred) formatting
+ */
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "LogMessages.hpp"
+
+enum class LoggingLevel : uint8_t
+{
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARNING = 2,
+    LOG_ERROR = 3,
+    LOG_CRITICAL = 4
+};
+
+/* A single log message, kept in binary form until somebody needs the text.
+ *
+ * Arguments are packed back to back in call order: integers and floats
+ * take 4 bytes (little endian, as on the ESP32), strings take a length
+ * byte followed by that many characters (truncated to fit).
+ */
+struct LogRecord
+{
+    static const uint32_t PAYLOAD_SIZE = 48;
+
+    uint32_t timestamp; // micros()
+    LogMsg id;
+    LoggingLevel level;
+    uint8_t length;
+    uint8_t payload[PAYLOAD_SIZE];
+
+    /* Serialized size: timestamp (4), id (2), level (1), length (1), payload */
+    static const uint32_t HEADER_SIZE = 8;
+    uint32_t encodedSize() const { return HEADER_SIZE + length; }
+
+    void IRAM_ATTR pack() {}
+
+    template <typename... Args>
+    void IRAM_ATTR pack(int32_t value, Args... args)
+    {
+        _packWord(&value);
+        pack(args...);
+    }
+    template <typename... Args>
+    void IRAM_ATTR pack(uint32_t value, Args... args)
+    {
+        _packWord(&value);
+        pack(args...);
+    }
+    template <typename... Args>
+    void IRAM_ATTR pack(bool value, Args... args)
+    {
+        int32_t v = value;
+        _packWord(&v);
+        pack(args...);
+    }
+    template <typename... Args>
+    void IRAM_ATTR pack(float value, Args... args)
+    {
+        _packWord(&value);
+        pack(args...);
+    }
+    template <typename... Args>
+    void IRAM_ATTR pack(double value, Args... args)
+    {
+        float v = value;
+        _packWord(&v);
+        pack(args...);
+    }
+    template <typename... Args>
+    void IRAM_ATTR pack(const char *value, Args... args)
+    {
+        if (length < PAYLOAD_SIZE)
+        {
+            uint32_t len = strnlen(value, PAYLOAD_SIZE - length - 1);
+            payload[length++] = len;
+            memcpy(payload + length, value, len);
+            length += len;
+        }
+        pack(args...);
+    }
+
+    /* Serialize to the wire format, returns bytes written */
+    uint32_t encode(uint8_t *out) const
+    {
+        uint16_t rawId = (uint16_t)id;
+        memcpy(out, &timestamp, 4);
+        memcpy(out + 4, &rawId, 2);
+        out[6] = (uint8_t)level;
+        out[7] = length;
+        memcpy(out + HEADER_SIZE, payload, length);
+        return encodedSize();
+    }
+
+    /* Format as human readable text, e.g. "[DEBUG] [12.345] Logging started!" */
+    void format(char *out, uint32_t size) const
+    {
+        int n = snprintf(out, size, "[%s] [%u.%03u] ", levelName(level),
+                         timestamp / 1000000, (timestamp / 1000) % 1000);
+        if (n < 0 || (uint32_t)n >= size)
+            return;
+        formatMessage(out + n, size - n);
+    }
+
+    /* Format the message text only, substituting the packed arguments */
+    void formatMessage(char *out, uint32_t size) const
+    {
+        const char *fmt = logMessageFormat(id);
+        uint32_t argIdx = 0;
+        uint32_t outIdx = 0;
+        while (*fmt && outIdx + 1 < size)
+        {
+            if (*fmt != '%')
+            {
+                out[outIdx++] = *fmt++;
+                continue;
+            }
+            if (fmt[1] == '%')
+            {
+                out[outIdx++] = '%';
+                fmt += 2;
+                continue;
+            }
+
+            // Copy out the full conversion spec, e.g. "%08x"
+            char spec[16];
+            uint32_t specLen = 0;
+            spec[specLen++] = *fmt++;
+            while (*fmt && strchr("-+ #0123456789.", *fmt) && specLen < sizeof(spec) - 2)
+                spec[specLen++] = *fmt++;
+            char conv = *fmt;
+            if (!conv)
+                break;
+            fmt++;
+            spec[specLen++] = conv;
+            spec[specLen] = '\0';
+
+            int n = 0;
+            if (conv == 's')
+            {
+                char str[PAYLOAD_SIZE];
+                uint32_t len = (argIdx < length) ? payload[argIdx] : 0;
+                if (argIdx + 1 + len > length)
+                    len = 0;
+                memcpy(str, payload + argIdx + 1, len);
+                str[len] = '\0';
+                argIdx += 1 + len;
+                n = snprintf(out + outIdx, size - outIdx, spec, str);
+            }
+            else if (argIdx + 4 <= length)
+            {
+                if (conv == 'f' || conv == 'g' || conv == 'e')
+                {
+                    float v;
+                    memcpy(&v, payload + argIdx, 4);
+                    n = snprintf(out + outIdx, size - outIdx, spec, (double)v);
+                }
+                else
+                {
+                    int32_t v;
+                    memcpy(&v, payload + argIdx, 4);
+                    n = snprintf(out + outIdx, size - outIdx, spec, v);
+                }
+                argIdx += 4;
+            }
+            if (n < 0)
+                break;
+            outIdx += n;
+        }
+        if (outIdx >= size)
+            outIdx = size - 1;
+        out[outIdx] = '\0';
+    }
+
+    static const char *levelName(LoggingLevel level)
+    {
+        switch (level)
+        {
+        case (LoggingLevel::LOG_DEBUG):
+            return "DEBUG";
+        case (LoggingLevel::LOG_INFO):
+            return "INFO";
+        case (LoggingLevel::LOG_WARNING):
+            return "WARNING";
+        case (LoggingLevel::LOG_ERROR):
+            return "ERROR";
+        case (LoggingLevel::LOG_CRITICAL):
+            return "CRITICAL";
+        default:
+            return "INFO";
+        }
+    }
+
+private:
+    void IRAM_ATTR _packWord(const void *value)
+    {
+        if ((uint32_t)length + 4 <= PAYLOAD_SIZE)
+        {
+            memcpy(payload + length, value, 4);
+            length += 4;
+        }
+    }
+};
+
+#endif /* LOG_RECORD_H */
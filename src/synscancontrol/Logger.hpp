@@ -25,120 +25,256 @@
 #define LOGGER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <stdint.h>
-#include <sstream>
 #include <vector>
 
-enum class LoggingLevel
-{
-    LOG_DEBUG,
-    LOG_INFO,
-    LOG_WARNING,
-    LOG_ERROR,
-    LOG_CRITICAL
-};
+#include "LogMessages.hpp"
+#include "LogRecord.hpp"
+
+/* Compile-time minimum logging level (see LoggingLevel)
+ * Messages below this level compile down to nothing, e.g.
+ * build with -DLOG_MIN_LEVEL=1 to strip all debug messages.
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
 
 class LoggerHandler
 {
 public:
     LoggerHandler() {};
-    virtual void log(const char *msg) = 0;
+    virtual void log(const LogRecord &record) = 0;
+
+    // Called after every drain pass (whether or not there were new
+    // messages), handlers that buffer messages decide here whether to send
+    virtual void flush() {};
 };
 
 class HardwareSerialLoggerHandler : public LoggerHandler
 {
 public:
     HardwareSerialLoggerHandler(HardwareSerial *s) : _s(s) {};
-    void log(const char *msg) override
+    void log(const LogRecord &record) override
     {
-        _s->println(msg);
+        record.format(_buffer, sizeof(_buffer));
+        _s->println(_buffer);
     }
 
 private:
     HardwareSerial *_s = nullptr;
+    char _buffer[256];
 };
 
+/* Logger front-end
+ *
+ * Log calls take a message ID from LogMessages.hpp plus its arguments.
+ * They only copy the raw arguments into a slot of a multi-producer
+ * lock-free ring (Vyukov's bounded queue) and return, so they are cheap,
+ * safe from both tasks and the tick ISR, and never block on a handler.
+ * A low-priority task started by begin() drains the ring to the handlers
+ * in batches. If the ring is full the message is dropped and counted,
+ * and the drain task reports the count.
+ */
 class Logger
 {
 public:
-    Logger() {};
+    static const uint32_t RING_SIZE = 64; // must be a power of two
+    static const uint32_t DRAIN_BATCH_SIZE = 32;
+    static const uint32_t DRAIN_PERIOD_MS = 20;
 
+    Logger()
+    {
+        for (uint32_t i = 0; i < RING_SIZE; i++)
+            _ring[i].sequence.store(i, std::memory_order_relaxed);
+    };
+
+    // Handlers must all be added before begin() is called
     void addHandler(LoggerHandler *handler)
     {
         _handlerList.push_back(handler);
     }
-    void debug(const char *msg)
+    void setLevel(LoggingLevel level)
     {
-        return _log(LoggingLevel::LOG_DEBUG, msg);
+        _level = level;
     }
-    void debug(std::ostringstream *msg)
+    LoggingLevel getLevel() const
     {
-        return debug(msg->str().c_str());
+        return _level;
     }
-    void info(const char *msg)
+    uint32_t getDroppedCount() const
     {
-        return _log(LoggingLevel::LOG_INFO, msg);
+        return _droppedTotal.load(std::memory_order_relaxed);
     }
-    void info(std::ostringstream *msg)
+    // Approximate free space in the ring, for producers that can pace themselves
+    uint32_t freeSlots() const
     {
-        return info(msg->str().c_str());
+        uint32_t used = _enqueuePos.load(std::memory_order_relaxed) - _dequeuePos.load(std::memory_order_relaxed);
+        return used >= RING_SIZE ? 0 : RING_SIZE - used;
     }
-    void warning(const char *msg)
+
+    /* Cheap check for whether a message at this level would go anywhere.
+     * Callers building expensive arguments should check this first.
+     */
+    inline bool isEnabledFor(LoggingLevel level) const
     {
-        return _log(LoggingLevel::LOG_WARNING, msg);
+#if LOG_MIN_LEVEL > 0
+        if ((int)level < LOG_MIN_LEVEL)
+            return false;
+#endif
+        return level >= _level && !_handlerList.empty();
     }
-    void warning(std::ostringstream *msg)
+
+    // Start the background task draining the ring to the handlers
+    void begin()
     {
-        return warning(msg->str().c_str());
+        if (_drainTask == nullptr)
+            xTaskCreatePinnedToCore(_drainTaskLoop, "Logger::drain", 4096, this, 1, &_drainTask, 0);
     }
-    void error(const char *msg)
+
+    // Hand over (at most a batch of) queued messages to the handlers.
+    // Only ever call this from one context at a time.
+    void drain()
     {
-        return _log(LoggingLevel::LOG_ERROR, msg);
+        uint32_t count = 0;
+        uint32_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        while (count < DRAIN_BATCH_SIZE)
+        {
+            Cell *cell = &_ring[pos & (RING_SIZE - 1)];
+            uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+            if ((int32_t)(seq - (pos + 1)) < 0)
+                break; // empty (or the next message is still being written)
+
+            _dispatch(cell->record);
+
+            cell->sequence.store(pos + RING_SIZE, std::memory_order_release);
+            pos++;
+            _dequeuePos.store(pos, std::memory_order_relaxed);
+            count++;
+        }
+
+        uint32_t dropped = _dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            LogRecord record;
+            record.timestamp = micros();
+            record.id = LogMsg::LOGGER_DROPPED;
+            record.level = LoggingLevel::LOG_WARNING;
+            record.length = 0;
+            record.pack(dropped);
+            _dispatch(record);
+            count++;
+        }
+
+        for (auto it = _handlerList.begin(); it != _handlerList.end(); ++it)
+            (*it)->flush();
     }
-    void error(std::ostringstream *msg)
+
+    template <typename... Args>
+    void debug(LogMsg id, Args... args)
+    {
+        if (isEnabledFor(LoggingLevel::LOG_DEBUG))
+            _log(LoggingLevel::LOG_DEBUG, id, args...);
+    }
+    template <typename... Args>
+    void info(LogMsg id, Args... args)
+    {
+        if (isEnabledFor(LoggingLevel::LOG_INFO))
+            _log(LoggingLevel::LOG_INFO, id, args...);
+    }
+    template <typename... Args>
+    void warning(LogMsg id, Args... args)
     {
-        return error(msg->str().c_str());
+        if (isEnabledFor(LoggingLevel::LOG_WARNING))
+            _log(LoggingLevel::LOG_WARNING, id, args...);
     }
-    void critical(const char *msg)
+    template <typename... Args>
+    void error(LogMsg id, Args... args)
     {
-        return _log(LoggingLevel::LOG_CRITICAL, msg);
+        if (isEnabledFor(LoggingLevel::LOG_ERROR))
+            _log(LoggingLevel::LOG_ERROR, id, args...);
     }
-    void critical(std::ostringstream *msg)
+    template <typename... Args>
+    void critical(LogMsg id, Args... args)
     {
-        return critical(msg->str().c_str());
+        if (isEnabledFor(LoggingLevel::LOG_CRITICAL))
+            _log(LoggingLevel::LOG_CRITICAL, id, args...);
     }
 
 private:
+    struct Cell
+    {
+        std::atomic<uint32_t> sequence;
+        LogRecord record;
+    };
+
     std::vector<LoggerHandler *> _handlerList;
-    char buffer[2048]; // TODO: enable larger buffer?
-    void _log(LoggingLevel level, const char *msg)
+    LoggingLevel _level = LoggingLevel::LOG_DEBUG;
+
+    Cell _ring[RING_SIZE];
+    std::atomic<uint32_t> _enqueuePos{0};
+    std::atomic<uint32_t> _dropped{0};
+    std::atomic<uint32_t> _droppedTotal{0};
+
+    // Only written by the drain side
+    std::atomic<uint32_t> _dequeuePos{0};
+    TaskHandle_t _drainTask = nullptr;
+
+    template <typename... Args>
+    void IRAM_ATTR _log(LoggingLevel level, LogMsg id, Args... args)
     {
-        switch (level)
+        // Claim a slot
+        Cell *cell;
+        uint32_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
         {
-        case (LoggingLevel::LOG_DEBUG):
-            sprintf(buffer, "[DEBUG] %s", msg);
-            break;
-        case (LoggingLevel::LOG_INFO):
-            sprintf(buffer, "[INFO] %s", msg);
-            break;
-        case (LoggingLevel::LOG_WARNING):
-            sprintf(buffer, "[WARNING] %s", msg);
-            break;
-        case (LoggingLevel::LOG_ERROR):
-            sprintf(buffer, "[ERROR] %s", msg);
-            break;
-        case (LoggingLevel::LOG_CRITICAL):
-            sprintf(buffer, "[CRITICAL] %s", msg);
-            break;
-        default:
-            sprintf(buffer, "[INFO] %s", msg);
-            break;
+            cell = &_ring[pos & (RING_SIZE - 1)];
+            uint32_t seq = cell->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0)
+            {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                // Ring is full, drop the message
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                _droppedTotal.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
         }
-        for (auto it = begin(_handlerList); it != end(_handlerList); ++it)
+
+        // Fill it in and publish it
+        cell->record.timestamp = micros();
+        cell->record.id = id;
+        cell->record.level = level;
+        cell->record.length = 0;
+        cell->record.pack(args...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    void _dispatch(const LogRecord &record)
+    {
+        for (auto it = _handlerList.begin(); it != _handlerList.end(); ++it)
+        {
+            (*it)->log(record);
+        }
+    }
+
+    static void _drainTaskLoop(void *arg)
+    {
+        Logger *logger = (Logger *)arg;
+        for (;;)
         {
-            (*it)->log(buffer);
+            logger->drain();
+            vTaskDelay(DRAIN_PERIOD_MS / portTICK_PERIOD_MS);
         }
     }
 };
 
-#endif /* LOGGER_H */
\ No newline at end of file
+#endif /* LOGGER_H */
@@ -22,13 +22,49 @@
  * Description: Manages high-level stepper motor control logic
  */
 #include <Arduino.h>
-#include <sstream>
 
+#include "FlashSettings.hpp"
 #include "Motor.hpp"
 
 using namespace SynScanControl;
 
-Motor::Motor(AxisEnum axis, uint8_t M0, uint8_t M1, uint8_t M2, uint8_t STEP, uint8_t DIR, uint32_t startPos, bool dirReverse, Logger *logger)
+static const char *slewTypeName(SlewTypeEnum type)
+{
+    if (type == SlewTypeEnum::GOTO)
+        return "GOTO";
+    else if (type == SlewTypeEnum::TRACKING)
+        return "TRACKING";
+    return "NONE";
+}
+
+static const char *slewSpeedName(SlewSpeedEnum speed)
+{
+    if (speed == SlewSpeedEnum::FAST)
+        return "FAST";
+    else if (speed == SlewSpeedEnum::SLOW)
+        return "SLOW";
+    return "NONE";
+}
+
+static const char *limitStopName(LimitStopEnum reason)
+{
+    if (reason == LimitStopEnum::SOFT_LIMIT)
+        return "soft limit";
+    else if (reason == LimitStopEnum::HORIZON)
+        return "horizon mask";
+    return "NONE";
+}
+
+static const char *slewDirectionName(SlewDirectionEnum dir)
+{
+    if (dir == SlewDirectionEnum::CCW)
+        return "CCW";
+    else if (dir == SlewDirectionEnum::CW)
+        return "CW";
+    return "NONE";
+}
+
+Motor::Motor(AxisEnum axis, uint8_t M0, uint8_t M1, uint8_t M2, uint8_t STEP, uint8_t DIR, uint32_t startPos, bool dirReverse, TraceRecorder *trace, Logger *logger)
 {
     _axis = axis;
     _M0 = M0;
@@ -37,24 +73,39 @@ Motor::Motor(AxisEnum axis, uint8_t M0, uint8_t M1, uint8_t M2, uint8_t STEP, ui
     _STEP = STEP;
     _DIR = DIR;
     _stepper = InterruptStepper(STEP, DIR, MAX_PULSE_PER_SECOND, dirReverse);
+#ifdef RMT_STEP_OUTPUT
+    _rmt = RmtStepOutput((axis == AxisEnum::AXIS_DEC) ? RMT_CHANNEL_1 : RMT_CHANNEL_0, STEP);
+#endif
     _position = startPos;
     _maxPosition = startPos + MICROSTEPS_PER_REV / 2;
     _minPosition = startPos - MICROSTEPS_PER_REV / 2;
+    _baseIncrement = 0xFFFFFFFF / _stepPeriod + 1;
+    _stepIncrement = _baseIncrement;
+    setGuideRate(500);
+    _trace = trace;
     _logger = logger;
 }
 
 void Motor::begin()
 {
     setMicrosteps(SLOW_MICROSTEPS);
-    _stepper.setAcceleration(MOTOR_ACCEL);
-    _stepper.setMaxSpeed(MAX_PULSE_PER_SECOND / 2);
+    setRampLimits(MOTOR_ACCEL, MAX_PULSE_PER_SECOND / 2);
     _stepper.initPosition(0);
     _stepper.setTargetPosition(0);
-}
 
-uint32_t Motor::getPosition() const
-{
-    return _position;
+    if (_pec.load(_nvsKey()))
+        _logger->info(LogMsg::PEC_LOADED, int(_axis));
+    if (_loadBacklash())
+        _logger->info(LogMsg::BACKLASH_LOADED, int(_axis), _backlash, preloadCode(_preloadDir));
+    if (_loadLimits())
+        _logger->info(LogMsg::LIMITS_LOADED, int(_axis), _lowerLimit, _upperLimit);
+    if (_loadGearShift())
+        _logger->info(LogMsg::GEAR_SHIFT_LOADED, int(_axis), _gearShift ? 1 : 0, _gearShiftSpeed);
+#ifdef RMT_STEP_OUTPUT
+    _rmtReady = _rmt.begin();
+    if (!_rmtReady)
+        _logger->error(LogMsg::RMT_STEP_OUTPUT_ERROR, int(_axis));
+#endif
 }
 
 uint32_t Motor::getTargetPosition() const
@@ -82,11 +133,6 @@ SlewDirectionEnum Motor::getSlewDirection() const
     return _dir;
 }
 
-bool Motor::isMoving() const
-{
-    return _moving;
-}
-
 void Motor::setPosition(uint32_t position)
 {
     _position = position;
@@ -94,13 +140,8 @@ void Motor::setPosition(uint32_t position)
 
 void Motor::setTargetPosition(uint32_t position)
 {
-
-    std::ostringstream log;
-    log << "Axis: " << int(_axis) << "; Current position: 0x" << std::hex << getPosition();
-    _logger->debug(&log);
-    log.str("");
-    log << "Axis: " << int(_axis) << "; Setting target position (reference) to: 0x" << std::hex << position;
-    _logger->debug(&log);
+    _logger->debug(LogMsg::MOTOR_POSITION, int(_axis), getPosition());
+    _logger->debug(LogMsg::MOTOR_SET_TARGET, int(_axis), position);
 
     _targetPosition = position;
 }
@@ -108,48 +149,393 @@ void Motor::setTargetPosition(uint32_t position)
 void Motor::setStepPeriod(uint32_t stepPeriod)
 {
     // Debug
-    std::ostringstream log;
-    log << "Axis: " << int(_axis) << "; Setting step period to: " << stepPeriod;
-    _logger->debug(&log);
+    _logger->debug(LogMsg::MOTOR_SET_STEP_PERIOD, int(_axis), stepPeriod);
 
     _stepPeriod = (stepPeriod <= 4) ? 4 : stepPeriod;
+    _velocityMode = false;
+    _updateBaseIncrement();
+    _updateStepIncrement();
+}
+
+void Motor::setTrackingRate(TrackingRateEnum rate)
+{
+    _logger->debug(LogMsg::MOTOR_SET_TRACKING_RATE, int(_axis), int(rate));
+    _trackingRate = rate;
+    _velocityMode = false;
+
+    // Right away if already tracking
+    if (_moving && !useAccel())
+    {
+        _updateBaseIncrement();
+        _updateStepIncrement();
+    }
+}
+
+void Motor::setVelocity(float unitsPerSecond)
+{
+    // One step per tick at most
+    float perTick = fminf(fabsf(unitsPerSecond) / _unitsPerPulse / MAX_PULSE_PER_SECOND, 0.999f);
+    _velocityIncrement = (uint32_t)(perTick * 4294967296.0f);
+    _velocityMode = true;
+    _updateBaseIncrement();
+
+    SlewDirectionEnum dir = (unitsPerSecond < 0.0f) ? SlewDirectionEnum::CCW : SlewDirectionEnum::CW;
+    if (!_moving)
+    {
+        // Taken up by setMotion()
+        _dir = dir;
+        return;
+    }
+    if (useAccel())
+        return;
+
+    portENTER_CRITICAL(&_mux);
+    if (dir != _dir)
+    {
+        _dir = dir;
+        _stepper.setRunDirection(dir);
+        _takeUp(dir);
+    }
+    _updateStepIncrement();
+    portEXIT_CRITICAL(&_mux);
+}
+
+// Crystal error in ppb, positive if the tick timer runs fast
+void Motor::setClockCorrection(int32_t ppb)
+{
+    _clockErrorPpb = ppb;
+    _updateBaseIncrement();
+    if (_moving && !useAccel())
+        _updateStepIncrement();
+}
+
+// The step rate from the host's step period, the built-in tracking
+// rate or setVelocity(), slowed down / sped up to make up for the crystal error
+void Motor::_updateBaseIncrement()
+{
+    uint32_t increment = (_trackingRate == TrackingRateEnum::HOST) ? 0xFFFFFFFF / _stepPeriod + 1
+                                                                    : TrackingRate::incrementFor(_trackingRate);
+    if (_velocityMode)
+        increment = _velocityIncrement;
+    _baseIncrement = increment - (int32_t)((int64_t)increment * _clockErrorPpb / 1000000000);
+}
+
+// Tracking rate for the current position, the PEC table is
+// applied as a fraction of the commanded step rate
+void IRAM_ATTR Motor::_updateStepIncrement()
+{
+    int32_t correction = _pec.correctionAt(_position);
+    uint32_t increment = _baseIncrement + (int32_t)(((int64_t)_baseIncrement * correction) >> 15);
+
+    // ST-4 guiding, up to a full stop at 1x; scaled like the step rate (e.g. FAST velocity mode)
+    uint32_t guide = _guideDelta / _unitsPerPulse;
+    if (_guideSign > 0)
+        increment += guide;
+    else if (_guideSign < 0)
+        increment = (increment > guide) ? increment - guide : 0;
+    _stepIncrement = increment;
+}
+
+// Guide rate as a fraction of the sidereal rate, in 1/1000
+void Motor::setGuideRate(uint32_t perMille)
+{
+    _guideDelta = TrackingRate::siderealFraction(perMille);
+}
+
+// Called from the guide port's GPIO interrupt, takes effect on the next tick
+void IRAM_ATTR Motor::setGuide(int32_t sign)
+{
+    if (sign == _guideSign)
+        return;
+    _guideSign = sign;
+
+    if (_moving)
+    {
+        if (!useAccel())
+            _updateStepIncrement();
+    }
+    else if (sign != 0)
+    {
+        // Half a step in, so the steps taken round to the pulse duration
+        _guidePhase = 0x80000000;
+        _guideIncrement = _guideDelta / _unitsPerPulse;
+        _stepper.setDirectionPin((sign > 0) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW);
+        _takeUp((sign > 0) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW);
+    }
+    else
+    {
+        _stepper.setDirectionPin(_stepper.getDirection());
+    }
+}
+
+bool Motor::pulseGuide(int32_t sign, uint32_t perMille, uint32_t durationUs)
+{
+    // GOTOs and fast slews don't run off the phase accumulator
+    if (_moving && useAccel())
+        return false;
+
+    uint32_t delta = TrackingRate::siderealFraction(perMille) / _unitsPerPulse;
+    return _pulses.push((sign > 0) ? (int32_t)delta : -(int32_t)delta, durationUs);
+}
+
+void Motor::clearPulseGuide()
+{
+    _pulses.clear();
+}
+
+void Motor::setBacklash(uint32_t backlash, SlewDirectionEnum preload)
+{
+    _logger->debug(LogMsg::MOTOR_SET_BACKLASH, int(_axis), backlash, preloadCode(preload));
+    _backlash = backlash;
+    _preloadDir = preload;
+}
+
+bool Motor::saveBacklash()
+{
+    uint32_t settings[2] = {_backlash, (uint32_t)_preloadDir};
+    bool ok = FlashSettings::save(BACKLASH_NVS_NAMESPACE, _nvsKey(), settings, sizeof(settings));
+    if (!ok)
+        _logger->error(LogMsg::BACKLASH_SAVE_ERROR, int(_axis));
+    return ok;
+}
+
+bool Motor::_loadBacklash()
+{
+    uint32_t settings[2] = {0, 0};
+    bool ok = FlashSettings::load(BACKLASH_NVS_NAMESPACE, _nvsKey(), settings, sizeof(settings));
+    if (ok)
+    {
+        _backlash = settings[0];
+        _preloadDir = (SlewDirectionEnum)settings[1];
+    }
+    return ok;
+}
+
+void Motor::setLimits(uint32_t lower, uint32_t upper)
+{
+    _logger->debug(LogMsg::MOTOR_SET_LIMITS, int(_axis), lower, upper);
+    _lowerLimit = lower;
+    _upperLimit = upper;
+    _limited = true;
+}
+
+void Motor::clearLimits()
+{
+    _logger->debug(LogMsg::MOTOR_SET_LIMITS, int(_axis), _minPosition, _maxPosition);
+    _limited = false;
+}
+
+bool Motor::getLimits(uint32_t *lower, uint32_t *upper) const
+{
+    *lower = _limited ? _lowerLimit : _minPosition;
+    *upper = _limited ? _upperLimit : _maxPosition;
+    return _limited;
+}
+
+// No limits: the entry is removed (not there to begin with is fine too)
+bool Motor::saveLimits()
+{
+    uint32_t settings[2] = {_lowerLimit, _upperLimit};
+    bool ok = _limited ? FlashSettings::save(LIMITS_NVS_NAMESPACE, _nvsKey(), settings, sizeof(settings))
+                       : FlashSettings::erase(LIMITS_NVS_NAMESPACE, _nvsKey());
+    if (!ok)
+        _logger->error(LogMsg::LIMITS_SAVE_ERROR, int(_axis));
+    return ok;
+}
+
+bool Motor::_loadLimits()
+{
+    uint32_t settings[2] = {0, 0};
+    bool ok = FlashSettings::load(LIMITS_NVS_NAMESPACE, _nvsKey(), settings, sizeof(settings));
+    if (ok)
+    {
+        _lowerLimit = settings[0];
+        _upperLimit = settings[1];
+        _limited = true;
+    }
+    return ok;
+}
+
+void IRAM_ATTR Motor::halt(LimitStopEnum reason)
+{
+    if (!_moving || _halting)
+        return;
+    _halting = true;
+    _limitStop = reason;
+    _toStop = true;
+    _shiftRest = 0;
+    if (useAccel())
+    {
+#ifdef RMT_STEP_OUTPUT
+        portENTER_CRITICAL(&_mux);
+#endif
+        int32_t stop = _stepper.stepsToStop();
+        _stepper.setTargetPosition(_stepper.getPosition() + ((_dir == SlewDirectionEnum::CW) ? stop : -stop));
+#ifdef RMT_STEP_OUTPUT
+        portEXIT_CRITICAL(&_mux);
+#endif
+    }
+}
+
+uint32_t IRAM_ATTR Motor::stoppingPosition(uint32_t aheadSteps)
+{
+    if (!_moving)
+        return _position;
+    uint32_t ratio = _unitsPerPulse;
+    uint32_t steps = aheadSteps + (useAccel() ? _stepper.stepsToStop() : 0);
+    return (_dir == SlewDirectionEnum::CW) ? _position + steps * ratio : _position - steps * ratio;
+}
+
+/* After a step towards a soft limit: halt while the ramp can still
+ * stop short of it, or before a step without a ramp would cross it.
+ * The ramp down takes a few steps more than stepsToStop() says (and
+ * that grows by one a step), hence the steps to spare. A GOTO ending
+ * short of the limit goes on, and nothing stops an axis outside its
+ * limits from heading back in. aheadSteps: how far the stepper has
+ * got past the position (steps planned, not taken yet).
+ */
+void IRAM_ATTR Motor::_checkLimits(uint32_t aheadSteps)
+{
+    int32_t ratio = _unitsPerPulse;
+    int32_t room = (_dir == SlewDirectionEnum::CW) ? (int32_t)(_upperLimit - _position) : (int32_t)(_position - _lowerLimit);
+    room -= (int32_t)aheadSteps * ratio;
+    bool ramp = useAccel();
+    int32_t stop = ramp ? _stepper.stepsToStop() + LIMIT_SPARE_STEPS : 1;
+    if (room >= stop * ratio || _halting)
+        return;
+    if (ramp && room >= 0 && abs(_stepper.distanceToGo()) <= room / ratio)
+        return;
+    halt(LimitStopEnum::SOFT_LIMIT);
+}
+
+void Motor::setGearShift(bool enabled, uint32_t maxSpeed)
+{
+    _logger->debug(LogMsg::MOTOR_SET_GEAR_SHIFT, int(_axis), enabled ? 1 : 0, maxSpeed);
+    _gearShift = enabled;
+    _gearShiftSpeed = maxSpeed;
+}
+
+bool Motor::saveGearShift()
+{
+    uint32_t settings[2] = {_gearShift ? 1u : 0u, _gearShiftSpeed};
+    bool ok = FlashSettings::save(GEAR_SHIFT_NVS_NAMESPACE, _nvsKey(), settings, sizeof(settings));
+    if (!ok)
+        _logger->error(LogMsg::GEAR_SHIFT_SAVE_ERROR, int(_axis));
+    return ok;
+}
+
+bool Motor::_loadGearShift()
+{
+    uint32_t settings[2] = {0, 0};
+    bool ok = FlashSettings::load(GEAR_SHIFT_NVS_NAMESPACE, _nvsKey(), settings, sizeof(settings));
+    if (ok)
+    {
+        _gearShift = settings[0] != 0;
+        _gearShiftSpeed = settings[1];
+    }
+    return ok;
+}
+
+float Motor::fastTopSpeed() const
+{
+    if (_gearShift)
+        return fminf(_rampMaxSpeed * SLOW_MICROSTEPS, (float)_gearShiftSpeed);
+    return _rampMaxSpeed * HIGH_SPEED_RATIO;
+}
+
+void IRAM_ATTR Motor::_setGear(uint32_t unitsPerPulse)
+{
+    setMicrosteps(SLOW_MICROSTEPS / unitsPerPulse);
+    _unitsPerPulse = unitsPerPulse;
+}
+
+/* After a step of a gear shifting move: half the microsteps once the
+ * pulse rate is up (at a full step), twice as many once it is down,
+ * the ramp rescaled to carry on at the same shaft speed. What the
+ * coarser gear can't step of the way left is kept aside, and stepped
+ * in the finest gear if the ramp comes to rest before shifting down.
+ */
+void IRAM_ATTR Motor::_shiftGear()
+{
+    float speed = fabsf(_stepper.getSpeed());
+    uint32_t units = _unitsPerPulse;
+    if (speed == 0.0f)
+    {
+        if (_shiftRest == 0)
+            return;
+        units = 1;
+    }
+    else if (speed >= _rampMaxSpeed * GEAR_UP_RATE && _stepper.getN() > 0 && units < SLOW_MICROSTEPS &&
+             _rampMaxSpeed * units < _gearShiftSpeed && _driverPhase == 0)
+        units *= 2;
+    else if (speed < _rampMaxSpeed * GEAR_DOWN_RATE && units > 1)
+        units /= 2;
+    else
+        return;
+
+    int32_t togo = _stepper.distanceToGo();
+    if (togo < STEPPER_INFINITE && togo > STEPPER_NINFINITE)
+    {
+        int32_t left = togo * (int32_t)_unitsPerPulse + _shiftRest;
+        togo = left / (int32_t)units;
+        _shiftRest = left % (int32_t)units;
+    }
+    _stepper.rescale((float)units / _unitsPerPulse, togo, fminf(_rampMaxSpeed, (float)_gearShiftSpeed / units));
+    _setGear(units);
+    _gearShifts++;
+    if (speed == 0.0f)
+        _stepper.computeNewSpeed();
+}
+
+/* Follows the driver's indexer within a full step: a step from a state
+ * that isn't valid in the current mode (it changed in between) goes to
+ * the next valid one, the DRV8825 way.
+ */
+void IRAM_ATTR Motor::_advancePhase(SlewDirectionEnum dir)
+{
+    uint32_t off = _driverPhase % _unitsPerPulse;
+    if (dir == SlewDirectionEnum::CW)
+        _driverPhase += _unitsPerPulse - off;
+    else
+        _driverPhase -= off ? off : _unitsPerPulse;
+    _driverPhase %= SLOW_MICROSTEPS;
+}
+
+/* About to drive the gears the given way: if that is a reversal, take
+ * the backlash up first. Nothing is known about the gears until the
+ * first move, so that one is left alone.
+ */
+void IRAM_ATTR Motor::_takeUp(SlewDirectionEnum dir)
+{
+    if (dir == _loadedDir)
+        return;
+    bool known = _loadedDir != SlewDirectionEnum::NONE;
+    _loadedDir = dir;
+    if (!known || _backlash == 0)
+        return;
+
+    uint32_t ratio = _unitsPerPulse;
+    _takeUpTicker = 0;
+    _stepper.setDirectionPin(dir);
+    _takeUpLeft = (_backlash + ratio - 1) / ratio;
 }
 
 void Motor::setSlewType(SlewTypeEnum type)
 {
     _type = type;
+    _velocityMode = false;
 
     // Debug
-    std::ostringstream log;
-    log << "Axis: " << int(_axis) << "; Setting slew type to: ";
-    if (type == SlewTypeEnum::GOTO)
-        log << "GOTO";
-    else if (type == SlewTypeEnum::TRACKING)
-        log << "TRACKING";
-    else if (type == SlewTypeEnum::NONE)
-        log << "NONE";
-    _logger->debug(&log);
+    _logger->debug(LogMsg::MOTOR_SET_SLEW_TYPE, int(_axis), slewTypeName(type));
 }
 
 void Motor::setSlewSpeed(SlewSpeedEnum speed)
 {
-    if (speed == SlewSpeedEnum::FAST)
-        setMicrosteps(FAST_MICROSTEPS);
-    else
-        setMicrosteps(SLOW_MICROSTEPS);
-
+    _setGear((speed == SlewSpeedEnum::FAST) ? HIGH_SPEED_RATIO : 1);
     _speed = speed;
 
     // Debug
-    std::ostringstream log;
-    log << "Axis: " << int(_axis) << "; Setting slew speed to: ";
-    if (speed == SlewSpeedEnum::FAST)
-        log << "FAST";
-    else if (speed == SlewSpeedEnum::SLOW)
-        log << "SLOW";
-    else if (speed == SlewSpeedEnum::NONE)
-        log << "NONE";
-    _logger->debug(&log);
+    _logger->debug(LogMsg::MOTOR_SET_SLEW_SPEED, int(_axis), slewSpeedName(speed));
 }
 
 void Motor::setSlewDir(SlewDirectionEnum dir)
@@ -157,25 +543,41 @@ void Motor::setSlewDir(SlewDirectionEnum dir)
     _dir = dir;
 
     // Debug
-    std::ostringstream log;
-    log << "Axis: " << int(_axis) << "; Setting slew direction to: ";
-    if (dir == SlewDirectionEnum::CCW)
-        log << "CCW";
-    else if (dir == SlewDirectionEnum::CW)
-        log << "CW";
-    else if (dir == SlewDirectionEnum::NONE)
-        log << "NONE";
-    _logger->debug(&log);
+    _logger->debug(LogMsg::MOTOR_SET_SLEW_DIR, int(_axis), slewDirectionName(dir));
 }
 
 void Motor::setMotion(bool moving)
 {
     if (moving)
     {
+        // A guide pulse moving the stopped axis becomes a rate change
+        if (_guideSign != 0 || _pulseSign != 0)
+            _stepper.setDirectionPin(_stepper.getDirection());
+        _pulseSign = 0;
+        if (useAccel())
+            _pulses.clear();
+
+        // Gear shifting moves start from the finest microsteps, at the same acceleration
+        _shifting = _gearShift && _speed == SlewSpeedEnum::FAST && useAccel();
+        if (_shifting)
+        {
+            _setGear(1);
+            _shiftRest = 0;
+            _gearShifts = 0;
+            _stepper.initPosition(0);
+            _stepper.setAcceleration(_rampAccel * HIGH_SPEED_RATIO);
+            _stepper.setMaxSpeed(fminf(_rampMaxSpeed, (float)_gearShiftSpeed));
+        }
+        _takeUp(_dir);
+
         _moving = true;
         _toStop = false;
+        _halting = false;
+        _limitStop = LimitStopEnum::NONE;
         if (getSlewType() == SlewTypeEnum::TRACKING)
         {
+            _updateBaseIncrement();
+            _updateStepIncrement();
             if (getSlewDirection() == SlewDirectionEnum::CW)
             {
                 _stepper.moveToInfinity();
@@ -211,8 +613,7 @@ void Motor::setMotion(bool moving)
                 numSteps = _position - _targetPosition;
             }
 
-            if (_speed == SlewSpeedEnum::FAST)
-                numSteps /= HIGH_SPEED_RATIO;
+            numSteps /= _unitsPerPulse;
 
             _stepper.setPosition(0);
             if (_dir == SlewDirectionEnum::CW)
@@ -224,16 +625,25 @@ void Motor::setMotion(bool moving)
                 _stepper.setTargetPosition(-numSteps);
             }
         }
+#ifdef RMT_STEP_OUTPUT
+        // Ramps are the RMT's, take-up included
+        if (_rmtReady && !_rmtActive && useAccel() && !_shifting)
+            _startRmt();
+#endif
+        _trace->record(TraceEventEnum::MOTION_START, _axis, _position, _stepper.getTargetPosition(), (uint32_t)_type);
     }
     else
     {
         _toStop = true;
+        _shiftRest = 0;
 
         // Debug
-        std::ostringstream log;
-        log << "Axis: " << int(_axis) << "; About to stop! Speed: " << _stepper.getSpeed() << ", Steps to stop: " << _stepper.stepsToStop();
-        _logger->debug(&log);
+        _logger->debug(LogMsg::MOTOR_STOPPING, int(_axis), _stepper.getSpeed(), _stepper.stepsToStop());
+        _trace->record(TraceEventEnum::MOTION_STOP, _axis, _position, _stepper.getPosition(), _stepper.stepsToStop());
 
+#ifdef RMT_STEP_OUTPUT
+        portENTER_CRITICAL(&_mux);
+#endif
         if (getSlewDirection() == SlewDirectionEnum::CW)
         {
             _stepper.setTargetPosition(_stepper.getPosition() + _stepper.stepsToStop());
@@ -242,10 +652,136 @@ void Motor::setMotion(bool moving)
         {
             _stepper.setTargetPosition(_stepper.getPosition() - _stepper.stepsToStop());
         }
+#ifdef RMT_STEP_OUTPUT
+        portEXIT_CRITICAL(&_mux);
+#endif
+    }
+}
+
+#ifdef RMT_STEP_OUTPUT
+/* Hands the ramp just set up to the RMT, after whatever backlash is
+ * left to take up: from here on the tick ISR only counts the steps.
+ */
+void Motor::_startRmt()
+{
+    portENTER_CRITICAL(&_mux);
+    uint32_t lead = _takeUpLeft;
+    _rmt.load(&_stepper, &_mux, lead, BACKLASH_TAKEUP_TICKS * TICK_PERIOD_US);
+    _rmtSteps = 0;
+    _rmtStart = _stepper.getPosition();
+    _rmtActive = true;
+    portEXIT_CRITICAL(&_mux);
+    _rmt.start();
+}
+
+/* Counts the steps the RMT has encoded since the last tick, take-up
+ * first, and hands the pin back once the train is out. A ramp that
+ * went past its target comes back on the tick ISR.
+ */
+void IRAM_ATTR Motor::_syncRmt()
+{
+    bool done = _rmt.isDone();
+    uint32_t steps = _rmt.getSteps();
+    SlewDirectionEnum dir = _stepper.getDirection();
+    bool moved = _rmtSteps != steps;
+    for (; _rmtSteps != steps; _rmtSteps++)
+    {
+        if (_takeUpLeft)
+        {
+            _advancePhase(_loadedDir);
+            _takeUpLeft--;
+        }
+        else
+        {
+            _updatePosition(dir);
+        }
+    }
+
+    if (moved && _limited && !_takeUpLeft)
+    {
+        portENTER_CRITICAL(&_mux);
+        uint32_t planned = abs(_stepper.getPosition() - _rmtStart);
+        portEXIT_CRITICAL(&_mux);
+        _checkLimits(planned - (_rmtSteps - _rmt.getLead()));
+    }
+    if (moved)
+        _trace->step(_axis, _position, _stepper.getN(), _stepper.getCn());
+
+    if (done)
+    {
+        _rmt.release();
+        _rmtActive = false;
+        if (_rmt.turnsAround())
+            _stepper.computeNewSpeed();
+    }
+}
+#endif
+
+// Acceleration (steps/s^2) and max speed (steps/s) used for GOTO / fast moves,
+// defaults are MOTOR_ACCEL and MAX_PULSE_PER_SECOND / 2
+void Motor::setRampLimits(float accel, float maxSpeed)
+{
+    _rampAccel = accel;
+    _rampMaxSpeed = maxSpeed;
+    _stepper.setAcceleration(accel);
+    _stepper.setMaxSpeed(maxSpeed);
+}
+
+bool Motor::savePecTable()
+{
+    _pecSavePending = false;
+    if (_pec.save(_nvsKey()))
+        return true;
+    _logger->error(LogMsg::PEC_SAVE_ERROR, int(_axis));
+    return false;
+}
+
+// PEC playback is off while training, so the raw periodic error is recorded
+void Motor::startPecTraining()
+{
+    _pec.setEnabled(false);
+    _pecTrainer.reset();
+    _pecTraining = true;
+    _logger->info(LogMsg::PEC_TRAINING_STARTED, int(_axis));
+}
+
+/* The table is replaced only if the whole worm was covered. It is saved
+ * once both axes stop (see longTick), flash writes pausing the tick timer.
+ */
+void Motor::stopPecTraining()
+{
+    if (!_pecTraining)
+        return;
+    _pecTraining = false;
+
+    if (!_pecTrainer.fit(&_pec))
+    {
+        _logger->warning(LogMsg::PEC_TRAINING_INCOMPLETE, int(_axis));
+        return;
+    }
+
+    int32_t peak = 0;
+    for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+        peak = max(peak, abs(_pec.getEntry(i)));
+    _logger->info(LogMsg::PEC_TRAINING_DONE, int(_axis), _pecTrainer.getCycles(), peak);
+    _pecSavePending = true;
+}
+
+void Motor::_updatePecTraining()
+{
+    // Only tracking says anything about the worm, anything else is skipped
+    if (!_moving || _type != SlewTypeEnum::TRACKING || _speed != SlewSpeedEnum::SLOW)
+    {
+        _pecTrainer.pause();
+        return;
     }
+
+    _pecTrainer.update(_position, micros());
+    if (_pecTrainer.getCycles() >= PEC_TRAINING_CYCLES && _pecTrainer.isComplete())
+        stopPecTraining();
 }
 
-void Motor::setMicrosteps(uint8_t s)
+void IRAM_ATTR Motor::setMicrosteps(uint8_t s)
 {
     switch (s)
     {
@@ -289,6 +825,26 @@ void Motor::setMicrosteps(uint8_t s)
 
 void IRAM_ATTR Motor::tick()
 {
+#ifdef RMT_STEP_OUTPUT
+    if (_rmtActive)
+    {
+        _syncRmt();
+        return;
+    }
+#endif
+
+    // Everything else waits for the backlash to be taken up
+    if (_takeUpLeft)
+    {
+        if (++_takeUpTicker % BACKLASH_TAKEUP_TICKS == 0)
+        {
+            _stepper.step();
+            _advancePhase(_loadedDir);
+            _takeUpLeft--;
+        }
+        return;
+    }
+
     if (_moving)
     {
         // Return if we do not wish to perform a step
@@ -299,10 +855,24 @@ void IRAM_ATTR Motor::tick()
             if (++_ticker % _stepper.getPulsesPerStep() > 0)
                 return;
         }
-        else if (++_ticker % _stepPeriod > 0)
-            return;
+        else
+        {
+            // Tracking: step whenever the phase accumulator wraps around
+            uint32_t increment = _stepIncrement;
+            if (_pulses.isActive())
+            {
+                int32_t offset = _pulses.next();
+                increment = (offset < 0 && (uint32_t)-offset > increment) ? 0 : increment + offset;
+            }
+            uint32_t phase = _stepPhase + increment;
+            bool wrapped = phase < _stepPhase;
+            _stepPhase = phase;
+            if (!wrapped || _halting)
+                return;
+        }
 
-        // Do the step
+        // Do the step, ramps may go past the target and come back
+        SlewDirectionEnum dir = useAccel() ? _stepper.getDirection() : _dir;
         _stepper.run();
 
         // Implement accel / decel (GOTO only)
@@ -310,49 +880,130 @@ void IRAM_ATTR Motor::tick()
             _stepper.computeNewSpeed();
 
         // Adjust position counter
-        uint32_t numSteps = 1;
-        if (_speed == SlewSpeedEnum::FAST)
-            numSteps *= HIGH_SPEED_RATIO;
-        if (_dir == SlewDirectionEnum::CW)
-        {
-            _position += numSteps;
-            if (_position > _maxPosition)
-                _position -= MICROSTEPS_PER_REV;
-        }
-        else
+        _updatePosition(dir);
+        if (_shifting)
+            _shiftGear();
+        if (_limited)
+            _checkLimits();
+
+        // Follow the PEC table as the worm turns
+        if (!useAccel())
+            _updateStepIncrement();
+
+        _trace->step(_axis, _position, _stepper.getN(), _stepper.getCn());
+    }
+    else if (_guideSign != 0)
+    {
+        // ST-4 guiding a stopped axis, the DIR pin was set by setGuide()
+        uint32_t phase = _guidePhase + _guideIncrement;
+        bool wrapped = phase < _guidePhase;
+        _guidePhase = phase;
+        if (!wrapped)
+            return;
+
+        _stepper.step();
+        _updatePosition((_guideSign > 0) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW);
+        _trace->step(_axis, _position, 0, 0.0f);
+    }
+    else if (_pulses.isActive())
+    {
+        // Timed guide pulses moving a stopped axis
+        int32_t offset = _pulses.next();
+        if (offset == 0)
+            return;
+        int32_t sign = (offset > 0) ? 1 : -1;
+        if (sign != _pulseSign)
         {
-            _position -= numSteps;
-            if (_position < _minPosition)
-                _position += MICROSTEPS_PER_REV;
+            // Half a step in, like setGuide()
+            _pulseSign = sign;
+            _guidePhase = 0x80000000;
+            _stepper.setDirectionPin((sign > 0) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW);
+            _takeUp((sign > 0) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW);
         }
+
+        uint32_t phase = _guidePhase + (uint32_t)((offset < 0) ? -offset : offset);
+        bool wrapped = phase < _guidePhase;
+        _guidePhase = phase;
+        if (!wrapped)
+            return;
+
+        _stepper.step();
+        _updatePosition((sign > 0) ? SlewDirectionEnum::CW : SlewDirectionEnum::CCW);
+        _trace->step(_axis, _position, 0, 0.0f);
+    }
+    else if (_pulseSign != 0)
+    {
+        // Done, leave the DIR pin as the next motion expects it
+        _pulseSign = 0;
+        _stepper.setDirectionPin(_stepper.getDirection());
+    }
+}
+
+void IRAM_ATTR Motor::_updatePosition(SlewDirectionEnum dir)
+{
+    uint32_t numSteps = _unitsPerPulse;
+    _advancePhase(dir);
+    if (dir == SlewDirectionEnum::CW)
+    {
+        _position += numSteps;
+        if (_position > _maxPosition)
+            _position -= MICROSTEPS_PER_REV;
+    }
+    else
+    {
+        _position -= numSteps;
+        if (_position < _minPosition)
+            _position += MICROSTEPS_PER_REV;
     }
 }
 
 void Motor::longTick()
 {
+    if (_pecTraining)
+        _updatePecTraining();
+
     if (_moving)
     {
         // NOTE: this is a bit too verbose to keep enabled!
         /*if (int(_axis) == 2)
         {
-            std::ostringstream log;
-            log << "Axis: " << int(_axis) << ";";
-            log << " TGT: 0x" << std::hex << _stepper.getTargetPosition() << ";";
-            log << " POS: 0x" << std::hex << _stepper.getPosition() << ";";
-            log << " DTG: " << std::dec << _stepper.distanceToGo() << ";";
-            log << " SPEED: " << std::dec << _stepper.getSpeed() << ";";
-            log << " PPS: " << std::dec << _stepper.getPulsesPerStep() << ";";
-            log << " STS: " << std::dec << _stepper.stepsToStop() << ";";
-            log << " TOSTOP: " << std::dec << _toStop << ";";
-            log << " MOVING: " << _moving << ";";
-            _logger->debug(&log);
+            _logger->debug(LogMsg::MOTOR_STATE, int(_axis), _stepper.getTargetPosition(), _stepper.getPosition(),
+                           _stepper.distanceToGo(), _stepper.getSpeed(), _stepper.getPulsesPerStep(), _stepper.stepsToStop());
         }*/
 
-        if ((_toStop && !useAccel()) || !_stepper.isRunning())
+        bool running = _stepper.isRunning();
+#ifdef RMT_STEP_OUTPUT
+        // The stepper is done before the RMT
+        running = running || _rmtActive;
+#endif
+        if ((_toStop && !useAccel()) || !running)
         {
             _toStop = false;
             _moving = false;
+            // A guide pulse still held is dropped, the next edge starts over
+            _guideSign = 0;
+            if (_halting)
+            {
+                _halting = false;
+                _logger->warning(LogMsg::LIMIT_STOP, int(_axis), _position, limitStopName(_limitStop));
+            }
+            _trace->record(TraceEventEnum::MOTION_DONE, _axis, _position, _stepper.getPosition(), 0);
             _stepper.setPosition(0);
+            if (_shifting)
+            {
+                // Back to the ramp of the other moves, in whatever gear it stopped
+                _shifting = false;
+                _stepper.setAcceleration(_rampAccel);
+                _stepper.setMaxSpeed(_rampMaxSpeed);
+                _logger->debug(LogMsg::MOTOR_GEAR_SHIFTS, int(_axis), _gearShifts, getMicrosteps());
+            }
+
+            // Get ready for tracking / guiding in the preload direction
+            if (_type == SlewTypeEnum::GOTO && _preloadDir != SlewDirectionEnum::NONE)
+                _takeUp(_preloadDir);
         }
     }
+
+    if (_pecSavePending && FlashSettings::canSave())
+        savePecTable();
 }
\ No newline at end of file
@@ -28,6 +28,12 @@
 #include "InterruptStepper.hpp"
 #include "Constants.hpp"
 #include "Logger.hpp"
+#include "PecTable.hpp"
+#include "PecTrainer.hpp"
+#include "PulseGuideQueue.hpp"
+#include "RmtStepOutput.hpp"
+#include "TraceRecorder.hpp"
+#include "TrackingRate.hpp"
 #include "Enums.hpp"
 
 namespace SynScanControl
@@ -43,16 +49,17 @@ namespace SynScanControl
         static const int32_t STEPPER_INFINITE = std::numeric_limits<int32_t>::max() / 2;
         static const int32_t STEPPER_NINFINITE = std::numeric_limits<int32_t>::min() / 2;
 
-        Motor(AxisEnum axis, uint8_t M0, uint8_t M1, uint8_t M2, uint8_t STEP, uint8_t DIR, uint32_t startPos, bool reversed, Logger *logger);
+        Motor(AxisEnum axis, uint8_t M0, uint8_t M1, uint8_t M2, uint8_t STEP, uint8_t DIR, uint32_t startPos, bool reversed, TraceRecorder *trace, Logger *logger);
 
         void begin();
-        uint32_t getPosition() const;
+        uint32_t getPosition() const { return _position; }
         uint32_t getTargetPosition() const;
         float getSpeed();
+        AxisEnum getAxis() const { return _axis; }
         SlewTypeEnum getSlewType() const;
         SlewSpeedEnum getSlewSpeed() const;
         SlewDirectionEnum getSlewDirection() const;
-        bool isMoving() const;
+        bool isMoving() const { return _moving; }
 
         void setPosition(uint32_t position);
         void setTargetPosition(uint32_t position);
@@ -61,14 +68,135 @@ namespace SynScanControl
         void setSlewSpeed(SlewSpeedEnum type);
         void setSlewDir(SlewDirectionEnum type);
         void setMotion(bool moving);
-        void setMicrosteps(uint8_t s);
+        void IRAM_ATTR setMicrosteps(uint8_t s);
+        void setRampLimits(float accel, float maxSpeed);
+
+        /* Track at a built-in rate rather than the step period, until the
+         * next setStepPeriod() from the host (HOST).
+         */
+        void setTrackingRate(TrackingRateEnum rate);
+        TrackingRateEnum getTrackingRate() const { return _trackingRate; }
+
+        /* Track at a signed rate in position units per second (CW
+         * positive) instead, updated on the fly: a change of direction
+         * goes through the backlash take-up but the axis never stops.
+         * Cleared by setSlewType(), setStepPeriod() and setTrackingRate().
+         */
+        void setVelocity(float unitsPerSecond);
+
+        // Tick timer crystal error in ppb (see ClockCalibration), the tracking rate makes up for it
+        void setClockCorrection(int32_t ppb);
+
+        PecTable *getPecTable() { return &_pec; }
+        bool savePecTable();
+        void startPecTraining();
+        void stopPecTraining();
+        bool isPecTraining() const { return _pecTraining; }
+
+        /* ST-4 guiding: +1 / -1 while a guide input is held, 0 when released.
+         * While tracking the rate is sped up / slowed down by the guide rate,
+         * otherwise the axis moves CW / CCW at the guide rate.
+         */
+        void setGuideRate(uint32_t perMille);
+        void IRAM_ATTR setGuide(int32_t sign);
+        int32_t getGuide() const { return _guideSign; }
+
+        /* Timed guide pulse, same directions as setGuide(), executed by the
+         * tick ISR. Returns false if the pulse can't be queued.
+         */
+        bool pulseGuide(int32_t sign, uint32_t perMille, uint32_t durationUs);
+        void clearPulseGuide();
+        PulseGuideQueue *getPulseGuideQueue() { return &_pulses; }
+
+        /* Gear backlash, in position units. Whenever the axis reverses,
+         * the motor first takes the backlash up with fast steps that don't
+         * count towards the position. With a preload direction set, the
+         * backlash is taken up towards it as soon as a GOTO ends, so
+         * tracking / guiding that way starts without any dead time.
+         */
+        void setBacklash(uint32_t backlash, SlewDirectionEnum preload);
+        uint32_t getBacklash() const { return _backlash; }
+        SlewDirectionEnum getBacklashPreload() const { return _preloadDir; }
+        // As SET / GET_BACKLASH have it (and the logs): 0 none, 1 CW, 2 CCW
+        static uint32_t preloadCode(SlewDirectionEnum preload)
+        {
+            return (preload == SlewDirectionEnum::CW) ? 1 : (preload == SlewDirectionEnum::CCW) ? 2 : 0;
+        }
+        bool saveBacklash();
+        bool isTakingUpBacklash() const { return _takeUpLeft > 0; }
+
+        /* Soft limits: the positions (as :j) the axis should stay
+         * between, saved to flash. Until they are set the whole turn
+         * is fine, wrapping around included.
+         */
+        void setLimits(uint32_t lower, uint32_t upper);
+        void clearLimits();
+        bool getLimits(uint32_t *lower, uint32_t *upper) const;
+        bool saveLimits();
+
+        /* Stops the axis from the tick ISR: down the ramp for GOTOs and
+         * fast slews, right away otherwise (as :K). Every step heading
+         * for a soft limit checks that the axis can still stop short
+         * of it. The reason stays until the next motion, or clearLimitStop().
+         */
+        void IRAM_ATTR halt(LimitStopEnum reason);
+        LimitStopEnum getLimitStop() const { return _limitStop; }
+        void clearLimitStop() { _limitStop = LimitStopEnum::NONE; }
+        // Where the axis would come to rest if halted now, after up to aheadSteps more steps
+        uint32_t IRAM_ATTR stoppingPosition(uint32_t aheadSteps);
+
+        /* Gear shifting: fast moves that ramp start at SLOW_MICROSTEPS
+         * and halve the microsteps (down to full steps) each time they
+         * speed up past half the pulse budget, up to maxSpeed position
+         * units / sec, then shift back on the way down. Microsteps only
+         * get coarser at a full step, where the driver's indexer is
+         * valid in every mode, so the position stays exact. Saved to
+         * flash, off until set.
+         */
+        void setGearShift(bool enabled, uint32_t maxSpeed);
+        bool getGearShift() const { return _gearShift; }
+        uint32_t getGearShiftSpeed() const { return _gearShiftSpeed; }
+        bool saveGearShift();
+        uint32_t getMicrosteps() const { return SLOW_MICROSTEPS / _unitsPerPulse; }
+        // Shifts during the last (or current) fast move
+        uint32_t getGearShifts() const { return _gearShifts; }
+        // Top speed of fast moves, in position units / sec
+        float fastTopSpeed() const;
 
         void IRAM_ATTR tick();
         void longTick();
 
-        bool useAccel() { return (_type == SlewTypeEnum::GOTO || _speed == SlewSpeedEnum::FAST); };
+        // Fast slews ramp, unless the velocity is set on the fly
+        bool useAccel() { return (_type == SlewTypeEnum::GOTO || (_speed == SlewSpeedEnum::FAST && !_velocityMode)); };
 
     private:
+        void _updateBaseIncrement();
+        void IRAM_ATTR _updateStepIncrement();
+        void IRAM_ATTR _updatePosition(SlewDirectionEnum dir);
+        void IRAM_ATTR _takeUp(SlewDirectionEnum dir);
+        void IRAM_ATTR _checkLimits(uint32_t aheadSteps = 0);
+        void IRAM_ATTR _setGear(uint32_t unitsPerPulse);
+        void IRAM_ATTR _shiftGear();
+        void IRAM_ATTR _advancePhase(SlewDirectionEnum dir);
+#ifdef RMT_STEP_OUTPUT
+        void _startRmt();
+        void IRAM_ATTR _syncRmt();
+#endif
+        bool _loadBacklash();
+        bool _loadLimits();
+        bool _loadGearShift();
+        void _updatePecTraining();
+        // Flash keys of the per-axis settings
+        const char *_nvsKey() const { return (_axis == AxisEnum::AXIS_DEC) ? "dec" : "ra"; }
+        static constexpr const char *BACKLASH_NVS_NAMESPACE = "backlash";
+        static constexpr const char *LIMITS_NVS_NAMESPACE = "limits";
+        static constexpr const char *GEAR_SHIFT_NVS_NAMESPACE = "gears";
+        // Steps to spare when ramping down short of a soft limit
+        static const int32_t LIMIT_SPARE_STEPS = 6;
+        // Pulse rates (fractions of the max speed) to shift up / down at, far enough apart not to hunt
+        static constexpr float GEAR_UP_RATE = 0.5f;
+        static constexpr float GEAR_DOWN_RATE = 0.2f;
+
         AxisEnum _axis;
         uint8_t _M0;
         uint8_t _M1;
@@ -77,22 +205,83 @@ namespace SynScanControl
         uint8_t _DIR;
 
         InterruptStepper _stepper;
+        PecTable _pec;
+        PecTrainer _pecTrainer;
+        bool _pecTraining = false;
+        bool _pecSavePending = false;
+        TraceRecorder *_trace;
         Logger *_logger;
 
         uint32_t _ticker = 0;
         bool _moving = false;
         bool _toStop = false;
 
-        uint32_t _pecPeriod = 0;
         uint32_t _stepPeriod = 6;
+        TrackingRateEnum _trackingRate = TrackingRateEnum::HOST;
+        bool _velocityMode = false;
+        uint32_t _velocityIncrement = 0;
+        int32_t _clockErrorPpb = 0;
+
+        // Tracking steps are taken whenever this phase accumulator wraps around,
+        // its increment is the step rate (2^32 / step period) plus the PEC correction
+        uint32_t _stepPhase = 0;
+        uint32_t _baseIncrement = 0;
+        volatile uint32_t _stepIncrement = 0;
+
+        // ST-4 guide rate (same Q32 increment units), and guide steps of a stopped axis
+        uint32_t _guideDelta = 0;
+        volatile int32_t _guideSign = 0;
+        uint32_t _guidePhase = 0;
+        uint32_t _guideIncrement = 0;
+
+        // Timed guide pulses, and the direction the DIR pin was set to for them
+        PulseGuideQueue _pulses;
+        int32_t _pulseSign = 0;
+
+        // Backlash, the direction the gears were last driven in, and the take-up in progress
+        uint32_t _backlash = 0;
+        SlewDirectionEnum _preloadDir = SlewDirectionEnum::NONE;
+        volatile SlewDirectionEnum _loadedDir = SlewDirectionEnum::NONE;
+        volatile uint32_t _takeUpLeft = 0;
+        uint32_t _takeUpTicker = 0;
         volatile uint32_t _position = 0x800000;
         uint32_t _maxPosition = _position + MICROSTEPS_PER_REV / 2;
         uint32_t _minPosition = _position - MICROSTEPS_PER_REV / 2;
         uint32_t _targetPosition = POSITION_INFINITE;
+        bool _limited = false;
+        uint32_t _lowerLimit = 0;
+        uint32_t _upperLimit = 0;
+        volatile bool _halting = false;
+        volatile LimitStopEnum _limitStop = LimitStopEnum::NONE;
+
+        // Ramp of fast moves (pulses), and the gear: position units per pulse
+        float _rampAccel = MOTOR_ACCEL;
+        float _rampMaxSpeed = MAX_PULSE_PER_SECOND / 2;
+        volatile uint32_t _unitsPerPulse = 1;
+        // Where the driver's indexer is within a full step, in position units
+        uint32_t _driverPhase = 0;
+        bool _gearShift = false;
+        uint32_t _gearShiftSpeed = DEFAULT_GEAR_SHIFT_SPEED;
+        // Shifting during this move, and the units to go the gear can't step
+        bool _shifting = false;
+        int32_t _shiftRest = 0;
+        volatile uint32_t _gearShifts = 0;
+
+#ifdef RMT_STEP_OUTPUT
+        // Ramps pulsed out by the RMT: the steps counted so far, and where the stepper started
+        RmtStepOutput _rmt;
+        bool _rmtReady = false;
+        volatile bool _rmtActive = false;
+        uint32_t _rmtSteps = 0;
+        int32_t _rmtStart = 0;
+#endif
 
         SlewTypeEnum _type = SlewTypeEnum::NONE;
         SlewSpeedEnum _speed = SlewSpeedEnum::NONE;
         SlewDirectionEnum _dir = SlewDirectionEnum::NONE;
+
+        // Direction changes of a running axis, against the tick ISR
+        portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
     };
 } // namespace SynScanControl
 
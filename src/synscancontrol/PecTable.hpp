@@ -0,0 +1,145 @@
+/*
+ * Project Name: synscancontrol
+ * File: PecTable.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Periodic error correction table, indexed by worm phase
+ */
+#ifndef PEC_TABLE_H
+#define PEC_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+#include "FlashSettings.hpp"
+
+namespace SynScanControl
+{
+    /* Rate corrections over one revolution of the worm.
+     *
+     * The worm revolution is split into NUM_BINS bins, each holding the
+     * correction to apply to the tracking rate at the start of that bin,
+     * as a Q15 fraction of the rate (e.g. +328 = run 1% faster). Between
+     * bins the correction is interpolated linearly. The worm phase comes
+     * straight from the axis position, so the table stays in sync with
+     * the worm across GOTOs and power cycles (as long as the position is).
+     *
+     * correctionAt() is only a multiply, a modulo and a few adds, cheap
+     * enough to be called by the tick ISR on every step.
+     */
+    class PecTable
+    {
+    public:
+        static const uint32_t NUM_BINS = 128;
+        // Corrections are clamped to +/-50% of the tracking rate
+        static const int32_t MAX_CORRECTION = 16384;
+
+        PecTable() { clear(); }
+
+        void clear()
+        {
+            memset(_entries, 0, sizeof(_entries));
+            _valid = false;
+            _enabled = false;
+        }
+
+        // Setting any entry makes the table valid
+        void setEntry(uint32_t bin, int32_t correction)
+        {
+            if (bin >= NUM_BINS)
+                return;
+            if (correction > MAX_CORRECTION)
+                correction = MAX_CORRECTION;
+            else if (correction < -MAX_CORRECTION)
+                correction = -MAX_CORRECTION;
+            _entries[bin] = (int16_t)correction;
+            _valid = true;
+        }
+
+        int32_t getEntry(uint32_t bin) const { return (bin < NUM_BINS) ? _entries[bin] : 0; }
+        bool isValid() const { return _valid; }
+
+        // Playback only happens with a valid table
+        void setEnabled(bool enabled) { _enabled = enabled && _valid; }
+        bool isEnabled() const { return _enabled; }
+
+        /* Keep the table in flash (NVS) under the given key, saving an
+         * invalid (cleared) table erases it. Playback is never enabled
+         * by load(), that is left to the client.
+         */
+        bool save(const char *key) const
+        {
+            if (_valid)
+                return FlashSettings::save(NVS_NAMESPACE, key, _entries, sizeof(_entries));
+            return FlashSettings::erase(NVS_NAMESPACE, key);
+        }
+
+        bool load(const char *key)
+        {
+            bool ok = FlashSettings::load(NVS_NAMESPACE, key, _entries, sizeof(_entries));
+            _valid = ok;
+            _enabled = false;
+            return ok;
+        }
+
+        // Worm period in position units, rounded (the exact one is MICROSTEPS_PER_REV / WORM_TEETH)
+        static uint32_t getPeriod() { return (MICROSTEPS_PER_REV + WORM_TEETH / 2) / WORM_TEETH; }
+
+        // Bin covering the given position
+        static uint32_t getBin(uint32_t position) { return _binPosition(position) >> FRAC_BITS; }
+
+        // Interpolated Q15 correction at the given position, 0 if disabled
+        inline int32_t IRAM_ATTR correctionAt(uint32_t position) const
+        {
+            if (!_enabled)
+                return 0;
+            uint32_t binPosition = _binPosition(position);
+            uint32_t bin = binPosition >> FRAC_BITS;
+            int32_t frac = binPosition & ((1 << FRAC_BITS) - 1);
+            int32_t a = _entries[bin];
+            int32_t b = _entries[(bin + 1) % NUM_BINS];
+            return a + (((b - a) * frac) >> FRAC_BITS);
+        }
+
+    private:
+        static constexpr const char *NVS_NAMESPACE = "pec";
+
+        // Fractional bits of the position within a bin
+        static const uint32_t FRAC_BITS = 8;
+        // (worm phase in [0, MICROSTEPS_PER_REV)) * PHASE_SCALE >> 32 = bin << FRAC_BITS | fraction
+        static constexpr uint32_t PHASE_SCALE = (uint32_t)((((uint64_t)NUM_BINS << (32 + FRAC_BITS)) + MICROSTEPS_PER_REV - 1) / MICROSTEPS_PER_REV);
+
+        static inline uint32_t IRAM_ATTR _binPosition(uint32_t position)
+        {
+            // Positions are 24 bits and the worm has less than 256 teeth, so this can't overflow
+            uint32_t phase = (position * WORM_TEETH) % MICROSTEPS_PER_REV;
+            uint32_t binPosition = (uint32_t)(((uint64_t)phase * PHASE_SCALE) >> 32);
+            return (binPosition < (NUM_BINS << FRAC_BITS)) ? binPosition : (NUM_BINS << FRAC_BITS) - 1;
+        }
+
+        int16_t _entries[NUM_BINS];
+        volatile bool _valid = false;
+        volatile bool _enabled = false;
+    };
+} // namespace SynScanControl
+
+#endif /* PEC_TABLE_H */
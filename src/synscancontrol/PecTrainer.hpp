@@ -0,0 +1,185 @@
+/*
+ * Project Name: synscancontrol
+ * File: PecTrainer.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Records the worm's periodic error while tracking and fits a PEC table to it
+ */
+#ifndef PEC_TRAINER_H
+#define PEC_TRAINER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Constants.hpp"
+#include "PecTable.hpp"
+
+namespace SynScanControl
+{
+    /* PEC training: while tracking (and being guided), the rate the axis
+     * actually moves at is recorded against the worm phase, then reduced
+     * to a PEC table.
+     *
+     * update() is called from the loop with the axis position and time.
+     * Each interval between two updates adds its steps and duration to
+     * the bin of the worm phase it ends in, so whatever moved the axis
+     * (guiding through rate changes, pulse guiding, ...) is captured.
+     * After enough worm cycles, fit() turns the per-bin rates into
+     * corrections relative to the mean rate and smooths them with a
+     * Fourier series of the first NUM_HARMONICS harmonics of the worm,
+     * all in fixed point. The mean rate itself (i.e. a tracking rate
+     * error) is not part of the table.
+     */
+    class PecTrainer
+    {
+    public:
+        static const uint32_t NUM_HARMONICS = 4;
+
+        PecTrainer() { reset(); }
+
+        void reset()
+        {
+            memset(_steps, 0, sizeof(_steps));
+            memset(_time, 0, sizeof(_time));
+            _totalSteps = 0;
+            _hasLast = false;
+        }
+
+        // Add the movement since the last update, only call while tracking
+        void update(uint32_t position, uint32_t micros)
+        {
+            if (_hasLast)
+            {
+                int32_t delta = (int32_t)(position - _lastPosition);
+                if (delta > (int32_t)MICROSTEPS_PER_REV / 2)
+                    delta -= MICROSTEPS_PER_REV;
+                else if (delta < -(int32_t)MICROSTEPS_PER_REV / 2)
+                    delta += MICROSTEPS_PER_REV;
+                uint32_t bin = PecTable::getBin(position);
+                _steps[bin] += (delta < 0) ? -delta : delta;
+                _time[bin] += micros - _lastMicros;
+                _totalSteps += (delta < 0) ? -delta : delta;
+            }
+            _lastPosition = position;
+            _lastMicros = micros;
+            _hasLast = true;
+        }
+
+        // The next update() starts a new interval (e.g. after the axis stopped tracking)
+        void pause() { _hasLast = false; }
+
+        // Steps recorded so far, in worm cycles
+        uint32_t getCycles() const { return _totalSteps / PecTable::getPeriod(); }
+
+        // Whether every bin has been recorded at least once
+        bool isComplete() const
+        {
+            for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+            {
+                if (!_time[i] || !_steps[i])
+                    return false;
+            }
+            return true;
+        }
+
+        // Fit the recorded rates into the table, returns false if some bin is missing
+        bool fit(PecTable *table) const
+        {
+            if (!isComplete())
+                return false;
+
+            uint64_t totalTime = 0;
+            for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+                totalTime += _time[i];
+
+            // Q15 rate of each bin relative to the mean rate, minus one
+            int32_t rates[PecTable::NUM_BINS];
+            for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+            {
+                uint64_t ratio = (uint64_t)_steps[i] * totalTime / _time[i];
+                rates[i] = (int32_t)((ratio << 15) / _totalSteps) - 32768;
+            }
+
+            /* Fourier coefficients (Q15). The rates are averages over their
+             * bin, so they are taken at the bin centers, i.e. odd indices of
+             * a 2 * NUM_BINS point circle, while the table entries are at
+             * the start of each bin (even indices).
+             */
+            int32_t a[NUM_HARMONICS + 1];
+            int32_t b[NUM_HARMONICS + 1];
+            for (uint32_t k = 1; k <= NUM_HARMONICS; k++)
+            {
+                int64_t sumCos = 0;
+                int64_t sumSin = 0;
+                for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+                {
+                    uint32_t angle = (2 * i + 1) * k;
+                    sumCos += (int64_t)rates[i] * _cos(angle);
+                    sumSin += (int64_t)rates[i] * _sin(angle);
+                }
+                // 2 / NUM_BINS * sum, back from Q30 to Q15
+                a[k] = (int32_t)((sumCos * 2 / (int64_t)PecTable::NUM_BINS + (1 << 14)) >> 15);
+                b[k] = (int32_t)((sumSin * 2 / (int64_t)PecTable::NUM_BINS + (1 << 14)) >> 15);
+            }
+
+            for (uint32_t i = 0; i < PecTable::NUM_BINS; i++)
+            {
+                int32_t value = 0;
+                for (uint32_t k = 1; k <= NUM_HARMONICS; k++)
+                {
+                    uint32_t angle = 2 * i * k;
+                    value += (int32_t)(((int64_t)a[k] * _cos(angle) + (int64_t)b[k] * _sin(angle) + (1 << 14)) >> 15);
+                }
+                table->setEntry(i, value);
+            }
+            return true;
+        }
+
+    private:
+        // Q15 sine / cosine of angle * 2 pi / 256 (i.e. 2 * NUM_BINS)
+        static int32_t _sin(uint32_t angle)
+        {
+            static const int16_t QUARTER_SINE[65] = {
+                0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739, 9512,
+                10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868,
+                19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319,
+                26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113,
+                31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767};
+            angle &= 2 * PecTable::NUM_BINS - 1;
+            if (angle < 64)
+                return QUARTER_SINE[angle];
+            else if (angle < 128)
+                return QUARTER_SINE[128 - angle];
+            else if (angle < 192)
+                return -QUARTER_SINE[angle - 128];
+            return -QUARTER_SINE[256 - angle];
+        }
+
+        static int32_t _cos(uint32_t angle) { return _sin(angle + PecTable::NUM_BINS / 2); }
+
+        uint32_t _steps[PecTable::NUM_BINS];
+        uint32_t _time[PecTable::NUM_BINS];
+        uint32_t _totalSteps = 0;
+        uint32_t _lastPosition = 0;
+        uint32_t _lastMicros = 0;
+        bool _hasLast = false;
+    };
+} // namespace SynScanControl
+
+#endif /* PEC_TRAINER_H */
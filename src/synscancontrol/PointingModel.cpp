@@ -0,0 +1,185 @@
+/*
+ * Project Name: synscancontrol
+ * File: PointingModel.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Alignment stars and the pointing model fitted to them
+ */
+#include <math.h>
+#include <string.h>
+
+#include "FlashSettings.hpp"
+#include "PointingModel.hpp"
+
+using namespace SynScanControl;
+
+PointingModel::Saved PointingModel::_saved;
+
+static const float RAD_PER_Q32 = 1.46291808e-9f;
+static const float ARCSEC_PER_Q32 = 3.01748514e-4f;
+static const float Q32_PER_ARCSEC = 3313.97867f;
+
+// Keeps the hour angle correction finite at the pole (89.4 degrees)
+static const float MIN_COS_DEC = 0.01f;
+
+void PointingModel::addStar(int32_t ha, int32_t dec, int32_t mountHa, int32_t mountDec, PierSideEnum side)
+{
+    // Full: the oldest star makes room
+    Star &star = _stars[_next];
+    _next = (_next + 1) % MAX_STARS;
+    if (_count < MAX_STARS)
+        _count++;
+
+    star.ha = ha * RAD_PER_Q32;
+    star.dec = dec * RAD_PER_Q32;
+    star.dHa = (int32_t)((uint32_t)mountHa - (uint32_t)ha) * ARCSEC_PER_Q32;
+    star.dDec = (int32_t)((uint32_t)mountDec - (uint32_t)dec) * ARCSEC_PER_Q32;
+    star.side = (side == PierSideEnum::WEST) ? -1 : 1;
+}
+
+void PointingModel::clear()
+{
+    _count = 0;
+    _next = 0;
+    for (uint32_t i = 0; i < NUM_TERMS; i++)
+        _terms[i] = 0;
+    _rms = 0;
+}
+
+// Design matrix rows of a star: hour angle (on the sky) and Dec
+void PointingModel::_rows(float ha, float dec, int8_t side, float *haRow, float *decRow)
+{
+    float sinHa = sinf(ha);
+    float cosHa = cosf(ha);
+    float sinDec = sinf(dec);
+    float cosDec = cosf(dec);
+
+    haRow[IH] = cosDec;
+    haRow[ID] = 0;
+    haRow[CH] = side;
+    haRow[NP] = side * sinDec;
+    haRow[MA] = -cosHa * sinDec;
+    haRow[ME] = sinHa * sinDec;
+
+    decRow[IH] = 0;
+    decRow[ID] = side;
+    decRow[CH] = 0;
+    decRow[NP] = 0;
+    decRow[MA] = sinHa;
+    decRow[ME] = cosHa;
+}
+
+void PointingModel::_offsets(float ha, float dec, int8_t side, float *dHa, float *dDec) const
+{
+    float haRow[NUM_TERMS];
+    float decRow[NUM_TERMS];
+    _rows(ha, dec, side, haRow, decRow);
+    float onSky = 0;
+    *dDec = 0;
+    for (uint32_t i = 0; i < NUM_TERMS; i++)
+    {
+        onSky += haRow[i] * _terms[i];
+        *dDec += decRow[i] * _terms[i];
+    }
+    *dHa = onSky / fmaxf(cosf(dec), MIN_COS_DEC);
+}
+
+bool PointingModel::fit()
+{
+    if (_count == 0)
+        return false;
+
+    LeastSquares<float, NUM_TERMS> ls;
+    float haRow[NUM_TERMS];
+    float decRow[NUM_TERMS];
+    for (uint32_t i = 0; i < _count; i++)
+    {
+        const Star &star = _stars[i];
+        _rows(star.ha, star.dec, star.side, haRow, decRow);
+        ls.add(haRow, star.dHa * cosf(star.dec));
+        ls.add(decRow, star.dDec);
+    }
+
+    const bool free[NUM_TERMS] = {true, true, _count >= 3, _count >= 3, _count >= 2, _count >= 2};
+    float terms[NUM_TERMS];
+    if (!ls.solve(terms, free))
+        return false;
+    for (uint32_t i = 0; i < NUM_TERMS; i++)
+        _terms[i] = terms[i];
+
+    float sum = 0;
+    for (uint32_t i = 0; i < _count; i++)
+    {
+        const Star &star = _stars[i];
+        float dHa = 0;
+        float dDec = 0;
+        _offsets(star.ha, star.dec, star.side, &dHa, &dDec);
+        float haResidual = (star.dHa - dHa) * cosf(star.dec);
+        sum += haResidual * haResidual + (star.dDec - dDec) * (star.dDec - dDec);
+    }
+    _rms = sqrtf(sum / _count);
+    return true;
+}
+
+void PointingModel::apply(int32_t ha, int32_t dec, PierSideEnum side, int32_t *mountHa, int32_t *mountDec) const
+{
+    float dHa = 0;
+    float dDec = 0;
+    _offsets(ha * RAD_PER_Q32, dec * RAD_PER_Q32, (side == PierSideEnum::WEST) ? -1 : 1, &dHa, &dDec);
+    *mountHa = (int32_t)((uint32_t)ha + (uint32_t)(int32_t)lrintf(dHa * Q32_PER_ARCSEC));
+    *mountDec = (int32_t)((uint32_t)dec + (uint32_t)(int32_t)lrintf(dDec * Q32_PER_ARCSEC));
+}
+
+// The corrections change slowly over the sky, a couple of iterations are plenty
+void PointingModel::unapply(int32_t mountHa, int32_t mountDec, PierSideEnum side, int32_t *ha, int32_t *dec) const
+{
+    *ha = mountHa;
+    *dec = mountDec;
+    for (int i = 0; i < 3; i++)
+    {
+        int32_t h = 0;
+        int32_t d = 0;
+        apply(*ha, *dec, side, &h, &d);
+        *ha = (int32_t)((uint32_t)*ha + ((uint32_t)mountHa - (uint32_t)h));
+        *dec = (int32_t)((uint32_t)*dec + ((uint32_t)mountDec - (uint32_t)d));
+    }
+}
+
+bool PointingModel::save() const
+{
+    memcpy(_saved.terms, _terms, sizeof(_terms));
+    _saved.rms = _rms;
+    _saved.count = _count;
+    _saved.next = _next;
+    memcpy(_saved.stars, _stars, sizeof(_stars));
+    return FlashSettings::save(NVS_NAMESPACE, NVS_KEY, &_saved, sizeof(_saved));
+}
+
+bool PointingModel::load()
+{
+    if (!FlashSettings::load(NVS_NAMESPACE, NVS_KEY, &_saved, sizeof(_saved)) || _saved.count > MAX_STARS ||
+        _saved.next >= MAX_STARS)
+        return false;
+    memcpy(_terms, _saved.terms, sizeof(_terms));
+    _rms = _saved.rms;
+    _count = _saved.count;
+    _next = _saved.next;
+    memcpy(_stars, _saved.stars, sizeof(_stars));
+    return true;
+}
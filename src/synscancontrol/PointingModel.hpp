@@ -0,0 +1,124 @@
+/*
+ * Project Name: synscancontrol
+ * File: PointingModel.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Alignment stars and the pointing model fitted to them
+ */
+#ifndef POINTING_MODEL_H
+#define POINTING_MODEL_H
+
+#include <stdint.h>
+
+#include "CelestialTransform.hpp"
+#include "Enums.hpp"
+#include "LeastSquares.hpp"
+
+namespace SynScanControl
+{
+    /* The standard six term pointing model of an equatorial mount (as
+     * in TPOINT), fitted to alignment stars: where the star really was
+     * (hour angle / Dec) against where the axes said the telescope was
+     * pointing once it was centered.
+     *
+     *   dH cos(Dec) = IH cos(Dec) + CH p + NP p sin(Dec) - MA cos(H) sin(Dec) + ME sin(H) sin(Dec)
+     *   dDec        = ID p + MA sin(H) + ME cos(H)
+     *
+     * with p = 1 east of the pier, -1 west: the Dec index, cone and
+     * non-perpendicularity errors mirror when the telescope flips. The
+     * model is linear in the terms, so a fit is a 6x6 least squares
+     * solve, with the stars kept in a fixed array. Terms are in arcsec.
+     */
+    class PointingModel
+    {
+    public:
+        static const uint32_t MAX_STARS = 50;
+
+        enum Term
+        {
+            IH = 0, // HA index error
+            ID,     // Dec index error
+            CH,     // Cone error (optical axis not square to the Dec axis)
+            NP,     // HA / Dec axes not perpendicular
+            MA,     // Polar axis left / right of the pole
+            ME,     // Polar axis above / below the pole
+            NUM_TERMS
+        };
+
+        // Angles in Q32 turns: the star's true hour angle / Dec, and where the axes say they point
+        void addStar(int32_t ha, int32_t dec, int32_t mountHa, int32_t mountDec, PierSideEnum side);
+        uint32_t getStarCount() const { return _count; }
+        void clear();
+
+        /* Refits the terms from the stars: index errors from the first
+         * star, polar alignment from the second, all six from the third.
+         */
+        bool fit();
+        float getTerm(Term term) const { return _terms[term]; }
+        void setTerm(Term term, float arcsec) { _terms[term] = arcsec; }
+        // On-sky RMS of the stars left after the fit, arcsec
+        float getRms() const { return _rms; }
+
+        // True hour angle / Dec to what the axes should read, and back
+        void apply(int32_t ha, int32_t dec, PierSideEnum side, int32_t *mountHa, int32_t *mountDec) const;
+        void unapply(int32_t mountHa, int32_t mountDec, PierSideEnum side, int32_t *ha, int32_t *dec) const;
+
+        /* The terms and the stars they were fitted to, in flash: a star
+         * added after a reboot refits from all of them, not from itself.
+         */
+        bool save() const;
+        bool load();
+
+    private:
+        struct Star
+        {
+            float ha;  // True position, radians
+            float dec;
+            float dHa; // Axes minus true, arcsec (on the HA axis, not on the sky)
+            float dDec;
+            int8_t side;
+        };
+
+        // One blob, the terms always go with their stars
+        struct Saved
+        {
+            float terms[NUM_TERMS];
+            float rms;
+            uint32_t count;
+            uint32_t next;
+            Star stars[MAX_STARS];
+        };
+        // About 1 KB, kept off the loop task's stack
+        static Saved _saved;
+
+        static constexpr const char *NVS_NAMESPACE = "model";
+        static constexpr const char *NVS_KEY = "stars";
+
+        static void _rows(float ha, float dec, int8_t side, float *haRow, float *decRow);
+        void _offsets(float ha, float dec, int8_t side, float *dHa, float *dDec) const;
+
+        Star _stars[MAX_STARS];
+        uint32_t _count = 0;
+        uint32_t _next = 0;
+        float _terms[NUM_TERMS] = {0, 0, 0, 0, 0, 0};
+        float _rms = 0;
+    };
+} // namespace SynScanControl
+
+#endif /* POINTING_MODEL_H */
@@ -51,9 +51,7 @@ namespace SynScanControl
         void setBrightness(uint8_t pwm)
         {
             // Log
-            std::ostringstream log;
-            log << "Setting polar scope LED PWM to: 0x" << std::hex << int(pwm);
-            _logger->debug(&log);
+            _logger->debug(LogMsg::POLAR_LED_BRIGHTNESS, int(pwm));
 
             ledcWrite(_pwm_channel, pwm);
         }
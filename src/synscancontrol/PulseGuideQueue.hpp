@@ -0,0 +1,152 @@
+/*
+ * Project Name: synscancontrol
+ * File: PulseGuideQueue.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Timed guide pulses executed by the tick ISR
+ */
+#ifndef PULSE_GUIDE_QUEUE_H
+#define PULSE_GUIDE_QUEUE_H
+
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+
+namespace SynScanControl
+{
+    /* Timed guide pulses, queued from the loop and played out by the tick ISR.
+     *
+     * A pulse is a rate offset (an increment for the motor's Q32 phase
+     * accumulator, signed) held for a duration. next() is called once per
+     * tick and returns the offset to add to that tick's increment. The
+     * tick a pulse ends in only gets the fraction of the offset covering
+     * the rest of the pulse, the next pulse picks up the remainder of the
+     * tick, so the correction applied matches the duration to the
+     * microsecond rather than to the tick.
+     *
+     * A pulse in the same direction and at the same rate as the last one
+     * queued (possibly the one playing) is merged into it, anything else
+     * waits its turn. The queue is only modified with the tick ISR masked,
+     * the ISR itself never waits on it.
+     */
+    class PulseGuideQueue
+    {
+    public:
+        static const uint8_t SIZE = 8;
+
+        // Returns false if the queue is full
+        bool push(int32_t offset, uint32_t durationUs)
+        {
+            bool success = true;
+            portENTER_CRITICAL(&_mux);
+            if (_count > 0 && _pulses[_last()].offset == offset)
+            {
+                _pulses[_last()].durationUs += durationUs;
+            }
+            else if (_count < SIZE)
+            {
+                _pulses[(_head + _count) % SIZE] = {offset, durationUs};
+                _count++;
+            }
+            else
+            {
+                success = false;
+            }
+            portEXIT_CRITICAL(&_mux);
+            return success;
+        }
+
+        void clear()
+        {
+            portENTER_CRITICAL(&_mux);
+            _count = 0;
+            _elapsedUs = 0;
+            portEXIT_CRITICAL(&_mux);
+        }
+
+        bool isActive() const { return _count > 0; }
+
+        // Time left until the queue is empty
+        uint32_t getRemainingUs()
+        {
+            uint32_t remaining = 0;
+            portENTER_CRITICAL(&_mux);
+            for (uint8_t i = 0; i < _count; i++)
+                remaining += _pulses[(_head + i) % SIZE].durationUs;
+            remaining -= _elapsedUs;
+            portEXIT_CRITICAL(&_mux);
+            return remaining;
+        }
+
+        // Pulses played out to the end
+        uint32_t getCompleted() const { return _completed; }
+
+        // Offset to apply over the next tick
+        int32_t IRAM_ATTR next()
+        {
+            int32_t total = 0;
+            uint32_t tickLeft = TICK_PERIOD_US;
+            while (_count > 0 && tickLeft > 0)
+            {
+                Pulse &pulse = _pulses[_head];
+                uint32_t left = pulse.durationUs - _elapsedUs;
+                if (left > tickLeft)
+                {
+                    _elapsedUs += tickLeft;
+                    total += (tickLeft == TICK_PERIOD_US) ? pulse.offset : _fraction(pulse.offset, tickLeft);
+                    break;
+                }
+
+                // The pulse ends within this tick
+                total += _fraction(pulse.offset, left);
+                tickLeft -= left;
+                _elapsedUs = 0;
+                _head = (_head + 1) % SIZE;
+                _count--;
+                _completed++;
+            }
+            return total;
+        }
+
+    private:
+        struct Pulse
+        {
+            int32_t offset;
+            uint32_t durationUs;
+        };
+
+        uint8_t _last() const { return (_head + _count - 1) % SIZE; }
+
+        static int32_t IRAM_ATTR _fraction(int32_t offset, uint32_t us)
+        {
+            return (int32_t)((int64_t)offset * us / TICK_PERIOD_US);
+        }
+
+        Pulse _pulses[SIZE];
+        uint8_t _head = 0;
+        volatile uint8_t _count = 0;
+        uint32_t _elapsedUs = 0;
+        volatile uint32_t _completed = 0;
+        portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    };
+} // namespace SynScanControl
+
+#endif /* PULSE_GUIDE_QUEUE_H */
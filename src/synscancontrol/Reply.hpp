@@ -25,6 +25,7 @@
 #define REPLY_H
 
 #include <Arduino.h>
+#include <sstream>
 
 #include "HexConversionUtils.hpp"
 
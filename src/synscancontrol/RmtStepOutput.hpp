@@ -0,0 +1,182 @@
+/*
+ * Project Name: synscancontrol
+ * File: RmtStepOutput.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Provides optional step pulses from the ESP32's RMT peripheral
+ */
+#ifndef RMT_STEP_OUTPUT_H
+#define RMT_STEP_OUTPUT_H
+
+#ifdef RMT_STEP_OUTPUT
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <rom/gpio.h>
+#include <soc/gpio_sig_map.h>
+
+#include "InterruptStepper.hpp"
+#include "StepSegments.hpp"
+
+namespace SynScanControl
+{
+    static_assert(sizeof(RmtItem) == sizeof(rmt_item32_t), "RmtItem must match rmt_item32_t");
+
+    /* Pulses an axis' STEP pin from an RMT channel for the length of a
+     * ramp, so step timing no longer rounds to the tick ISR period and
+     * step rates above MAX_PULSE_PER_SECOND are possible. The RMT
+     * driver's interrupt asks for half a memory block of items at a
+     * time, those are planned off the stepper's ramp there and then
+     * (under the motor's mux): the stepper's position runs up to a
+     * segment ahead of the steps encoded, which run up to a memory
+     * block ahead of the STEP pin.
+     *
+     * The pin belongs to the RMT from start() until release(), and to
+     * the GPIO matrix (the tick ISR) otherwise. One channel per axis.
+     * Everything the translator calls is in IRAM (StepPlanner::next,
+     * StepEncoder, the stepper's ramp), as for the tick ISR.
+     */
+    class RmtStepOutput
+    {
+    public:
+        static const uint32_t CHANNELS = 2;
+
+        RmtStepOutput() {};
+        RmtStepOutput(rmt_channel_t channel, uint8_t pin) : _channel(channel), _pin(pin) {};
+
+        bool begin()
+        {
+            if ((uint32_t)_channel >= CHANNELS)
+                return false;
+
+            rmt_config_t config = {};
+            config.rmt_mode = RMT_MODE_TX;
+            config.channel = _channel;
+            config.gpio_num = (gpio_num_t)_pin;
+            config.mem_block_num = 1;
+            config.clk_div = APB_CLK_FREQ / 1000000 / StepPlanner::TICKS_PER_US;
+            config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+            config.tx_config.idle_output_en = true;
+            if (rmt_config(&config) != ESP_OK || rmt_driver_install(_channel, 0, 0) != ESP_OK)
+                return false;
+
+            static const sample_to_rmt_t translators[CHANNELS] = {_translate<0>, _translate<1>};
+            if (rmt_translator_init(_channel, translators[_channel]) != ESP_OK)
+                return false;
+            _output(_channel) = this;
+            rmt_register_tx_end_callback(_txEnd, nullptr);
+
+            // rmt_config() took the pin, the tick ISR has it until start()
+            release();
+            return true;
+        }
+
+        /* Resets the train for the stepper's ramp, after leadSteps
+         * steps leadPeriodUs apart (a backlash take-up). Call with the
+         * mux held, before start(): the steps count from here.
+         */
+        void load(InterruptStepper *stepper, portMUX_TYPE *mux, uint32_t leadSteps, uint32_t leadPeriodUs)
+        {
+            _mux = mux;
+            _planner.begin(stepper);
+            _encoder.reset();
+            _lead = leadSteps;
+            if (leadSteps > 0)
+            {
+                StepSegment lead = {leadSteps, leadPeriodUs * StepPlanner::TICKS_PER_US * 256};
+                _encoder.load(lead);
+            }
+            _done = false;
+        }
+
+        void start()
+        {
+            rmt_set_pin(_channel, RMT_MODE_TX, (gpio_num_t)_pin);
+            // The translator pulls from the planner, not from this byte
+            rmt_write_sample(_channel, &_sample, 1, false);
+        }
+
+        void release()
+        {
+            gpio_matrix_out(_pin, SIG_GPIO_OUT_IDX, false, false);
+        }
+
+        // The last item went out
+        bool isDone() const { return _done; }
+        // Steps encoded so far, lead included
+        uint32_t getSteps() const { return _encoder.getSteps(); }
+        uint32_t getLead() const { return _lead; }
+        // The ramp went past its target: the steps back are the tick ISR's
+        bool turnsAround() const { return _planner.turnsAround(); }
+
+    private:
+        rmt_channel_t _channel = RMT_CHANNEL_0;
+        uint8_t _pin = 0;
+        portMUX_TYPE *_mux = nullptr;
+        StepPlanner _planner;
+        StepEncoder _encoder;
+        uint32_t _lead = 0;
+        volatile bool _done = true;
+        uint8_t _sample = 0;
+
+        static RmtStepOutput *&IRAM_ATTR _output(uint32_t channel)
+        {
+            static RmtStepOutput *outputs[CHANNELS] = {};
+            return outputs[channel];
+        }
+
+        // Translators don't get told their channel in this version of the driver
+        template <uint32_t CHANNEL>
+        static void IRAM_ATTR _translate(const void *, rmt_item32_t *dest, size_t, size_t wanted, size_t *translated, size_t *items)
+        {
+            _output(CHANNEL)->_fill((RmtItem *)dest, wanted, translated, items);
+        }
+
+        /* The driver keeps asking while there are whole blocks: fewer
+         * items than wanted end the train, and use up the sample.
+         */
+        void IRAM_ATTR _fill(RmtItem *dest, size_t wanted, size_t *translated, size_t *items)
+        {
+            uint32_t count = _encoder.fill(dest, wanted);
+            while (count < wanted)
+            {
+                StepSegment segment;
+                portENTER_CRITICAL(_mux);
+                bool more = _planner.next(&segment);
+                portEXIT_CRITICAL(_mux);
+                if (!more)
+                    break;
+                _encoder.load(segment);
+                count += _encoder.fill(dest + count, wanted - count);
+            }
+            *items = count;
+            *translated = (count < wanted) ? 1 : 0;
+        }
+
+        static void IRAM_ATTR _txEnd(rmt_channel_t channel, void *)
+        {
+            if ((uint32_t)channel < CHANNELS && _output(channel) != nullptr)
+                _output(channel)->_done = true;
+        }
+    };
+} // namespace SynScanControl
+
+#endif
+
+#endif /* RMT_STEP_OUTPUT_H */
@@ -0,0 +1,355 @@
+/*
+ * Project Name: synscancontrol
+ * File: Sgp4.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: SGP4 orbit propagation from two line elements
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Sgp4.hpp"
+
+using namespace SynScanControl;
+
+// WGS-72, which the elements are fitted with
+static const double RADIUS_KM = 6378.135;
+static const double MU = 398600.8;
+static const double J2 = 0.001082616;
+static const double J3 = -0.00000253881;
+static const double J4 = -0.00000165597;
+static const double J3OJ2 = J3 / J2;
+static const double TWO_PI = 6.283185307179586;
+static const double DEG = TWO_PI / 360.0;
+static const double X2O3 = 2.0 / 3.0;
+
+// sqrt(MU / RADIUS^3) in earth radii^1.5 per minute
+static const double XKE = 60.0 / sqrt(RADIUS_KM * RADIUS_KM * RADIUS_KM / MU);
+
+bool Sgp4::checksum(const char *line)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < LINE_LENGTH - 1; i++)
+    {
+        if (line[i] >= '0' && line[i] <= '9')
+            sum += line[i] - '0';
+        else if (line[i] == '-')
+            sum++;
+    }
+    return line[LINE_LENGTH - 1] == (char)('0' + sum % 10);
+}
+
+// Fixed columns (0 based), blanks around the number are fine
+bool Sgp4::_field(const char *line, uint32_t start, uint32_t length, double *value)
+{
+    char buffer[16];
+    if (length >= sizeof(buffer))
+        return false;
+    memcpy(buffer, line + start, length);
+    buffer[length] = '\0';
+
+    char *end = nullptr;
+    *value = strtod(buffer, &end);
+    if (end == buffer)
+        return false;
+    while (*end == ' ')
+        end++;
+    return *end == '\0';
+}
+
+// "-11606-4" style: sign, 5 digits with an implied leading decimal point, exponent
+bool Sgp4::_exponentField(const char *line, uint32_t start, double *value)
+{
+    double mantissa = 0;
+    double exponent = 0;
+    if (!_field(line, start + 1, 5, &mantissa) || !_field(line, start + 6, 2, &exponent))
+        return false;
+    *value = ((line[start] == '-') ? -mantissa : mantissa) * 1e-5 * pow(10.0, exponent);
+    return true;
+}
+
+// Two digit year (57-99 are 1900s) and day of the year, 1.0 being January 1st 0h
+double Sgp4::_epochFrom(uint32_t year, double day)
+{
+    year += (year < 57) ? 2000 : 1900;
+    auto leapYearsBefore = [](int32_t y)
+    { return (y - 1) / 4 - (y - 1) / 100 + (y - 1) / 400; };
+    int32_t days = 365 * ((int32_t)year - 2000) + leapYearsBefore(year) - leapYearsBefore(2000);
+
+    // J2000 is January 1st 2000, 12h
+    return (days + day - 1.5) * 86400000.0;
+}
+
+bool Sgp4::parse(const char *line1, const char *line2)
+{
+    _valid = false;
+    if (strlen(line1) < LINE_LENGTH || strlen(line2) < LINE_LENGTH || line1[0] != '1' || line2[0] != '2' ||
+        !checksum(line1) || !checksum(line2) || strncmp(line1 + 2, line2 + 2, 5) != 0)
+        return false;
+
+    double number = 0;
+    double year = 0;
+    double day = 0;
+    double ecc = 0;
+    double meanMotion = 0;
+    if (!_field(line1, 2, 5, &number) || !_field(line1, 18, 2, &year) || !_field(line1, 20, 12, &day) ||
+        !_exponentField(line1, 53, &_bstar) ||
+        !_field(line2, 8, 8, &_inclo) || !_field(line2, 17, 8, &_nodeo) || !_field(line2, 26, 7, &ecc) ||
+        !_field(line2, 34, 8, &_argpo) || !_field(line2, 43, 8, &_mo) || !_field(line2, 52, 11, &meanMotion) ||
+        meanMotion <= 0)
+        return false;
+
+    _catalogNumber = (uint32_t)number;
+    _epochMs = _epochFrom((uint32_t)year, day);
+    _inclo *= DEG;
+    _nodeo *= DEG;
+    _ecco = ecc * 1e-7;
+    _argpo *= DEG;
+    _mo *= DEG;
+    _noKozai = meanMotion * TWO_PI / 1440.0;
+
+    _valid = _init();
+    return _valid;
+}
+
+// sgp4init(), near earth part
+bool Sgp4::_init()
+{
+    // Un-Kozai the mean motion
+    double cosio = cos(_inclo);
+    double cosio2 = cosio * cosio;
+    double eccsq = _ecco * _ecco;
+    double omeosq = 1.0 - eccsq;
+    double rteosq = sqrt(omeosq);
+    double ak = pow(XKE / _noKozai, X2O3);
+    double d1 = 0.75 * J2 * (3.0 * cosio2 - 1.0) / (rteosq * omeosq);
+    double del = d1 / (ak * ak);
+    double adel = ak * (1.0 - del * del - del * (1.0 / 3.0 + 134.0 * del * del / 81.0));
+    del = d1 / (adel * adel);
+    _noUnkozai = _noKozai / (1.0 + del);
+
+    // Deep space
+    if (TWO_PI / _noUnkozai >= 225.0 || _ecco >= 1.0)
+        return false;
+
+    double ao = pow(XKE / _noUnkozai, X2O3);
+    double sinio = sin(_inclo);
+    double po = ao * omeosq;
+    double con42 = 1.0 - 5.0 * cosio2;
+    _con41 = -con42 - cosio2 - cosio2;
+    double posq = po * po;
+    double rp = ao * (1.0 - _ecco);
+
+    // Perigees under 220 km get the simplified drag terms
+    _isimp = rp < 220.0 / RADIUS_KM + 1.0;
+    double sfour = 78.0 / RADIUS_KM + 1.0;
+    double qzms24 = pow((120.0 - 78.0) / RADIUS_KM, 4);
+    double perige = (rp - 1.0) * RADIUS_KM;
+    if (perige < 156.0)
+    {
+        sfour = (perige < 98.0) ? 20.0 : perige - 78.0;
+        qzms24 = pow((120.0 - sfour) / RADIUS_KM, 4);
+        sfour = sfour / RADIUS_KM + 1.0;
+    }
+
+    double pinvsq = 1.0 / posq;
+    double tsi = 1.0 / (ao - sfour);
+    _eta = ao * _ecco * tsi;
+    double etasq = _eta * _eta;
+    double eeta = _ecco * _eta;
+    double psisq = fabs(1.0 - etasq);
+    double coef = qzms24 * pow(tsi, 4);
+    double coef1 = coef / pow(psisq, 3.5);
+    double cc2 = coef1 * _noUnkozai *
+                 (ao * (1.0 + 1.5 * etasq + eeta * (4.0 + etasq)) +
+                  0.375 * J2 * tsi / psisq * _con41 * (8.0 + 3.0 * etasq * (8.0 + etasq)));
+    _cc1 = _bstar * cc2;
+    double cc3 = (_ecco > 1.0e-4) ? -2.0 * coef * tsi * J3OJ2 * _noUnkozai * sinio / _ecco : 0.0;
+    _x1mth2 = 1.0 - cosio2;
+    _cc4 = 2.0 * _noUnkozai * coef1 * ao * omeosq *
+           (_eta * (2.0 + 0.5 * etasq) + _ecco * (0.5 + 2.0 * etasq) -
+            J2 * tsi / (ao * psisq) *
+                (-3.0 * _con41 * (1.0 - 2.0 * eeta + etasq * (1.5 - 0.5 * eeta)) +
+                 0.75 * _x1mth2 * (2.0 * etasq - eeta * (1.0 + etasq)) * cos(2.0 * _argpo)));
+    _cc5 = 2.0 * coef1 * ao * omeosq * (1.0 + 2.75 * (etasq + eeta) + eeta * etasq);
+
+    // Secular rates from J2 / J4
+    double cosio4 = cosio2 * cosio2;
+    double temp1 = 1.5 * J2 * pinvsq * _noUnkozai;
+    double temp2 = 0.5 * temp1 * J2 * pinvsq;
+    double temp3 = -0.46875 * J4 * pinvsq * pinvsq * _noUnkozai;
+    _mdot = _noUnkozai + 0.5 * temp1 * rteosq * _con41 + 0.0625 * temp2 * rteosq * (13.0 - 78.0 * cosio2 + 137.0 * cosio4);
+    _argpdot = -0.5 * temp1 * con42 + 0.0625 * temp2 * (7.0 - 114.0 * cosio2 + 395.0 * cosio4) +
+               temp3 * (3.0 - 36.0 * cosio2 + 49.0 * cosio4);
+    double xhdot1 = -temp1 * cosio;
+    _nodedot = xhdot1 + (0.5 * temp2 * (4.0 - 19.0 * cosio2) + 2.0 * temp3 * (3.0 - 7.0 * cosio2)) * cosio;
+    _omgcof = _bstar * cc3 * cos(_argpo);
+    _xmcof = (_ecco > 1.0e-4) ? -X2O3 * coef * _bstar / eeta : 0.0;
+    _nodecf = 3.5 * omeosq * xhdot1 * _cc1;
+    _t2cof = 1.5 * _cc1;
+
+    // Avoid a division by zero for 180 degree inclinations
+    double cosio1 = (fabs(cosio + 1.0) > 1.5e-12) ? 1.0 + cosio : 1.5e-12;
+    _xlcof = -0.25 * J3OJ2 * sinio * (3.0 + 5.0 * cosio) / cosio1;
+    _aycof = -0.5 * J3OJ2 * sinio;
+    _delmo = pow(1.0 + _eta * cos(_mo), 3);
+    _sinmao = sin(_mo);
+    _x7thm1 = 7.0 * cosio2 - 1.0;
+
+    if (!_isimp)
+    {
+        double cc1sq = _cc1 * _cc1;
+        _d2 = 4.0 * ao * tsi * cc1sq;
+        double temp = _d2 * tsi * _cc1 / 3.0;
+        _d3 = (17.0 * ao + sfour) * temp;
+        _d4 = 0.5 * temp * ao * tsi * (221.0 * ao + 31.0 * sfour) * _cc1;
+        _t3cof = _d2 + 2.0 * cc1sq;
+        _t4cof = 0.25 * (3.0 * _d3 + _cc1 * (12.0 * _d2 + 10.0 * cc1sq));
+        _t5cof = 0.2 * (3.0 * _d4 + 12.0 * _cc1 * _d3 + 6.0 * _d2 * _d2 + 15.0 * cc1sq * (2.0 * _d2 + cc1sq));
+    }
+    return true;
+}
+
+bool Sgp4::propagate(double t, double *r, double *v) const
+{
+    if (!_valid)
+        return false;
+
+    // Secular gravity and atmospheric drag
+    double xmdf = _mo + _mdot * t;
+    double argpdf = _argpo + _argpdot * t;
+    double nodedf = _nodeo + _nodedot * t;
+    double argpm = argpdf;
+    double mm = xmdf;
+    double t2 = t * t;
+    double nodem = nodedf + _nodecf * t2;
+    double tempa = 1.0 - _cc1 * t;
+    double tempe = _bstar * _cc4 * t;
+    double templ = _t2cof * t2;
+
+    if (!_isimp)
+    {
+        double delomg = _omgcof * t;
+        double delmtemp = 1.0 + _eta * cos(xmdf);
+        double delm = _xmcof * (delmtemp * delmtemp * delmtemp - _delmo);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2 * t;
+        double t4 = t3 * t;
+        tempa = tempa - _d2 * t2 - _d3 * t3 - _d4 * t4;
+        tempe = tempe + _bstar * _cc5 * (sin(mm) - _sinmao);
+        templ = templ + _t3cof * t3 + t4 * (_t4cof + t * _t5cof);
+    }
+
+    double am = pow(XKE / _noUnkozai, X2O3) * tempa * tempa;
+    double nm = XKE / pow(am, 1.5);
+    double em = _ecco - tempe;
+    if (em >= 1.0 || em < -0.001 || am < 0.95)
+        return false;
+    if (em < 1.0e-6)
+        em = 1.0e-6;
+    mm = mm + _noUnkozai * templ;
+    double xlm = mm + argpm + nodem;
+    nodem = fmod(nodem, TWO_PI);
+    argpm = fmod(argpm, TWO_PI);
+    xlm = fmod(xlm, TWO_PI);
+    mm = fmod(xlm - argpm - nodem, TWO_PI);
+
+    // Long period periodics
+    double sinip = sin(_inclo);
+    double cosip = cos(_inclo);
+    double axnl = em * cos(argpm);
+    double temp = 1.0 / (am * (1.0 - em * em));
+    double aynl = em * sin(argpm) + temp * _aycof;
+    double xl = mm + argpm + nodem + temp * _xlcof * axnl;
+
+    // Kepler's equation
+    double u = fmod(xl - nodem, TWO_PI);
+    double eo1 = u;
+    double tem5 = 9999.9;
+    double sineo1 = 0;
+    double coseo1 = 0;
+    for (int i = 0; i < 10 && fabs(tem5) >= 1.0e-12; i++)
+    {
+        sineo1 = sin(eo1);
+        coseo1 = cos(eo1);
+        tem5 = 1.0 - coseo1 * axnl - sineo1 * aynl;
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        if (fabs(tem5) >= 0.95)
+            tem5 = (tem5 > 0.0) ? 0.95 : -0.95;
+        eo1 = eo1 + tem5;
+    }
+
+    // Short period periodics
+    double ecose = axnl * coseo1 + aynl * sineo1;
+    double esine = axnl * sineo1 - aynl * coseo1;
+    double el2 = axnl * axnl + aynl * aynl;
+    double pl = am * (1.0 - el2);
+    if (pl < 0.0)
+        return false;
+    double rl = am * (1.0 - ecose);
+    double rdotl = sqrt(am) * esine / rl;
+    double rvdotl = sqrt(pl) / rl;
+    double betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = atan2(sinu, cosu);
+    double sin2u = (cosu + cosu) * sinu;
+    double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5 * J2 * temp;
+    double temp2 = temp1 * temp;
+
+    double mrt = rl * (1.0 - 1.5 * temp2 * betal * _con41) + 0.5 * temp1 * _x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * _x7thm1 * sin2u;
+    double xnode = nodem + 1.5 * temp2 * cosip * sin2u;
+    double xinc = _inclo + 1.5 * temp2 * cosip * sinip * cos2u;
+    double mvt = rdotl - nm * temp1 * _x1mth2 * sin2u / XKE;
+    double rvdot = rvdotl + nm * temp1 * (_x1mth2 * cos2u + 1.5 * _con41) / XKE;
+
+    // Orientation vectors
+    double sinsu = sin(su);
+    double cossu = cos(su);
+    double snod = sin(xnode);
+    double cnod = cos(xnode);
+    double sini = sin(xinc);
+    double cosi = cos(xinc);
+    double xmx = -snod * cosi;
+    double xmy = cnod * cosi;
+    double ux = xmx * sinsu + cnod * cossu;
+    double uy = xmy * sinsu + snod * cossu;
+    double uz = sini * sinsu;
+    double vx = xmx * cossu - cnod * sinsu;
+    double vy = xmy * cossu - snod * sinsu;
+    double vz = sini * cossu;
+
+    const double vkmpersec = RADIUS_KM * XKE / 60.0;
+    r[0] = mrt * ux * RADIUS_KM;
+    r[1] = mrt * uy * RADIUS_KM;
+    r[2] = mrt * uz * RADIUS_KM;
+    v[0] = (mvt * ux + rvdot * vx) * vkmpersec;
+    v[1] = (mvt * uy + rvdot * vy) * vkmpersec;
+    v[2] = (mvt * uz + rvdot * vz) * vkmpersec;
+
+    // Below the surface: decayed
+    return mrt >= 1.0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Project Name: synscancontrol
+ * File: Sgp4.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: SGP4 orbit propagation from two line elements
+ */
+#ifndef SGP4_H
+#define SGP4_H
+
+#include <stdint.h>
+
+namespace SynScanControl
+{
+    /* Near earth SGP4 (Vallado et al., "Revisiting Spacetrack Report
+     * #3", 2006, WGS-72 constants), the propagator two line elements are
+     * made for: position / velocity in the TEME frame at a given time.
+     * Deep space orbits (periods of 225 minutes and up, SDP4) are not
+     * supported, those don't move fast enough to need on-device tracking.
+     *
+     * Everything is in double precision: mean anomaly and node grow by
+     * thousands of radians a day, and single precision would already be
+     * kilometres off. On the ESP32 that is software floating point, one
+     * propagation takes well under a millisecond.
+     */
+    class Sgp4
+    {
+    public:
+        // A TLE line is 69 characters, the last one the checksum
+        static const uint32_t LINE_LENGTH = 69;
+
+        /* Both lines of a TLE. False (and no elements) on a format or
+         * checksum error, lines of different satellites or a deep space
+         * orbit.
+         */
+        bool parse(const char *line1, const char *line2);
+        bool isValid() const { return _valid; }
+        void clear() { _valid = false; }
+
+        uint32_t getCatalogNumber() const { return _catalogNumber; }
+        // Epoch in ms since J2000 (UTC)
+        double getEpoch() const { return _epochMs; }
+
+        /* Position (km) and velocity (km/s) this many minutes after the
+         * epoch. False once the orbit decayed or the elements blew up.
+         */
+        bool propagate(double minutes, double *r, double *v) const;
+
+        // The modulo 10 checksum in the last column of a TLE line
+        static bool checksum(const char *line);
+
+    private:
+        static bool _field(const char *line, uint32_t start, uint32_t length, double *value);
+        static bool _exponentField(const char *line, uint32_t start, double *value);
+        static double _epochFrom(uint32_t year, double day);
+        bool _init();
+
+        bool _valid = false;
+        uint32_t _catalogNumber = 0;
+        double _epochMs = 0;
+
+        // Mean elements at epoch (radians, radians / minute)
+        double _bstar = 0;
+        double _inclo = 0;
+        double _nodeo = 0;
+        double _ecco = 0;
+        double _argpo = 0;
+        double _mo = 0;
+        double _noKozai = 0;
+
+        // Set up by _init() from the elements
+        bool _isimp = false;
+        double _noUnkozai = 0;
+        double _aycof = 0, _con41 = 0, _cc1 = 0, _cc4 = 0, _cc5 = 0;
+        double _d2 = 0, _d3 = 0, _d4 = 0, _delmo = 0, _eta = 0;
+        double _argpdot = 0, _omgcof = 0, _sinmao = 0;
+        double _t2cof = 0, _t3cof = 0, _t4cof = 0, _t5cof = 0;
+        double _x1mth2 = 0, _x7thm1 = 0, _mdot = 0, _nodedot = 0;
+        double _xlcof = 0, _xmcof = 0, _nodecf = 0;
+    };
+} // namespace SynScanControl
+
+#endif /* SGP4_H */
@@ -0,0 +1,127 @@
+/*
+ * Project Name: synscancontrol
+ * File: StepSegments.cpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Step trains as segments of RMT items, planned from the stepper ramp
+ */
+#include <Arduino.h>
+#include <math.h>
+
+#include "StepSegments.hpp"
+
+using namespace SynScanControl;
+
+void StepPlanner::begin(InterruptStepper *stepper)
+{
+    _stepper = stepper;
+    _dir = stepper->getDirection();
+    _turnsAround = false;
+    _carry = 0;
+}
+
+// From the RMT interrupt, like everything it calls
+bool IRAM_ATTR StepPlanner::next(StepSegment *segment)
+{
+    uint32_t steps = 0;
+    uint64_t total = 0;
+    uint32_t first = 0;
+    while (steps < SEGMENT_STEPS && !_turnsAround && _stepper->getSpeed() != 0.0f)
+    {
+        uint32_t period = (uint32_t)(_stepper->getCn() * (TICKS_PER_US * 256.0f) + 0.5f);
+        if (steps == 0)
+            first = period;
+        else if ((uint32_t)abs((int32_t)(period - first)) > SEGMENT_TOLERANCE)
+            break;
+        steps++;
+        total += period;
+        _stepper->advance();
+
+        // Past the target at the end of the ramp: the next step would be the first one back
+        int32_t togo = _stepper->distanceToGo();
+        if (_stepper->getN() == 0 && ((_dir == SlewDirectionEnum::CW) ? togo < 0 : togo > 0))
+            _turnsAround = true;
+        else
+            _stepper->computeNewSpeed();
+    }
+    if (steps == 0)
+        return false;
+    // What the mean period rounds off goes into the next segment's, so the steps don't drift
+    total += _carry;
+    segment->steps = steps;
+    segment->period = (uint32_t)((total + steps / 2) / steps);
+    _carry = (int64_t)total - (int64_t)segment->period * steps;
+    return true;
+}
+
+void StepEncoder::reset()
+{
+    _stepsLeft = 0;
+    _fraction = 0;
+    _wait = 0;
+    _steps = 0;
+}
+
+void IRAM_ATTR StepEncoder::load(const StepSegment &segment)
+{
+    _period = segment.period;
+    _stepsLeft = segment.steps;
+}
+
+uint32_t IRAM_ATTR StepEncoder::fill(RmtItem *items, uint32_t room)
+{
+    uint32_t written = 0;
+    while (written < room)
+    {
+        if (_wait == 0)
+        {
+            if (_stepsLeft == 0)
+                break;
+            _stepsLeft--;
+            _fraction += _period;
+            // Less the previous step's pulse, the train starts low
+            uint32_t ticks = _fraction >> 8;
+            _fraction &= 0xFF;
+            if (_steps == 0)
+                _wait = (ticks > 0) ? ticks : 1;
+            else
+                _wait = (ticks > HIGH_TICKS) ? ticks - HIGH_TICKS : 1;
+        }
+
+        RmtItem &item = items[written++];
+        if (_wait > MAX_DURATION)
+        {
+            // Low in both halves, leaving some for the step's own item
+            uint32_t ticks = (_wait - 1 < 2 * MAX_DURATION) ? _wait - 1 : 2 * MAX_DURATION;
+            item.level0 = 0;
+            item.duration0 = ticks / 2;
+            item.level1 = 0;
+            item.duration1 = ticks - ticks / 2;
+            _wait -= ticks;
+            continue;
+        }
+        item.level0 = 0;
+        item.duration0 = _wait;
+        item.level1 = 1;
+        item.duration1 = HIGH_TICKS;
+        _wait = 0;
+        _steps++;
+    }
+    return written;
+}
@@ -0,0 +1,119 @@
+/*
+ * Project Name: synscancontrol
+ * File: StepSegments.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Step trains as segments of RMT items, planned from the stepper ramp
+ */
+#ifndef STEP_SEGMENTS_H
+#define STEP_SEGMENTS_H
+
+#include <stdint.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "InterruptStepper.hpp"
+
+namespace SynScanControl
+{
+    /* Same layout as the ESP32's rmt_item32_t: two levels held for
+     * durations in RMT clock ticks. A zero duration ends the train.
+     */
+    struct RmtItem
+    {
+        uint32_t duration0 : 15;
+        uint32_t level0 : 1;
+        uint32_t duration1 : 15;
+        uint32_t level1 : 1;
+    };
+
+    // Steps one after the other, period in RMT ticks / 256 (the fraction carries over)
+    struct StepSegment
+    {
+        uint32_t steps;
+        uint32_t period;
+    };
+
+    /* Cuts the ramp of an InterruptStepper into segments of steps at
+     * about the same period, taking the steps as it goes (without
+     * pulsing the STEP pin). A segment ends when the period drifts by
+     * half a tick from its first step's: one step each early in a ramp,
+     * SEGMENT_STEPS further up and cruising. Its steps go at the mean
+     * period, what that rounds off carries over to the next segment, so
+     * every step stays within a few ticks of where the ramp puts it.
+     *
+     * The planner stops where the ramp would turn around (it went past
+     * the target), before computeNewSpeed() sets the DIR pin for the
+     * steps back: those are left to the tick ISR.
+     */
+    class StepPlanner
+    {
+    public:
+        // 80 MHz APB clock / 8
+        static const uint32_t TICKS_PER_US = 10;
+        static const uint32_t SEGMENT_STEPS = 32;
+        static const uint32_t SEGMENT_TOLERANCE = 128;
+
+        StepPlanner() {};
+
+        void begin(InterruptStepper *stepper);
+        // False once the ramp is done (or turns around), nothing planned then
+        bool next(StepSegment *segment);
+        bool turnsAround() const { return _turnsAround; }
+
+    private:
+        InterruptStepper *_stepper = nullptr;
+        SlewDirectionEnum _dir = SlewDirectionEnum::CW;
+        bool _turnsAround = false;
+        int64_t _carry = 0;
+    };
+
+    /* Turns segments into RMT items, one per step: low until the step
+     * is due (items of low halves in front of it when that is longer
+     * than an item holds), then high for STEPPER_PULSE_WIDTH_US. The
+     * first step is due one period after the train starts, like the
+     * tick ISR's. Fills whatever room it is given, resuming where it
+     * left off, so the items can go straight into the RMT's memory.
+     */
+    class StepEncoder
+    {
+    public:
+        static const uint32_t MAX_DURATION = 32767;
+        static const uint32_t HIGH_TICKS = STEPPER_PULSE_WIDTH_US * StepPlanner::TICKS_PER_US;
+
+        StepEncoder() {};
+
+        void reset();
+        void load(const StepSegment &segment);
+        // Items written, fewer than room once the segment is done
+        uint32_t fill(RmtItem *items, uint32_t room);
+        bool isDone() const { return _stepsLeft == 0 && _wait == 0; }
+        // Steps encoded since reset(), counted as their item is written
+        uint32_t getSteps() const { return _steps; }
+
+    private:
+        uint32_t _period = 0;
+        uint32_t _stepsLeft = 0;
+        uint32_t _fraction = 0;
+        uint32_t _wait = 0;
+        uint32_t _steps = 0;
+    };
+} // namespace SynScanControl
+
+#endif /* STEP_SEGMENTS_H */
@@ -0,0 +1,175 @@
+/*
+ * Project Name: synscancontrol
+ * File: TraceRecorder.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Fixed-size ring buffer of step / command events for post-mortem analysis
+ */
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <Arduino.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+#include "Logger.hpp"
+
+namespace SynScanControl
+{
+    enum class TraceEventEnum : uint8_t
+    {
+        NONE = 0,
+        STEP = 1,         // ISR: arg0 = stepper _n, arg1 = stepper _cn (float bits)
+        COMMAND = 2,      // loop: arg0 / arg1 = first 8 chars of the command (after ':')
+        MOTION_START = 3, // loop: arg0 = stepper target, arg1 = slew type
+        MOTION_STOP = 4,  // loop: arg0 = stepper position, arg1 = steps to stop
+        MOTION_DONE = 5   // loop: arg0 = stepper position
+    };
+
+    /* 16 bytes per event */
+    struct TraceEvent
+    {
+        uint32_t tick;     // tick ISR count (TICK_PERIOD_US each)
+        uint32_t info;     // position (24 bits) | axis (4 bits) << 24 | type (4 bits) << 28
+        uint32_t arg0;
+        uint32_t arg1;
+    };
+
+    /* Always-on flight recorder for the motion code.
+     *
+     * The tick ISR is the only writer of step events and costs a counter
+     * increment plus four stores per step, so this can stay enabled.
+     * Loop-side events are written with the ISR masked. Recording is
+     * paused while a dump is in progress, the dump is paced by pump() so
+     * it doesn't overflow the logger.
+     */
+    class TraceRecorder
+    {
+    public:
+        static const uint32_t NUM_EVENTS = 1024; // must be a power of two
+        static const uint32_t PUMP_BATCH_SIZE = 8;
+
+        TraceRecorder() { memset(_events, 0, sizeof(_events)); }
+
+        void setEnabled(bool enabled) { _enabled = enabled; }
+        bool isEnabled() const { return _enabled; }
+        bool isDumping() const { return _dumping; }
+        uint32_t getTicks() const { return _ticks; }
+
+        // Called once per tick ISR
+        inline void IRAM_ATTR tick()
+        {
+            _ticks++;
+        }
+
+        // ISR side
+        inline void IRAM_ATTR step(AxisEnum axis, uint32_t position, int32_t n, float cn)
+        {
+            if (!_enabled || _dumping)
+                return;
+            uint32_t cnBits;
+            memcpy(&cnBits, &cn, 4);
+            _write(TraceEventEnum::STEP, axis, position, (uint32_t)n, cnBits);
+        }
+
+        // Loop side
+        void record(TraceEventEnum type, AxisEnum axis, uint32_t position, uint32_t arg0, uint32_t arg1)
+        {
+            if (!_enabled || _dumping)
+                return;
+            portENTER_CRITICAL(&_mux);
+            _write(type, axis, position, arg0, arg1);
+            portEXIT_CRITICAL(&_mux);
+        }
+
+        void recordCommand(AxisEnum axis, const char *cmd, uint16_t len)
+        {
+            // Skip the leading ':', keep the next 8 characters
+            uint32_t args[2] = {0, 0};
+            if (len > 1)
+                memcpy(args, cmd + 1, (len - 1 > 8) ? 8 : len - 1);
+            record(TraceEventEnum::COMMAND, axis, 0, args[0], args[1]);
+        }
+
+        // Start sending the recorded events to the logger, oldest first
+        void startDump()
+        {
+            if (_dumping)
+                return;
+            _dumping = true;
+            uint32_t count = (_head > NUM_EVENTS) ? NUM_EVENTS : _head;
+            _dumpIdx = _head - count;
+            _dumpEnd = _head;
+            _dumpStarted = false;
+        }
+
+        // Call regularly from the loop, sends a few events per call while the logger has room
+        void pump(Logger *logger)
+        {
+            if (!_dumping)
+                return;
+            if (!_dumpStarted)
+            {
+                if (logger->freeSlots() < 2)
+                    return;
+                logger->info(LogMsg::TRACE_DUMP_START, _dumpEnd - _dumpIdx, TICK_PERIOD_US);
+                _dumpStarted = true;
+            }
+            for (uint32_t i = 0; i < PUMP_BATCH_SIZE && _dumpIdx != _dumpEnd; i++)
+            {
+                if (logger->freeSlots() < Logger::RING_SIZE / 4)
+                    return;
+                const TraceEvent &e = _events[_dumpIdx & (NUM_EVENTS - 1)];
+                logger->info(LogMsg::TRACE_EVENT, e.tick, e.info, e.arg0, e.arg1);
+                _dumpIdx++;
+            }
+            if (_dumpIdx == _dumpEnd && logger->freeSlots() > 0)
+            {
+                logger->info(LogMsg::TRACE_DUMP_END);
+                _dumping = false;
+            }
+        }
+
+    private:
+        TraceEvent _events[NUM_EVENTS];
+        volatile uint32_t _head = 0;
+        volatile uint32_t _ticks = 0;
+        volatile bool _enabled = true;
+        volatile bool _dumping = false;
+        uint32_t _dumpIdx = 0;
+        uint32_t _dumpEnd = 0;
+        bool _dumpStarted = false;
+        portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+        inline void IRAM_ATTR _write(TraceEventEnum type, AxisEnum axis, uint32_t position, uint32_t arg0, uint32_t arg1)
+        {
+            TraceEvent &e = _events[_head & (NUM_EVENTS - 1)];
+            e.tick = _ticks;
+            e.info = (position & 0xFFFFFF) | (((uint32_t)axis & 0x0F) << 24) | (((uint32_t)type & 0x0F) << 28);
+            e.arg0 = arg0;
+            e.arg1 = arg1;
+            _head = _head + 1;
+        }
+    };
+} // namespace SynScanControl
+
+#endif /* TRACE_RECORDER_H */
@@ -0,0 +1,97 @@
+/*
+ * Project Name: synscancontrol
+ * File: TrackingRate.hpp
+ *
+ * Copyright (C) 2024 Jon Dalrymple
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Jon Dalrymple
+ * Created: 18 October 2026
+ * Description: Built-in tracking rates in fixed point
+ */
+#ifndef TRACKING_RATE_H
+#define TRACKING_RATE_H
+
+#include <stdint.h>
+
+#include "Constants.hpp"
+#include "Enums.hpp"
+
+namespace SynScanControl
+{
+    /* Tracking rates as increments of the motor's Q32 phase accumulator
+     * (2^32 = one step per tick), worked out at compile time from
+     * MICROSTEPS_PER_REV and the tick rate, in integers only.
+     *
+     * Position units per arcsec reduce to a small fraction (94 / 27 on
+     * the HEQ5), so the rate in micro-arcseconds per second times 2^32
+     * still fits in 64 bits. Rounding the rate to 1 uas/s and the
+     * increment to an integer costs less than 0.1 ppm, against ~180 ppm
+     * for the integer step period a host sends with :I.
+     */
+    namespace TrackingRate
+    {
+        // Rates in micro-arcseconds per second
+        constexpr uint64_t SIDEREAL_UAS = 15041069; // 360 degrees per sidereal day (86164.0905 s)
+        constexpr uint64_t LUNAR_UAS = 14492054;    // Sidereal less the mean motion of the Moon (27.321661 day month)
+        constexpr uint64_t SOLAR_UAS = 15000000;    // 360 degrees per mean solar day
+        constexpr uint64_t KING_UAS = 15036900;     // Sidereal corrected for refraction (King, 1931)
+
+        constexpr uint64_t gcd(uint64_t a, uint64_t b) { return b ? gcd(b, a % b) : a; }
+
+        // Position units per arcsec, as a reduced fraction
+        constexpr uint64_t UNITS_NUM = MICROSTEPS_PER_REV / gcd(MICROSTEPS_PER_REV, 1296000);
+        constexpr uint64_t UNITS_DEN = 1296000 / gcd(MICROSTEPS_PER_REV, 1296000);
+        constexpr uint64_t UAS_TICKS = UNITS_DEN * 1000000ULL * MAX_PULSE_PER_SECOND;
+
+        static_assert(SIDEREAL_UAS * UNITS_NUM < (1ULL << 32), "Rate doesn't fit the 64 bit intermediate");
+
+        constexpr uint32_t increment(uint64_t uas)
+        {
+            return (uint32_t)(((uas * UNITS_NUM << 32) + UAS_TICKS / 2) / UAS_TICKS);
+        }
+
+        constexpr uint32_t SIDEREAL = increment(SIDEREAL_UAS);
+        constexpr uint32_t LUNAR = increment(LUNAR_UAS);
+        constexpr uint32_t SOLAR = increment(SOLAR_UAS);
+        constexpr uint32_t KING = increment(KING_UAS);
+
+        // 0 for HOST, the rate then comes from the step period
+        inline uint32_t incrementFor(TrackingRateEnum rate)
+        {
+            switch (rate)
+            {
+            case TrackingRateEnum::SIDEREAL:
+                return SIDEREAL;
+            case TrackingRateEnum::LUNAR:
+                return LUNAR;
+            case TrackingRateEnum::SOLAR:
+                return SOLAR;
+            case TrackingRateEnum::KING:
+                return KING;
+            default:
+                return 0;
+            }
+        }
+
+        // Fraction of the sidereal rate, e.g. a guide rate
+        inline uint32_t siderealFraction(uint32_t perMille)
+        {
+            return (uint32_t)(((uint64_t)SIDEREAL * perMille + 500) / 1000);
+        }
+    } // namespace TrackingRate
+} // namespace SynScanControl
+
+#endif /* TRACKING_RATE_H */
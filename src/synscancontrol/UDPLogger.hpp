@@ -28,44 +28,101 @@
 
 #include <Arduino.h>
 #include <AsyncUDP.h>
+#include <atomic>
 #include <WiFi.h>
 
+#include "Constants.hpp"
 #include "Logger.hpp"
 
+/* The socket and the batch belong to the logger's drain task (log() and
+ * flush()): connect() / disconnect(), called from loop() as the WiFi comes
+ * and goes, only ask for it, the drain task does it on its next pass.
+ */
 class UDPLoggerHandler : public LoggerHandler
 {
 public:
     UDPLoggerHandler(uint16_t udpPort, HardwareSerial *s = nullptr) : _udpPort(udpPort), _s(s) {};
 
-    void connect()
+    void connect() { _wantConnected = true; }
+    void disconnect() { _wantConnected = false; }
+
+    /* Log records are batched and broadcast in binary, see tools/synscanlog.py for the decoder.
+     * Datagram layout: magic "SL", format version, record count, sequence number, then the records.
+     * The sequence number lets the receiver detect lost datagrams.
+     */
+    void log(const LogRecord &record) override
     {
-        if (_udp == nullptr)
-            _udp = new AsyncUDP();
+        _update();
+        if (!_isConnected)
+            return;
 
-        if (_udp->connect(IPAddress(255, 255, 255, 255), _udpPort))
-        {
-            if (_s != nullptr)
-                _s->println("UDP connected");
-            _isConnected = true;
-        }
+        if (_length + record.encodedSize() > SynScanControl::UDP_LOGGER_MAX_DATAGRAM || _count == UINT8_MAX)
+            _send();
+
+        if (_count == 0)
+            _firstRecordMs = millis();
+        _length += record.encode(_datagram + _length);
+        _count++;
     }
 
-    void disconnect()
+    void flush() override
     {
-        if (_udp != nullptr)
+        _update();
+        if (_count > 0 && millis() - _firstRecordMs >= SynScanControl::UDP_LOGGER_FLUSH_MS)
+            _send();
+    }
+
+private:
+    static const uint8_t FORMAT_VERSION = 2;
+    static const uint32_t HEADER_SIZE = 8;
+
+    uint8_t _datagram[SynScanControl::UDP_LOGGER_MAX_DATAGRAM];
+    uint32_t _length = HEADER_SIZE;
+    uint8_t _count = 0;
+    uint32_t _sequence = 0;
+    uint32_t _firstRecordMs = 0;
+
+    // Drain task only
+    void _update()
+    {
+        bool want = _wantConnected;
+        if (want && !_isConnected)
+        {
+            if (_udp == nullptr)
+                _udp = new AsyncUDP();
+            if (_udp->connect(IPAddress(255, 255, 255, 255), _udpPort))
+            {
+                if (_s != nullptr)
+                    _s->println("UDP connected");
+                _isConnected = true;
+            }
+        }
+        else if (!want && _udp != nullptr)
+        {
             delete _udp;
-        _udp = nullptr;
-        _isConnected = false;
+            _udp = nullptr;
+            _isConnected = false;
+            _length = HEADER_SIZE;
+            _count = 0;
+        }
     }
 
-    void log(const char *msg) override
+    void _send()
     {
-        if (_isConnected && _udp != nullptr)
-            _udp->broadcastTo(msg, _udpPort);
+        _datagram[0] = 'S';
+        _datagram[1] = 'L';
+        _datagram[2] = FORMAT_VERSION;
+        _datagram[3] = _count;
+        memcpy(_datagram + 4, &_sequence, 4);
+        _udp->broadcastTo(_datagram, _length, _udpPort);
+
+        _sequence++;
+        _length = HEADER_SIZE;
+        _count = 0;
     }
 
-private:
     uint16_t _udpPort = 0;
+    std::atomic<bool> _wantConnected{false};
     bool _isConnected = false;
     AsyncUDP *_udp = nullptr;
     HardwareSerial *_s = nullptr;
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Compare two benchmark result files (JSON lines written by the bench suite)
+
+Exits with 1 if any benchmark got slower than the threshold.
+"""
+
+import sys
+import json
+import argparse
+
+
+def load(path):
+    header = {}
+    results = {}
+    with open(path, 'r') as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith('{'):
+                continue  # e.g. boot messages in a serial capture
+            entry = json.loads(line)
+            if 'suite' in entry:
+                header = entry
+            elif 'name' in entry:
+                results[entry['name']] = entry
+    return header, results
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument('baseline', type=str, help='Results of the reference run')
+    parser.add_argument('current', type=str, help='Results to check')
+    parser.add_argument('-t', '--threshold', required=False, type=float, default=10.0,
+                        help='Slowdown (%%) counted as a regression')
+    pargs = parser.parse_args()
+
+    base_header, base = load(pargs.baseline)
+    cur_header, cur = load(pargs.current)
+    if base_header.get('unit') != cur_header.get('unit'):
+        sys.exit('Can\'t compare %s (%s) against %s (%s)'
+                 % (pargs.baseline, base_header.get('platform'), pargs.current, cur_header.get('platform')))
+
+    unit = cur_header.get('unit', '')
+    print('%-40s %12s %12s %8s' % ('benchmark', 'baseline', 'current', 'change'))
+    regressions = 0
+    for name in sorted(set(base) | set(cur)):
+        if name not in base or name not in cur:
+            print('%-40s %12s %12s' % (name, '%.2f' % base[name]['per_op'] if name in base else '-',
+                                       '%.2f' % cur[name]['per_op'] if name in cur else '-'))
+            continue
+        before, after = base[name]['per_op'], cur[name]['per_op']
+        change = (after / before - 1.0) * 100.0 if before > 0 else 0.0
+        flag = ''
+        if change > pargs.threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        print('%-40s %12.2f %12.2f %+7.1f%%%s' % (name, before, after, change, flag))
+
+    print('\n%d regression(s) over %.0f%% (%s per op, %s -> %s)'
+          % (regressions, pargs.threshold, unit, base_header.get('revision'), cur_header.get('revision')))
+    sys.exit(1 if regressions else 0)
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Record a client <-> mount session by sitting between them
+
+Creates a pty for the client (EQMOD, INDI, the SynScan app via a serial
+bridge...) to connect to, forwards everything to the mount's serial port
+and records each frame with a timestamp, for session_replay.py.
+Stop with Ctrl-C.
+"""
+
+import os
+import sys
+import tty
+import time
+import select
+import argparse
+
+import synscanserial
+
+
+class FrameSplitter:
+    """ Splits a byte stream into '\\r' terminated frames """
+
+    def __init__(self):
+        self._buffer = b''
+
+    def feed(self, data):
+        self._buffer += data
+        frames = []
+        while b'\r' in self._buffer:
+            frame, self._buffer = self._buffer.split(b'\r', 1)
+            frames.append(frame.decode('ascii', errors='replace'))
+        return frames
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port', type=str, help='Serial port of the mount (or a synscansim serve pty)')
+    parser.add_argument('-o', '--output', required=False, type=str, default='session.jsonl',
+                        help='Session file to write')
+    parser.add_argument('-b', '--baud', required=False, type=int, default=9600, help='Baud rate')
+    pargs = parser.parse_args()
+
+    mount = synscanserial.open_serial(pargs.port, pargs.baud)
+    client, client_slave = os.openpty()
+    tty.setraw(client_slave)
+    print('Connect the client to %s' % os.ttyname(client_slave))
+    sys.stdout.flush()
+
+    frames = []
+    splitters = {'rx': FrameSplitter(), 'tx': FrameSplitter()}
+    start = time.monotonic()
+    try:
+        while True:
+            readable, _, _ = select.select([client, mount], [], [])
+            for fd in readable:
+                data = os.read(fd, 1024)
+                now = time.monotonic() - start
+                direction = 'rx' if fd == client else 'tx'
+                os.write(mount if fd == client else client, data)
+                for frame in splitters[direction].feed(data):
+                    frames.append({'t': round(now, 6), 'dir': direction, 'data': frame})
+    except KeyboardInterrupt:
+        pass
+    finally:
+        synscanserial.write_session(pargs.output, frames)
+        print('\nWrote %d frames to %s' % (len(frames), pargs.output))
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Replay a recorded client session against a mount and report reply latencies
+
+The session comes from session_capture.py (JSON lines) or from a UDP log
+capture of firmware built with -DSERIAL_CAPTURE. The target is any serial
+port: a real mount, or the pty printed by `synscansim serve`.
+
+Commands are sent with the recorded cadence (scaled by --speed), but never
+before the previous reply arrived, like a real client. Reports per-command
+latency percentiles and every reply that differs from the recorded one.
+Exits with 1 if there were any divergences.
+"""
+
+import os
+import sys
+import time
+import select
+import termios
+import argparse
+
+import synscanlog
+import synscanserial
+
+
+def pair_frames(frames):
+    """ [(t, command, recorded reply or None)] """
+    pairs = []
+    for frame in frames:
+        if frame['dir'] == 'rx':
+            pairs.append([frame['t'], frame['data'], None])
+        elif pairs and pairs[-1][2] is None:
+            pairs[-1][2] = frame['data']
+    return [tuple(p) for p in pairs]
+
+
+def read_reply(fd, timeout):
+    """ Read up to the next '\\r', returns (reply, seconds) or (None, timeout) """
+    start = time.monotonic()
+    data = b''
+    while True:
+        remaining = timeout - (time.monotonic() - start)
+        if remaining <= 0:
+            return None, timeout
+        readable, _, _ = select.select([fd], [], [], remaining)
+        if not readable:
+            continue
+        data += os.read(fd, 256)
+        if b'\r' in data:
+            return data.split(b'\r', 1)[0].decode('ascii', errors='replace'), time.monotonic() - start
+
+
+def percentile(values, p):
+    values = sorted(values)
+    k = (len(values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(values) - 1)
+    return values[lo] + (values[hi] - values[lo]) * (k - lo)
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('session', type=str, help='Recorded session')
+    parser.add_argument('port', type=str, help='Serial port / pty of the mount to replay against')
+    parser.add_argument('-b', '--baud', required=False, type=int, default=9600, help='Baud rate')
+    parser.add_argument('-s', '--speed', required=False, type=float, default=1.0,
+                        help='Replay speed relative to the recording, 0 to send as fast as replies allow')
+    parser.add_argument('-t', '--timeout', required=False, type=float, default=0.5,
+                        help='Seconds to wait for a reply')
+    parser.add_argument('-i', '--ignore', required=False, type=str, default='',
+                        help='Command letters whose reply contents aren\'t compared (e.g. "jf", positions and status change with time)')
+    parser.add_argument('-d', '--dictionary', required=False, type=str, default=synscanlog.DEFAULT_DICTIONARY,
+                        help='LogMessages.hpp, for sessions taken from UDP log captures')
+    pargs = parser.parse_args()
+
+    pairs = pair_frames(synscanserial.read_session(pargs.session, synscanlog.load_dictionary(pargs.dictionary)))
+    if not pairs:
+        sys.exit('No commands in %s' % pargs.session)
+
+    fd = synscanserial.open_serial(pargs.port, pargs.baud)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+
+    latencies = {}
+    divergences = []
+    timeouts = 0
+    start = time.monotonic()
+    t0 = pairs[0][0]
+    for t, command, expected in pairs:
+        if pargs.speed > 0:
+            delay = start + (t - t0) / pargs.speed - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+        os.write(fd, (command + '\r').encode('ascii'))
+        reply, seconds = read_reply(fd, pargs.timeout)
+
+        key = command[1] if len(command) > 1 else '?'
+        if reply is None:
+            timeouts += 1
+        else:
+            latencies.setdefault(key, []).append(seconds * 1000.0)
+
+        if reply != expected and not (key in pargs.ignore and reply is not None and expected is not None):
+            divergences.append((t, command, expected, reply))
+
+    print('Replayed %d commands in %.1f s' % (len(pairs), time.monotonic() - start))
+    print('%-8s %6s %8s %8s %8s %8s   (ms)' % ('command', 'count', 'p50', 'p90', 'p99', 'max'))
+    everything = []
+    for key in sorted(latencies):
+        values = latencies[key]
+        everything += values
+        print('%-8s %6d %8.2f %8.2f %8.2f %8.2f' % (':' + key, len(values), percentile(values, 50),
+                                                  percentile(values, 90), percentile(values, 99), max(values)))
+    if everything:
+        print('%-8s %6d %8.2f %8.2f %8.2f %8.2f' % ('all', len(everything), percentile(everything, 50),
+                                                  percentile(everything, 90), percentile(everything, 99), max(everything)))
+    print('Timeouts: %d' % timeouts)
+
+    print('Divergences: %d' % len(divergences))
+    for t, command, expected, reply in divergences[:20]:
+        print('  [%9.3f] %-12s recorded %-12s got %s' % (t, command, repr(expected), repr(reply)))
+    sys.exit(1 if divergences else 0)
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Decoder for the synscancontrol binary log format
+
+The firmware only sends a message ID, a timestamp and the raw arguments
+for each log message. The format strings live in
+src/synscancontrol/LogMessages.hpp, which is parsed here to rebuild the text.
+"""
+
+import os
+import re
+import struct
+from dataclasses import dataclass
+
+DEFAULT_DICTIONARY = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                  '..', 'src', 'synscancontrol', 'LogMessages.hpp')
+
+LEVELS = ['DEBUG', 'INFO', 'WARNING', 'ERROR', 'CRITICAL']
+
+DATAGRAM_MAGIC = b'SL'
+DATAGRAM_VERSION = 2
+DATAGRAM_HEADER = struct.Struct('<2sBBI')  # magic, version, record count, sequence number
+RECORD_HEADER = struct.Struct('<IHBB')  # timestamp (us), message ID, level, payload length
+
+_ENTRY_RE = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+_CONV_RE = re.compile(r'%([-+ #0-9.]*)([a-zA-Z%])')
+
+
+@dataclass
+class LogRecord:
+    timestamp_us: int
+    msg_id: int
+    level: str
+    name: str
+    args: tuple
+    text: str
+
+
+def load_dictionary(path=DEFAULT_DICTIONARY):
+    """ Parse the LOG_MESSAGES X-macro table into a list of (name, format) """
+    with open(path, 'r') as f:
+        source = f.read()
+    table = source[source.index('#define LOG_MESSAGES(X)'):]
+    table = table[:table.index('enum class LogMsg')]
+    return [(name, bytes(fmt, 'utf-8').decode('unicode_escape'))
+            for name, fmt in _ENTRY_RE.findall(table)]
+
+
+def decode_args(fmt, payload):
+    """ Unpack the raw arguments of a record, as described by its format string """
+    args = []
+    idx = 0
+    for _, conv in _CONV_RE.findall(fmt):
+        if conv == '%':
+            continue
+        if conv == 's':
+            length = payload[idx]
+            args.append(payload[idx + 1:idx + 1 + length].decode('utf-8', errors='replace'))
+            idx += 1 + length
+        elif conv in 'fgeG':
+            args.append(struct.unpack_from('<f', payload, idx)[0])
+            idx += 4
+        elif conv in 'di':
+            args.append(struct.unpack_from('<i', payload, idx)[0])
+            idx += 4
+        else:
+            args.append(struct.unpack_from('<I', payload, idx)[0])
+            idx += 4
+    return tuple(args)
+
+
+def format_message(fmt, args):
+    try:
+        return fmt % args
+    except (TypeError, ValueError):
+        return '%s %r' % (fmt, args)
+
+
+def decode_records(data, dictionary, count=None):
+    """ Decode back-to-back records, returns a list of LogRecord """
+    records = []
+    offset = 0
+    while offset + RECORD_HEADER.size <= len(data) and (count is None or len(records) < count):
+        timestamp, msg_id, level, length = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        payload = data[offset:offset + length]
+        offset += length
+
+        if msg_id < len(dictionary):
+            name, fmt = dictionary[msg_id]
+        else:
+            name, fmt = 'UNKNOWN_%d' % msg_id, 'Unknown message %d' % msg_id
+        try:
+            args = decode_args(fmt, payload)
+            text = format_message(fmt, args)
+        except (IndexError, struct.error):
+            args = ()
+            text = '%s (malformed payload %s)' % (fmt, payload.hex())
+        level_name = LEVELS[level] if level < len(LEVELS) else 'INFO'
+        records.append(LogRecord(timestamp, msg_id, level_name, name, args, text))
+    return records
+
+
+def decode_datagram(data, dictionary):
+    """ Decode a UDP log datagram into (sequence number, records),
+    raises ValueError if it isn't one """
+    if len(data) < DATAGRAM_HEADER.size or data[:2] != DATAGRAM_MAGIC:
+        raise ValueError('Not a binary log datagram')
+    _, version, count, sequence = DATAGRAM_HEADER.unpack_from(data, 0)
+    if version != DATAGRAM_VERSION:
+        raise ValueError('Unsupported log format version %d' % version)
+    return sequence, decode_records(data[DATAGRAM_HEADER.size:], dictionary, count)
+
+
+def encode_record(timestamp_us, msg_id, level, payload=b''):
+    """ Encode a single record the way the firmware does """
+    return RECORD_HEADER.pack(timestamp_us, msg_id, level, len(payload)) + payload
+
+
+def encode_datagram(sequence, records):
+    """ Wrap encoded records into a datagram the way the firmware does """
+    return DATAGRAM_HEADER.pack(DATAGRAM_MAGIC, DATAGRAM_VERSION, len(records), sequence) + b''.join(records)
+
+
+CAPTURE_LENGTH = struct.Struct('<H')
+
+
+def write_capture(f, data):
+    """ Append one raw datagram to a capture file """
+    f.write(CAPTURE_LENGTH.pack(len(data)) + data)
+
+
+def read_capture(path):
+    """ Yield the raw datagrams stored in a capture file """
+    with open(path, 'rb') as f:
+        while True:
+            header = f.read(CAPTURE_LENGTH.size)
+            if len(header) < CAPTURE_LENGTH.size:
+                return
+            length, = CAPTURE_LENGTH.unpack(header)
+            data = f.read(length)
+            if len(data) < length:
+                return
+            yield data
+
+
+class SequenceTracker:
+    """ Tracks datagram sequence numbers from one sender to detect loss """
+
+    # A jump back further than this is treated as the device restarting
+    RESTART_THRESHOLD = 1000
+
+    def __init__(self):
+        self.expected = None
+        self.received = 0
+        self.lost = 0
+        self.reordered = 0
+        self.duplicates = 0
+        self.restarts = 0
+        # Sequence numbers skipped over that may still turn up (the last RESTART_THRESHOLD)
+        self.missing = set()
+
+    def update(self, sequence):
+        """ Returns the number of datagrams found missing just before this one """
+        missing = 0
+        if self.expected is not None:
+            delta = (sequence - self.expected) & 0xFFFFFFFF
+            if delta == 0:
+                pass
+            elif delta < 0x80000000:
+                missing = delta
+                for skipped in range(max(0, delta - self.RESTART_THRESHOLD), delta):
+                    self.missing.add((self.expected + skipped) & 0xFFFFFFFF)
+            elif (self.expected - sequence) & 0xFFFFFFFF > self.RESTART_THRESHOLD:
+                self.restarts += 1
+                self.missing.clear()
+            elif sequence in self.missing:
+                # Late arrival of a datagram we already counted as lost
+                self.missing.discard(sequence)
+                self.received += 1
+                self.reordered += 1
+                self.lost -= 1
+                return 0
+            else:
+                self.duplicates += 1
+                return 0
+        self.received += 1
+        self.lost += missing
+        self.expected = (sequence + 1) & 0xFFFFFFFF
+        # Too far behind to be told from a restart any more
+        if self.missing:
+            self.missing = set(m for m in self.missing
+                               if (self.expected - m) & 0xFFFFFFFF <= self.RESTART_THRESHOLD)
+        return missing
+
+    def summary(self):
+        total = self.received + self.lost
+        rate = 100.0 * self.lost / total if total else 0.0
+        return ('received %d, lost %d (%.2f%%), reordered %d, duplicates %d, restarts %d'
+                % (self.received, self.lost, rate, self.reordered, self.duplicates, self.restarts))
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Serial port and session capture helpers for the synscancontrol tools
+
+Only uses the standard library (termios), so works the same with real
+serial ports and with the pty served by `synscansim serve`.
+
+A session is a list of frames, each a dict {"t": seconds, "dir": "rx" | "tx", "data": str}
+where "rx" is towards the mount and "tx" from it, without the trailing '\\r'.
+Sessions are stored as JSON lines.
+"""
+
+import os
+import json
+import tty
+import termios
+
+import synscanlog
+
+
+def open_serial(path, baud=9600):
+    """ Open a serial port / pty in raw mode, returns a file descriptor """
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    attrs = termios.tcgetattr(fd)
+    speed = getattr(termios, 'B%d' % baud)
+    attrs[4] = attrs[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def write_session(path, frames):
+    with open(path, 'w') as f:
+        for frame in frames:
+            f.write(json.dumps(frame) + '\n')
+
+
+def read_session(path, dictionary=None):
+    """ Load a session from a JSON lines file, or from a UDP log capture
+    (udp_receiver.py --save) of firmware built with -DSERIAL_CAPTURE """
+    with open(path, 'rb') as f:
+        start = f.read(1)
+    if start == b'{':
+        with open(path, 'r') as f:
+            return [json.loads(line) for line in f if line.strip()]
+
+    dictionary = dictionary or synscanlog.load_dictionary()
+    frames = []
+    last_ts = None
+    offset = 0
+    # Lines too long for one record come in pieces, the last one as SESSION_RX / SESSION_TX
+    pieces = {'rx': [], 'tx': []}
+    for data in synscanlog.read_capture(path):
+        try:
+            _, records = synscanlog.decode_datagram(data, dictionary)
+        except ValueError:
+            continue
+        for record in records:
+            if record.name not in ('SESSION_RX', 'SESSION_TX', 'SESSION_RX_MORE', 'SESSION_TX_MORE'):
+                continue
+            # micros() wraps around every ~71 minutes
+            if last_ts is not None and record.timestamp_us < last_ts:
+                offset += 1 << 32
+            last_ts = record.timestamp_us
+            t = (record.timestamp_us + offset) / 1e6
+            direction = 'rx' if record.name.startswith('SESSION_RX') else 'tx'
+            pieces[direction].append((t, record.args[0]))
+            if record.name.endswith('_MORE'):
+                continue
+            frames.append({'t': pieces[direction][0][0], 'dir': direction,
+                           'data': ''.join(p for _, p in pieces[direction]).rstrip('\r')})
+            pieces[direction] = []
+    if frames:
+        t0 = frames[0]['t']
+        for frame in frames:
+            frame['t'] -= t0
+    return frames
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Convert trace dumps (:Z103) from a UDP log capture into a Chrome / Perfetto trace
+
+Capture the logs with `udp_receiver.py --save capture.bin`, send `:Z103` to
+the mount, then run this on the capture and open the output in
+https://ui.perfetto.dev or chrome://tracing.
+"""
+
+import json
+import struct
+import argparse
+
+import synscanlog
+
+# TraceEventEnum in TraceRecorder.hpp
+STEP = 1
+COMMAND = 2
+MOTION_START = 3
+MOTION_STOP = 4
+MOTION_DONE = 5
+
+AXES = {1: 'RA', 2: 'DEC'}
+SLEW_TYPES = ['GOTO', 'TRACKING', 'NONE']
+
+
+def unpack_event(args):
+    """ TRACE_EVENT args -> (tick, type, axis, position, arg0, arg1) """
+    tick, info, arg0, arg1 = args
+    return tick, info >> 28, (info >> 24) & 0x0F, info & 0xFFFFFF, arg0, arg1
+
+
+def signed(value):
+    return struct.unpack('<i', struct.pack('<I', value))[0]
+
+
+def find_dumps(records):
+    """ Group TRACE_EVENT records by dump, returns a list of (us per tick, [events]) """
+    dumps = []
+    current = None
+    for record in records:
+        if record.name == 'TRACE_DUMP_START':
+            current = (record.args[1], [])
+            dumps.append(current)
+        elif record.name == 'TRACE_EVENT' and current is not None:
+            current[1].append(unpack_event(record.args))
+        elif record.name == 'TRACE_DUMP_END':
+            current = None
+    return dumps
+
+
+def to_trace_events(dumps):
+    out = []
+    for pid, (tick_us, events) in enumerate(dumps, start=1):
+        out.append({'name': 'process_name', 'ph': 'M', 'pid': pid, 'args': {'name': 'Trace dump %d' % pid}})
+        for axis, name in AXES.items():
+            out.append({'name': 'thread_name', 'ph': 'M', 'pid': pid, 'tid': axis, 'args': {'name': name}})
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': pid, 'tid': 0, 'args': {'name': 'Commands'}})
+
+        last_step = {}
+        open_slices = set()
+        for tick, kind, axis, position, arg0, arg1 in events:
+            ts = tick * tick_us
+            axis_name = AXES.get(axis, str(axis))
+            if kind == STEP:
+                cn = struct.unpack('<f', struct.pack('<I', arg1))[0]
+                counters = {'position': position, 'n': signed(arg0)}
+                if cn > 0:
+                    counters['accel rate (steps/s)'] = 1e6 / cn
+                if axis in last_step and ts > last_step[axis]:
+                    counters['step rate (steps/s)'] = 1e6 / (ts - last_step[axis])
+                last_step[axis] = ts
+                for name, value in counters.items():
+                    out.append({'name': '%s %s' % (axis_name, name), 'ph': 'C', 'ts': ts, 'pid': pid,
+                                'args': {name: value}})
+            elif kind == COMMAND:
+                text = ':' + struct.pack('<II', arg0, arg1).rstrip(b'\0').decode('ascii', errors='replace')
+                out.append({'name': text, 'ph': 'i', 's': 't', 'ts': ts, 'pid': pid, 'tid': 0})
+            elif kind == MOTION_START:
+                if axis in open_slices:
+                    out.append({'ph': 'E', 'ts': ts, 'pid': pid, 'tid': axis})
+                slew = SLEW_TYPES[arg1] if arg1 < len(SLEW_TYPES) else str(arg1)
+                out.append({'name': slew, 'ph': 'B', 'ts': ts, 'pid': pid, 'tid': axis,
+                            'args': {'position': position, 'stepper target': signed(arg0)}})
+                open_slices.add(axis)
+            elif kind == MOTION_STOP:
+                out.append({'name': 'stop requested', 'ph': 'i', 's': 't', 'ts': ts, 'pid': pid, 'tid': axis,
+                            'args': {'stepper position': signed(arg0), 'steps to stop': signed(arg1)}})
+            elif kind == MOTION_DONE and axis in open_slices:
+                out.append({'ph': 'E', 'ts': ts, 'pid': pid, 'tid': axis,
+                            'args': {'position': position}})
+                open_slices.discard(axis)
+    return out
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('capture', type=str, help='Capture file written by udp_receiver.py --save')
+    parser.add_argument('-o', '--output', required=False, type=str, default='trace.json',
+                        help='Output trace file')
+    parser.add_argument('-d', '--dictionary', required=False, type=str, default=synscanlog.DEFAULT_DICTIONARY,
+                        help='LogMessages.hpp matching the firmware sending the logs')
+    pargs = parser.parse_args()
+
+    dictionary = synscanlog.load_dictionary(pargs.dictionary)
+
+    records = []
+    for data in synscanlog.read_capture(pargs.capture):
+        try:
+            _, datagram_records = synscanlog.decode_datagram(data, dictionary)
+        except ValueError:
+            continue
+        records.extend(datagram_records)
+
+    dumps = find_dumps(records)
+    with open(pargs.output, 'w') as f:
+        json.dump({'traceEvents': to_trace_events(dumps), 'displayTimeUnit': 'ms'}, f)
+    print('Wrote %d trace dump(s), %d events to %s'
+          % (len(dumps), sum(len(events) for _, events in dumps), pargs.output))
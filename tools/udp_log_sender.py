@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+""" Sends synthetic binary log datagrams, for testing udp_receiver.py locally
+
+Datagrams are built exactly like the firmware's UDP logger does. Some of them
+can be deliberately skipped (their sequence numbers are still consumed) to
+check that the receiver notices and reports the loss, e.g.:
+
+    ./udp_receiver.py &
+    ./udp_log_sender.py --count 1000 --drop-rate 0.05
+"""
+
+import sys
+import time
+import random
+import socket
+import struct
+import argparse
+
+import synscanlog
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-H', '--host', required=False, type=str, default='127.0.0.1',
+                        help='Host to send the datagrams to')
+    parser.add_argument('-p', '--port', required=False, type=int, default=6309,
+                        help='UDP port to send the datagrams to')
+    parser.add_argument('-n', '--count', required=False, type=int, default=100,
+                        help='Number of datagrams to (attempt to) send')
+    parser.add_argument('-r', '--records', required=False, type=int, default=20,
+                        help='Log records per datagram')
+    parser.add_argument('--drop-rate', required=False, type=float, default=0.0,
+                        help='Probability of skipping a datagram')
+    parser.add_argument('--interval', required=False, type=float, default=0.001,
+                        help='Seconds between datagrams')
+    parser.add_argument('--seed', required=False, type=int, default=None,
+                        help='Random seed, for repeatable runs')
+    pargs = parser.parse_args()
+
+    rng = random.Random(pargs.seed)
+    dictionary = synscanlog.load_dictionary()
+    msg_id = [name for name, _ in dictionary].index('MOTOR_POSITION')
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    dropped = 0
+    t_us = 0
+    for sequence in range(pargs.count):
+        records = []
+        for i in range(pargs.records):
+            t_us += 50
+            position = 0x800000 + sequence * pargs.records + i
+            records.append(synscanlog.encode_record(t_us, msg_id, 0, struct.pack('<iI', 1, position)))
+        datagram = synscanlog.encode_datagram(sequence, records)
+
+        if rng.random() < pargs.drop_rate:
+            dropped += 1
+        else:
+            sock.sendto(datagram, (pargs.host, pargs.port))
+        time.sleep(pargs.interval)
+
+    print('Sent %d datagram(s), deliberately dropped %d' % (pargs.count - dropped, dropped), file=sys.stderr)
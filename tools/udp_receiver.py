@@ -7,11 +7,17 @@ import socket
 import logging
 import argparse
 
+import synscanlog
+
 if __name__  == '__main__':
 
     parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.ArgumentDefaultsHelpFormatter)
     parser.add_argument('-p', '--port', required=False, type=int, default=6309,
                         help='UDP port to listen to for logging')
+    parser.add_argument('-d', '--dictionary', required=False, type=str, default=synscanlog.DEFAULT_DICTIONARY,
+                        help='LogMessages.hpp matching the firmware sending the logs')
+    parser.add_argument('-s', '--save', required=False, type=str, default=None,
+                        help='Also append the raw datagrams to this capture file (e.g. for trace_to_perfetto.py)')
     pargs = parser.parse_args()
 
     # Configure logging
@@ -21,6 +27,8 @@ if __name__  == '__main__':
     h.setFormatter(logging.Formatter("%(asctime)-15s %(levelname)s %(message)s"))
     logger.addHandler(h)
 
+    dictionary = synscanlog.load_dictionary(pargs.dictionary)
+
     UDP_IP  = '0.0.0.0'
     UDP_PORT = pargs.port
 
@@ -29,27 +37,59 @@ if __name__  == '__main__':
     sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
     sock.bind((UDP_IP, UDP_PORT))
 
-    while True:
-        data, addr = sock.recvfrom(1024)
-
-        try:
-            split_msg = data.decode('utf-8').split(' ')
-            level, msg = split_msg[0], ' '.join(split_msg[1:])
-
-            msg = '[%s:%s] %s' % (addr[0], addr[1], msg)
-
-            if 'DEBUG' in level:
-                logger.debug(msg)
-            if 'INFO' in level:
-                logger.info(msg)
-            if 'WARNING' in level:
-                logger.warning(msg)
-            if 'ERROR' in level:
-                logger.error(msg)
-            if 'CRITICAL' in level:
-                logger.critical(msg)
-        except:
+    capture = open(pargs.save, 'ab') if pargs.save else None
+
+    # Datagram sequence tracking, per sender
+    trackers = {}
+
+    try:
+        while True:
+            data, addr = sock.recvfrom(2048)
+            if capture:
+                synscanlog.write_capture(capture, data)
+                capture.flush()
+
+            # Binary log datagrams
             try:
-                logger.info(data.decode('utf-8'))
+                sequence, records = synscanlog.decode_datagram(data, dictionary)
+            except ValueError:
+                pass
+            else:
+                tracker = trackers.setdefault(addr, synscanlog.SequenceTracker())
+                missing = tracker.update(sequence)
+                if missing:
+                    logger.warning('[%s:%s] Lost %d datagram(s) before #%d (%s)'
+                                   % (addr[0], addr[1], missing, sequence, tracker.summary()))
+                for record in records:
+                    msg = '[%s:%s] [%.6f] %s' % (addr[0], addr[1], record.timestamp_us / 1e6, record.text)
+                    logger.log(getattr(logging, record.level), msg)
+                continue
+
+            # Plain text (older firmware)
+            try:
+                split_msg = data.decode('utf-8').split(' ')
+                level, msg = split_msg[0], ' '.join(split_msg[1:])
+
+                msg = '[%s:%s] %s' % (addr[0], addr[1], msg)
+
+                if 'DEBUG' in level:
+                    logger.debug(msg)
+                if 'INFO' in level:
+                    logger.info(msg)
+                if 'WARNING' in level:
+                    logger.warning(msg)
+                if 'ERROR' in level:
+                    logger.error(msg)
+                if 'CRITICAL' in level:
+                    logger.critical(msg)
             except:
-                logger.info(repr(data))
+                try:
+                    logger.info(data.decode('utf-8'))
+                except:
+                    logger.info(repr(data))
+    except KeyboardInterrupt:
+        for addr, tracker in trackers.items():
+            logger.info('[%s:%s] %s' % (addr[0], addr[1], tracker.summary()))
+    finally:
+        if capture:
+            capture.close()